@@ -1,29 +1,172 @@
 #include "app_dive.h"
+#include "dive_session.h"
+#include "dive_storage.h"
+#include "dive_space.h"
+#include "sensor_service.h"
 #include "touch_water.h"
+#include "app_jobs.h"
 #include "esp_log.h"
+#include "dlog.h"
+#include "trace.h"
+#include "metrics.h"
+#include "app_mem.h"
+#include "led_status.h"
+#include "telemetry.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <inttypes.h>
 
 static const char *TAG = "app_dive";
 
+#ifndef CONFIG_APP_DIVE_START_WINDOW_S
+#define CONFIG_APP_DIVE_START_WINDOW_S 60
+#endif
+
+#ifndef CONFIG_APP_LED_ASCENT_WARN_M_MIN
+#define CONFIG_APP_LED_ASCENT_WARN_M_MIN 10
+#endif
+
+static dive_session_t s_session;
+
+/* Motif LED selon la phase ; led_status_set ne réveille le moteur qu'au changement */
+static void dive_led_update(const dive_session_t *s)
+{
+    led_status_t st = LED_STATUS_OFF;
+    if (s->dive_open)
+        st = (s->state == DIVE_STATE_ASCENT && s->rate_m_min < -CONFIG_APP_LED_ASCENT_WARN_M_MIN)
+             ? LED_STATUS_ASCENT_WARN : LED_STATUS_DIVE;
+    led_status_set(st);
+}
+static volatile bool s_running = false;
+static volatile bool s_stop = false;        // app_dive_stop() : fermer et sortir
+static SemaphoreHandle_t s_exited;          // donné par la tâche juste avant sa fin
+
+#if CONFIG_APP_TELEMETRY
+/* Échantillon fusionné -> boîte d'envoi MQTT (non bloquant) */
+static void telemetry_tap(const dive_sample_t *smp, double depth_m, dive_state_t st, void *ctx)
+{
+    telemetry_sample_t t = {
+        .ts_us     = smp->timestamp,
+        .depth_m   = (float)depth_m,
+        .temp_c    = smp->temperature,
+        .press_bar = smp->pressure,
+        .state     = (uint8_t)st,
+    };
+    telemetry_push(&t);
+}
+#endif
+
 static void dive_task(void *arg)
 {
+    QueueHandle_t q = (QueueHandle_t)arg;
+    TRACE_TASK("dive");
+
+    // Détection eau/air sur interruption (événements TOUCH_WATER_EVENT)
+    esp_err_t te = touch_water_start_monitor();
+    if (te != ESP_OK) ESP_LOGW(TAG, "touch monitor: %s", esp_err_to_name(te));
     ESP_LOGI(TAG, "newDive start (baseline=%" PRIu32 ", thr=%" PRIu32 ")",
              touch_water_get_baseline(), touch_water_get_threshold());
-    for (int i=0; i<10; ++i) {
-        bool wet = touch_water_is_present();
-        uint32_t raw = touch_water_read_raw();
-        ESP_LOGI(TAG, "raw=%" PRIu32 " water=%s", raw, wet ? "YES" : "no");
-        vTaskDelay(pdMS_TO_TICKS(1000));
+
+    if (dive_storage_init() != ESP_OK) {
+        ESP_LOGE(TAG, "storage unavailable");
+        s_running = false;
+        app_jobs_done(APP_JOB_DIVE);
+        xSemaphoreGive(s_exited);
+        app_task_exit();
+    }
+    // les échantillons arrivent déjà (file de 16) : vérification seule, le GC
+    // a été fait par la maintenance de fin de plongée ou d'upload
+    esp_err_t re = dive_space_check(NULL);
+    if (re != ESP_OK) ESP_LOGW(TAG, "space: %s", esp_err_to_name(re));
+    dive_session_init(&s_session, NULL);
+#if CONFIG_APP_TELEMETRY
+    esp_err_t me = telemetry_start(NULL);
+    if (me == ESP_OK) s_session.tap = telemetry_tap;
+    else ESP_LOGW(TAG, "telemetry: %s", esp_err_to_name(me));
+#endif
+
+    const int64_t t0 = esp_timer_get_time();
+    sensor_sample_msg_t msg;
+    while (!s_stop) {
+        TRACE_BEGIN(TRACE_EV_BLOCK, 1000);
+        BaseType_t got = xQueueReceive(q, &msg, pdMS_TO_TICKS(1000));
+        TRACE_END(TRACE_EV_BLOCK, 0);
+        if (got == pdTRUE) {
+            TRACE_INSTANT(TRACE_EV_QUEUE_RECV, uxQueueMessagesWaiting(q));
+            app_jobs_progress(APP_JOB_DIVE);
+            esp_err_t e = dive_session_feed(&s_session, &msg.measure, esp_timer_get_time());
+            if (e != ESP_OK) DLOGW(TAG, "store: %s", esp_err_to_name(e));
+        }
+        int64_t now = esp_timer_get_time();
+        dive_session_tick(&s_session, now);
+        dive_led_update(&s_session);
+
+        // Pas de plongée confirmée dans la fenêtre de départ -> abandon
+        if (s_session.stats.dives == 0 && !dive_session_is_active(&s_session) &&
+            now - t0 >= (int64_t)CONFIG_APP_DIVE_START_WINDOW_S * 1000000LL) {
+            ESP_LOGI(TAG, "no dive detected within %ds", CONFIG_APP_DIVE_START_WINDOW_S);
+            break;
+        }
+        // Plongée(s) terminée(s) et intervalle de surface écoulé
+        if (s_session.stats.dives > 0 && !dive_session_is_active(&s_session)) break;
+    }
+    if (s_stop && s_session.dive_open) {
+        // arrêt demandé (échéance du job) : la plongée est close avant le sommeil
+        ESP_LOGW(TAG, "stop requested, closing %s", s_session.meta.id);
+        dive_session_abort(&s_session);
+    }
+
+    const dive_session_stats_t *st = &s_session.stats;
+    ESP_LOGI(TAG, "newDive done: dives=%" PRIu32 " in=%" PRIu32 " stored=%" PRIu32
+             " err=%" PRIu32 " lat avg=%lld max=%lld us",
+             st->dives, st->samples_in, st->samples_stored, st->store_errors,
+             (long long)(st->samples_live ? st->sum_latency_us / st->samples_live : 0),
+             (long long)st->max_latency_us);
+#if CONFIG_APP_TELEMETRY
+    s_session.tap = NULL;
+    telemetry_stop();
+#endif
+    metrics_log();
+    led_status_set(LED_STATUS_OFF);
+    touch_water_stop_monitor();
+    if (st->dives > 0) trace_dump(NULL);   // <FS>/trace.bin, écrasé à chaque plongée
+    if (st->dives > 0 && !s_stop) {
+        // plus d'échantillon à écrire : rétention et GC pour la prochaine plongée
+        app_jobs_progress(APP_JOB_DIVE);
+        dive_space_maintain(NULL);
+    }
+    s_running = false;
+    app_jobs_done(APP_JOB_DIVE);
+    xSemaphoreGive(s_exited);
+    app_task_exit();
+}
+
+esp_err_t app_dive_start(QueueHandle_t samples)
+{
+    if (!samples) return ESP_ERR_INVALID_ARG;
+    if (s_running) return ESP_ERR_INVALID_STATE;
+    APP_TASK_MEM(task_mem, 4096);
+    static bool accounted;
+    if (!accounted) { app_mem_account("app_dive", sizeof(s_session)); accounted = true; }
+    if (!s_exited) {
+        static StaticSemaphore_t exited_buf;
+        s_exited = xSemaphoreCreateBinaryStatic(&exited_buf);
     }
-    ESP_LOGI(TAG, "newDive done");
-    vTaskDelete(NULL);
+    xSemaphoreTake(s_exited, 0);
+    s_stop = false;
+    s_running = true;
+    esp_err_t e = app_task_create(dive_task, "dive", &task_mem, (void*)samples, APP_ROLE_STORAGE, NULL);
+    if (e != ESP_OK) s_running = false;
+    return e;
 }
 
-esp_err_t app_dive_start(void)
+void app_dive_stop(uint32_t timeout_ms)
 {
-    if (xTaskCreate(dive_task, "dive", 4096, NULL, 5, NULL) != pdPASS)
-        return ESP_ERR_NO_MEM;
-    return ESP_OK;
+    if (!s_running) return;
+    s_stop = true;
+    // la boucle relit s_stop au plus tard après 1 s sans échantillon
+    if (xSemaphoreTake(s_exited, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+        ESP_LOGE(TAG, "dive task did not stop within %u ms", (unsigned)timeout_ms);
 }
@@ -0,0 +1,300 @@
+#include "dive_session.h"
+#include "esp_log.h"
+#include "dlog.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <inttypes.h>
+
+static const char *TAG = "dive_session";
+
+/* Filets de sécurité si Kconfig absent */
+#ifndef CONFIG_APP_DIVE_START_DEPTH_CM
+#define CONFIG_APP_DIVE_START_DEPTH_CM 120
+#endif
+#ifndef CONFIG_APP_DIVE_END_DEPTH_CM
+#define CONFIG_APP_DIVE_END_DEPTH_CM 60
+#endif
+#ifndef CONFIG_APP_DIVE_START_CONFIRM_S
+#define CONFIG_APP_DIVE_START_CONFIRM_S 5
+#endif
+#ifndef CONFIG_APP_DIVE_END_CONFIRM_S
+#define CONFIG_APP_DIVE_END_CONFIRM_S 30
+#endif
+#ifndef CONFIG_APP_DIVE_SURFACE_INTERVAL_S
+#define CONFIG_APP_DIVE_SURFACE_INTERVAL_S 600
+#endif
+
+const char *dive_state_name(dive_state_t st)
+{
+    switch (st) {
+        case DIVE_STATE_SURFACE:          return "surface";
+        case DIVE_STATE_DESCENT:          return "descent";
+        case DIVE_STATE_BOTTOM:           return "bottom";
+        case DIVE_STATE_ASCENT:           return "ascent";
+        case DIVE_STATE_SAFETY_STOP:      return "safety_stop";
+        case DIVE_STATE_SURFACE_INTERVAL: return "surface_interval";
+        default:                          return "?";
+    }
+}
+
+void dive_session_default_cfg(dive_session_cfg_t *cfg)
+{
+    cfg->start_depth_cm      = CONFIG_APP_DIVE_START_DEPTH_CM;
+    cfg->end_depth_cm        = CONFIG_APP_DIVE_END_DEPTH_CM;
+    cfg->start_confirm_ms    = CONFIG_APP_DIVE_START_CONFIRM_S * 1000u;
+    cfg->end_confirm_ms      = CONFIG_APP_DIVE_END_CONFIRM_S * 1000u;
+    cfg->surface_interval_ms = CONFIG_APP_DIVE_SURFACE_INTERVAL_S * 1000u;
+    cfg->rate_cm_per_min     = 300;   // 3 m/min
+    cfg->safety_min_cm       = 300;
+    cfg->safety_max_cm       = 600;
+    cfg->temp_max_age_ms     = 3000;
+    cfg->ascent_window_ms    = 10000;
+}
+
+METRIC_COUNTER(s_m_stored, "dive.samples_stored");
+METRIC_HISTO(s_m_latency, "dive.sample_latency_us");
+
+void dive_session_init(dive_session_t *s, const dive_session_cfg_t *cfg)
+{
+    memset(s, 0, sizeof(*s));
+    if (cfg) s->cfg = *cfg;
+    else     dive_session_default_cfg(&s->cfg);
+    s->state = DIVE_STATE_SURFACE;
+    s->cand_since_us = -1;
+    metrics_register(&s_m_stored.m);
+    metrics_register(&s_m_latency.m);
+
+    // Décalage esp_timer -> epoch (0 si l'heure n'est pas réglée)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    s->epoch_offset_us = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec - esp_timer_get_time();
+}
+
+bool dive_session_is_active(const dive_session_t *s)
+{
+    return s->state != DIVE_STATE_SURFACE;
+}
+
+static void set_state(dive_session_t *s, dive_state_t st)
+{
+    if (s->state == st) return;
+    // appelé depuis feed() : log différé pour ne pas bloquer le chemin échantillon
+    DLOGI(TAG, "%s -> %s (depth=%.2f m, rate=%.1f m/min)",
+          dive_state_name(s->state), dive_state_name(st), s->depth_m, s->rate_m_min);
+    s->state = st;
+}
+
+/* ---------- Tampon pré-plongée ---------- */
+static void pre_push(dive_session_t *s, const dive_sample_t *smp)
+{
+    size_t idx = (s->pre_head + s->pre_n) % DIVE_SESSION_PRE_SAMPLES;
+    s->pre[idx] = *smp;
+    if (s->pre_n < DIVE_SESSION_PRE_SAMPLES) s->pre_n++;
+    else s->pre_head = (s->pre_head + 1) % DIVE_SESSION_PRE_SAMPLES;
+}
+
+/* Profondeur (eau de mer) depuis la pression absolue, comme sensor_ms5837 */
+static double depth_from_bar(double p_bar)
+{
+    double dp_pa = (p_bar - 1.013) * 1e5;
+    return (dp_pa > 0) ? dp_pa / (1029.0 * 9.80665) : 0.0;
+}
+
+/* ---------- Écriture ---------- */
+/* sensor_ts_us < 0 : échantillon rejoué (tampon pré-plongée), hors stats de latence */
+static esp_err_t store(dive_session_t *s, const dive_sample_t *smp, int64_t sensor_ts_us)
+{
+    esp_err_t e = dive_storage_append_sample(s->meta.id, smp);
+    if (e != ESP_OK) {
+        s->stats.store_errors++;
+        return e;
+    }
+    s->stats.samples_stored++;
+    metric_inc(&s_m_stored);
+    if (sensor_ts_us < 0) return ESP_OK;
+    int64_t lat = esp_timer_get_time() - sensor_ts_us;
+    s->stats.samples_live++;
+    s->stats.last_latency_us = lat;
+    s->stats.sum_latency_us += lat;
+    if (lat > s->stats.max_latency_us) s->stats.max_latency_us = lat;
+    metric_observe(&s_m_latency, (uint32_t)lat);
+    return ESP_OK;
+}
+
+/* cand_us : début de la fenêtre de confirmation ; le tampon pré-plongée peut
+ * contenir jusqu'à DIVE_SESSION_PRE_SAMPLES échantillons de surface avant */
+static esp_err_t open_dive(dive_session_t *s, int64_t ts_us, int64_t cand_us)
+{
+    memset(&s->meta, 0, sizeof(s->meta));
+    int64_t epoch_us = ts_us + s->epoch_offset_us;
+    time_t t = (time_t)(epoch_us / 1000000LL);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(s->meta.date, sizeof(s->meta.date), "%Y-%m-%dT%H:%M:%S", &tm);
+
+    // id unique même sans horloge réglée (epoch à 0 après un démarrage à froid)
+    esp_err_t e = dive_storage_new_id((int64_t)t, s->meta.id);
+    if (e == ESP_OK) e = dive_storage_create_dive(&s->meta);
+    if (e != ESP_OK) {
+        ESP_LOGE(TAG, "create %s failed: %s", s->meta.id, esp_err_to_name(e));
+        return e;
+    }
+    s->dive_open = true;
+    s->stats.dives++;
+    dive_stats_reset(&s->dstats, s->cfg.ascent_window_ms);
+    ESP_LOGI(TAG, "dive %s opened", s->meta.id);
+
+    // Vide le tampon pré-plongée (la descente n'est pas perdue) ; ce qui précède
+    // la fenêtre de confirmation est de la surface : enregistré, hors durée et moyennes
+    while (s->pre_n) {
+        dive_sample_t *p = &s->pre[s->pre_head];
+        int64_t ts = (int64_t)p->timestamp - s->epoch_offset_us;
+        (void)store(s, p, -1);
+        dive_stats_feed(&s->dstats, ts, depth_from_bar(p->pressure), p->temperature,
+                        ts < cand_us ? DIVE_STATE_SURFACE : DIVE_STATE_DESCENT);
+        s->pre_head = (s->pre_head + 1) % DIVE_SESSION_PRE_SAMPLES;
+        s->pre_n--;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t close_dive(dive_session_t *s)
+{
+    if (!s->dive_open) return ESP_OK;
+    s->dive_open = false;
+
+    // Résumé finalisé dans les métadonnées : pas de seconde passe sur data.csv
+    dive_stats_finalize(&s->dstats, &s->meta.summary);
+    s->meta.has_summary = true;
+    esp_err_t e = dive_storage_update_metadata(&s->meta);
+    if (e != ESP_OK) ESP_LOGW(TAG, "summary %s: %s", s->meta.id, esp_err_to_name(e));
+
+    ESP_LOGI(TAG, "dive %s closed: %us, max %.2f m, avg %.2f m, Tmin %.1f C, ascent max %.1f m/min",
+             s->meta.id, (unsigned)s->meta.summary.duration_s, s->meta.summary.max_depth_m,
+             s->meta.summary.avg_depth_m, s->meta.summary.min_temp_c,
+             s->meta.summary.max_ascent_m_min);
+    ESP_LOGI(TAG, "pipeline: %" PRIu32 " samples, max latency %lld us",
+             s->stats.samples_stored, (long long)s->stats.max_latency_us);
+    esp_err_t ce = dive_storage_close_dive(s->meta.id);
+    return (e != ESP_OK) ? e : ce;
+}
+
+/* Classe la phase à partir de la profondeur et de la vitesse verticale */
+static void classify(dive_session_t *s)
+{
+    const double thr   = s->cfg.rate_cm_per_min / 100.0;
+    const double d_cm  = s->depth_m * 100.0;
+    const bool in_band = d_cm >= s->cfg.safety_min_cm && d_cm <= s->cfg.safety_max_cm;
+
+    if (s->rate_m_min > thr) {
+        set_state(s, DIVE_STATE_DESCENT);
+    } else if (s->rate_m_min < -thr) {
+        set_state(s, DIVE_STATE_ASCENT);
+    } else if (in_band && (s->state == DIVE_STATE_ASCENT || s->state == DIVE_STATE_SAFETY_STOP)) {
+        set_state(s, DIVE_STATE_SAFETY_STOP);
+    } else {
+        set_state(s, DIVE_STATE_BOTTOM);
+    }
+}
+
+static esp_err_t step(dive_session_t *s, const dive_sample_t *smp, int64_t ts_us)
+{
+    const double d_cm = s->depth_m * 100.0;
+
+    if (!s->dive_open) {
+        if (d_cm >= s->cfg.start_depth_cm) {
+            if (s->cand_since_us < 0) s->cand_since_us = ts_us;
+            pre_push(s, smp);
+            if (ts_us - s->cand_since_us >= (int64_t)s->cfg.start_confirm_ms * 1000) {
+                int64_t cand_us = s->cand_since_us;
+                s->cand_since_us = -1;
+                // échec : on reste en surface (fenêtre de départ toujours active),
+                // nouvel essai après une autre confirmation
+                esp_err_t e = open_dive(s, ts_us, cand_us);
+                if (e == ESP_OK) set_state(s, DIVE_STATE_DESCENT);
+                return e;
+            }
+            return ESP_OK;
+        }
+        s->cand_since_us = -1;
+        pre_push(s, smp);
+        return dive_session_tick(s, ts_us);
+    }
+
+    esp_err_t e = store(s, smp, ts_us);
+    dive_stats_feed(&s->dstats, ts_us, s->depth_m, smp->temperature, s->state);
+
+    if (d_cm < s->cfg.end_depth_cm) {
+        if (s->cand_since_us < 0) s->cand_since_us = ts_us;
+        if (ts_us - s->cand_since_us >= (int64_t)s->cfg.end_confirm_ms * 1000) {
+            s->cand_since_us = -1;
+            s->surf_since_us = ts_us;
+            set_state(s, DIVE_STATE_SURFACE_INTERVAL);
+            esp_err_t ce = close_dive(s);
+            return (e != ESP_OK) ? e : ce;
+        }
+    } else {
+        s->cand_since_us = -1;
+    }
+    classify(s);
+    return e;
+}
+
+esp_err_t dive_session_feed(dive_session_t *s, const sensor_measure_t *m, int64_t now_us)
+{
+    if (!s || !m) return ESP_ERR_INVALID_ARG;
+    (void)now_us;
+    s->stats.samples_in++;
+
+    if (m->pressure_bar <= 0.0) {
+        // mesure température seule (TSYS01)
+        s->temp_c = m->temperature_c;
+        s->temp_us = (int64_t)m->ts_us;
+        s->have_temp = true;
+        return ESP_OK;
+    }
+
+    const int64_t ts = (int64_t)m->ts_us;
+    if (s->have_p && ts > s->last_p_us) {
+        double dt_min = (double)(ts - s->last_p_us) / 60e6;
+        double inst = (m->depth_m - s->depth_m) / dt_min;
+        s->rate_m_min = 0.7 * s->rate_m_min + 0.3 * inst;
+    }
+    s->depth_m = m->depth_m;
+    s->last_p_us = ts;
+    s->have_p = true;
+
+    // Fusion : température TSYS si récente, sinon celle du MS5837
+    bool fresh = s->have_temp && (ts - s->temp_us) <= (int64_t)s->cfg.temp_max_age_ms * 1000;
+    dive_sample_t smp = {
+        .timestamp   = (uint64_t)(ts + s->epoch_offset_us),
+        .temperature = (float)(fresh ? s->temp_c : m->temperature_c),
+        .pressure    = (float)m->pressure_bar,
+    };
+    if (s->tap) s->tap(&smp, s->depth_m, s->state, s->tap_ctx);
+    return step(s, &smp, ts);
+}
+
+esp_err_t dive_session_tick(dive_session_t *s, int64_t now_us)
+{
+    if (!s) return ESP_ERR_INVALID_ARG;
+    if (s->state == DIVE_STATE_SURFACE_INTERVAL &&
+        now_us - s->surf_since_us >= (int64_t)s->cfg.surface_interval_ms * 1000) {
+        set_state(s, DIVE_STATE_SURFACE);
+    }
+    return ESP_OK;
+}
+
+esp_err_t dive_session_abort(dive_session_t *s)
+{
+    if (!s) return ESP_ERR_INVALID_ARG;
+    esp_err_t e = close_dive(s);
+    s->cand_since_us = -1;
+    set_state(s, DIVE_STATE_SURFACE);
+    return e;
+}
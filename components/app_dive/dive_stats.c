@@ -0,0 +1,69 @@
+#include "dive_stats.h"
+#include "dive_session.h"
+#include <string.h>
+#include <float.h>
+
+void dive_stats_reset(dive_stats_t *st, uint32_t window_ms)
+{
+    memset(st, 0, sizeof(*st));
+    st->window_us  = (window_ms ? window_ms : 10000) * 1000u;
+    st->min_temp_c = DBL_MAX;
+    st->max_temp_c = -DBL_MAX;
+    st->last_phase = -1;
+}
+
+void dive_stats_feed(dive_stats_t *st, int64_t ts_us, double depth_m, double temp_c, int phase)
+{
+    if (!st->started && phase == DIVE_STATE_SURFACE) {
+        st->n++;
+        return;
+    }
+    if (!st->started) {
+        st->started = true;
+        st->first_us = ts_us;
+        st->win_start_us = ts_us;
+        st->win_start_depth_m = depth_m;
+    } else if (ts_us > st->last_us) {
+        int64_t dt = ts_us - st->last_us;
+        st->depth_integral += 0.5 * (st->last_depth_m + depth_m) * ((double)dt / 1e6);
+        if (st->last_phase >= 0 && st->last_phase < DIVE_STATS_PHASES)
+            st->phase_us[st->last_phase] += dt;
+    }
+
+    if (depth_m > st->max_depth_m) st->max_depth_m = depth_m;
+    if (temp_c < st->min_temp_c)   st->min_temp_c = temp_c;
+    if (temp_c > st->max_temp_c)   st->max_temp_c = temp_c;
+
+    // Fenêtre écoulée : vitesse moyenne de remontée sur la fenêtre
+    int64_t wdt = ts_us - st->win_start_us;
+    if (wdt >= (int64_t)st->window_us) {
+        double ascent = (st->win_start_depth_m - depth_m) / ((double)wdt / 60e6);
+        if (ascent > st->max_ascent_m_min) st->max_ascent_m_min = ascent;
+        st->win_start_us = ts_us;
+        st->win_start_depth_m = depth_m;
+    }
+
+    st->last_us = ts_us;
+    st->last_depth_m = depth_m;
+    st->last_phase = phase;
+    st->n++;
+}
+
+void dive_stats_finalize(const dive_stats_t *st, dive_summary_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (st->n == 0) return;
+
+    double dur_s = (double)(st->last_us - st->first_us) / 1e6;
+    out->samples            = st->n;
+    out->duration_s         = (uint32_t)(dur_s + 0.5);
+    out->max_depth_m        = (float)st->max_depth_m;
+    out->avg_depth_m        = (float)(dur_s > 0 ? st->depth_integral / dur_s : st->last_depth_m);
+    out->min_temp_c         = (float)st->min_temp_c;
+    out->max_temp_c         = (float)st->max_temp_c;
+    out->max_ascent_m_min   = (float)st->max_ascent_m_min;
+    out->descent_s          = (uint32_t)(st->phase_us[DIVE_STATE_DESCENT]     / 1000000);
+    out->bottom_s           = (uint32_t)(st->phase_us[DIVE_STATE_BOTTOM]      / 1000000);
+    out->ascent_s           = (uint32_t)(st->phase_us[DIVE_STATE_ASCENT]      / 1000000);
+    out->safety_stop_s      = (uint32_t)(st->phase_us[DIVE_STATE_SAFETY_STOP] / 1000000);
+}
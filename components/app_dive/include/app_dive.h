@@ -1,9 +1,20 @@
 #pragma once
+#include <stdint.h>
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
-esp_err_t app_dive_start(void);
+
+/** Démarre la tâche de plongée (job APP_JOB_DIVE : progression à chaque échantillon).
+ *  samples : queue de sensor_sample_msg_t publiée par sensor_service. */
+esp_err_t app_dive_start(QueueHandle_t samples);
+
+/** Demande l'arrêt de la tâche (plongée ouverte close) et attend sa fin,
+ *  au plus timeout_ms. Sans effet si elle ne tourne pas. */
+void      app_dive_stop(uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor.h"
+#include "dive_storage.h"
+#include "dive_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Phases d'une session de plongée */
+typedef enum {
+    DIVE_STATE_SURFACE = 0,        // en surface, aucune plongée ouverte
+    DIVE_STATE_DESCENT,
+    DIVE_STATE_BOTTOM,
+    DIVE_STATE_ASCENT,
+    DIVE_STATE_SAFETY_STOP,
+    DIVE_STATE_SURFACE_INTERVAL,   // plongée fermée, on attend une éventuelle reprise
+} dive_state_t;
+
+/* Seuils de détection (profondeurs en cm, durées en ms) */
+typedef struct {
+    uint32_t start_depth_cm;       // profondeur d'entrée (hystérésis haute)
+    uint32_t end_depth_cm;         // profondeur de sortie (hystérésis basse)
+    uint32_t start_confirm_ms;     // durée sous start_depth avant d'ouvrir la plongée
+    uint32_t end_confirm_ms;       // durée au-dessus de end_depth avant de la fermer
+    uint32_t surface_interval_ms;  // durée de l'intervalle de surface avant fin de session
+    uint32_t rate_cm_per_min;      // vitesse verticale distinguant descente/fond/remontée
+    uint32_t safety_min_cm;        // bande du palier de sécurité
+    uint32_t safety_max_cm;
+    uint32_t temp_max_age_ms;      // âge max d'une température TSYS pour la fusion
+    uint32_t ascent_window_ms;     // fenêtre de calcul de la vitesse de remontée max
+} dive_session_cfg_t;
+
+/* Statistiques du chemin capteur -> flash */
+typedef struct {
+    uint32_t samples_in;           // mesures reçues
+    uint32_t samples_stored;       // échantillons fusionnés écrits
+    uint32_t samples_live;         // dont écrits en direct (base des stats de latence)
+    uint32_t store_errors;
+    uint32_t dives;                // plongées ouvertes dans la session
+    int64_t  last_latency_us;      // mesure -> append terminé
+    int64_t  max_latency_us;
+    int64_t  sum_latency_us;
+} dive_session_stats_t;
+
+/* Taille du tampon pré-plongée (échantillons gardés pendant la confirmation) */
+#define DIVE_SESSION_PRE_SAMPLES 16
+
+typedef struct {
+    dive_session_cfg_t   cfg;
+    dive_state_t         state;
+    dive_metadata_t      meta;           // plongée courante (valide si dive_open)
+    bool                 dive_open;
+
+    // dernière mesure de pression fusionnée
+    double               depth_m;
+    double               rate_m_min;     // >0 = descente
+    int64_t              last_p_us;
+    bool                 have_p;
+
+    // dernière température TSYS (prioritaire sur celle du MS5837)
+    double               temp_c;
+    int64_t              temp_us;
+    bool                 have_temp;
+
+    int64_t              cand_since_us;  // début de la condition d'hystérésis, -1 si aucune
+    int64_t              surf_since_us;  // début de l'intervalle de surface
+
+    int64_t              epoch_offset_us; // esp_timer -> epoch
+
+    dive_sample_t        pre[DIVE_SESSION_PRE_SAMPLES];
+    size_t               pre_head, pre_n;
+
+    dive_session_stats_t stats;
+    dive_stats_t         dstats;         // résumé de la plongée courante
+
+    // observateur optionnel de chaque échantillon fusionné (télémétrie), appelé
+    // depuis feed() avant la détection : doit rester non bloquant
+    void                (*tap)(const dive_sample_t *smp, double depth_m, dive_state_t st, void *ctx);
+    void                 *tap_ctx;
+} dive_session_t;
+
+/** Remplit cfg avec les valeurs Kconfig (ou les défauts) */
+void dive_session_default_cfg(dive_session_cfg_t *cfg);
+
+/** Initialise la session (cfg NULL = défauts) */
+void dive_session_init(dive_session_t *s, const dive_session_cfg_t *cfg);
+
+/** Injecte une mesure capteur (pression et/ou température).
+ *  now_us : horloge esp_timer au moment du traitement. */
+esp_err_t dive_session_feed(dive_session_t *s, const sensor_measure_t *m, int64_t now_us);
+
+/** Fait avancer les temporisations sans nouvelle mesure */
+esp_err_t dive_session_tick(dive_session_t *s, int64_t now_us);
+
+/** Ferme la plongée en cours s'il y en a une (arrêt forcé) */
+esp_err_t dive_session_abort(dive_session_t *s);
+
+/** True tant qu'une plongée est ouverte ou qu'on est en intervalle de surface */
+bool dive_session_is_active(const dive_session_t *s);
+
+const char *dive_state_name(dive_state_t st);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "dive_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Nombre de phases suivies (= valeurs de dive_state_t) */
+#define DIVE_STATS_PHASES 6
+
+/** Accumulateur en mémoire constante, alimenté à chaque échantillon de plongée */
+typedef struct {
+    uint32_t n;
+    bool     started;              // premier échantillon hors surface vu (début de la durée)
+    int64_t  first_us, last_us;
+    double   last_depth_m;
+    int      last_phase;
+
+    double   depth_integral;       // m·s (trapèzes) pour la moyenne pondérée
+    double   max_depth_m;
+    double   min_temp_c, max_temp_c;
+
+    // vitesse de remontée sur fenêtre glissante (tumbling)
+    uint32_t window_us;
+    int64_t  win_start_us;
+    double   win_start_depth_m;
+    double   max_ascent_m_min;
+
+    int64_t  phase_us[DIVE_STATS_PHASES];
+} dive_stats_t;
+
+/** Remet à zéro l'accumulateur (window_ms : fenêtre de calcul de la vitesse) */
+void dive_stats_reset(dive_stats_t *st, uint32_t window_ms);
+
+/** Ajoute un échantillon (phase = dive_state_t courant). Un échantillon
+ *  DIVE_STATE_SURFACE d'avant la plongée (tampon pré-plongée) est compté dans
+ *  samples mais reste hors durée, moyenne, phases et températures */
+void dive_stats_feed(dive_stats_t *st, int64_t ts_us, double depth_m, double temp_c, int phase);
+
+/** Produit le résumé final (sans modifier l'accumulateur) */
+void dive_stats_finalize(const dive_stats_t *st, dive_summary_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+#include "app_jobs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "app_mem.h"
+
+static const char *TAG = "app_jobs";
+
+#define DONE_BIT(j)  ((EventBits_t)1 << (j))
+#define PROG_BIT(j)  ((EventBits_t)1 << (8 + (j)))
+
+static const char *const s_names[APP_JOB_MAX] = { "dive", "upload" };
+
+typedef struct {
+    bool     active;
+    uint32_t deadline_ms;
+    int64_t  last_us;       // dernier begin/progress
+} job_t;
+
+static EventGroupHandle_t s_eg = NULL;
+static job_t s_jobs[APP_JOB_MAX];
+
+esp_err_t app_jobs_init(void)
+{
+    if (s_eg) return ESP_OK;
+#if CONFIG_APP_STATIC_ALLOC
+    static StaticEventGroup_t eg_buf;
+    s_eg = xEventGroupCreateStatic(&eg_buf);
+    app_mem_account("app_jobs", sizeof(eg_buf) + sizeof(s_jobs));
+#else
+    s_eg = xEventGroupCreate();
+#endif
+    return s_eg ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void app_jobs_begin(app_job_t job, uint32_t deadline_s)
+{
+    if (job >= APP_JOB_MAX || app_jobs_init() != ESP_OK) return;
+    xEventGroupClearBits(s_eg, DONE_BIT(job) | PROG_BIT(job));
+    s_jobs[job].deadline_ms = deadline_s * 1000u;
+    s_jobs[job].last_us = esp_timer_get_time();
+    s_jobs[job].active = true;
+}
+
+void app_jobs_progress(app_job_t job)
+{
+    if (job < APP_JOB_MAX && s_eg) xEventGroupSetBits(s_eg, PROG_BIT(job));
+}
+
+void app_jobs_done(app_job_t job)
+{
+    if (job < APP_JOB_MAX && s_eg) xEventGroupSetBits(s_eg, DONE_BIT(job));
+}
+
+bool app_jobs_wait_all(void)
+{
+    bool all_ok = true;
+    if (!s_eg) return true;
+
+    while (1) {
+        EventBits_t wait_mask = 0;
+        int64_t now = esp_timer_get_time();
+        int64_t next_ms = -1;    // -1 : pas d'échéance
+
+        for (int j = 0; j < APP_JOB_MAX; ++j) {
+            job_t *jb = &s_jobs[j];
+            if (!jb->active) continue;
+            if (jb->deadline_ms) {
+                int64_t left = jb->deadline_ms - (now - jb->last_us) / 1000;
+                if (left <= 0) {
+                    ESP_LOGW(TAG, "%s: no progress for %u s -> abandoned",
+                             s_names[j], (unsigned)(jb->deadline_ms / 1000));
+                    jb->active = false;
+                    all_ok = false;
+                    continue;
+                }
+                if (next_ms < 0 || left < next_ms) next_ms = left;
+            }
+            wait_mask |= DONE_BIT(j) | PROG_BIT(j);
+        }
+        if (!wait_mask) return all_ok;
+
+        TickType_t to = (next_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(next_ms) + 1;
+        EventBits_t bits = xEventGroupWaitBits(s_eg, wait_mask, pdFALSE, pdFALSE, to);
+
+        now = esp_timer_get_time();
+        for (int j = 0; j < APP_JOB_MAX; ++j) {
+            if (!s_jobs[j].active) continue;
+            if (bits & PROG_BIT(j)) {
+                xEventGroupClearBits(s_eg, PROG_BIT(j));
+                s_jobs[j].last_us = now;
+            }
+            if (bits & DONE_BIT(j)) {
+                ESP_LOGI(TAG, "%s done", s_names[j]);
+                s_jobs[j].active = false;
+            }
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Orchestrateur : les tâches applicatives signalent progression et fin via un event group,
+ * app_main dort dès que le dernier job se termine (ou que son échéance expire). */
+
+typedef enum {
+    APP_JOB_DIVE = 0,
+    APP_JOB_UPLOAD,
+    APP_JOB_MAX
+} app_job_t;
+
+/** Crée l'event group (idempotent) */
+esp_err_t app_jobs_init(void);
+
+/** Déclare un job lancé. deadline_s : délai max sans progression (0 = aucun) */
+void app_jobs_begin(app_job_t job, uint32_t deadline_s);
+
+/** Signale une progression : repousse l'échéance du job */
+void app_jobs_progress(app_job_t job);
+
+/** Signale la fin du job (à appeler avant vTaskDelete) */
+void app_jobs_done(app_job_t job);
+
+/** Bloque jusqu'à la fin de tous les jobs lancés.
+ *  @return true si tous ont terminé, false si au moins une échéance a expiré */
+bool app_jobs_wait_all(void);
+
+#ifdef __cplusplus
+}
+#endif
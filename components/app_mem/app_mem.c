@@ -0,0 +1,240 @@
+#include "app_mem.h"
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+
+static const char *TAG = "app_mem";
+
+#define APP_MEM_MAX_TASKS 12
+#define APP_MEM_MAX_BLOCKS 16
+
+#ifndef CONFIG_APP_TASK_PLAN
+#define CONFIG_APP_TASK_PLAN 0
+#endif
+#ifndef CONFIG_APP_CORE_SAMPLING
+#define CONFIG_APP_CORE_SAMPLING 1
+#endif
+#ifndef CONFIG_APP_CORE_IO
+#define CONFIG_APP_CORE_IO 0
+#endif
+#ifndef CONFIG_APP_PRIO_SAMPLING
+#define CONFIG_APP_PRIO_SAMPLING 10
+#endif
+#ifndef CONFIG_APP_PRIO_STORAGE
+#define CONFIG_APP_PRIO_STORAGE 6
+#endif
+#ifndef CONFIG_APP_PRIO_NET
+#define CONFIG_APP_PRIO_NET 4
+#endif
+#ifndef CONFIG_APP_PRIO_MONITOR
+#define CONFIG_APP_PRIO_MONITOR 3
+#endif
+
+typedef struct {
+    UBaseType_t prio;
+    BaseType_t  core;
+} app_plan_t;
+
+#if CONFIG_APP_TASK_PLAN && !CONFIG_FREERTOS_UNICORE
+static const app_plan_t s_plan[APP_ROLE_MAX] = {
+    [APP_ROLE_SAMPLING]   = { CONFIG_APP_PRIO_SAMPLING, CONFIG_APP_CORE_SAMPLING },
+    [APP_ROLE_STORAGE]    = { CONFIG_APP_PRIO_STORAGE,  CONFIG_APP_CORE_IO },
+    [APP_ROLE_NET]        = { CONFIG_APP_PRIO_NET,      CONFIG_APP_CORE_IO },
+    [APP_ROLE_MONITOR]    = { CONFIG_APP_PRIO_MONITOR,  CONFIG_APP_CORE_IO },
+    [APP_ROLE_BACKGROUND] = { tskIDLE_PRIORITY + 1,     CONFIG_APP_CORE_IO },
+};
+#else
+/* Historique : tout à 5 sans affinité (référence pour les mesures de gigue) */
+static const app_plan_t s_plan[APP_ROLE_MAX] = {
+    [APP_ROLE_SAMPLING]   = { 5, tskNO_AFFINITY },
+    [APP_ROLE_STORAGE]    = { 5, tskNO_AFFINITY },
+    [APP_ROLE_NET]        = { 5, tskNO_AFFINITY },
+    [APP_ROLE_MONITOR]    = { 4, tskNO_AFFINITY },
+    [APP_ROLE_BACKGROUND] = { tskIDLE_PRIORITY + 1, tskNO_AFFINITY },
+};
+#endif
+
+/* Tâches suivies : marge minimale relevée à la sortie (ou à la lecture si vivante) */
+typedef struct {
+    const char  *name;
+    TaskHandle_t handle;          // NULL une fois la tâche supprimée
+    bool         exited;          // statique : sortie, suspendue en attente de suppression
+    uint32_t     stack_size;
+    uint32_t     hwm;             // marge minimale observée (UINT32_MAX = jamais relevée)
+    bool         is_static;
+    app_task_role_t role;
+} app_task_rec_t;
+
+typedef struct {
+    const char *component;
+    size_t      bytes;
+} app_block_rec_t;
+
+static app_task_rec_t  s_tasks[APP_MEM_MAX_TASKS];
+static uint32_t        s_ntasks;
+static app_block_rec_t s_blocks[APP_MEM_MAX_BLOCKS];
+static uint32_t        s_nblocks;
+static bool            s_blocks_lock;   // appels rares : simple verrou tournant
+static bool            s_tasks_lock;
+
+/* Entrées publiées : remplies avant que s_ntasks ne les compte */
+static uint32_t task_count(void)
+{
+    return __atomic_load_n(&s_ntasks, __ATOMIC_ACQUIRE);
+}
+
+/* Entrée d'une instance précédente du même nom, sinon nouvelle entrée remplie
+ * puis publiée : la tâche peut appeler app_task_exit() avant le retour de la
+ * création (priorité plus haute que le créateur). *fresh = nouvelle entrée */
+static app_task_rec_t *task_claim(const char *name, const app_task_mem_t *mem,
+                                  app_task_role_t role, bool *fresh)
+{
+    app_task_rec_t *r = NULL;
+    *fresh = false;
+    while (__atomic_test_and_set(&s_tasks_lock, __ATOMIC_ACQUIRE)) {}
+    uint32_t n = s_ntasks;
+    for (uint32_t i = 0; i < n; ++i)
+        if (!strcmp(s_tasks[i].name, name)) { r = &s_tasks[i]; break; }
+    if (!r && n < APP_MEM_MAX_TASKS) {
+        r = &s_tasks[n];
+        *r = (app_task_rec_t){
+            .name = name, .hwm = UINT32_MAX, .is_static = (mem->stack != NULL),
+            .stack_size = mem->stack_size, .role = role,
+        };
+        __atomic_store_n(&s_ntasks, n + 1, __ATOMIC_RELEASE);
+        *fresh = true;
+    }
+    __atomic_clear(&s_tasks_lock, __ATOMIC_RELEASE);
+    return r;
+}
+
+void app_task_plan(app_task_role_t role, UBaseType_t *prio, BaseType_t *core)
+{
+    const app_plan_t *p = &s_plan[role < APP_ROLE_MAX ? role : APP_ROLE_BACKGROUND];
+    if (prio) *prio = p->prio;
+    if (core) *core = p->core;
+}
+
+esp_err_t app_task_create(TaskFunction_t fn, const char *name, const app_task_mem_t *mem,
+                          void *arg, app_task_role_t role, TaskHandle_t *out)
+{
+    UBaseType_t prio;
+    BaseType_t core;
+    app_task_plan(role, &prio, &core);
+
+    // Suivi : entrée prête avant la création (NULL si la table est pleine)
+    bool fresh;
+    app_task_rec_t *r = task_claim(name, mem, role, &fresh);
+
+    TaskHandle_t h = NULL;
+#if CONFIG_APP_STATIC_ALLOC
+    if (mem->stack && mem->tcb) {
+        // une pile statique ne sert qu'à une instance à la fois
+        if (r && r->handle) {
+            if (!__atomic_load_n(&r->exited, __ATOMIC_ACQUIRE)) return ESP_ERR_INVALID_STATE;
+            // Instance précédente sortie : une fois suspendue, vTaskDelete() depuis
+            // une autre tâche libère son TCB tout de suite (pas d'attente de l'idle)
+            while (eTaskGetState(r->handle) != eSuspended) vTaskDelay(1);
+            vTaskDelete(r->handle);
+            r->handle = NULL;
+            r->exited = false;
+        }
+        h = xTaskCreateStaticPinnedToCore(fn, name, mem->stack_size, arg, prio,
+                                          mem->stack, mem->tcb, core);
+        if (!h) return ESP_FAIL;
+        // la tâche a pu déjà sortir (trouvée par son nom) : même handle, suspendue
+        if (r) __atomic_store_n(&r->handle, h, __ATOMIC_RELEASE);
+        if (fresh) app_mem_account(name, mem->stack_size * sizeof(StackType_t) + sizeof(StaticTask_t));
+    } else
+#endif
+    {
+        // handle écrit par FreeRTOS avant que la tâche ne soit prête : jamais
+        // republié ici après un vTaskDelete(NULL) (TCB libéré)
+        TaskHandle_t *slot = r ? &r->handle : &h;
+        if (xTaskCreatePinnedToCore(fn, name, mem->stack_size, arg, prio, slot, core) != pdPASS)
+            return ESP_ERR_NO_MEM;
+        if (r) h = __atomic_load_n(&r->handle, __ATOMIC_ACQUIRE);   // NULL : déjà sortie
+    }
+    if (out) *out = h;
+    return ESP_OK;
+}
+
+static void task_sample(app_task_rec_t *r)
+{
+    if (!r->handle) return;
+    uint32_t m = (uint32_t)uxTaskGetStackHighWaterMark(r->handle);
+    if (m < r->hwm) r->hwm = m;
+}
+
+void app_task_exit(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    app_task_rec_t *r = NULL;
+    uint32_t n = task_count();
+    for (uint32_t i = 0; i < n && !r; ++i)
+        if (__atomic_load_n(&s_tasks[i].handle, __ATOMIC_ACQUIRE) == self) r = &s_tasks[i];
+#if CONFIG_APP_STATIC_ALLOC
+    // création statique pas encore revenue (handle rendu au retour) : par le nom,
+    // tronqué par FreeRTOS à configMAX_TASK_NAME_LEN
+    const char *me = pcTaskGetName(NULL);
+    for (uint32_t i = 0; i < n && !r; ++i)
+        if (s_tasks[i].is_static && !strncmp(s_tasks[i].name, me, configMAX_TASK_NAME_LEN - 1))
+            r = &s_tasks[i];
+#endif
+    if (r) {
+        __atomic_store_n(&r->handle, self, __ATOMIC_RELEASE);
+        task_sample(r);
+    }
+#if CONFIG_APP_STATIC_ALLOC
+    if (r && r->is_static) {
+        // vTaskDelete(NULL) laisse le TCB à l'idle : pile et TCB statiques seraient
+        // réutilisés avant d'être rendus. La tâche se suspend, le prochain
+        // app_task_create() du même nom la supprime avant de les reprendre.
+        __atomic_store_n(&r->exited, true, __ATOMIC_RELEASE);
+        for (;;) vTaskSuspend(NULL);
+    }
+#endif
+    if (r) __atomic_store_n(&r->handle, NULL, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+    for (;;) {}   // jamais atteint
+}
+
+void app_mem_account(const char *component, size_t bytes)
+{
+    while (__atomic_test_and_set(&s_blocks_lock, __ATOMIC_ACQUIRE)) {}
+    uint32_t i = 0;
+    while (i < s_nblocks && strcmp(s_blocks[i].component, component)) ++i;
+    if (i < s_nblocks) {
+        s_blocks[i].bytes += bytes;
+    } else if (s_nblocks < APP_MEM_MAX_BLOCKS) {
+        s_blocks[i].component = component;
+        s_blocks[i].bytes = bytes;
+        s_nblocks++;
+    }
+    __atomic_clear(&s_blocks_lock, __ATOMIC_RELEASE);
+}
+
+void app_mem_report(void)
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < s_nblocks; ++i) {
+        ESP_LOGI(TAG, "static %-16s %6u B", s_blocks[i].component, (unsigned)s_blocks[i].bytes);
+        total += s_blocks[i].bytes;
+    }
+    ESP_LOGI(TAG, "static total %u B (%s)", (unsigned)total,
+             CONFIG_APP_STATIC_ALLOC ? "static alloc" : "heap alloc");
+
+    uint32_t n = task_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        app_task_rec_t *r = &s_tasks[i];
+        task_sample(r);
+        if (r->hwm == UINT32_MAX) continue;
+        UBaseType_t prio;
+        BaseType_t core;
+        app_task_plan(r->role, &prio, &core);
+        ESP_LOGI(TAG, "task %-14s stack %5" PRIu32 " min free %5" PRIu32 " prio %u core %s (%s%s)",
+                 r->name, r->stack_size, r->hwm, (unsigned)prio,
+                 core == tskNO_AFFINITY ? "any" : (core ? "1" : "0"),
+                 r->is_static ? "static" : "heap", r->handle && !r->exited ? ", running" : "");
+    }
+}
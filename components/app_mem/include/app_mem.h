@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Mode allocation statique (CONFIG_APP_STATIC_ALLOC) : piles, TCB, queues,
+ * mutex et objets des composants sont réservés dans .bss, le tas n'est plus
+ * sollicité par le pipeline après le boot. Sans l'option : allocation dynamique
+ * comme avant. Dans les deux modes, les tâches créées ici sont suivies pour le
+ * rapport de marge de pile. */
+
+#ifndef CONFIG_APP_STATIC_ALLOC
+#define CONFIG_APP_STATIC_ALLOC 0
+#endif
+
+typedef struct {
+    StackType_t  *stack;
+    StaticTask_t *tcb;
+    uint32_t      stack_size;     // unité de xTaskCreate (octets sous ESP-IDF)
+} app_task_mem_t;
+
+/* Réserve la pile et le TCB d'une tâche (rien en mode dynamique) */
+#if CONFIG_APP_STATIC_ALLOC
+#define APP_TASK_MEM(var, size)                                         \
+    static StackType_t  var##_stack[size];                              \
+    static StaticTask_t var##_tcb;                                      \
+    static const app_task_mem_t var = { var##_stack, &var##_tcb, (size) }
+#else
+#define APP_TASK_MEM(var, size) \
+    static const app_task_mem_t var = { NULL, NULL, (size) }
+#endif
+
+/* Plan de placement (CONFIG_APP_TASK_PLAN) : l'échantillonnage (poll + I²C) a
+ * son cœur et la priorité haute, stockage/réseau/export/log partagent l'autre
+ * avec la pile Wi-Fi. Sans l'option : pas d'affinité, priorités historiques. */
+typedef enum {
+    APP_ROLE_SAMPLING = 0,      // sensor_poll
+    APP_ROLE_STORAGE,           // consommateur queue -> dive_storage
+    APP_ROLE_NET,               // upload, export
+    APP_ROLE_MONITOR,           // moniteur tactile
+    APP_ROLE_BACKGROUND,        // vidange dlog
+    APP_ROLE_MAX
+} app_task_role_t;
+
+/** Priorité et cœur (tskNO_AFFINITY possible) du rôle selon le plan courant */
+void app_task_plan(app_task_role_t role, UBaseType_t *prio, BaseType_t *core);
+
+/** Création selon le mode (statique/tas) et le plan du rôle. La tâche est suivie (rapport). */
+esp_err_t app_task_create(TaskFunction_t fn, const char *name, const app_task_mem_t *mem,
+                          void *arg, app_task_role_t role, TaskHandle_t *out);
+
+/** Fin de tâche : relève la marge de pile finale puis vTaskDelete(NULL). Tâche
+ *  statique : se suspend, supprimée par la création suivante (pile/TCB rendus) */
+void app_task_exit(void) __attribute__((noreturn));
+
+/** Comptabilise un bloc statique (octets) pour le rapport par composant */
+void app_mem_account(const char *component, size_t bytes);
+
+/** Rapport : empreinte statique par composant + marge de pile minimale par tâche (+ cœur) */
+void app_mem_report(void);
+
+#ifdef __cplusplus
+}
+#endif
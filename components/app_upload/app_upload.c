@@ -1,8 +1,18 @@
 #include "app_upload.h"
 #include "wifi_net.h"
-#include "esp_http_client.h"
+#include "app_jobs.h"
+#include "upload_http.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "app_mem.h"
+#include "led_status.h"
+#include "dive_sync.h"
+#include "dive_space.h"
+#include "pull_server.h"
+#include "cJSON.h"
 #include "esp_log.h"
 #include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "app_upload";
 
@@ -10,33 +20,114 @@ static const char *TAG = "app_upload";
 #define CONFIG_APP_UPLOAD_URL "http://example.com/api/dives/upload"
 #endif
 
+// booléen Kconfig : absent quand il vaut n
+#if CONFIG_APP_UPLOAD_KEEP_ALIVE
+#define UPLOAD_KEEP_ALIVE true
+#else
+#define UPLOAD_KEEP_ALIVE false
+#endif
+
+#ifndef CONFIG_APP_SYNC_URL
+#define CONFIG_APP_SYNC_URL "http://example.com/api/dives/sync"
+#endif
+
+#ifndef CONFIG_APP_PULL_IDLE_S
+#define CONFIG_APP_PULL_IDLE_S 30
+#endif
+
+METRIC_GAUGE(s_m_radio, "upload.radio_ms");   // fenêtre radio du dernier passage
+
+/* Corps de la requête : identification + snapshot des métriques de santé */
+static char *build_body(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+    cJSON_AddStringToObject(root, "device", "esp32-s3");
+    cJSON_AddStringToObject(root, "action", "upload_dives");
+    cJSON *m = metrics_to_json();
+    if (m) cJSON_AddItemToObject(root, "metrics", m);
+    char *txt = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return txt;
+}
+
+#if CONFIG_APP_PULL_SERVER
+/* Fenêtre de téléchargement après la synchro : le serveur, ouvert dès la connexion,
+ * reste ouvert tant qu'un poste l'interroge */
+static void serve_pull(void)
+{
+    int64_t seen = esp_timer_get_time();
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+        int64_t last = pull_server_last_request_us();
+        if (last > seen) {
+            seen = last;
+            app_jobs_progress(APP_JOB_UPLOAD);
+        }
+        if (esp_timer_get_time() - seen > (int64_t)CONFIG_APP_PULL_IDLE_S * 1000000) break;
+    }
+}
+#endif
+
 static void upload_task(void *arg)
 {
     ESP_LOGI(TAG, "upload start");
+    led_status_progress(0);
+    led_status_set(LED_STATUS_UPLOAD);
+    metrics_register(&s_m_radio.m);
+    dive_sync_stats_t st = { 0 };
+    int64_t t_radio = esp_timer_get_time();   // radio allumée de connect à stop
     if (wifi_net_connect(10000) == ESP_OK)
     {
-        const char *json = "{\"device\":\"esp32-s3\",\"action\":\"upload_dives\"}";
-        esp_http_client_config_t cfg = {.url = CONFIG_APP_UPLOAD_URL, .timeout_ms = 8000};
-        esp_http_client_handle_t cli = esp_http_client_init(&cfg);
-        if (cli)
+        app_jobs_progress(APP_JOB_UPLOAD);
+#if CONFIG_APP_PULL_SERVER
+        // un poste peut tirer les plongées sans attendre la fin de la synchro
+        esp_err_t pe = pull_server_start();
+        if (pe != ESP_OK) ESP_LOGW(TAG, "pull server: %s", esp_err_to_name(pe));
+#endif
+        // une connexion pour tout le passage : plongées d'abord (reprise au curseur), puis l'état de santé
+        upload_session_begin(UPLOAD_KEEP_ALIVE);
+        if (CONFIG_APP_SYNC_URL[0]) {
+            esp_err_t se = dive_sync_run(CONFIG_APP_SYNC_URL, &st);
+            if (se != ESP_OK) ESP_LOGW(TAG, "sync: %s (resumes next dock)", esp_err_to_name(se));
+            app_jobs_progress(APP_JOB_UPLOAD);
+        } else {
+            ESP_LOGI(TAG, "no sync URL, sync skipped");
+        }
+
+        char *json = CONFIG_APP_UPLOAD_URL[0] ? build_body() : NULL;
+        if (json)
         {
-            esp_http_client_set_method(cli, HTTP_METHOD_POST);
-            esp_http_client_set_header(cli, "Content-Type", "application/json");
-            esp_http_client_set_post_field(cli, json, strlen(json));
-            esp_err_t err = esp_http_client_perform(cli);
-            int st = esp_http_client_get_status_code(cli);
-            ESP_LOGI(TAG, "HTTP: err=%s status=%d", esp_err_to_name(err), st);
-            esp_http_client_cleanup(cli);
+            upload_req_t r = { .url = CONFIG_APP_UPLOAD_URL, .enc = upload_default_encoding(),
+                               .body = json, .len = strlen(json) };
+            esp_err_t err = upload_post(&r, &st.http);
+            ESP_LOGI(TAG, "HTTP: err=%s status=%d", esp_err_to_name(err), r.status);
+            led_status_progress(100);
         }
+        free(json);
+        upload_session_end();
+#if CONFIG_APP_PULL_SERVER
+        if (pe == ESP_OK) {
+            serve_pull();
+            pull_server_stop();
+        }
+#endif
     }
     wifi_net_stop();
+    uint32_t radio_ms = (uint32_t)((esp_timer_get_time() - t_radio) / 1000);
+    metric_set(&s_m_radio, (int32_t)radio_ms);
+    upload_stats_log("upload", &st.http, radio_ms);
+    // entre deux plongées, radio coupée : rétention et GC pour la prochaine plongée
+    app_jobs_progress(APP_JOB_UPLOAD);
+    dive_space_maintain(NULL);
     ESP_LOGI(TAG, "upload done");
-    vTaskDelete(NULL);
+    led_status_set(LED_STATUS_OFF);
+    app_jobs_done(APP_JOB_UPLOAD);
+    app_task_exit();
 }
 
 esp_err_t app_upload_start(void)
 {
-    if (xTaskCreate(upload_task, "upload", 8192, NULL, 5, NULL) != pdPASS)
-        return ESP_ERR_NO_MEM;
-    return ESP_OK;
+    APP_TASK_MEM(task_mem, 8192);
+    return app_task_create(upload_task, "upload", &task_mem, NULL, APP_ROLE_NET, NULL);
 }
@@ -0,0 +1,333 @@
+#include "dive_sync.h"
+#include "dive_storage.h"
+#include "wifi_net.h"
+#include "led_status.h"
+#include "app_jobs.h"
+#include "metrics.h"
+#include "upload_http.h"
+#include "sync_codec.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+static const char *TAG = "dive_sync";
+
+#ifndef CONFIG_APP_SYNC_CHUNK_SAMPLES
+#define CONFIG_APP_SYNC_CHUNK_SAMPLES 256
+#endif
+#ifndef CONFIG_APP_SYNC_MAX_RETRIES
+#define CONFIG_APP_SYNC_MAX_RETRIES 5
+#endif
+#ifndef CONFIG_APP_SYNC_BINARY
+#define CONFIG_APP_SYNC_BINARY 1
+#endif
+#ifndef CONFIG_APP_SYNC_BATCH_DIVES
+#define CONFIG_APP_SYNC_BATCH_DIVES 0
+#endif
+#ifndef CONFIG_APP_SYNC_BACKOFF_MS
+#define CONFIG_APP_SYNC_BACKOFF_MS 500
+#endif
+#ifndef CONFIG_APP_SYNC_BACKOFF_MAX_MS
+#define CONFIG_APP_SYNC_BACKOFF_MAX_MS 8000
+#endif
+METRIC_COUNTER(s_m_chunks,  "sync.chunks");
+METRIC_COUNTER(s_m_retries, "sync.retries");
+
+/* Bloc lu en flash, prêt à partir : le JSON est encodé d'avance, le protobuf
+ * s'écrit depuis s pendant l'envoi (taille seule calculée d'avance) */
+typedef struct {
+    char            id[32];
+    dive_metadata_t meta;
+    dive_cursor_t   from;        // position du premier échantillon du bloc
+    dive_cursor_t   next;        // position après le bloc
+    dive_sample_t  *s;           // échantillons du bloc (tampon du contexte)
+    size_t          n;
+    bool            final;
+    bool            ready;       // false = rien à envoyer (plongée ouverte, rien de nouveau)
+    sync_fmt_t      fmt;
+    char           *body;        // JSON, NULL en protobuf
+    size_t          len;
+} chunk_t;
+
+typedef struct {
+    const char         *url;
+    dive_sample_t      *buf;         // échantillons du bloc en cours (l'autre tampon est pf.s)
+    dive_sync_stats_t  *st;
+    uint32_t            fails;       // échecs consécutifs
+    sync_fmt_t          fmt;         // JSON tant que le serveur n'a pas annoncé mieux
+    const char         *next_id;     // plongée suivante du parcours (NULL = dernière)
+    bool                batch_end;   // dernière plongée du lot : pas de préchargement au-delà
+    const chunk_t      *inflight;    // bloc dont on attend la réponse
+    chunk_t             pf;          // bloc suivant, préparé pendant cette attente
+    bool                pf_tried;
+} sync_ctx_t;
+
+static sync_chunk_t chunk_view(const chunk_t *k)
+{
+    return (sync_chunk_t){ .meta = &k->meta, .from = k->from.acked, .s = k->s, .n = k->n, .final = k->final };
+}
+
+/* Lit le bloc suivant from dans k->s et le prépare (k->ready false si rien à envoyer) */
+static esp_err_t prepare(sync_ctx_t *c, const char *id, const dive_metadata_t *meta,
+                         const dive_cursor_t *from, chunk_t *k)
+{
+    strlcpy(k->id, id, sizeof(k->id));
+    if (&k->meta != meta) k->meta = *meta;   // plongée suivante : déjà lue dans pf.meta
+    k->from = *from;
+    k->next = *from;
+    k->fmt = c->fmt;
+    k->ready = false;
+    k->body = NULL;
+    k->n = 0;
+    esp_err_t e = dive_storage_read_samples(id, &k->next, k->s, CONFIG_APP_SYNC_CHUNK_SAMPLES, &k->n);
+    if (e != ESP_OK) return e;
+    // dernier bloc d'une plongée fermée : le serveur reçoit le résumé et clôt
+    k->final = meta->has_summary && k->n < CONFIG_APP_SYNC_CHUNK_SAMPLES;
+    if (k->n == 0 && !k->final) return ESP_OK;   // plongée ouverte, rien de nouveau
+    sync_chunk_t ch = chunk_view(k);
+    if (k->fmt == SYNC_FMT_PB) {
+        k->len = sync_chunk_pb_len(&ch);
+    } else {
+        e = sync_chunk_encode(k->fmt, &ch, &k->body, &k->len);
+        if (e != ESP_OK) return e;
+    }
+    k->ready = true;
+    return ESP_OK;
+}
+
+static void drop_chunk(chunk_t *k)
+{
+    free(k->body);
+    k->body = NULL;
+    k->ready = false;
+}
+
+static void drop_prefetch(sync_ctx_t *c) { drop_chunk(&c->pf); }
+
+/* Pendant l'aller-retour d'un bloc : lecture flash + encodage du suivant, en
+ * supposant l'acquittement complet (cas courant). Suite de la même plongée si
+ * le bloc était plein, sinon premier bloc de la plongée suivante. Écarté si
+ * la réponse mène ailleurs. */
+static void prefetch(void *arg)
+{
+    sync_ctx_t *c = arg;
+    const chunk_t *k = c->inflight;
+    if (c->pf_tried || !k) return;   // déjà fait (requête rejouée sur une nouvelle connexion)
+    c->pf_tried = true;
+    drop_prefetch(c);
+    esp_err_t e = ESP_OK;
+    if (!k->final && k->n == CONFIG_APP_SYNC_CHUNK_SAMPLES) {
+        e = prepare(c, k->id, &k->meta, &k->next, &c->pf);
+    } else if (!c->batch_end && c->next_id) {
+        const char *id = c->next_id;
+        dive_cursor_t cur;
+        dive_storage_load_cursor(id, &cur);
+        if (cur.done) return;
+        memset(&c->pf.meta, 0, sizeof(c->pf.meta));   // read_metadata ne remet rien à zéro
+        e = dive_storage_read_metadata(id, &c->pf.meta);
+        if (e == ESP_OK) e = prepare(c, id, &c->pf.meta, &cur, &c->pf);
+    }
+    if (e != ESP_OK) drop_prefetch(c);
+}
+
+/* Corps protobuf écrit depuis les échantillons du bloc, au fil de l'envoi */
+static esp_err_t write_pb(void *arg, upload_put_fn put, void *sink)
+{
+    sync_chunk_t ch = chunk_view(arg);
+    return sync_chunk_pb_write(&ch, put, sink);
+}
+
+/* Un POST ; status HTTP dans *status (-1 = échec transport), "acked" dans *acked (-1 si absent) */
+static esp_err_t post_chunk(sync_ctx_t *c, chunk_t *k, int *status, int64_t *acked)
+{
+    char resp[96];
+    upload_req_t r = { .url = c->url, .enc = upload_default_encoding(), .content_type = sync_fmt_mime(k->fmt),
+                       .body = k->body, .len = k->len, .resp = resp, .resp_size = sizeof(resp),
+                       .on_sent = prefetch, .on_sent_arg = c };
+    if (!k->body) {
+        r.write_body = write_pb;
+        r.body_arg = k;
+    }
+#if CONFIG_APP_SYNC_BINARY
+    if (c->fmt == SYNC_FMT_JSON) r.want_accept = sync_fmt_mime(SYNC_FMT_PB);
+#endif
+    esp_err_t e = upload_post(&r, &c->st->http);
+    *status = r.status;
+    *acked = -1;
+#if CONFIG_APP_SYNC_BINARY
+    // négociation : le serveur liste ses formats dans Accept-Post, le binaire sert dès le bloc suivant
+    if (c->fmt == SYNC_FMT_JSON && r.accepted) {
+        ESP_LOGI(TAG, "server accepts %s, switching", sync_fmt_mime(SYNC_FMT_PB));
+        c->fmt = SYNC_FMT_PB;
+    }
+#endif
+    if (e == ESP_OK && resp[0]) {
+        cJSON *j = cJSON_Parse(resp);
+        cJSON *a = j ? cJSON_GetObjectItem(j, "acked") : NULL;
+        if (cJSON_IsNumber(a) && a->valuedouble >= 0) *acked = (int64_t)a->valuedouble;
+        cJSON_Delete(j);
+    }
+    return e;
+}
+
+/* Échec transport ou 5xx : attente exponentielle, Wi-Fi relancé si tombé */
+static bool backoff(sync_ctx_t *c)
+{
+    c->st->retries++;
+    metric_inc(&s_m_retries);
+    if (++c->fails > CONFIG_APP_SYNC_MAX_RETRIES) return false;
+    uint32_t ms = CONFIG_APP_SYNC_BACKOFF_MS << (c->fails - 1);
+    if (ms > CONFIG_APP_SYNC_BACKOFF_MAX_MS) ms = CONFIG_APP_SYNC_BACKOFF_MAX_MS;
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    if (!wifi_net_is_connected()) wifi_net_connect(10000);
+    return true;
+}
+
+/* Synchronise une plongée depuis son curseur. ESP_ERR_TIMEOUT = essais épuisés. */
+static esp_err_t sync_dive(sync_ctx_t *c, const char *id)
+{
+    dive_cursor_t cur;
+    dive_storage_load_cursor(id, &cur);
+    if (cur.done) return ESP_OK;
+
+    dive_metadata_t meta = { 0 };
+    if (dive_storage_read_metadata(id, &meta) != ESP_OK) return ESP_FAIL;
+
+    chunk_t k;
+    for (;;) {
+        const chunk_t *pf = &c->pf;
+        if (pf->ready && strcmp(pf->id, id) == 0 && pf->from.offset == cur.offset &&
+            pf->from.acked == cur.acked && pf->fmt == c->fmt) {
+            k = *pf;                               // préparé pendant le bloc précédent
+            c->pf.s = c->buf;                      // échange des tampons d'échantillons
+            c->buf = k.s;
+            c->pf.body = NULL;
+            c->pf.ready = false;
+        } else {
+            drop_prefetch(c);
+            k.s = c->buf;
+            esp_err_t e = prepare(c, id, &meta, &cur, &k);
+            if (e != ESP_OK) return e;
+        }
+        if (!k.ready) break;
+        dive_cursor_t next = k.next;
+        bool final = k.final;
+        sync_fmt_t fmt = k.fmt;
+
+        int status;
+        int64_t acked;
+        c->inflight = &k;
+        c->pf_tried = false;
+        esp_err_t e = post_chunk(c, &k, &status, &acked);
+        c->inflight = NULL;
+        drop_chunk(&k);
+
+        if (e == ESP_OK && status == 415 && fmt != SYNC_FMT_JSON) {
+            ESP_LOGW(TAG, "%s refused, back to JSON", sync_fmt_mime(fmt));
+            c->fmt = SYNC_FMT_JSON;
+            continue;   // même bloc, sans compter d'essai
+        }
+
+        if (e != ESP_OK || status < 0 || status >= 500) {
+            ESP_LOGW(TAG, "%s@%" PRIu32 ": %s status=%d", id, cur.acked, esp_err_to_name(e), status);
+            if (!backoff(c)) return ESP_ERR_TIMEOUT;
+            continue;   // même bloc, même curseur
+        }
+        if (status / 100 != 2 && status != 409) {
+            ESP_LOGE(TAG, "%s rejected (status %d)", id, status);
+            return ESP_FAIL;
+        }
+
+        if (status == 409 && acked < 0) return ESP_FAIL;
+        uint32_t prev = cur.acked;
+        if (acked < 0 || acked == next.acked) {
+            cur = next;                           // bloc entier acquitté
+        } else if (acked > next.acked) {
+            // le serveur en a plus que la flash (plongée effacée puis recréée ?) : rien à renvoyer
+            ESP_LOGW(TAG, "%s: server ahead (%" PRId64 " > %" PRIu32 ")", id, acked, next.acked);
+            cur = next;
+        } else if (acked != cur.acked) {
+            // le serveur est ailleurs (perte côté serveur, autre passage) : on s'aligne
+            ESP_LOGW(TAG, "%s: server at %" PRId64 ", local %" PRIu32, id, acked, next.acked);
+            e = dive_storage_seek_samples(id, (uint32_t)acked, &cur);
+            if (e != ESP_OK) return e;
+        } else if (next.acked != cur.acked) {
+            // aucun progrès alors que des données ont été envoyées (dernier bloc
+            // compris : sinon renvoyé sans fin, l'échéance du job repoussée à chaque tour)
+            if (!backoff(c)) return ESP_ERR_TIMEOUT;
+            continue;
+        }
+        c->fails = 0;                             // 2xx avec progrès (ou alignement)
+        if (final && cur.acked == next.acked) cur.done = true;
+
+        dive_storage_save_cursor(id, &cur);
+        app_jobs_progress(APP_JOB_UPLOAD);   // l'échéance du job court depuis le dernier bloc
+        c->st->chunks++;
+        metric_inc(&s_m_chunks);
+        if (cur.acked > prev) c->st->samples += cur.acked - prev;
+        if (cur.done) {
+            c->st->dives_synced++;
+            ESP_LOGI(TAG, "%s synced (%" PRIu32 " samples)", id, cur.acked);
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t dive_sync_run(const char *url, dive_sync_stats_t *st)
+{
+    if (!url || !st) return ESP_ERR_INVALID_ARG;
+    memset(st, 0, sizeof(*st));
+    metrics_register(&s_m_chunks.m);
+    metrics_register(&s_m_retries.m);
+
+    esp_err_t e = dive_storage_init();
+    if (e != ESP_OK) return e;
+    // deux tampons : le bloc en vol garde ses échantillons (protobuf écrit à l'envoi,
+    // renvoi sur une nouvelle connexion) pendant que le suivant se lit dans l'autre
+    sync_ctx_t c = { .url = url, .st = st,
+                     .buf = malloc(2 * CONFIG_APP_SYNC_CHUNK_SAMPLES * sizeof(dive_sample_t)) };
+    if (!c.buf) e = ESP_ERR_NO_MEM;
+    else c.pf.s = c.buf + CONFIG_APP_SYNC_CHUNK_SAMPLES;
+    dive_sample_t *bufs = c.buf;
+
+    // plongées pas encore acquittées, dans l'ordre des ids ; une d'avance pour le préchargement
+    const dive_filter_t pending = { .pending_only = true };
+    dive_iter_t it;
+    char ids[2][32];
+    size_t cnt = 0, i = 0;
+    if (e == ESP_OK) e = dive_storage_count(&pending, &cnt);
+    dive_iter_init(&it, &pending);
+    bool have = e == ESP_OK && dive_iter_next(&it, ids[0], NULL) == ESP_OK;
+
+    // lot : au plus CONFIG_APP_SYNC_BATCH_DIVES plongées à envoyer par passage, la suite au dock suivant
+    size_t started = 0;
+    for (; e == ESP_OK && have; ++i) {
+        const char *id = ids[i & 1];
+        bool more = dive_iter_next(&it, ids[(i + 1) & 1], NULL) == ESP_OK;
+        if (CONFIG_APP_SYNC_BATCH_DIVES && started == CONFIG_APP_SYNC_BATCH_DIVES) {
+            st->dives_pending++;
+        } else {
+            started++;
+            c.next_id = more ? ids[(i + 1) & 1] : NULL;
+            c.batch_end = CONFIG_APP_SYNC_BATCH_DIVES && started == CONFIG_APP_SYNC_BATCH_DIVES;
+            esp_err_t de = sync_dive(&c, id);
+            dive_cursor_t cur;
+            if (dive_storage_load_cursor(id, &cur) == ESP_OK && !cur.done) st->dives_pending++;
+            if (de == ESP_ERR_TIMEOUT) e = de;   // lien perdu : inutile d'insister sur les suivantes
+            else if (de != ESP_OK) ESP_LOGW(TAG, "%s: %s", id, esp_err_to_name(de));
+        }
+        if (cnt) led_status_progress((uint8_t)((i + 1 < cnt ? i + 1 : cnt) * 100 / cnt));
+        have = more;
+    }
+    drop_prefetch(&c);
+    free(bufs);
+    ESP_LOGI(TAG, "sync: %" PRIu32 " dives done, %" PRIu32 " pending, %" PRIu32 " chunks, %" PRIu32
+             " samples, %" PRIu32 " retries",
+             st->dives_synced, st->dives_pending, st->chunks, st->samples, st->retries);
+    return e;
+}
@@ -3,6 +3,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+/** Démarre la tâche d'upload (job APP_JOB_UPLOAD) */
 esp_err_t app_upload_start(void);
 #ifdef __cplusplus
 }
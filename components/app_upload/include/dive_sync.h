@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "upload_http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Synchro incrémentale des plongées : chaque plongée a un curseur persistant
+ * (dive_storage_*_cursor) ; seuls les échantillons au-delà du dernier acquitté
+ * sont envoyés, par blocs. Un bloc perdu (coupure) est renvoyé tel quel.
+ *
+ * Requête  : POST url, {"device","dive","from","final","meta"?,"samples":[...]}
+ * Réponse  : 2xx {"acked":N} = nb d'échantillons que le serveur détient pour la
+ *            plongée (autoritaire) ; sans "acked", from + n est supposé.
+ *            409 {"acked":N} = désaccord de position, reprise à N.
+ * Format   : JSON au départ ; si une réponse porte "Accept-Post: application/x-protobuf",
+ *            les blocs suivants partent en protobuf (proto/dive_sync.proto), et
+ *            reviennent au JSON sur un 415. La réponse reste en JSON. */
+typedef struct {
+    uint32_t dives_synced;     // plongées fermées entièrement acquittées pendant ce passage
+    uint32_t dives_pending;    // plongées laissées incomplètes (échec, ou plongée ouverte)
+    uint32_t chunks;           // blocs acquittés
+    uint32_t samples;          // échantillons acquittés
+    uint32_t retries;          // tentatives ratées (transport, 5xx)
+    upload_stats_t http;       // octets bruts/transmis, CPU de compression (tentatives ratées comprises)
+} dive_sync_stats_t;
+
+/** Synchronise toutes les plongées vers url. ESP_ERR_TIMEOUT si les essais
+ *  sont épuisés : les curseurs sont à jour, le passage suivant reprend là. */
+esp_err_t dive_sync_run(const char *url, dive_sync_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
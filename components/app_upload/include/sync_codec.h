@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "dive_storage.h"
+#include "upload_http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Encodage d'un bloc de synchro (cf. dive_sync.h) : JSON, ou protobuf selon
+ * proto/dive_sync.proto, écrit directement depuis les échantillons lus en flash.
+ * Le protobuf peut partir en flux (sync_chunk_pb_write -> upload_req_t.write_body) :
+ * taille exacte par une passe de comptage, aucun tampon de la taille du message. */
+typedef enum {
+    SYNC_FMT_JSON = 0,
+    SYNC_FMT_PB,
+} sync_fmt_t;
+
+typedef struct {
+    const dive_metadata_t *meta;      // émis au premier bloc (from == 0) et au dernier
+    uint32_t               from;
+    const dive_sample_t   *s;
+    size_t                 n;
+    bool                   final;
+} sync_chunk_t;
+
+/** Type MIME du format (Content-Type de la requête) */
+const char *sync_fmt_mime(sync_fmt_t fmt);
+
+/** Encode un bloc ; *out alloué, à free() ; *len sans '\0' final */
+esp_err_t sync_chunk_encode(sync_fmt_t fmt, const sync_chunk_t *c, char **out, size_t *len);
+
+/** Taille exacte du bloc en protobuf (passe de comptage, rien d'écrit) */
+size_t    sync_chunk_pb_len(const sync_chunk_t *c);
+
+/** Bloc en protobuf vers put(sink, ...), par morceaux de quelques centaines
+ *  d'octets au plus ; sync_chunk_pb_len(c) octets au total. Erreur = celle de put */
+esp_err_t sync_chunk_pb_write(const sync_chunk_t *c, upload_put_fn put, void *sink);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* POST partagé par la synchro et l'état de santé. Le corps peut être
+ * compressé au fil de l'envoi (tdefl de la ROM, fenêtre fixe de 32 Ko) et part
+ * alors en Transfer-Encoding: chunked avec Content-Encoding: deflate|gzip.
+ * Dans une session (upload_session_begin), les POST réutilisent une seule
+ * connexion keep-alive ; après une coupure, la reconnexion reprend la session
+ * TLS (ticket) au lieu d'une poignée de main complète. */
+typedef enum {
+    UPLOAD_ENC_IDENTITY = 0,
+    UPLOAD_ENC_DEFLATE,          // zlib (RFC 1950), ce qu'attend "Content-Encoding: deflate"
+    UPLOAD_ENC_GZIP,
+} upload_enc_t;
+
+/* Écriture d'un morceau de corps (compressé au passage selon enc) */
+typedef esp_err_t (*upload_put_fn)(void *sink, const void *d, size_t n);
+
+typedef struct {
+    const char  *url;
+    upload_enc_t enc;
+    const char  *content_type;   // NULL = application/json
+    const char  *body;           // JSON ou binaire, len octets ; NULL si write_body
+    size_t       len;
+    esp_err_t  (*write_body)(void *arg, upload_put_fn put, void *sink);   // corps produit au fil de
+    void        *body_arg;                                                 // l'envoi, len octets en tout
+    char        *resp;           // optionnel : début de la réponse, terminé par '\0'
+    size_t       resp_size;
+    int          status;         // sortie : code HTTP, -1 = échec transport
+    const char  *want_accept;    // optionnel : type MIME cherché dans l'en-tête Accept-Post
+    bool         accepted;       // sortie : want_accept fait partie de la liste de la réponse
+    void       (*on_sent)(void *arg);   // optionnel : appelé corps envoyé, avant d'attendre la
+    void        *on_sent_arg;           // réponse (travail local recouvert par l'aller-retour)
+} upload_req_t;
+
+/* Cumul sur un passage d'upload (à remettre à zéro par l'appelant) */
+typedef struct {
+    uint32_t requests;
+    uint32_t connects;           // connexions TCP (TLS) ouvertes
+    uint32_t raw_bytes;          // corps avant compression
+    uint32_t wire_bytes;         // corps effectivement écrit (cadrage chunked compris)
+    uint32_t deflate_us;         // CPU passé dans tdefl, écritures réseau déduites
+    uint32_t http_us;            // open -> réponse lue
+} upload_stats_t;
+
+/** Encodage choisi dans menuconfig ; IDENTITY si la cible n'a pas tdefl (linux) */
+upload_enc_t upload_default_encoding(void);
+
+/** Un POST ; r->status renseigné. Si le compresseur ne peut être alloué en RAM
+ *  interne, le corps part en clair (avertissement unique). st peut être NULL. */
+esp_err_t upload_post(upload_req_t *r, upload_stats_t *st);
+
+/** Début de passage : keep_alive = une connexion pour tous les POST suivants
+ *  (sinon une par requête, comme hors session) */
+void upload_session_begin(bool keep_alive);
+
+/** Fin de passage : ferme la connexion et rend la mémoire du compresseur */
+void upload_session_end(void);
+
+/** Une ligne de bilan : taux de compression, CPU, durée HTTP, fenêtre radio (ms, 0 = non mesurée) */
+void upload_stats_log(const char *what, const upload_stats_t *st, uint32_t radio_ms);
+
+#ifdef __cplusplus
+}
+#endif
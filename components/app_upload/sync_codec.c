@@ -0,0 +1,229 @@
+#include "sync_codec.h"
+#include "cJSON.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- JSON ---------- */
+static esp_err_t encode_json(const sync_chunk_t *c, char **out, size_t *len)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return ESP_ERR_NO_MEM;
+    cJSON_AddStringToObject(root, "device", "esp32-s3");
+    cJSON_AddStringToObject(root, "dive", c->meta->id);
+    cJSON_AddNumberToObject(root, "from", c->from);
+    cJSON_AddBoolToObject(root, "final", c->final);
+    if (c->from == 0 || c->final) {
+        // métadonnées au premier bloc, résumé avec le dernier
+        cJSON *m = cJSON_AddObjectToObject(root, "meta");
+        if (m) dive_storage_meta_to_json(c->meta, m);
+    }
+    cJSON *arr = cJSON_AddArrayToObject(root, "samples");
+    for (size_t i = 0; arr && i < c->n; ++i) {
+        cJSON *o = cJSON_CreateObject();
+        if (!o) break;
+        cJSON_AddNumberToObject(o, "ts_us", (double)c->s[i].timestamp);
+        cJSON_AddNumberToObject(o, "temp_c", c->s[i].temperature);
+        cJSON_AddNumberToObject(o, "press_bar", c->s[i].pressure);
+        cJSON_AddItemToArray(arr, o);
+    }
+    char *txt = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!txt) return ESP_ERR_NO_MEM;
+    *out = txt;
+    *len = strlen(txt);
+    return ESP_OK;
+}
+
+/* ---------- Protobuf (format filaire, sans runtime) ----------
+ * Écrivain à trois usages : ni p ni put compte les octets (taille des
+ * sous-messages, préfixée avant leur contenu), p écrit en mémoire, put reçoit
+ * le flux par morceaux de PB_BUF octets (tampon sur la pile, rien d'alloué). */
+#define PB_BUF 128
+
+typedef struct {
+    uint8_t      *p;
+    size_t        len;
+    upload_put_fn put;
+    void         *sink;
+    esp_err_t     err;           // premier échec de put, la suite est ignorée
+    size_t        fill;
+    uint8_t       buf[PB_BUF];
+} pb_w_t;
+
+enum { PB_VARINT = 0, PB_LEN = 2, PB_FIXED32 = 5 };
+
+static void pb_flush(pb_w_t *w)
+{
+    if (w->fill && w->err == ESP_OK) w->err = w->put(w->sink, w->buf, w->fill);
+    w->fill = 0;
+}
+
+static void pb_raw(pb_w_t *w, const void *d, size_t n)
+{
+    w->len += n;
+    if (w->p) {
+        memcpy(w->p + w->len - n, d, n);
+    } else if (w->put) {
+        const uint8_t *b = d;
+        while (n) {
+            size_t k = PB_BUF - w->fill < n ? PB_BUF - w->fill : n;
+            memcpy(w->buf + w->fill, b, k);
+            w->fill += k;
+            b += k;
+            n -= k;
+            if (w->fill == PB_BUF) pb_flush(w);
+        }
+    }
+}
+
+static void pb_varint(pb_w_t *w, uint64_t v)
+{
+    uint8_t b[10];
+    size_t n = 0;
+    do {
+        b[n] = (uint8_t)(v & 0x7f);
+        v >>= 7;
+        if (v) b[n] |= 0x80;
+        n++;
+    } while (v);
+    pb_raw(w, b, n);
+}
+
+static size_t pb_varint_len(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+static void pb_tag(pb_w_t *w, unsigned field, unsigned wt) { pb_varint(w, (field << 3) | wt); }
+
+static uint64_t pb_zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+static void pb_uint(pb_w_t *w, unsigned field, uint64_t v)
+{
+    if (!v) return;
+    pb_tag(w, field, PB_VARINT);
+    pb_varint(w, v);
+}
+
+static void pb_float(pb_w_t *w, unsigned field, float f)
+{
+    if (f == 0.0f) return;
+    pb_tag(w, field, PB_FIXED32);
+    pb_raw(w, &f, 4);            // little-endian sur Xtensa/RISC-V comme sur le fil
+}
+
+static void pb_str(pb_w_t *w, unsigned field, const char *s)
+{
+    size_t n = strlen(s);
+    if (!n) return;
+    pb_tag(w, field, PB_LEN);
+    pb_varint(w, n);
+    pb_raw(w, s, n);
+}
+
+/* Sous-message : passe de comptage pour le préfixe de longueur, puis écriture */
+static void pb_sub(pb_w_t *w, unsigned field, void (*fn)(pb_w_t *, const sync_chunk_t *),
+                   const sync_chunk_t *c)
+{
+    pb_w_t sz = { 0 };
+    fn(&sz, c);
+    pb_tag(w, field, PB_LEN);
+    pb_varint(w, sz.len);
+    fn(w, c);
+}
+
+static void pb_summary(pb_w_t *w, const sync_chunk_t *c)
+{
+    const dive_summary_t *sm = &c->meta->summary;
+    pb_uint(w, 1, sm->samples);
+    pb_uint(w, 2, sm->duration_s);
+    pb_float(w, 3, sm->max_depth_m);
+    pb_float(w, 4, sm->avg_depth_m);
+    pb_float(w, 5, sm->min_temp_c);
+    pb_float(w, 6, sm->max_temp_c);
+    pb_float(w, 7, sm->max_ascent_m_min);
+    pb_uint(w, 8, sm->descent_s);
+    pb_uint(w, 9, sm->bottom_s);
+    pb_uint(w, 10, sm->ascent_s);
+    pb_uint(w, 11, sm->safety_stop_s);
+}
+
+static void pb_meta(pb_w_t *w, const sync_chunk_t *c)
+{
+    pb_str(w, 1, c->meta->id);
+    pb_str(w, 2, c->meta->date);
+    pb_str(w, 3, c->meta->location);
+    pb_str(w, 4, c->meta->diver);
+    if (c->meta->has_summary) pb_sub(w, 5, pb_summary, c);
+}
+
+static int64_t ts_delta(const sync_chunk_t *c, size_t i)
+{
+    return i ? (int64_t)(c->s[i].timestamp - c->s[i - 1].timestamp) : 0;
+}
+
+static void pb_samples(pb_w_t *w, const sync_chunk_t *c)
+{
+    pb_uint(w, 1, c->s[0].timestamp);
+    size_t dl = 0;
+    for (size_t i = 0; i < c->n; ++i) dl += pb_varint_len(pb_zigzag(ts_delta(c, i)));
+    pb_tag(w, 2, PB_LEN);
+    pb_varint(w, dl);
+    for (size_t i = 0; i < c->n; ++i) pb_varint(w, pb_zigzag(ts_delta(c, i)));
+    pb_tag(w, 3, PB_LEN);
+    pb_varint(w, 4 * c->n);
+    for (size_t i = 0; i < c->n; ++i) pb_raw(w, &c->s[i].temperature, 4);
+    pb_tag(w, 4, PB_LEN);
+    pb_varint(w, 4 * c->n);
+    for (size_t i = 0; i < c->n; ++i) pb_raw(w, &c->s[i].pressure, 4);
+}
+
+/* Message racine, dans l'ordre des champs */
+static void pb_chunk(pb_w_t *w, const sync_chunk_t *c)
+{
+    pb_str(w, 1, "esp32-s3");
+    pb_str(w, 2, c->meta->id);
+    pb_uint(w, 3, c->from);
+    pb_uint(w, 4, c->final);
+    if (c->from == 0 || c->final) pb_sub(w, 5, pb_meta, c);
+    if (c->n) pb_sub(w, 6, pb_samples, c);
+}
+
+static esp_err_t encode_pb(const sync_chunk_t *c, char **out, size_t *len)
+{
+    pb_w_t w = { .p = malloc(sync_chunk_pb_len(c)) };
+    if (!w.p) return ESP_ERR_NO_MEM;
+    pb_chunk(&w, c);
+    *out = (char *)w.p;
+    *len = w.len;
+    return ESP_OK;
+}
+
+size_t sync_chunk_pb_len(const sync_chunk_t *c)
+{
+    pb_w_t w = { 0 };
+    pb_chunk(&w, c);
+    return w.len;
+}
+
+esp_err_t sync_chunk_pb_write(const sync_chunk_t *c, upload_put_fn put, void *sink)
+{
+    if (!c || !c->meta || (c->n && !c->s) || !put) return ESP_ERR_INVALID_ARG;
+    pb_w_t w = { .put = put, .sink = sink };
+    pb_chunk(&w, c);
+    pb_flush(&w);
+    return w.err;
+}
+
+const char *sync_fmt_mime(sync_fmt_t fmt)
+{
+    return fmt == SYNC_FMT_PB ? "application/x-protobuf" : "application/json";
+}
+
+esp_err_t sync_chunk_encode(sync_fmt_t fmt, const sync_chunk_t *c, char **out, size_t *len)
+{
+    if (!c || !c->meta || (c->n && !c->s) || !out || !len) return ESP_ERR_INVALID_ARG;
+    return fmt == SYNC_FMT_PB ? encode_pb(c, out, len) : encode_json(c, out, len);
+}
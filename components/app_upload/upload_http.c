@@ -0,0 +1,318 @@
+#include "upload_http.h"
+#include "metrics.h"
+#include "esp_http_client.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "miniz.h"              // tdefl de la ROM (esp_rom)
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#define UPLOAD_HAVE_TDEFL 1
+#endif
+
+static const char *TAG = "upload_http";
+
+#if !defined(CONFIG_APP_UPLOAD_ENC_IDENTITY) && !defined(CONFIG_APP_UPLOAD_ENC_DEFLATE) && \
+    !defined(CONFIG_APP_UPLOAD_ENC_GZIP)
+#define CONFIG_APP_UPLOAD_ENC_DEFLATE 1
+#endif
+#ifndef CONFIG_APP_UPLOAD_DEFLATE_LEVEL
+#define CONFIG_APP_UPLOAD_DEFLATE_LEVEL 3
+#endif
+
+METRIC_COUNTER(s_m_raw,  "upload.raw_bytes");
+METRIC_COUNTER(s_m_wire, "upload.wire_bytes");
+METRIC_COUNTER(s_m_cpu,  "upload.deflate_us");
+
+typedef struct {
+    esp_http_client_handle_t cli;
+    upload_enc_t enc;
+    uint32_t raw;                // octets de corps reçus du producteur
+    uint32_t crc;                // CRC-32 du corps en clair (gzip)
+    uint32_t wire;               // octets écrits, cadrage compris
+    int64_t  io_us;              // temps passé dans les écritures réseau
+} sink_t;
+
+/* Session : client gardé d'un POST à l'autre (NULL hors session keep-alive) */
+static esp_http_client_handle_t s_cli;
+static bool s_keep_alive;
+
+typedef struct {
+    upload_req_t *r;
+    uint32_t      connects;
+} call_t;
+
+/* type présent dans une liste "a/b, c/d;q=0.5" (casse et paramètres ignorés) */
+static bool accept_lists(const char *list, const char *type)
+{
+    size_t tl = strlen(type);
+    for (const char *p = list; *p;) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        size_t n = strcspn(p, ",; \t");
+        if (n == tl && strncasecmp(p, type, tl) == 0) return true;
+        p += strcspn(p, ",");
+    }
+    return false;
+}
+
+static esp_err_t on_event(esp_http_client_event_t *ev)
+{
+    call_t *k = ev->user_data;
+    if (ev->event_id == HTTP_EVENT_ON_CONNECTED) {
+        k->connects++;
+    } else if (ev->event_id == HTTP_EVENT_ON_HEADER && k->r->want_accept &&
+               strcasecmp(ev->header_key, "Accept-Post") == 0) {
+        // formats acceptés annoncés par le serveur (négociation côté dive_sync) : liste
+        // parcourue ici même, sans copie ni limite de longueur
+        if (accept_lists(ev->header_value, k->r->want_accept)) k->r->accepted = true;
+    }
+    return ESP_OK;
+}
+
+static esp_http_client_handle_t client_new(const char *url, call_t *k)
+{
+    esp_http_client_config_t cfg = {
+        .url = url, .timeout_ms = 8000, .event_handler = on_event, .user_data = k,
+        .keep_alive_enable = s_keep_alive,     // sondes TCP : lien mort détecté entre deux blocs
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true,           // reconnexion HTTPS par ticket, sans poignée complète
+#endif
+    };
+    return esp_http_client_init(&cfg);
+}
+
+upload_enc_t upload_default_encoding(void)
+{
+#if defined(UPLOAD_HAVE_TDEFL) && CONFIG_APP_UPLOAD_ENC_GZIP
+    return UPLOAD_ENC_GZIP;
+#elif defined(UPLOAD_HAVE_TDEFL) && CONFIG_APP_UPLOAD_ENC_DEFLATE
+    return UPLOAD_ENC_DEFLATE;
+#else
+    return UPLOAD_ENC_IDENTITY;
+#endif
+}
+
+#ifdef UPLOAD_HAVE_TDEFL
+/* Le compresseur (~dizaines de Ko, fenêtre figée par la ROM) vit en RAM
+ * interne le temps d'un passage : alloué au premier POST, rendu par upload_session_end() */
+static tdefl_compressor *s_tdefl;
+static bool s_warned;
+#endif
+
+/* Morceau de corps venu du producteur : dans tdefl, ou tel quel sur le socket */
+static esp_err_t put_body(void *sink, const void *d, size_t n)
+{
+    sink_t *s = sink;
+    s->raw += (uint32_t)n;
+#ifdef UPLOAD_HAVE_TDEFL
+    if (s->enc != UPLOAD_ENC_IDENTITY) {
+        if (s->enc == UPLOAD_ENC_GZIP) s->crc = esp_rom_crc32_le(s->crc, d, (uint32_t)n);
+        return tdefl_compress_buffer(s_tdefl, d, n, TDEFL_NO_FLUSH) == TDEFL_STATUS_OKAY ? ESP_OK : ESP_FAIL;
+    }
+#endif
+    int w = esp_http_client_write(s->cli, d, (int)n);
+    if (w > 0) s->wire += (uint32_t)w;
+    return w == (int)n ? ESP_OK : ESP_FAIL;
+}
+
+/* Corps de la requête : tampon entier, ou morceaux rendus par write_body */
+static esp_err_t write_body(const upload_req_t *r, sink_t *s)
+{
+    if (r->write_body) return r->write_body(r->body_arg, put_body, s);
+    return r->len ? put_body(s, r->body, r->len) : ESP_OK;
+}
+
+#ifdef UPLOAD_HAVE_TDEFL
+/* Bloc chunked : taille hexa, données, CRLF */
+static esp_err_t put_chunk(sink_t *s, const void *buf, size_t len)
+{
+    if (!len) return ESP_OK;
+    char hdr[12];
+    int h = snprintf(hdr, sizeof(hdr), "%x\r\n", (unsigned)len);
+    int64_t t0 = esp_timer_get_time();
+    bool ok = esp_http_client_write(s->cli, hdr, h) == h &&
+              esp_http_client_write(s->cli, buf, (int)len) == (int)len &&
+              esp_http_client_write(s->cli, "\r\n", 2) == 2;
+    s->io_us += esp_timer_get_time() - t0;
+    s->wire += (uint32_t)(h + len + 2);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+/* Appelé par tdefl à chaque tampon de sortie plein : part directement sur le socket */
+static mz_bool tdefl_sink(const void *buf, int len, void *user)
+{
+    return put_chunk(user, buf, (size_t)len) == ESP_OK;
+}
+
+static int tdefl_flags(upload_enc_t enc)
+{
+    // sondes par niveau, comme tdefl_create_comp_flags_from_zip_params()
+    static const uint16_t probes[10] = { 0, 1, 6, 32, 16, 32, 128, 256, 512, 768 };
+    int lvl = CONFIG_APP_UPLOAD_DEFLATE_LEVEL;
+    int f = probes[lvl] | (lvl <= 3 ? TDEFL_GREEDY_PARSING_FLAG : 0);
+    if (enc == UPLOAD_ENC_DEFLATE) f |= TDEFL_WRITE_ZLIB_HEADER;
+    return f;
+}
+
+/* Corps compressé au fil de l'eau ; *cpu_us = temps tdefl (et producteur) hors écritures */
+static esp_err_t send_deflate(sink_t *s, const upload_req_t *r, uint32_t *cpu_us)
+{
+    static const uint8_t gz_head[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t e = ESP_OK;
+
+    if (s->enc == UPLOAD_ENC_GZIP) e = put_chunk(s, gz_head, sizeof(gz_head));
+    if (e == ESP_OK && tdefl_init(s_tdefl, tdefl_sink, s, tdefl_flags(s->enc)) != TDEFL_STATUS_OKAY) e = ESP_FAIL;
+    if (e == ESP_OK) e = write_body(r, s);
+    if (e == ESP_OK && tdefl_compress_buffer(s_tdefl, NULL, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE) e = ESP_FAIL;
+    if (e == ESP_OK && s->enc == UPLOAD_ENC_GZIP) {
+        uint32_t crc = s->crc, isz = s->raw;
+        const uint8_t tail[8] = { crc, crc >> 8, crc >> 16, crc >> 24, isz, isz >> 8, isz >> 16, isz >> 24 };
+        e = put_chunk(s, tail, sizeof(tail));
+    }
+    if (e == ESP_OK) {
+        int64_t t1 = esp_timer_get_time();
+        if (esp_http_client_write(s->cli, "0\r\n\r\n", 5) != 5) e = ESP_FAIL;
+        s->io_us += esp_timer_get_time() - t1;
+        s->wire += 5;
+    }
+    *cpu_us = (uint32_t)(esp_timer_get_time() - t0 - s->io_us);
+    return e;
+}
+#endif
+
+esp_err_t upload_post(upload_req_t *r, upload_stats_t *st)
+{
+    if (!r || !r->url || (!r->body && !r->write_body)) return ESP_ERR_INVALID_ARG;
+    r->status = -1;
+    r->accepted = false;
+    if (r->resp && r->resp_size) r->resp[0] = '\0';
+    metrics_register(&s_m_raw.m);
+    metrics_register(&s_m_wire.m);
+    metrics_register(&s_m_cpu.m);
+
+    upload_enc_t enc = r->enc;
+#ifdef UPLOAD_HAVE_TDEFL
+    if (enc != UPLOAD_ENC_IDENTITY && !s_tdefl) {
+        s_tdefl = heap_caps_malloc(sizeof(*s_tdefl), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!s_tdefl && !s_warned) {
+            ESP_LOGW(TAG, "no internal RAM for tdefl (%u B), sending uncompressed", (unsigned)sizeof(*s_tdefl));
+            s_warned = true;
+        }
+    }
+    if (!s_tdefl) enc = UPLOAD_ENC_IDENTITY;
+#else
+    enc = UPLOAD_ENC_IDENTITY;
+#endif
+
+    call_t k = { .r = r };
+    sink_t s = { 0 };
+    uint32_t cpu_us = 0, http_us = 0;
+    esp_err_t e = ESP_FAIL;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        // connexion de session réutilisée, sinon client à usage unique
+        bool reused = s_cli != NULL;
+        esp_http_client_handle_t cli = s_cli;
+        if (reused) {
+            esp_http_client_set_url(cli, r->url);
+            esp_http_client_set_user_data(cli, &k);
+        } else {
+            cli = client_new(r->url, &k);
+            if (!cli) return ESP_ERR_NO_MEM;
+            if (s_keep_alive) s_cli = cli;
+        }
+        esp_http_client_set_method(cli, HTTP_METHOD_POST);
+        esp_http_client_set_header(cli, "Content-Type", r->content_type ? r->content_type : "application/json");
+        if (enc != UPLOAD_ENC_IDENTITY) {
+            esp_http_client_set_header(cli, "Content-Encoding", enc == UPLOAD_ENC_GZIP ? "gzip" : "deflate");
+        } else {
+            esp_http_client_delete_header(cli, "Content-Encoding");
+        }
+
+        s = (sink_t){ .cli = cli, .enc = enc };
+        cpu_us = 0;
+        uint32_t connects = k.connects;
+        int64_t t0 = esp_timer_get_time();
+        // taille inconnue d'avance une fois compressé : -1 = Transfer-Encoding: chunked
+        e = esp_http_client_open(cli, enc == UPLOAD_ENC_IDENTITY ? (int)r->len : -1);
+        if (e == ESP_OK && enc == UPLOAD_ENC_IDENTITY) {
+            e = write_body(r, &s);
+            if (e == ESP_OK && s.raw != r->len) e = ESP_FAIL;   // Content-Length annoncé
+        }
+#ifdef UPLOAD_HAVE_TDEFL
+        else if (e == ESP_OK) {
+            e = send_deflate(&s, r, &cpu_us);
+        }
+#endif
+        if (e == ESP_OK && r->on_sent) r->on_sent(r->on_sent_arg);
+        if (e == ESP_OK && esp_http_client_fetch_headers(cli) < 0) e = ESP_FAIL;
+        if (e == ESP_OK) {
+            r->status = esp_http_client_get_status_code(cli);
+            if (r->resp && r->resp_size > 1) {
+                int n = esp_http_client_read_response(cli, r->resp, (int)r->resp_size - 1);
+                r->resp[n > 0 ? n : 0] = '\0';
+            }
+            // reste de la réponse consommé : la connexion peut resservir
+            if (cli == s_cli) esp_http_client_flush_response(cli, NULL);
+        }
+        http_us += (uint32_t)(esp_timer_get_time() - t0);
+
+        if (cli != s_cli) {
+            esp_http_client_cleanup(cli);
+        } else if (e != ESP_OK) {
+            esp_http_client_close(cli);        // état inconnu : reconnexion au prochain open
+        }
+        // connexion gardée fermée entre-temps par le serveur : un seul nouvel essai, à neuf
+        if (e == ESP_OK || !reused || k.connects != connects) break;
+        ESP_LOGD(TAG, "stale keep-alive connection, reconnecting");
+    }
+
+    metric_add(&s_m_raw, (uint32_t)r->len);
+    metric_add(&s_m_wire, s.wire);
+    metric_add(&s_m_cpu, cpu_us);
+    if (st) {
+        st->requests++;
+        st->connects   += k.connects;
+        st->raw_bytes  += (uint32_t)r->len;
+        st->wire_bytes += s.wire;
+        st->deflate_us += cpu_us;
+        st->http_us    += http_us;
+    }
+    return e;
+}
+
+void upload_session_begin(bool keep_alive)
+{
+    upload_session_end();
+    s_keep_alive = keep_alive;
+}
+
+void upload_session_end(void)
+{
+    if (s_cli) {
+        esp_http_client_cleanup(s_cli);
+        s_cli = NULL;
+    }
+    s_keep_alive = false;
+#ifdef UPLOAD_HAVE_TDEFL
+    free(s_tdefl);
+    s_tdefl = NULL;
+#endif
+}
+
+void upload_stats_log(const char *what, const upload_stats_t *st, uint32_t radio_ms)
+{
+    uint32_t pct = st->raw_bytes ? (uint32_t)((uint64_t)st->wire_bytes * 100 / st->raw_bytes) : 100;
+    ESP_LOGI(TAG, "%s: %" PRIu32 " req / %" PRIu32 " conn, %" PRIu32 " -> %" PRIu32 " B (%" PRIu32
+             "%%), deflate %" PRIu32 " ms CPU, http %" PRIu32 " ms, radio on %" PRIu32 " ms",
+             what, st->requests, st->connects, st->raw_bytes, st->wire_bytes, pct,
+             st->deflate_us / 1000, st->http_us / 1000, radio_ms);
+}
@@ -0,0 +1,200 @@
+#include "bench.h"
+#include "hal_fs.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+  #include <time.h>
+  #include <malloc.h>
+#else
+  #include "esp_cpu.h"
+  #include "esp_rom_sys.h"
+  #include "esp_heap_caps.h"
+  #include "esp_timer.h"
+#endif
+
+static const char *TAG = "bench";
+
+#ifndef CONFIG_APP_TASK_PLAN
+#define CONFIG_APP_TASK_PLAN 0
+#endif
+#ifndef CONFIG_APP_BENCH_ITERS
+#define CONFIG_APP_BENCH_ITERS 200
+#endif
+
+/* ---------- Horloge et tas, par plateforme ---------- */
+#if CONFIG_IDF_TARGET_LINUX
+typedef uint64_t bench_stamp_t;
+static inline bench_stamp_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+static inline uint64_t elapsed_ns(bench_stamp_t t0, bench_stamp_t t1) { return t1 - t0; }
+static inline int64_t ns_to_cycles(uint64_t ns) { (void)ns; return -1; }
+static inline int64_t heap_used(void) { return (int64_t)mallinfo2().uordblks; }
+#else
+/* Le compteur de cycles (32 bits) reboucle en ~18 s à 240 MHz : au-delà de
+ * 10 s on prend esp_timer (64 bits, à la µs) */
+typedef struct { int64_t us; uint32_t cyc; } bench_stamp_t;
+static inline bench_stamp_t bench_now(void)
+{
+    return (bench_stamp_t){ .us = esp_timer_get_time(), .cyc = esp_cpu_get_cycle_count() };
+}
+static inline uint64_t elapsed_ns(bench_stamp_t t0, bench_stamp_t t1)
+{
+    int64_t us = t1.us - t0.us;
+    if (us >= 10000000) return (uint64_t)us * 1000u;
+    return (uint64_t)(uint32_t)(t1.cyc - t0.cyc) * 1000u / esp_rom_get_cpu_ticks_per_us();
+}
+static inline int64_t ns_to_cycles(uint64_t ns)
+{
+    return (int64_t)(ns * esp_rom_get_cpu_ticks_per_us() / 1000u);
+}
+static inline int64_t heap_used(void)
+{
+    return -(int64_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+#endif
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t pct(const uint64_t *v, uint32_t n, uint32_t p)
+{
+    uint32_t i = (n * p + 99) / 100;
+    return v[i ? i - 1 : 0];
+}
+
+esp_err_t bench_run(const bench_case_t *c, bench_result_t *res)
+{
+    if (!c || !c->run || !res) return ESP_ERR_INVALID_ARG;
+    memset(res, 0, sizeof(*res));
+    res->name = c->name;
+    res->mean_cycles = -1;
+
+    uint32_t n = c->iters ? c->iters : CONFIG_APP_BENCH_ITERS;
+    uint64_t *lat = malloc(n * sizeof(uint64_t));
+    if (!lat) return ESP_ERR_NO_MEM;
+
+    int64_t heap0 = heap_used();
+    void *ctx = NULL;
+    if (c->setup) {
+        esp_err_t e = c->setup(&ctx);
+        if (e == ESP_ERR_NOT_SUPPORTED) {
+            res->skipped = true;
+            free(lat);
+            return ESP_OK;
+        }
+        if (e != ESP_OK) {
+            free(lat);
+            return e;
+        }
+    }
+
+    // la mesure du tas exclut ce que setup() garde pour toute la série
+    int64_t base = heap_used(), peak = base;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        bench_stamp_t t0 = bench_now();
+        esp_err_t e = c->run(ctx);
+        uint64_t dt = elapsed_ns(t0, bench_now());
+        if (e != ESP_OK) res->errors++;
+        lat[i] = c->sample_ns ? c->sample_ns(ctx) : dt;
+        sum += lat[i];
+        int64_t h = heap_used();
+        if (h > peak) peak = h;
+    }
+    if (c->teardown) c->teardown(ctx);
+
+    qsort(lat, n, sizeof(uint64_t), cmp_u64);
+    res->iters   = n;
+    res->p50_ns  = pct(lat, n, 50);
+    res->p90_ns  = pct(lat, n, 90);
+    res->p99_ns  = pct(lat, n, 99);
+    res->max_ns  = lat[n - 1];
+    res->mean_ns = sum / n;
+    if (!c->sample_ns) res->mean_cycles = ns_to_cycles(res->mean_ns);
+    res->heap_peak = (int32_t)(peak - base);
+    res->heap_leak = (int32_t)(heap_used() - heap0);
+    free(lat);
+    return ESP_OK;
+}
+
+static cJSON *result_json(const bench_result_t *r)
+{
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "name", r->name);
+    if (r->skipped) {
+        cJSON_AddBoolToObject(o, "skipped", true);
+        return o;
+    }
+    cJSON_AddNumberToObject(o, "iters", r->iters);
+    cJSON_AddNumberToObject(o, "errors", r->errors);
+    cJSON_AddNumberToObject(o, "p50_ns", (double)r->p50_ns);
+    cJSON_AddNumberToObject(o, "p90_ns", (double)r->p90_ns);
+    cJSON_AddNumberToObject(o, "p99_ns", (double)r->p99_ns);
+    cJSON_AddNumberToObject(o, "max_ns", (double)r->max_ns);
+    cJSON_AddNumberToObject(o, "mean_ns", (double)r->mean_ns);
+    if (r->mean_cycles >= 0) cJSON_AddNumberToObject(o, "mean_cycles", (double)r->mean_cycles);
+    else                     cJSON_AddNullToObject(o, "mean_cycles");
+    cJSON_AddNumberToObject(o, "heap_peak", r->heap_peak);
+    cJSON_AddNumberToObject(o, "heap_leak", r->heap_leak);
+    return o;
+}
+
+esp_err_t bench_run_all(const char *path)
+{
+    size_t count = 0;
+    const bench_case_t *cases = bench_cases(&count);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "target", CONFIG_IDF_TARGET);
+    cJSON_AddBoolToObject(root, "task_plan", CONFIG_APP_TASK_PLAN);
+    cJSON *arr = cJSON_AddArrayToObject(root, "cases");
+
+    for (size_t i = 0; i < count; ++i) {
+        bench_result_t r;
+        esp_err_t e = bench_run(&cases[i], &r);
+        if (e != ESP_OK) {
+            ESP_LOGE(TAG, "%s: %s", cases[i].name, esp_err_to_name(e));
+            continue;
+        }
+        if (r.skipped) ESP_LOGI(TAG, "%-12s skipped", r.name);
+        else ESP_LOGI(TAG, "%-12s n=%" PRIu32 " err=%" PRIu32 " p50=%" PRIu64 " p99=%" PRIu64
+                      " max=%" PRIu64 " ns heap=%" PRId32,
+                      r.name, r.iters, r.errors, r.p50_ns, r.p99_ns, r.max_ns, r.heap_peak);
+        cJSON_AddItemToArray(arr, result_json(&r));
+    }
+
+    char *txt = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!txt) return ESP_ERR_NO_MEM;
+
+    char def[80];
+    if (!path) {
+        snprintf(def, sizeof(def), "%s/bench.json", hal_fs_base_path());
+        path = def;
+    }
+    esp_err_t ret = ESP_OK;
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(txt, f);
+        fputc('\n', f);
+        fclose(f);
+        ESP_LOGI(TAG, "results -> %s", path);
+    } else {
+        ESP_LOGE(TAG, "cannot write %s", path);
+        ret = ESP_FAIL;
+    }
+    free(txt);
+    return ret;
+}
@@ -0,0 +1,1370 @@
+#include "bench.h"
+#include "i2c_bus.h"
+#include "hal_i2c.h"
+#include "sensor_ms5837.h"
+#include "dive_storage.h"
+#include "dive_session.h"
+#include "dive_space.h"
+#include "hal_fs.h"
+#include "wifi_net.h"
+#include "wifi_fast.h"
+#include "esp_http_client.h"
+#include "upload_http.h"
+#include "sync_codec.h"
+#include "dive_sync.h"
+#include "telemetry.h"
+#include "touch_detect.h"
+#include "rgb_led.h"
+#include "cJSON.h"
+#include "dlog.h"
+#include "trace.h"
+#include "metrics.h"
+#include "app_mem.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef CONFIG_APP_BENCH_UPLOAD_URL
+#define CONFIG_APP_BENCH_UPLOAD_URL ""
+#endif
+#ifndef CONFIG_APP_BENCH_SYNC_URL
+#define CONFIG_APP_BENCH_SYNC_URL ""
+#endif
+#ifndef CONFIG_APP_BENCH_MQTT_URI
+#define CONFIG_APP_BENCH_MQTT_URI ""
+#endif
+
+#define BENCH_DIVE_SAMPLES 200
+#define BENCH_UPLOAD_CHUNK 1024
+#define BENCH_JITTER_PERIOD_MS 10
+
+/* ---------- I²C : transaction ADC read via i2c_bus (simulée sur hôte) ---------- */
+#if CONFIG_IDF_TARGET_LINUX
+static esp_err_t sim_ms5837(void *ctx, uint8_t addr, const uint8_t *w, size_t wl, uint8_t *r, size_t rl)
+{
+    (void)ctx; (void)addr; (void)w; (void)wl;
+    static const uint8_t adc[3] = { 0x4B, 0xA7, 0xE3 };   // D1 = 4958179 (datasheet)
+    for (size_t i = 0; i < rl; ++i) r[i] = adc[i % 3];
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t i2c_setup(void **ctx)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    hal_i2c_sim_set_handler(sim_ms5837, NULL);
+#endif
+    return i2c_bus_create(0, 8, 9, 400000, (i2c_bus_t **)ctx);
+}
+
+static esp_err_t i2c_run(void *ctx)
+{
+    uint8_t b[3];
+    return i2c_bus_write_read(ctx, 0x76, (uint8_t[]){ 0x00 }, 1, b, sizeof(b), pdMS_TO_TICKS(20));
+}
+
+static void i2c_teardown(void *ctx)
+{
+    i2c_bus_destroy(ctx);
+#if CONFIG_IDF_TARGET_LINUX
+    hal_i2c_sim_set_handler(NULL, NULL);
+#endif
+}
+
+/* ---------- Conversion MS5837 (valeurs d'exemple de la datasheet) ---------- */
+static esp_err_t conv_run(void *ctx)
+{
+    (void)ctx;
+    static const uint16_t C[8] = { 0, 34982, 36352, 20328, 22354, 26646, 26146, 0 };
+    static volatile uint32_t d1 = 4958179, d2 = 6815414;   // volatile : pas de constant folding
+    sensor_measure_t m;
+    sensor_ms5837_convert(C, d1, d2, &m);
+    return (m.temperature_c > -50.0 && m.temperature_c < 100.0) ? ESP_OK : ESP_FAIL;
+}
+
+/* ---------- Queue : publication + consommation d'une mesure ---------- */
+static esp_err_t queue_setup(void **ctx)
+{
+    QueueHandle_t q = xQueueCreate(16, sizeof(sensor_measure_t));
+    if (!q) return ESP_ERR_NO_MEM;
+    *ctx = q;
+    return ESP_OK;
+}
+
+static esp_err_t queue_run(void *ctx)
+{
+    sensor_measure_t m = { .pressure_bar = 2.0, .temperature_c = 18.0 }, out;
+    if (xQueueSend(ctx, &m, 0) != pdTRUE) return ESP_FAIL;
+    return (xQueueReceive(ctx, &out, 0) == pdTRUE) ? ESP_OK : ESP_FAIL;
+}
+
+static void queue_teardown(void *ctx) { vQueueDelete(ctx); }
+
+/* ---------- Stockage : plongée de test ---------- */
+static esp_err_t bench_dive(const char *id, int samples)
+{
+    esp_err_t e = dive_storage_init();
+    if (e != ESP_OK) return e;
+    dive_storage_delete(id);
+
+    dive_metadata_t meta = { 0 };
+    strncpy(meta.id, id, sizeof(meta.id) - 1);
+    strncpy(meta.date, "2000-01-01T00:00:00", sizeof(meta.date) - 1);
+    e = dive_storage_create_dive(&meta);
+    for (int i = 0; e == ESP_OK && i < samples; ++i) {
+        dive_sample_t s = { .timestamp = 1000000ull * i, .temperature = 18.0f, .pressure = 1.0f + i * 0.01f };
+        e = dive_storage_append_sample(id, &s);
+    }
+    return e;
+}
+
+/* Lot de plongées <prefix>000.. : la i-ème a samples + i * step échantillons */
+static void bench_dives_id(const char *prefix, int i, char id[32])
+{
+    snprintf(id, 32, "%s%03d", prefix, i);
+}
+
+static void bench_dives_delete(const char *prefix, int n)
+{
+    char id[32];
+    for (int i = 0; i < n; ++i) {
+        bench_dives_id(prefix, i, id);
+        dive_storage_delete(id);
+    }
+}
+
+static esp_err_t bench_dives_create(const char *prefix, int n, int samples, int step)
+{
+    esp_err_t e = ESP_OK;
+    char id[32];
+    for (int i = 0; e == ESP_OK && i < n; ++i) {
+        bench_dives_id(prefix, i, id);
+        e = bench_dive(id, samples + i * step);
+    }
+    if (e != ESP_OK) bench_dives_delete(prefix, n);
+    return e;
+}
+
+static uint32_t s_seq;
+
+static esp_err_t append_setup(void **ctx)
+{
+    (void)ctx;
+    s_seq = 0;
+    return bench_dive("bench_app", 0);
+}
+
+static esp_err_t append_run(void *ctx)
+{
+    (void)ctx;
+    dive_sample_t s = { .timestamp = 1000000ull * s_seq, .temperature = 18.0f, .pressure = 2.0f };
+    s_seq++;
+    return dive_storage_append_sample("bench_app", &s);
+}
+
+static void append_teardown(void *ctx)
+{
+    (void)ctx;
+    dive_storage_delete("bench_app");
+}
+
+static esp_err_t export_setup(void **ctx)
+{
+    (void)ctx;
+    return bench_dive("bench_exp", BENCH_DIVE_SAMPLES);
+}
+
+static esp_err_t export_run(void *ctx)
+{
+    (void)ctx;
+    char *json = NULL;
+    esp_err_t e = dive_storage_export_dive_json("bench_exp", &json, NULL);
+    free(json);
+    return e;
+}
+
+static void export_teardown(void *ctx)
+{
+    (void)ctx;
+    dive_storage_delete("bench_exp");
+}
+
+/* ---------- Session de plongée sur un profil simulé (capteur -> flash) ----------
+ * Une itération = une mesure MS5837 (toutes les 500 ms en temps simulé, plus une
+ * TSYS01 sur deux) injectée dans dive_session avec le vrai dive_storage :
+ * surface 10 s, descente 18 m/min jusqu'à 18 m, fond 2 min, remontée 9 m/min,
+ * palier 1 min à 5 m, surface. La valeur est la latence de feed() (détection +
+ * append) ; le débit soutenu (échantillons/s de CPU) est journalisé à la fin. */
+#define BENCH_SESSION_DT_US 500000
+
+typedef struct {
+    dive_session_t s;
+    double   depth;
+    int      phase;
+    uint32_t k, hold;
+    int64_t  busy_us;               // temps passé dans feed()
+} session_ctx_t;
+/* Horloge simulée (pas de 500 ms) : la latence capteur de la session n'a pas
+ * de sens ici, la latence par pas est celle mesurée par le banc (p50/p99) */
+
+static esp_err_t session_setup(void **ctx)
+{
+    esp_err_t e = dive_storage_init();
+    if (e != ESP_OK) return e;
+    session_ctx_t *c = calloc(1, sizeof(*c));
+    if (!c) return ESP_ERR_NO_MEM;
+    dive_session_init(&c->s, NULL);
+    *ctx = c;
+    return ESP_OK;
+}
+
+/* Profondeur du pas suivant ; phase : surface, descente, fond, remontée, palier, remontée, surface */
+static void session_profile(session_ctx_t *c)
+{
+    const double down = 18.0 / 120, up = 9.0 / 120;   // m par pas de 500 ms
+    switch (c->phase) {
+        case 0: if (++c->hold >= 20) { c->phase = 1; c->hold = 0; } break;
+        case 1: c->depth += down; if (c->depth >= 18.0) c->phase = 2; break;
+        case 2: if (++c->hold >= 240) { c->phase = 3; c->hold = 0; } break;
+        case 3: c->depth -= up; if (c->depth <= 5.0) c->phase = 4; break;
+        case 4: if (++c->hold >= 120) c->phase = 5; break;
+        case 5: c->depth -= up; if (c->depth <= 0.0) { c->depth = 0.0; c->phase = 6; } break;
+        default: break;
+    }
+}
+
+static esp_err_t session_run(void *ctx)
+{
+    session_ctx_t *c = ctx;
+    session_profile(c);
+    uint64_t ts = (uint64_t)(++c->k) * BENCH_SESSION_DT_US;
+    sensor_measure_t m = {
+        .temperature_c = 20.0 - c->depth / 3.0,
+        .pressure_bar  = 1.013 + c->depth * 1029.0 * 9.80665 / 1e5,
+        .depth_m       = c->depth,
+        .ts_us         = ts,
+    };
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t e = dive_session_feed(&c->s, &m, (int64_t)ts);
+    if (e == ESP_OK && (c->k & 1)) {
+        sensor_measure_t t = { .temperature_c = m.temperature_c - 1.0, .ts_us = ts };
+        e = dive_session_feed(&c->s, &t, (int64_t)ts);
+    }
+    if (e == ESP_OK) e = dive_session_tick(&c->s, (int64_t)ts);
+    c->busy_us += esp_timer_get_time() - t0;
+    return e;
+}
+
+static void session_teardown(void *ctx)
+{
+    session_ctx_t *c = ctx;
+    const dive_session_stats_t *st = &c->s.stats;
+    ESP_LOGI("bench", "session: %u dives, %u samples stored (%u errors) in %lld ms of feed, %.0f samples/s, %s",
+             (unsigned)st->dives, (unsigned)st->samples_stored, (unsigned)st->store_errors,
+             (long long)(c->busy_us / 1000), c->busy_us ? st->samples_stored * 1e6 / c->busy_us : 0.0,
+             c->s.meta.has_summary ? "closed" : "NOT closed");
+    dive_session_abort(&c->s);
+    if (c->s.meta.id[0]) dive_storage_delete(c->s.meta.id);
+    free(c);
+}
+
+/* ---------- Détection eau/air sur trace simulée (touch_detect) ----------
+ * Une itération = une trace de 2000 lectures à CONFIG_APP_TOUCH_POLL_MS : à sec
+ * (dérive lente, bruit ±8 %, éclaboussures d'une ou deux lectures au-delà du
+ * seuil), immersion à la lecture 1000, sortie à la lecture 1500. Les
+ * itérations alternent les deux sens du capteur (ESP32, puis S2/S3). La valeur
+ * d'une itération est la latence de détection de l'immersion ; le bilan
+ * (fausses détections, latence de sortie) est journalisé à la fin. */
+#ifndef CONFIG_APP_TOUCH_POLL_MS
+#define CONFIG_APP_TOUCH_POLL_MS 200
+#endif
+#ifndef CONFIG_APP_TOUCH_THRESH_PCT
+#define CONFIG_APP_TOUCH_THRESH_PCT 70
+#endif
+#ifndef CONFIG_APP_TOUCH_EXIT_PCT
+#define CONFIG_APP_TOUCH_EXIT_PCT 80
+#endif
+#ifndef CONFIG_APP_TOUCH_DEBOUNCE
+#define CONFIG_APP_TOUCH_DEBOUNCE 3
+#endif
+#define TOUCH_TRACE_LEN  2000
+#define TOUCH_TRACE_IN   1000
+#define TOUCH_TRACE_OUT  1500
+
+typedef struct {
+    uint32_t rng;
+    uint32_t runs, false_wet, false_dry, missed;
+    uint64_t wet_reads, dry_reads;
+    uint64_t last_ns;
+} touch_trace_ctx_t;
+
+static int32_t touch_trace_noise(touch_trace_ctx_t *c, int32_t span)
+{
+    c->rng = c->rng * 1664525u + 1013904223u;
+    return (int32_t)((c->rng >> 8) % (uint32_t)(2 * span + 1)) - span;
+}
+
+static esp_err_t touch_trace_setup(void **ctx)
+{
+    touch_trace_ctx_t *c = calloc(1, sizeof(*c));
+    if (!c) return ESP_ERR_NO_MEM;
+    c->rng = 1;
+    *ctx = c;
+    return ESP_OK;
+}
+
+static esp_err_t touch_trace_run(void *ctx)
+{
+    touch_trace_ctx_t *c = ctx;
+    const bool rises = c->runs++ & 1;
+    const touch_detect_cfg_t cfg = {
+        .enter_pct = CONFIG_APP_TOUCH_THRESH_PCT,
+        .exit_pct  = CONFIG_APP_TOUCH_EXIT_PCT,
+        .debounce  = CONFIG_APP_TOUCH_DEBOUNCE,
+        .iir_shift = 4,
+        .rises     = rises,
+    };
+    const int32_t base0 = 20000, sign = rises ? 1 : -1;
+    touch_detect_t d;
+    touch_detect_init(&d, &cfg, (uint32_t)base0);
+
+    int wet_at = -1, dry_at = -1;
+    for (int i = 0; i < TOUCH_TRACE_LEN; i++) {
+        int32_t base = base0 + base0 / 20 * i / TOUCH_TRACE_LEN;      // dérive +5 %
+        int32_t delta = touch_trace_noise(c, base * 8 / 100);
+        bool in_water = i >= TOUCH_TRACE_IN && i < TOUCH_TRACE_OUT;
+        if (in_water) delta += sign * base * 55 / 100;
+        else if (i % 97 == 0 || (i % 97 == 1 && (i & 1))) delta += sign * base * 35 / 100;
+        touch_detect_evt_t ev = touch_detect_update(&d, (uint32_t)(base + delta));
+        if (ev == TOUCH_DETECT_WET) {
+            if (!in_water) c->false_wet++;
+            else if (wet_at < 0) wet_at = i;
+        } else if (ev == TOUCH_DETECT_DRY) {
+            if (in_water) c->false_dry++;
+            else if (i >= TOUCH_TRACE_OUT && dry_at < 0) dry_at = i;
+        }
+    }
+    if (wet_at < 0 || dry_at < 0) {
+        c->missed++;
+        return ESP_FAIL;
+    }
+    c->wet_reads += (uint32_t)(wet_at - TOUCH_TRACE_IN + 1);
+    c->dry_reads += (uint32_t)(dry_at - TOUCH_TRACE_OUT + 1);
+    c->last_ns = (uint64_t)(wet_at - TOUCH_TRACE_IN + 1) * CONFIG_APP_TOUCH_POLL_MS * 1000000u;
+    return ESP_OK;
+}
+
+static uint64_t touch_trace_sample(void *ctx) { return ((touch_trace_ctx_t *)ctx)->last_ns; }
+
+static void touch_trace_teardown(void *ctx)
+{
+    touch_trace_ctx_t *c = ctx;
+    uint32_t ok = c->runs - c->missed;
+    ESP_LOGI("bench", "touch_trace: %u traces, %u missed, false wet %u / dry %u (%u dry reads), "
+             "latency wet %.1f dry %.1f reads (x %d ms)", (unsigned)c->runs, (unsigned)c->missed,
+             (unsigned)c->false_wet, (unsigned)c->false_dry,
+             (unsigned)(c->runs * (TOUCH_TRACE_LEN - (TOUCH_TRACE_OUT - TOUCH_TRACE_IN))),
+             ok ? (double)c->wet_reads / ok : 0.0, ok ? (double)c->dry_reads / ok : 0.0,
+             CONFIG_APP_TOUCH_POLL_MS);
+    free(c);
+}
+
+/* ---------- Fondus LED contre le LEDC simulé (hôte seulement) ----------
+ * Scénarios : fondu normal (rappel unique, refus pendant le fondu), échec d'un
+ * canal après un lancement (rappel des canaux partis, canal échoué relancé au
+ * fondu suivant), échec du premier canal, échec après des fondus déjà finis.
+ * Une itération les enchaîne ; un écart compte une erreur. */
+#if CONFIG_IDF_TARGET_LINUX
+typedef struct {
+    uint32_t done;                      // rappels de fin reçus
+    uint32_t failed;                    // scénarios en écart
+} led_fade_ctx_t;
+
+static bool led_fade_done(void *arg)
+{
+    ((led_fade_ctx_t *)arg)->done++;
+    return false;
+}
+
+static bool led_fade_check(led_fade_ctx_t *c, const char *what, bool ok)
+{
+    if (!ok) {
+        c->failed++;
+        ESP_LOGE("bench", "led_fade: %s", what);
+    }
+    return ok;
+}
+
+static esp_err_t led_fade_setup(void **ctx)
+{
+    led_fade_ctx_t *c = calloc(1, sizeof(*c));
+    if (!c) return ESP_ERR_NO_MEM;
+    esp_err_t e = rgb_led_init();
+    if (e == ESP_OK) e = rgb_led_fade_init(led_fade_done, c);
+    if (e != ESP_OK) {
+        free(c);
+        return e;
+    }
+    *ctx = c;
+    return ESP_OK;
+}
+
+static esp_err_t led_fade_run(void *ctx)
+{
+    led_fade_ctx_t *c = ctx;
+    const uint32_t failed0 = c->failed;
+    bool st = false;
+    esp_err_t e;
+
+    // départ connu, fondus immédiats
+    hal_pwm_sim_defer_fades(false);
+    rgb_led_fade_rgb(0, 0, 0, 0, &st);
+
+    // 1. fondu normal : refus pendant le fondu, un seul rappel pour trois canaux
+    hal_pwm_sim_defer_fades(true);
+    c->done = 0;
+    e = rgb_led_fade_rgb(255, 128, 40, 100, &st);
+    led_fade_check(c, "normal start", e == ESP_OK && st);
+    e = rgb_led_fade_rgb(1, 2, 3, 100, &st);
+    led_fade_check(c, "busy refused", e == ESP_ERR_INVALID_STATE && !st);
+    led_fade_check(c, "normal end", hal_pwm_sim_complete_fades() == 3 && c->done == 1);
+
+    // 2. R lancé, G échoue : R rappelle quand même ; G reste à l'ancienne valeur
+    c->done = 0;
+    hal_pwm_sim_fail_next_fade(1);
+    e = rgb_led_fade_rgb(0, 0, 40, 100, &st);
+    led_fade_check(c, "fail G", e != ESP_OK && st);
+    led_fade_check(c, "fail G end", hal_pwm_sim_complete_fades() == 1 && c->done == 1);
+    e = rgb_led_fade_rgb(0, 0, 40, 100, &st);   // seul G diffère encore
+    led_fade_check(c, "retry G", e == ESP_OK && st);
+    led_fade_check(c, "retry G end", hal_pwm_sim_complete_fades() == 1 && c->done == 2);
+
+    // 3. échec du premier canal : rien de lancé, pas de rappel, pas de blocage
+    c->done = 0;
+    hal_pwm_sim_fail_next_fade(0);
+    e = rgb_led_fade_rgb(200, 0, 40, 100, &st);
+    led_fade_check(c, "fail R", e != ESP_OK && !st && hal_pwm_sim_complete_fades() == 0);
+
+    // 4. fondus finis avant l'échec de B (fin immédiate) : pas de rappel attendu
+    hal_pwm_sim_defer_fades(false);
+    hal_pwm_sim_fail_next_fade(2);
+    e = rgb_led_fade_rgb(100, 100, 100, 100, &st);
+    led_fade_check(c, "fail B after ends", e != ESP_OK && !st && c->done == 0);
+    e = rgb_led_fade_rgb(100, 100, 100, 100, &st);
+    led_fade_check(c, "not stuck", e == ESP_OK && st && c->done == 1);
+
+    return c->failed == failed0 ? ESP_OK : ESP_FAIL;
+}
+
+static void led_fade_teardown(void *ctx)
+{
+    led_fade_ctx_t *c = ctx;
+    ESP_LOGI("bench", "led_fade: %u checks failed", (unsigned)c->failed);
+    hal_pwm_sim_defer_fades(false);
+    rgb_led_deinit();
+    free(c);
+}
+#else
+static esp_err_t led_fade_setup(void **ctx) { (void)ctx; return ESP_ERR_NOT_SUPPORTED; }
+static esp_err_t led_fade_run(void *ctx) { (void)ctx; return ESP_OK; }
+static void led_fade_teardown(void *ctx) { (void)ctx; }
+#endif
+
+/* ---------- Reconnexion Wi-Fi rapide : séquences d'événements simulées ----------
+ * wifi_fast est de la logique pure : on lui rejoue ce que le driver enverrait
+ * (scan à froid, directe avec et sans bail frais, DHCP lent, AP disparu,
+ * échéances, perte après UP, autres identifiants, IP fixe, cache corrompu) et
+ * on vérifie actions, phase et cache. Un écart compte une erreur. */
+typedef struct {
+    wifi_cache_t cache;
+    wifi_fsm_t   f;
+    uint32_t     failed;
+} wifi_fsm_ctx_t;
+
+static wifi_act_t wifi_ev(wifi_fsm_ctx_t *c, wifi_ev_kind_t k, int64_t now_s)
+{
+    const wifi_ev_t ev = { .kind = k, .bssid = { 1, 2, 3, 4, 5, 6 }, .channel = 6,
+                           .lease = { 0x0a00000a, 0x00ffffff, 0x0100000a, 0x0100000a } };
+    return wifi_fast_event(&c->f, &ev, now_s);
+}
+
+static void wifi_check(wifi_fsm_ctx_t *c, const char *what, bool ok)
+{
+    if (!ok) {
+        c->failed++;
+        ESP_LOGE("bench", "wifi_fsm: %s", what);
+    }
+}
+
+static esp_err_t wifi_fsm_setup(void **ctx)
+{
+    *ctx = calloc(1, sizeof(wifi_fsm_ctx_t));
+    return *ctx ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t wifi_fsm_run(void *ctx)
+{
+    wifi_fsm_ctx_t *c = ctx;
+    wifi_fsm_t *f = &c->f;
+    const uint32_t failed0 = c->failed;
+    const uint32_t cred = wifi_fast_cred("ssid", "pass");
+    wifi_fast_cache_clear(&c->cache);
+
+    // 1. à froid : scan + DHCP, bail mis en cache
+    wifi_check(c, "cold begin", wifi_fast_begin(f, &c->cache, cred, false, false) == WIFI_PHASE_SCAN);
+    wifi_check(c, "cold start", wifi_ev(c, WIFI_EV_START, 100) == WIFI_ACT_CONNECT);
+    wifi_check(c, "cold retry", wifi_ev(c, WIFI_EV_DISCONNECTED, 100) == WIFI_ACT_CONNECT);
+    wifi_check(c, "cold assoc", wifi_ev(c, WIFI_EV_CONNECTED, 100) == WIFI_ACT_NONE &&
+                                f->phase == WIFI_PHASE_DHCP && !f->fast);
+    wifi_check(c, "cold ip", wifi_ev(c, WIFI_EV_GOT_IP, 100) == WIFI_ACT_UP && !f->fast);
+    wifi_check(c, "cold cache", wifi_fast_cache_valid(&c->cache, cred) && c->cache.channel == 6 &&
+                                c->cache.has_lease && c->cache.lease_t == 100);
+
+    // 2. directe, bail frais : UP dès l'association, bail gardé avec sa date
+    bool fresh = wifi_fast_lease_fresh(&c->cache, 200, 1800);
+    wifi_check(c, "lease fresh", fresh);
+    wifi_check(c, "fast begin", wifi_fast_begin(f, &c->cache, cred, false, fresh) == WIFI_PHASE_FAST &&
+                                f->lease_used);
+    wifi_check(c, "fast start", wifi_ev(c, WIFI_EV_START, 200) == WIFI_ACT_CONNECT);
+    wifi_check(c, "fast up", wifi_ev(c, WIFI_EV_CONNECTED, 200) == WIFI_ACT_UP && f->fast);
+    wifi_check(c, "fast lease kept", c->cache.lease_t == 100 && wifi_fast_cache_valid(&c->cache, cred));
+    wifi_check(c, "late ip ignored", wifi_ev(c, WIFI_EV_GOT_IP, 200) == WIFI_ACT_NONE);
+
+    // 3. directe, bail périmé, DHCP plus long que l'échéance rapide : pas de repli
+    wifi_check(c, "lease stale", !wifi_fast_lease_fresh(&c->cache, 5000, 1800));
+    wifi_check(c, "dhcp begin", wifi_fast_begin(f, &c->cache, cred, false, false) == WIFI_PHASE_FAST &&
+                                !f->lease_used);
+    wifi_check(c, "dhcp assoc", wifi_ev(c, WIFI_EV_CONNECTED, 5000) == WIFI_ACT_NONE &&
+                                f->phase == WIFI_PHASE_DHCP && f->fast);
+    wifi_check(c, "fast timeout after assoc", wifi_fast_timeout(f, false, 5001) == WIFI_ACT_NONE &&
+                                              f->phase == WIFI_PHASE_DHCP);
+    wifi_check(c, "dhcp ip", wifi_ev(c, WIFI_EV_GOT_IP, 5002) == WIFI_ACT_UP && f->fast &&
+                             c->cache.lease_t == 5002);
+
+    // 4. perte après UP en directe : rescan, pas un raté, cache gardé
+    wifi_check(c, "up drop", wifi_ev(c, WIFI_EV_DISCONNECTED, 5100) == WIFI_ACT_RESCAN &&
+                             f->phase == WIFI_PHASE_SCAN && wifi_fast_cache_valid(&c->cache, cred));
+    wifi_check(c, "up drop reassoc", wifi_ev(c, WIFI_EV_CONNECTED, 5100) == WIFI_ACT_NONE && !f->fast);
+    wifi_check(c, "up drop ip", wifi_ev(c, WIFI_EV_GOT_IP, 5101) == WIFI_ACT_UP && !f->fast);
+
+    // 5. association directe perdue avant le bail : raté, cache oublié
+    wifi_fast_begin(f, &c->cache, cred, false, false);
+    wifi_ev(c, WIFI_EV_CONNECTED, 5200);
+    wifi_check(c, "dhcp drop", wifi_ev(c, WIFI_EV_DISCONNECTED, 5200) == WIFI_ACT_FALLBACK &&
+                               !wifi_fast_cache_valid(&c->cache, cred) && f->phase == WIFI_PHASE_SCAN);
+    wifi_check(c, "dhcp drop scan", wifi_ev(c, WIFI_EV_CONNECTED, 5201) == WIFI_ACT_NONE &&
+                                    wifi_ev(c, WIFI_EV_GOT_IP, 5201) == WIFI_ACT_UP && !f->fast);
+
+    // 6. AP disparu : refus en directe -> repli, puis scan
+    bool lease_ok = wifi_fast_lease_fresh(&c->cache, 6000, 1800);
+    wifi_check(c, "gone begin", wifi_fast_begin(f, &c->cache, cred, false, lease_ok) == WIFI_PHASE_FAST);
+    wifi_check(c, "gone refused", wifi_ev(c, WIFI_EV_DISCONNECTED, 6000) == WIFI_ACT_FALLBACK &&
+                                  !wifi_fast_cache_valid(&c->cache, cred) && f->phase == WIFI_PHASE_SCAN);
+    wifi_check(c, "gone retry", wifi_ev(c, WIFI_EV_DISCONNECTED, 6000) == WIFI_ACT_CONNECT);
+    wifi_ev(c, WIFI_EV_CONNECTED, 6000);
+    wifi_check(c, "gone ip", wifi_ev(c, WIFI_EV_GOT_IP, 6001) == WIFI_ACT_UP && !f->fast &&
+                             c->cache.lease_t == 6001);
+
+    // 7. échéances : directe puis abandon (scan, puis DHCP)
+    wifi_fast_begin(f, &c->cache, cred, false, true);
+    wifi_check(c, "final ignored in fast", wifi_fast_timeout(f, true, 7000) == WIFI_ACT_NONE);
+    wifi_check(c, "fast timeout", wifi_fast_timeout(f, false, 7000) == WIFI_ACT_FALLBACK);
+    wifi_check(c, "scan give up", wifi_fast_timeout(f, true, 7000) == WIFI_ACT_GIVE_UP &&
+                                  f->phase == WIFI_PHASE_FAILED);
+    wifi_check(c, "failed quiet", wifi_ev(c, WIFI_EV_DISCONNECTED, 7000) == WIFI_ACT_NONE);
+    wifi_fast_begin(f, &c->cache, cred, false, false);
+    wifi_ev(c, WIFI_EV_CONNECTED, 7100);
+    wifi_check(c, "dhcp give up", wifi_fast_timeout(f, true, 7100) == WIFI_ACT_GIVE_UP);
+
+    // 8. autres identifiants : cache ignoré
+    wifi_fast_begin(f, &c->cache, cred, false, false);
+    wifi_ev(c, WIFI_EV_CONNECTED, 8000);
+    wifi_ev(c, WIFI_EV_GOT_IP, 8000);
+    wifi_check(c, "other cred", wifi_fast_begin(f, &c->cache, wifi_fast_cred("other", "pass"), false, true) ==
+                                WIFI_PHASE_SCAN);
+
+    // 9. IP fixe : UP à l'association, pas de bail en cache
+    wifi_check(c, "fixed begin", wifi_fast_begin(f, &c->cache, cred, true, true) == WIFI_PHASE_SCAN);
+    wifi_check(c, "fixed up", wifi_ev(c, WIFI_EV_CONNECTED, 9000) == WIFI_ACT_UP && !c->cache.has_lease &&
+                              wifi_fast_cache_valid(&c->cache, cred));
+    wifi_check(c, "fixed fast", wifi_fast_begin(f, &c->cache, cred, true, true) == WIFI_PHASE_FAST &&
+                                !f->lease_used && wifi_ev(c, WIFI_EV_CONNECTED, 9000) == WIFI_ACT_UP && f->fast);
+
+    // 10. cache corrompu
+    c->cache.channel ^= 1;
+    wifi_check(c, "corrupt", !wifi_fast_cache_valid(&c->cache, cred));
+
+    return c->failed == failed0 ? ESP_OK : ESP_FAIL;
+}
+
+static void wifi_fsm_teardown(void *ctx)
+{
+    wifi_fsm_ctx_t *c = ctx;
+    ESP_LOGI("bench", "wifi_fsm: %u checks failed", (unsigned)c->failed);
+    free(c);
+}
+
+/* ---------- Ajout à 50/80/95 % de remplissage, sans puis avec réservation ----------
+ * Le FS est rempli de fichiers de 8 Ko dont un sur quatre est réécrit (pages
+ * sales, comme après des suppressions) ; une itération = un ajout à bench_fill.
+ * "_rsv" appelle d'abord dive_space_maintain() comme une fin de plongée puis
+ * dive_space_check() comme le début de la suivante (les deux évincent donc des
+ * plongées synchronisées) : comparer p99/max des deux variantes. Cible
+ * seulement (FS de l'hôte = son disque). */
+#define BENCH_FILL_CHUNK 8192
+
+typedef struct {
+    int  files;
+    bool reserved;
+} fill_ctx_t;
+
+static void fill_path(int i, char *out, size_t n)
+{
+    snprintf(out, n, "%s/bench_fill_%04d", hal_fs_base_path(), i);
+}
+
+static bool fill_write(int i, const void *buf)
+{
+    char path[96];
+    fill_path(i, path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(buf, 1, BENCH_FILL_CHUNK, f) == BENCH_FILL_CHUNK;
+    return fclose(f) == 0 && ok;
+}
+
+static void fill_teardown(void *ctx)
+{
+    fill_ctx_t *c = ctx;
+    char path[96];
+    for (int i = 0; i < c->files; ++i) {
+        fill_path(i, path, sizeof(path));
+        unlink(path);
+    }
+    dive_storage_delete("bench_fill");
+    free(c);
+}
+
+static esp_err_t fill_setup(void **ctx, int pct, bool reserve)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+    esp_err_t e = bench_dive("bench_fill", 0);
+    if (e != ESP_OK) return e;
+    fill_ctx_t *c = calloc(1, sizeof(*c));
+    uint8_t *buf = malloc(BENCH_FILL_CHUNK);
+    if (!c || !buf) {
+        free(buf);
+        free(c);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(buf, 0x5A, BENCH_FILL_CHUNK);
+    size_t total = 0, used = 0;
+    while (hal_fs_info(&total, &used) == ESP_OK && used < total / 100 * pct && fill_write(c->files, buf))
+        c->files++;
+    for (int i = 0; i < c->files; i += 4) {
+        char path[96];
+        fill_path(i, path, sizeof(path));
+        unlink(path);
+        fill_write(i, buf);
+    }
+    free(buf);
+    hal_fs_info(&total, &used);
+    ESP_LOGI("bench", "fill %d%%: %d files, used %u/%u", pct, c->files, (unsigned)used, (unsigned)total);
+    if (reserve) {
+        dive_space_maintain(NULL);
+        c->reserved = dive_space_check(NULL) == ESP_OK;
+    }
+    s_seq = 0;
+    *ctx = c;
+    return ESP_OK;
+}
+
+static esp_err_t fill_run(void *ctx)
+{
+    (void)ctx;
+    dive_sample_t s = { .timestamp = 1000000ull * s_seq, .temperature = 18.0f, .pressure = 2.0f };
+    s_seq++;
+    return dive_storage_append_sample("bench_fill", &s);
+}
+
+static esp_err_t fill50_setup(void **ctx)     { return fill_setup(ctx, 50, false); }
+static esp_err_t fill80_setup(void **ctx)     { return fill_setup(ctx, 80, false); }
+static esp_err_t fill95_setup(void **ctx)     { return fill_setup(ctx, 95, false); }
+static esp_err_t fill50_rsv_setup(void **ctx) { return fill_setup(ctx, 50, true); }
+static esp_err_t fill80_rsv_setup(void **ctx) { return fill_setup(ctx, 80, true); }
+static esp_err_t fill95_rsv_setup(void **ctx) { return fill_setup(ctx, 95, true); }
+
+/* ---------- Parcours des plongées : 100 plongées, mémoire constante ----------
+ * Une itération = un dive_iter complet (métadonnées comprises), ordre croissant
+ * vérifié ; hors métadonnées, une ouverture de l'index par page de DIVE_ITER_PAGE.
+ * Les ids bench_i* précèdent les dive_* : chaque création réécrit l'index (setup). */
+#define BENCH_ITER_DIVES 100
+
+static void iter_teardown(void *ctx)
+{
+    (void)ctx;
+    bench_dives_delete("bench_i", BENCH_ITER_DIVES);
+}
+
+static esp_err_t iter_setup(void **ctx)
+{
+    (void)ctx;
+    return bench_dives_create("bench_i", BENCH_ITER_DIVES, 0, 0);
+}
+
+static esp_err_t iter_run(void *ctx)
+{
+    (void)ctx;
+    dive_iter_t it;
+    dive_iter_init(&it, NULL);
+    char id[32], prev[32] = "";
+    dive_metadata_t m;
+    int n = 0;
+    esp_err_t e;
+    while ((e = dive_iter_next(&it, id, &m)) == ESP_OK) {
+        if (strcmp(id, prev) <= 0) return ESP_FAIL;
+        strcpy(prev, id);
+        if (strncmp(id, "bench_i", 7) == 0) n++;
+    }
+    if (e != ESP_ERR_NOT_FOUND) return e;
+    return n == BENCH_ITER_DIVES ? ESP_OK : ESP_FAIL;
+}
+
+/* ---------- JSON : sérialisation d'un lot d'échantillons en mémoire ---------- */
+static esp_err_t json_run(void *ctx)
+{
+    (void)ctx;
+    cJSON *arr = cJSON_CreateArray();
+    if (!arr) return ESP_ERR_NO_MEM;
+    for (int i = 0; i < 50; ++i) {
+        cJSON *o = cJSON_CreateObject();
+        cJSON_AddNumberToObject(o, "ts_us", 1000000.0 * i);
+        cJSON_AddNumberToObject(o, "temp_c", 18.25);
+        cJSON_AddNumberToObject(o, "press_bar", 2.0 + i * 0.01);
+        cJSON_AddItemToArray(arr, o);
+    }
+    char *txt = cJSON_PrintUnformatted(arr);
+    cJSON_Delete(arr);
+    if (!txt) return ESP_ERR_NO_MEM;
+    free(txt);
+    return ESP_OK;
+}
+
+/* ---------- Bloc de synchro : JSON vs protobuf, mêmes échantillons ----------
+ * Tailles des deux corps loggées au setup de chunk_pb. chunk_pb mesure
+ * l'encodeur en flux (celui de dive_sync) ; son setup vérifie aussi le bloc de
+ * référence et que flux et tampon donnent les mêmes octets. */
+#define BENCH_CHUNK_SAMPLES 256
+
+/* Même vecteur que GOLDEN_PB de tools/sync_server.py (--self-check le décode) */
+static const uint8_t GOLDEN_PB[] = {
+    0x0a, 0x08, 0x65, 0x73, 0x70, 0x33, 0x32, 0x2d, 0x73, 0x33, 0x12, 0x0f, 0x64, 0x69, 0x76, 0x65,
+    0x5f, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x34, 0x32, 0x20, 0x01, 0x2a, 0x55, 0x0a,
+    0x0f, 0x64, 0x69, 0x76, 0x65, 0x5f, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x34, 0x32,
+    0x12, 0x13, 0x32, 0x30, 0x32, 0x36, 0x2d, 0x31, 0x30, 0x2d, 0x31, 0x38, 0x54, 0x31, 0x30, 0x3a,
+    0x30, 0x30, 0x3a, 0x30, 0x30, 0x1a, 0x09, 0x50, 0x6f, 0x72, 0x74, 0x2d, 0x43, 0x72, 0x6f, 0x73,
+    0x22, 0x01, 0x41, 0x2a, 0x1f, 0x08, 0x03, 0x10, 0x01, 0x1d, 0x00, 0x00, 0x48, 0x41, 0x25, 0x00,
+    0x00, 0x04, 0x41, 0x2d, 0x00, 0x00, 0x8e, 0x41, 0x35, 0x00, 0x00, 0x92, 0x41, 0x3d, 0x00, 0x00,
+    0x10, 0x41, 0x40, 0x01, 0x32, 0x2e, 0x08, 0x80, 0x80, 0xf9, 0xc0, 0xc1, 0xc4, 0x82, 0x03, 0x12,
+    0x07, 0x00, 0xc0, 0x84, 0x3d, 0xbf, 0x9a, 0x0c, 0x1a, 0x0c, 0x00, 0x00, 0x92, 0x41, 0x00, 0x00,
+    0x90, 0x41, 0x00, 0x00, 0x8e, 0x41, 0x22, 0x0c, 0xfc, 0xa9, 0x81, 0x3f, 0x00, 0x00, 0x20, 0x40,
+    0x00, 0x00, 0x10, 0x40,
+};
+
+static esp_err_t golden_check(void)
+{
+    dive_metadata_t m = { .has_summary = true };
+    strlcpy(m.id, "dive_0000000042", sizeof(m.id));
+    strlcpy(m.date, "2026-10-18T10:00:00", sizeof(m.date));
+    strlcpy(m.location, "Port-Cros", sizeof(m.location));
+    strlcpy(m.diver, "A", sizeof(m.diver));
+    m.summary = (dive_summary_t){ .samples = 3, .duration_s = 1, .max_depth_m = 12.5f, .avg_depth_m = 8.25f,
+                                  .min_temp_c = 17.75f, .max_temp_c = 18.25f, .max_ascent_m_min = 9.0f,
+                                  .descent_s = 1 };
+    const dive_sample_t s[3] = {
+        { .timestamp = 1700000000000000ULL, .temperature = 18.25f, .pressure = 1.013f },
+        { .timestamp = 1700000000500000ULL, .temperature = 18.0f,  .pressure = 2.5f },
+        { .timestamp = 1700000000400000ULL, .temperature = 17.75f, .pressure = 2.25f },   // delta < 0
+    };
+    sync_chunk_t ch = { .meta = &m, .from = 0, .s = s, .n = 3, .final = true };
+    char *out;
+    size_t len;
+    esp_err_t e = sync_chunk_encode(SYNC_FMT_PB, &ch, &out, &len);
+    if (e != ESP_OK) return e;
+    bool same = len == sizeof(GOLDEN_PB) && memcmp(out, GOLDEN_PB, len) == 0;
+    free(out);
+    if (!same) ESP_LOGE("bench", "chunk_pb: encoder output differs from the reference chunk");
+    return same ? ESP_OK : ESP_FAIL;
+}
+
+/* Puits du flux : compte, ou compare à un tampon de référence */
+typedef struct {
+    const char *ref;
+    size_t      ref_len;
+    size_t      len;
+    bool        diff;
+} pb_sink_t;
+
+static esp_err_t pb_sink(void *sink, const void *d, size_t n)
+{
+    pb_sink_t *k = sink;
+    if (k->ref && (k->len + n > k->ref_len || memcmp(k->ref + k->len, d, n) != 0)) k->diff = true;
+    k->len += n;
+    return ESP_OK;
+}
+
+typedef struct {
+    dive_metadata_t meta;
+    dive_sample_t   s[BENCH_CHUNK_SAMPLES];
+} chunk_ctx_t;
+
+static esp_err_t chunk_setup(void **ctx)
+{
+    chunk_ctx_t *c = calloc(1, sizeof(*c));
+    if (!c) return ESP_ERR_NO_MEM;
+    strlcpy(c->meta.id, "bench_chunk", sizeof(c->meta.id));
+    for (int i = 0; i < BENCH_CHUNK_SAMPLES; ++i) {
+        c->s[i].timestamp   = 1700000000000000ULL + 1000000ULL * i;
+        c->s[i].temperature = 18.25f - 0.01f * i;
+        c->s[i].pressure    = 1.013f + 0.0125f * i;
+    }
+    *ctx = c;
+    return ESP_OK;
+}
+
+static esp_err_t chunk_encode(void *ctx, sync_fmt_t fmt, size_t *len)
+{
+    chunk_ctx_t *c = ctx;
+    sync_chunk_t ch = { .meta = &c->meta, .from = 1, .s = c->s, .n = BENCH_CHUNK_SAMPLES };
+    char *out;
+    esp_err_t e = sync_chunk_encode(fmt, &ch, &out, len);
+    if (e == ESP_OK) free(out);
+    return e;
+}
+
+static esp_err_t chunk_json_run(void *ctx) { size_t n; return chunk_encode(ctx, SYNC_FMT_JSON, &n); }
+
+static esp_err_t chunk_pb_run(void *ctx)
+{
+    chunk_ctx_t *c = ctx;
+    sync_chunk_t ch = { .meta = &c->meta, .from = 1, .s = c->s, .n = BENCH_CHUNK_SAMPLES };
+    pb_sink_t k = { 0 };
+    esp_err_t e = sync_chunk_pb_write(&ch, pb_sink, &k);
+    return e == ESP_OK && k.len == sync_chunk_pb_len(&ch) ? e : ESP_FAIL;
+}
+
+static esp_err_t chunk_pb_setup(void **ctx)
+{
+    esp_err_t e = golden_check();
+    if (e == ESP_OK) e = chunk_setup(ctx);
+    if (e != ESP_OK) return e;
+    chunk_ctx_t *c = *ctx;
+    sync_chunk_t ch = { .meta = &c->meta, .from = 1, .s = c->s, .n = BENCH_CHUNK_SAMPLES };
+    size_t jl = 0, pl = 0;
+    char *buf = NULL;
+    e = chunk_encode(c, SYNC_FMT_JSON, &jl);
+    if (e == ESP_OK) e = sync_chunk_encode(SYNC_FMT_PB, &ch, &buf, &pl);
+    if (e == ESP_OK) {
+        // en flux : mêmes octets que l'encodage en tampon
+        pb_sink_t k = { .ref = buf, .ref_len = pl };
+        e = sync_chunk_pb_write(&ch, pb_sink, &k);
+        if (e == ESP_OK && (k.diff || k.len != pl)) e = ESP_FAIL;
+    }
+    free(buf);
+    if (e == ESP_OK) {
+        ESP_LOGI("bench", "chunk %d samples: json %u B, protobuf %u B",
+                 BENCH_CHUNK_SAMPLES, (unsigned)jl, (unsigned)pl);
+    } else {
+        free(c);
+    }
+    return e;
+}
+
+/* ---------- Log par échantillon : différé vs ESP_LOGI (même format, 4 conversions) ---------- */
+static const char *LOG_TAG = "bench_log";
+
+static esp_err_t dlog_run(void *ctx)
+{
+    (void)ctx;
+    static uint64_t ts;
+    DLOGI(LOG_TAG, "[%s] T=%.2f C P=%.3f bar ts=%llu", "MS5837", 18.25, 2.013, (unsigned long long)++ts);
+    return ESP_OK;
+}
+
+static void dlog_teardown(void *ctx)
+{
+    (void)ctx;
+    dlog_flush();
+}
+
+static esp_err_t logi_run(void *ctx)
+{
+    (void)ctx;
+    static uint64_t ts;
+    ESP_LOGI(LOG_TAG, "[%s] T=%.2f C P=%.3f bar ts=%llu", "MS5837", 18.25, 2.013, (unsigned long long)++ts);
+    return ESP_OK;
+}
+
+/* ---------- Coût d'un événement de trace ---------- */
+static esp_err_t trace_run(void *ctx)
+{
+    (void)ctx;
+    trace_record(TRACE_EV_QUEUE_SEND, TRACE_PH_INSTANT, 1);
+    return ESP_OK;
+}
+
+/* ---------- Coût d'une mise à jour de métrique (histogramme, le plus cher) ---------- */
+METRIC_HISTO(s_bench_histo, "bench.histo");
+
+static esp_err_t metric_run(void *ctx)
+{
+    (void)ctx;
+    static uint32_t v;
+    metric_observe(&s_bench_histo, (v += 37) & 0xFFFF);
+    return ESP_OK;
+}
+
+/* ---------- Upload : export streamé par blocs vers CONFIG_APP_BENCH_UPLOAD_URL ---------- */
+typedef struct {
+    char          *json;
+    size_t         len;
+    upload_stats_t st;           // cas upload_z
+} upload_ctx_t;
+
+static esp_err_t upload_setup(void **ctx)
+{
+    if (!CONFIG_APP_BENCH_UPLOAD_URL[0]) return ESP_ERR_NOT_SUPPORTED;
+
+    upload_ctx_t *u = calloc(1, sizeof(*u));
+    if (!u) return ESP_ERR_NO_MEM;
+    esp_err_t e = bench_dive("bench_up", BENCH_DIVE_SAMPLES);
+    if (e == ESP_OK) e = dive_storage_export_dive_json("bench_up", &u->json, &u->len);
+    if (e == ESP_OK) e = wifi_net_connect(10000);
+    if (e != ESP_OK) {
+        free(u->json);
+        free(u);
+        return e;
+    }
+    *ctx = u;
+    return ESP_OK;
+}
+
+static esp_err_t upload_run(void *ctx)
+{
+    upload_ctx_t *u = ctx;
+    esp_http_client_config_t cfg = { .url = CONFIG_APP_BENCH_UPLOAD_URL, .timeout_ms = 8000 };
+    esp_http_client_handle_t cli = esp_http_client_init(&cfg);
+    if (!cli) return ESP_ERR_NO_MEM;
+
+    esp_http_client_set_method(cli, HTTP_METHOD_POST);
+    esp_http_client_set_header(cli, "Content-Type", "application/json");
+    esp_err_t e = esp_http_client_open(cli, (int)u->len);
+    for (size_t off = 0; e == ESP_OK && off < u->len; ) {
+        int n = (int)(u->len - off < BENCH_UPLOAD_CHUNK ? u->len - off : BENCH_UPLOAD_CHUNK);
+        int w = esp_http_client_write(cli, u->json + off, n);
+        if (w <= 0) e = ESP_FAIL;
+        else off += (size_t)w;
+    }
+    if (e == ESP_OK && esp_http_client_fetch_headers(cli) < 0) e = ESP_FAIL;
+    if (e == ESP_OK && esp_http_client_get_status_code(cli) / 100 != 2) e = ESP_FAIL;
+    esp_http_client_cleanup(cli);
+    return e;
+}
+
+static void upload_teardown(void *ctx)
+{
+    upload_ctx_t *u = ctx;
+    wifi_net_stop();
+    dive_storage_delete("bench_up");
+    free(u->json);
+    free(u);
+}
+
+/* ---------- Upload compressé : même plongée que "upload", via upload_post() ----------
+ * Durée à comparer à "upload" ; taux de compression et CPU tdefl loggés au teardown. */
+static esp_err_t upload_z_setup(void **ctx)
+{
+    if (upload_default_encoding() == UPLOAD_ENC_IDENTITY) return ESP_ERR_NOT_SUPPORTED;
+    return upload_setup(ctx);
+}
+
+static esp_err_t upload_z_run(void *ctx)
+{
+    upload_ctx_t *u = ctx;
+    upload_req_t r = { .url = CONFIG_APP_BENCH_UPLOAD_URL, .enc = upload_default_encoding(),
+                       .body = u->json, .len = u->len };
+    esp_err_t e = upload_post(&r, &u->st);
+    if (e == ESP_OK && r.status / 100 != 2) e = ESP_FAIL;
+    return e;
+}
+
+static void upload_z_teardown(void *ctx)
+{
+    upload_ctx_t *u = ctx;
+    upload_stats_log("bench upload_z", &u->st, 0);
+    upload_session_end();
+    upload_teardown(ctx);
+}
+
+/* ---------- Synchro d'un lot de 50 plongées : connexion persistante vs une par requête ----------
+ * Une itération = un dive_sync_run() complet vers CONFIG_APP_BENCH_SYNC_URL ; les
+ * curseurs sont remis à zéro en tête d'itération (même coût flash dans les deux cas). */
+#define BENCH_SYNC_DIVES   50
+#define BENCH_SYNC_SAMPLES 100
+
+typedef struct {
+    bool           keep_alive;
+    upload_stats_t last;         // HTTP de la dernière itération (requêtes, connexions)
+} sync50_ctx_t;
+
+static void sync50_teardown(void *ctx)
+{
+    sync50_ctx_t *s = ctx;
+    upload_stats_log(s->keep_alive ? "bench sync50_keep" : "bench sync50_fresh", &s->last, 0);
+    wifi_net_stop();
+    bench_dives_delete("bench_s", BENCH_SYNC_DIVES);
+    free(s);
+}
+
+static esp_err_t sync50_setup(void **ctx, bool keep_alive)
+{
+    if (!CONFIG_APP_BENCH_SYNC_URL[0]) return ESP_ERR_NOT_SUPPORTED;
+    sync50_ctx_t *s = calloc(1, sizeof(*s));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->keep_alive = keep_alive;
+    esp_err_t e = bench_dives_create("bench_s", BENCH_SYNC_DIVES, BENCH_SYNC_SAMPLES, 0);
+    if (e == ESP_OK) e = wifi_net_connect(10000);
+    if (e != ESP_OK) {
+        sync50_teardown(s);
+        return e;
+    }
+    *ctx = s;
+    return ESP_OK;
+}
+
+static esp_err_t sync50_keep_setup(void **ctx)  { return sync50_setup(ctx, true); }
+static esp_err_t sync50_fresh_setup(void **ctx) { return sync50_setup(ctx, false); }
+
+static esp_err_t sync50_run(void *ctx)
+{
+    sync50_ctx_t *s = ctx;
+    const dive_cursor_t zero = { 0 };
+    char id[32];
+    for (int i = 0; i < BENCH_SYNC_DIVES; ++i) {
+        bench_dives_id("bench_s", i, id);
+        dive_storage_save_cursor(id, &zero);
+    }
+    upload_session_begin(s->keep_alive);
+    dive_sync_stats_t st;
+    esp_err_t e = dive_sync_run(CONFIG_APP_BENCH_SYNC_URL, &st);
+    upload_session_end();
+    s->last = st.http;
+    if (e == ESP_OK && st.chunks < BENCH_SYNC_DIVES) e = ESP_FAIL;
+    return e;
+}
+
+/* ---------- Synchro reprise sur serveur capricieux ----------
+ * tools/sync_server.py --drop 0.3 --lose-ack 0.1 : coupures au milieu du corps
+ * et acquittements perdus. Des passages dive_sync_run() s'enchaînent (comme les
+ * réveils successifs) jusqu'à ce que toutes les plongées, fermées, soient
+ * acquittées en entier ; un passage qui épuise ses essais laisse les curseurs
+ * où ils en sont. La valeur est la durée totale ; passages, essais et blocs au
+ * journal. Côté serveur, GET / donne pour chaque plongée "acked" et "final"
+ * (et --store les échantillons reçus, à comparer sans trou ni doublon). */
+#define BENCH_RESUME_DIVES   10
+#define BENCH_RESUME_SAMPLES 500
+#define BENCH_RESUME_PASSES  20
+#define BENCH_RESUME_STEP    37   // échantillons en plus par plongée : blocs partiels à des positions variées
+
+static void resume_teardown(void *ctx)
+{
+    (void)ctx;
+    wifi_net_stop();
+    bench_dives_delete("bench_r", BENCH_RESUME_DIVES);
+}
+
+static esp_err_t resume_setup(void **ctx)
+{
+    if (!CONFIG_APP_BENCH_SYNC_URL[0]) return ESP_ERR_NOT_SUPPORTED;
+    esp_err_t e = bench_dives_create("bench_r", BENCH_RESUME_DIVES, BENCH_RESUME_SAMPLES, BENCH_RESUME_STEP);
+    char id[32];
+    for (int i = 0; e == ESP_OK && i < BENCH_RESUME_DIVES; ++i) {
+        bench_dives_id("bench_r", i, id);
+        dive_metadata_t meta = { 0 };
+        e = dive_storage_read_metadata(id, &meta);
+        if (e == ESP_OK) {
+            meta.has_summary = true;   // fermée : le dernier bloc est final
+            meta.summary.samples = BENCH_RESUME_SAMPLES + i * BENCH_RESUME_STEP;
+            e = dive_storage_update_metadata(&meta);
+        }
+    }
+    if (e == ESP_OK) e = wifi_net_connect(10000);
+    if (e != ESP_OK) {
+        resume_teardown(NULL);
+        return e;
+    }
+    *ctx = NULL;
+    return ESP_OK;
+}
+
+static esp_err_t resume_run(void *ctx)
+{
+    (void)ctx;
+    dive_sync_stats_t st;
+    uint32_t passes = 0, retries = 0, chunks = 0, timeouts = 0;
+    esp_err_t e;
+    do {
+        upload_session_begin(true);
+        e = dive_sync_run(CONFIG_APP_BENCH_SYNC_URL, &st);
+        upload_session_end();
+        passes++;
+        retries += st.retries;
+        chunks += st.chunks;
+        if (e == ESP_ERR_TIMEOUT) timeouts++;
+    } while ((e == ESP_ERR_TIMEOUT || st.dives_pending) && passes < BENCH_RESUME_PASSES);
+
+    uint32_t bad = 0;
+    char id[32];
+    for (int i = 0; i < BENCH_RESUME_DIVES; ++i) {
+        bench_dives_id("bench_r", i, id);
+        dive_cursor_t c;
+        if (dive_storage_load_cursor(id, &c) != ESP_OK || !c.done ||
+            c.acked != (uint32_t)(BENCH_RESUME_SAMPLES + i * BENCH_RESUME_STEP)) {
+            ESP_LOGE("bench", "sync_resume: %s acked %u, done %d", id, (unsigned)c.acked, c.done);
+            bad++;
+        }
+    }
+    ESP_LOGI("bench", "sync_resume: %u passes (%u out of retries), %u chunks, %u retries, %u dives wrong",
+             (unsigned)passes, (unsigned)timeouts, (unsigned)chunks, (unsigned)retries, (unsigned)bad);
+    if (e == ESP_OK && bad) e = ESP_FAIL;
+    return e;
+}
+
+/* ---------- Télémétrie MQTT vers tools/mqtt_sink.py ----------
+ * Un échantillon daté de maintenant toutes les 2 ms (500/s, bien au-delà des
+ * 2/s d'une plongée) ; la valeur d'une itération est le coût du dépôt. Le
+ * récepteur mesure latence de bout en bout, débit et trous de séquence ;
+ * telemetry_stop() journalise dépôts, messages et pertes. */
+#define BENCH_TELEMETRY_PERIOD_MS 2
+
+typedef struct {
+    uint64_t last_ns;
+    uint32_t seq;
+} telemetry_ctx_t;
+
+static void telemetry_done(void *ctx)
+{
+    telemetry_stop();
+    wifi_net_stop();
+    free(ctx);
+}
+
+static esp_err_t telemetry_setup(void **ctx)
+{
+    if (!CONFIG_APP_BENCH_MQTT_URI[0]) return ESP_ERR_NOT_SUPPORTED;
+    telemetry_ctx_t *t = calloc(1, sizeof(*t));
+    if (!t) return ESP_ERR_NO_MEM;
+    esp_err_t e = wifi_net_connect(10000);
+    if (e == ESP_OK) e = telemetry_start(CONFIG_APP_BENCH_MQTT_URI);
+    if (e != ESP_OK) {
+        telemetry_done(t);
+        return e;
+    }
+    vTaskDelay(pdMS_TO_TICKS(1000));    // session MQTT établie avant la première mesure
+    *ctx = t;
+    return ESP_OK;
+}
+
+static esp_err_t telemetry_run(void *ctx)
+{
+    telemetry_ctx_t *t = ctx;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    telemetry_sample_t smp = {
+        .ts_us     = (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec,
+        .depth_m   = (float)(t->seq % 4000) / 100.0f,
+        .temp_c    = 18.5f,
+        .press_bar = 1.013f + (float)(t->seq % 4000) / 1000.0f,
+        .state     = 2,
+    };
+    t->seq++;
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t e = telemetry_push(&smp);
+    t->last_ns = (uint64_t)(esp_timer_get_time() - t0) * 1000u;
+    vTaskDelay(pdMS_TO_TICKS(BENCH_TELEMETRY_PERIOD_MS));
+    return e;                           // ESP_ERR_NO_MEM (boîte pleine) compté en erreur
+}
+
+static uint64_t telemetry_sample(void *ctx) { return ((telemetry_ctx_t *)ctx)->last_ns; }
+
+/* ---------- Gigue d'échantillonnage, au repos puis sous charge réseau/export ----------
+ * Un échantillonneur (rôle SAMPLING du plan) se réveille toutes les 10 ms ; la
+ * valeur d'une itération est l'écart de son intervalle à la période. La charge
+ * (rôle NET) rejoue l'upload si une URL est configurée, sinon export + JSON.
+ * Comparer bench.json avec APP_TASK_PLAN=n (avant) et =y (après). */
+typedef struct {
+    QueueHandle_t q;
+    uint32_t      last_ns;
+    volatile bool stop;
+    volatile bool sampler_up, load_up;
+    void         *upload;               // upload_ctx_t si la charge fait l'upload
+    bool          exported;             // sinon plongée bench_exp créée pour la charge locale
+} jitter_ctx_t;
+
+static void jitter_sampler(void *arg)
+{
+    jitter_ctx_t *j = arg;
+    TickType_t wake = xTaskGetTickCount();
+    int64_t prev = 0;
+    while (!j->stop) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(BENCH_JITTER_PERIOD_MS));
+        int64_t now = esp_timer_get_time();
+        if (prev) {
+            int64_t d = now - prev - BENCH_JITTER_PERIOD_MS * 1000;
+            uint32_t ns = (uint32_t)((d < 0 ? -d : d) * 1000);
+            xQueueSend(j->q, &ns, 0);
+        }
+        prev = now;
+    }
+    j->sampler_up = false;
+    app_task_exit();
+}
+
+static void jitter_load(void *arg)
+{
+    jitter_ctx_t *j = arg;
+    while (!j->stop) {
+        if (j->upload) {
+            upload_run(j->upload);
+        } else {
+            export_run(NULL);
+            json_run(NULL);
+        }
+        vTaskDelay(1);   // laisse respirer l'idle (watchdog)
+    }
+    j->load_up = false;
+    app_task_exit();
+}
+
+static esp_err_t jitter_start(jitter_ctx_t **out, bool load)
+{
+    APP_TASK_MEM(smp_mem, 2048);
+    APP_TASK_MEM(load_mem, 8192);
+    jitter_ctx_t *j = calloc(1, sizeof(*j));
+    if (!j) return ESP_ERR_NO_MEM;
+    j->q = xQueueCreate(8, sizeof(uint32_t));
+    esp_err_t e = j->q ? ESP_OK : ESP_ERR_NO_MEM;
+    if (e == ESP_OK && load) {
+        e = upload_setup(&j->upload);
+        if (e == ESP_ERR_NOT_SUPPORTED) {                         // pas d'URL : charge locale
+            e = export_setup(NULL);
+            j->exported = (e == ESP_OK);
+        }
+        if (e == ESP_OK) {
+            j->load_up = true;
+            e = app_task_create(jitter_load, "bench_load", &load_mem, j, APP_ROLE_NET, NULL);
+            if (e != ESP_OK) j->load_up = false;
+        }
+    }
+    if (e == ESP_OK) {
+        j->sampler_up = true;
+        e = app_task_create(jitter_sampler, "bench_smp", &smp_mem, j, APP_ROLE_SAMPLING, NULL);
+        if (e != ESP_OK) j->sampler_up = false;
+    }
+    *out = j;
+    return e;
+}
+
+static void jitter_teardown(void *ctx)
+{
+    jitter_ctx_t *j = ctx;
+    if (!j) return;
+    j->stop = true;
+    while (j->sampler_up || j->load_up) vTaskDelay(pdMS_TO_TICKS(10));
+    if (j->upload) upload_teardown(j->upload);
+    if (j->exported) export_teardown(NULL);
+    if (j->q) vQueueDelete(j->q);
+    free(j);
+}
+
+static esp_err_t jitter_setup_common(void **ctx, bool load)
+{
+    jitter_ctx_t *j = NULL;
+    esp_err_t e = jitter_start(&j, load);
+    if (e != ESP_OK) {
+        jitter_teardown(j);
+        return e;
+    }
+    *ctx = j;
+    return ESP_OK;
+}
+
+static esp_err_t jitter_idle_setup(void **ctx) { return jitter_setup_common(ctx, false); }
+static esp_err_t jitter_load_setup(void **ctx) { return jitter_setup_common(ctx, true); }
+
+static esp_err_t jitter_run(void *ctx)
+{
+    jitter_ctx_t *j = ctx;
+    return xQueueReceive(j->q, &j->last_ns, pdMS_TO_TICKS(20 * BENCH_JITTER_PERIOD_MS)) == pdTRUE
+           ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static uint64_t jitter_sample(void *ctx) { return ((jitter_ctx_t *)ctx)->last_ns; }
+
+static const bench_case_t s_cases[] = {
+    { "i2c_xfer",     i2c_setup,          i2c_run,        i2c_teardown,      0,   NULL },
+    { "ms5837_conv",  NULL,               conv_run,       NULL,              0,   NULL },
+    { "queue",        queue_setup,        queue_run,      queue_teardown,    0,   NULL },
+    { "append",       append_setup,       append_run,     append_teardown,   0,   NULL },
+    { "export",       export_setup,       export_run,     export_teardown,   20,  NULL },
+    { "dive_iter",    iter_setup,         iter_run,       iter_teardown,     10,  NULL },
+    // profil complet : fermeture vers le pas 800 (fin confirmée 30 s après la surface)
+    { "session",      session_setup,      session_run,    session_teardown,  900, NULL },
+    // valeurs = latence de détection de l'immersion, pas la durée de run()
+    { "touch_trace",  touch_trace_setup,  touch_trace_run, touch_trace_teardown, 100, touch_trace_sample },
+    // correction des fondus (hôte) : les erreurs comptent, pas la durée
+    { "led_fade",     led_fade_setup,     led_fade_run,   led_fade_teardown, 20,  NULL },
+    // logique de reconnexion Wi-Fi sur événements simulés : les erreurs comptent
+    { "wifi_fsm",     wifi_fsm_setup,     wifi_fsm_run,   wifi_fsm_teardown, 20,  NULL },
+    // ajouts à 50/80/95 % de remplissage, sans puis avec maintain + check
+    { "append_f50",     fill50_setup,     fill_run,       fill_teardown,     500, NULL },
+    { "append_f80",     fill80_setup,     fill_run,       fill_teardown,     500, NULL },
+    { "append_f95",     fill95_setup,     fill_run,       fill_teardown,     500, NULL },
+    { "append_f50_rsv", fill50_rsv_setup, fill_run,       fill_teardown,     500, NULL },
+    { "append_f80_rsv", fill80_rsv_setup, fill_run,       fill_teardown,     500, NULL },
+    { "append_f95_rsv", fill95_rsv_setup, fill_run,       fill_teardown,     500, NULL },
+    { "json",         NULL,               json_run,       NULL,              0,   NULL },
+    { "chunk_json",   chunk_setup,        chunk_json_run, free,              50,  NULL },
+    { "chunk_pb",     chunk_pb_setup,     chunk_pb_run,   free,              50,  NULL },
+    // 100 < DLOG_SLOTS : on mesure l'écriture, pas le chemin "anneau plein"
+    { "dlog",         NULL,               dlog_run,       dlog_teardown,     100, NULL },
+    { "esp_logi",     NULL,               logi_run,       NULL,              100, NULL },
+    { "trace",        NULL,               trace_run,      NULL,              0,   NULL },
+    { "metric",       NULL,               metric_run,     NULL,              0,   NULL },
+    { "upload",       upload_setup,       upload_run,     upload_teardown,   10,  NULL },
+    { "upload_z",     upload_z_setup,     upload_z_run,   upload_z_teardown, 10,  NULL },
+    { "sync50_keep",  sync50_keep_setup,  sync50_run,     sync50_teardown,   3,   NULL },
+    { "sync50_fresh", sync50_fresh_setup, sync50_run,     sync50_teardown,   3,   NULL },
+    // reprise sous coupures (sync_server.py --drop/--lose-ack) : passages jusqu'à tout acquitté
+    { "sync_resume",  resume_setup,       resume_run,     resume_teardown,   1,   NULL },
+    // valeurs = coût du dépôt ; latence et débit côté tools/mqtt_sink.py
+    { "telemetry",    telemetry_setup,    telemetry_run,  telemetry_done,    2000, telemetry_sample },
+    // valeurs = gigue (ns) de l'échantillonneur, pas la durée de run()
+    { "jitter_idle",  jitter_idle_setup,  jitter_run,     jitter_teardown,   200, jitter_sample },
+    { "jitter_load",  jitter_load_setup,  jitter_run,     jitter_teardown,   500, jitter_sample },
+};
+
+const bench_case_t *bench_cases(size_t *count)
+{
+    *count = sizeof(s_cases) / sizeof(s_cases[0]);
+    return s_cases;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Un cas de mesure : setup/teardown hors chrono, run() = une itération chronométrée */
+typedef struct {
+    const char *name;
+    esp_err_t (*setup)(void **ctx);      // ESP_ERR_NOT_SUPPORTED = cas ignoré
+    esp_err_t (*run)(void *ctx);
+    void      (*teardown)(void *ctx);
+    uint32_t   iters;                    // 0 = CONFIG_APP_BENCH_ITERS
+    uint64_t (*sample_ns)(void *ctx);    // optionnel : valeur de l'itération fournie par le cas
+                                         // (ex. gigue mesurée ailleurs) au lieu de la durée de run()
+} bench_case_t;
+
+typedef struct {
+    const char *name;
+    bool     skipped;
+    uint32_t iters;
+    uint32_t errors;                     // itérations dont run() a échoué
+    uint64_t p50_ns, p90_ns, p99_ns, max_ns;
+    uint64_t mean_ns;
+    int64_t  mean_cycles;                // -1 si pas de compteur de cycles (hôte)
+    int32_t  heap_peak;                  // octets pris au pire pendant les itérations
+    int32_t  heap_leak;                  // octets non rendus après teardown
+} bench_result_t;
+
+/** Exécute un cas et remplit res */
+esp_err_t bench_run(const bench_case_t *c, bench_result_t *res);
+
+/** Exécute tous les cas et écrit les résultats en JSON dans path (NULL = <FS>/bench.json) */
+esp_err_t bench_run_all(const char *path);
+
+/* Cas fournis par bench_cases.c */
+const bench_case_t *bench_cases(size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+#include "boot_timeline.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <stdio.h>
+
+static const char *TAG = "boot_tl";
+
+typedef struct {
+    const char *label;
+    int64_t     t_us;
+} tl_entry_t;
+
+static tl_entry_t s_tl[BOOT_TIMELINE_MAX];
+static uint32_t   s_n = 0;
+
+void boot_timeline_mark(const char *label)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t i = __atomic_fetch_add(&s_n, 1, __ATOMIC_RELAXED);
+    if (i >= BOOT_TIMELINE_MAX) return;   // plein : les étapes suivantes sont ignorées
+    s_tl[i].t_us = now;
+    s_tl[i].label = label;
+}
+
+size_t boot_timeline_count(void)
+{
+    uint32_t n = __atomic_load_n(&s_n, __ATOMIC_RELAXED);
+    return n > BOOT_TIMELINE_MAX ? BOOT_TIMELINE_MAX : n;
+}
+
+void boot_timeline_dump(const char *path)
+{
+    char line[384];
+    size_t n = boot_timeline_count();
+    int len = 0;
+    int64_t prev = 0;
+
+    // chaque étape : delta (ms) depuis la précédente, la première depuis le boot
+    for (size_t i = 0; i < n && len < (int)sizeof(line); ++i) {
+        len += snprintf(line + len, sizeof(line) - len, "%s=+%lld ",
+                        s_tl[i].label ? s_tl[i].label : "?",
+                        (long long)((s_tl[i].t_us - prev) / 1000));
+        prev = s_tl[i].t_us;
+    }
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    line[len] = '\0';
+
+    ESP_LOGI(TAG, "%s: %stotal=%lld ms", path ? path : "boot", line,
+             (long long)(esp_timer_get_time() / 1000));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Chronologie du réveil : horodate chaque étape d'init (esp_timer, us depuis le boot) */
+
+#define BOOT_TIMELINE_MAX 24
+
+/** Marque une étape. label doit rester valide (littéral). Appelable de toute tâche. */
+void boot_timeline_mark(const char *label);
+
+/** Nombre d'étapes enregistrées */
+size_t boot_timeline_count(void);
+
+/** Affiche la chronologie sur une ligne compacte : "path: a=+12 b=+3 ... total=345 ms" */
+void boot_timeline_dump(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
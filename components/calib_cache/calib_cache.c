@@ -0,0 +1,75 @@
+#include "calib_cache.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "calib_cache";
+
+/* Nombre de réveils avant de forcer une relecture complète (rafraîchissement paresseux) */
+#ifndef CONFIG_CALIB_CACHE_MAX_AGE
+#define CONFIG_CALIB_CACHE_MAX_AGE 100
+#endif
+
+#define CALIB_MAGIC 0x43414C42u   // "CALB"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t id;
+    uint16_t len;
+    uint16_t age;             // nb de chargements depuis le dernier store
+    uint8_t  data[CALIB_CACHE_DATA_MAX];
+    uint32_t crc;             // CRC32 de magic..data
+} calib_entry_t;
+
+static RTC_DATA_ATTR calib_entry_t s_cache[CALIB_SLOT_MAX];
+
+static uint32_t entry_crc(const calib_entry_t *e)
+{
+    // l'âge évolue à chaque chargement : exclu du CRC
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&e->magic, sizeof(e->magic) + sizeof(e->id) + sizeof(e->len));
+    return esp_rom_crc32_le(crc, e->data, sizeof(e->data));
+}
+
+esp_err_t calib_cache_load(calib_slot_t slot, uint32_t id, void *out, size_t len)
+{
+    if (slot >= CALIB_SLOT_MAX || !out || len == 0 || len > CALIB_CACHE_DATA_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    calib_entry_t *e = &s_cache[slot];
+    if (e->magic != CALIB_MAGIC || e->id != id || e->len != len)
+        return ESP_ERR_NOT_FOUND;
+    if (e->crc != entry_crc(e)) {
+        ESP_LOGW(TAG, "slot %d: bad CRC", (int)slot);
+        e->magic = 0;
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (e->age >= CONFIG_CALIB_CACHE_MAX_AGE) {
+        ESP_LOGI(TAG, "slot %d: stale (%u wakes), refresh", (int)slot, e->age);
+        return ESP_ERR_NOT_FOUND;
+    }
+    e->age++;
+    memcpy(out, e->data, len);
+    return ESP_OK;
+}
+
+esp_err_t calib_cache_store(calib_slot_t slot, uint32_t id, const void *data, size_t len)
+{
+    if (slot >= CALIB_SLOT_MAX || !data || len == 0 || len > CALIB_CACHE_DATA_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    calib_entry_t *e = &s_cache[slot];
+    memset(e, 0, sizeof(*e));
+    e->magic = CALIB_MAGIC;
+    e->id = id;
+    e->len = (uint16_t)len;
+    memcpy(e->data, data, len);
+    e->crc = entry_crc(e);
+    return ESP_OK;
+}
+
+void calib_cache_invalidate(calib_slot_t slot)
+{
+    if (slot < CALIB_SLOT_MAX) s_cache[slot].magic = 0;
+}
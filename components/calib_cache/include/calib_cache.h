@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache de calibration en RTC slow memory : survit au deep sleep, perdu au cold boot.
+ * Chaque entrée est validée par un CRC32 et l'identifiant du capteur. */
+
+typedef enum {
+    CALIB_SLOT_TOUCH = 0,     // baseline tactile
+    CALIB_SLOT_MS5837,        // PROM C0..C7
+    CALIB_SLOT_TSYS01,        // PROM k0..k7
+    CALIB_SLOT_MAX
+} calib_slot_t;
+
+#define CALIB_CACHE_DATA_MAX 16   // octets utiles par entrée
+
+/** Charge l'entrée si id/len/CRC sont valides et qu'elle n'est pas trop vieille.
+ *  @return ESP_OK, ESP_ERR_NOT_FOUND (vide/périmée), ESP_ERR_INVALID_CRC, ESP_ERR_INVALID_ARG */
+esp_err_t calib_cache_load(calib_slot_t slot, uint32_t id, void *out, size_t len);
+
+/** Écrit (ou rafraîchit) une entrée, remet son âge à zéro */
+esp_err_t calib_cache_store(calib_slot_t slot, uint32_t id, const void *data, size_t len);
+
+/** Invalide une entrée (ex: erreur de lecture capteur) */
+void calib_cache_invalidate(calib_slot_t slot);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,140 @@
+#include "dive_space.h"
+#include "dive_storage.h"
+#include "hal_fs.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+
+static const char *TAG = "dive_space";
+
+#ifndef CONFIG_APP_DIVE_MAX_MIN
+#define CONFIG_APP_DIVE_MAX_MIN 90
+#endif
+#ifndef CONFIG_APP_RETAIN_DIVES
+#define CONFIG_APP_RETAIN_DIVES 20
+#endif
+#ifndef CONFIG_APP_SPACE_HIGH_PCT
+#define CONFIG_APP_SPACE_HIGH_PCT 80
+#endif
+
+/* Un échantillon fusionné par mesure MS5837 (500 ms) ; ligne CSV ~30 octets */
+#define SPACE_SAMPLES_PER_S 2
+#define SPACE_SAMPLE_BYTES  32
+/* <id>.met, en-tête CSV, <id>.cur : une page SPIFFS chacun, et la marge d'index */
+#define SPACE_DIVE_OVERHEAD 2048
+
+METRIC_COUNTER(s_m_evicted, "fs.evicted");
+METRIC_HISTO(s_m_gc, "fs.gc_ms");
+
+static void space_metrics(void)
+{
+    static bool registered;
+    if (registered) return;
+    metrics_register(&s_m_evicted.m);
+    metrics_register(&s_m_gc.m);
+    registered = true;
+}
+
+size_t dive_space_reserve_bytes(void)
+{
+    return (size_t)CONFIG_APP_DIVE_MAX_MIN * 60 * SPACE_SAMPLES_PER_S * SPACE_SAMPLE_BYTES +
+           SPACE_DIVE_OVERHEAD;
+}
+
+static bool is_synced(const char *id)
+{
+    dive_cursor_t c;
+    return dive_storage_load_cursor(id, &c) == ESP_OK && c.done;
+}
+
+static size_t fs_free(void)
+{
+    size_t total = 0, used = 0;
+    if (hal_fs_info(&total, &used) != ESP_OK || used > total) return 0;
+    return total - used;
+}
+
+/* Supprime les plus anciennes plongées synchronisées tant qu'il en reste plus
+ * de keep (0 = pas de limite) ou que la place libre est sous want_free. Le
+ * parcours suit l'ordre des ids ; dive_storage_new_id les donne à chiffres
+ * fixes et croissants, c'est donc l'ordre de création */
+static uint32_t evict(uint32_t keep, size_t want_free)
+{
+    const dive_filter_t pending = { .pending_only = true };
+    size_t all = 0, unsynced = 0;
+    if (dive_storage_count(NULL, &all) != ESP_OK || dive_storage_count(&pending, &unsynced) != ESP_OK)
+        return 0;
+    size_t synced = all - unsynced;
+
+    uint32_t n = 0;
+    dive_iter_t it;
+    dive_iter_init(&it, NULL);
+    char id[32];
+    while (synced > 0 && dive_iter_next(&it, id, NULL) == ESP_OK) {
+        bool too_many = keep && synced > keep;
+        if (!too_many && fs_free() >= want_free) break;
+        if (!is_synced(id)) continue;
+        dive_storage_delete(id);
+        synced--;
+        n++;
+        metric_inc(&s_m_evicted);
+        ESP_LOGI(TAG, "evicted %s (%s)", id, too_many ? "retention" : "space");
+    }
+    return n;
+}
+
+/* Pages effacées d'avance pour bytes octets (au plus la place libre) */
+static void gc(dive_space_report_t *r, size_t bytes)
+{
+    size_t free_b = fs_free();
+    if (bytes > free_b) bytes = free_b;
+    int64_t t0 = esp_timer_get_time();
+    r->gc = bytes ? hal_fs_gc(bytes) : ESP_OK;
+    r->gc_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    metric_observe(&s_m_gc, r->gc_ms);
+    hal_fs_info(&r->total, &r->used);
+}
+
+esp_err_t dive_space_check(dive_space_report_t *rep)
+{
+    space_metrics();
+    dive_space_report_t r = { .reserve = dive_space_reserve_bytes(), .gc = ESP_OK };
+    if (hal_fs_info(&r.total, &r.used) != ESP_OK) return ESP_FAIL;
+
+    // pas de maintain depuis la dernière plongée (pas d'upload) : on évince, sans GC
+    size_t free_b = r.used < r.total ? r.total - r.used : 0;
+    if (free_b < r.reserve) {
+        r.evicted = evict(0, r.reserve);
+        hal_fs_info(&r.total, &r.used);
+        free_b = r.used < r.total ? r.total - r.used : 0;
+    }
+
+    esp_err_t e = ESP_OK;
+    if (free_b < r.reserve) {
+        ESP_LOGW(TAG, "%u bytes free, a %d min dive needs %u", (unsigned)free_b,
+                 CONFIG_APP_DIVE_MAX_MIN, (unsigned)r.reserve);
+        e = ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "check %u bytes: evicted %u, used %u/%u", (unsigned)r.reserve,
+             (unsigned)r.evicted, (unsigned)r.used, (unsigned)r.total);
+    if (rep) *rep = r;
+    return e;
+}
+
+esp_err_t dive_space_maintain(dive_space_report_t *rep)
+{
+    space_metrics();
+    dive_space_report_t r = { .reserve = dive_space_reserve_bytes() };
+    if (hal_fs_info(&r.total, &r.used) != ESP_OK) return ESP_FAIL;
+
+    // sous le seuil de remplissage, et toujours de quoi réserver la prochaine plongée
+    size_t want = r.total / 100 * (100 - CONFIG_APP_SPACE_HIGH_PCT);
+    if (want < r.reserve) want = r.reserve;
+    r.evicted = evict(CONFIG_APP_RETAIN_DIVES, want);
+    gc(&r, r.reserve);
+    ESP_LOGI(TAG, "maintain: evicted %u, gc %u ms (%s), used %u/%u", (unsigned)r.evicted,
+             (unsigned)r.gc_ms, esp_err_to_name(r.gc), (unsigned)r.used, (unsigned)r.total);
+    if (rep) *rep = r;
+    return ESP_OK;
+}
@@ -1,87 +1,272 @@
 #include "dive_storage.h"
-#include "esp_spiffs.h"
+#include "hal_fs.h"
+#include "trace.h"
+#include "metrics.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include "cJSON.h"
 
 static const char *TAG = "dive_storage";
 
+static bool s_mounted = false;
+
+METRIC_GAUGE(s_m_free, "fs.free_bytes");
+
+static int32_t fs_free(void *ctx)
+{
+    (void)ctx;
+    size_t total = 0, used = 0;
+    if (hal_fs_info(&total, &used) != ESP_OK) return -1;
+    return (int32_t)(total - used);
+}
+static char s_dir[64] = "/spiffs/dives";   // <racine FS>/dives, fixé au montage
+static char s_idx[80];                      // <dir>/ids.idx
+static char s_idx_last[32];                 // dernier id de l'index : au-delà, on ajoute en fin
+static bool s_idx_ok;                       // false : à vérifier (ou reconstruire) avant lecture
+
+/* Disposition à plat : SPIFFS n'a pas de répertoires (mkdir échoue, readdir ne
+ * rend que des fichiers). Une plongée = dives/<id>.csv (données, présence =
+ * plongée), <id>.met (métadonnées), <id>.cur (curseur de synchro), et leurs
+ * .tmp. Nom d'objet SPIFFS complet borné à CONFIG_SPIFFS_OBJ_NAME_LEN (32) :
+ * "/dives/dive_0000000000.cur.tmp" tient en 30. */
+#define DIVE_DATA    ".csv"
+#define DIVE_META    ".met"
+#define DIVE_CURSOR  ".cur"
+#define DIVE_LAST_ID "last_id"     // dernier numéro attribué (survit aux suppressions)
+#define DIVE_INDEX   "ids.idx"     // index trié des ids, voir index_check()
+
+static void build_path(const char *dive_id, const char *ext, char *out, size_t out_sz)
+{
+    snprintf(out, out_sz, "%s/%s%s", s_dir, dive_id, ext);
+}
+
+static void migrate_dirs(void);
+static esp_err_t index_check(void);
+static esp_err_t index_add(const char *id);
+
 esp_err_t dive_storage_init(void)
 {
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 10,
-        .format_if_mount_failed = true};
-    ESP_ERROR_CHECK(esp_vfs_spiffs_register(&conf));
+    if (s_mounted) return ESP_OK;
+
+    esp_err_t e = hal_fs_mount(10, true);
+    if (e != ESP_OK) {
+        ESP_LOGE(TAG, "mount: %s", esp_err_to_name(e));
+        return e;
+    }
+    snprintf(s_dir, sizeof(s_dir), "%s/dives", hal_fs_base_path());
+    s_m_free.sample = fs_free;
+    metrics_register(&s_m_free.m);
 
     // Vérifie ou crée le répertoire
     struct stat st;
-    if (stat("/spiffs/dives", &st) != 0)
+    if (stat(s_dir, &st) != 0)
     {
-        ESP_LOGI(TAG, "Creating /spiffs/dives");
-        mkdir("/spiffs/dives", 0777);
+        ESP_LOGI(TAG, "Creating %s", s_dir);
+        mkdir(s_dir, 0777);   // sans effet sur SPIFFS : les noms portent le préfixe
     }
+    snprintf(s_idx, sizeof(s_idx), "%s/" DIVE_INDEX, s_dir);
+    s_mounted = true;
+    migrate_dirs();
+    index_check();
     return ESP_OK;
 }
 
-static void build_path(const char *dive_id, const char *fname, char *out, size_t out_sz)
+/* --- Métadonnées : un enregistrement binaire de taille fixe par plongée ---
+ * <id>.met se charge en un fread et se valide par CRC, sans analyse de texte.
+ * Version 1 ; size permet d'ajouter des champs en fin (version suivante).
+ * Les anciens metadata.txt (clé=valeur) sont convertis par migrate_dirs(). */
+#define META_MAGIC   0x41544D52u   // "RMTA"
+#define META_VERSION 1
+#define META_HAS_SUMMARY 0x1u
+
+typedef struct {
+    uint32_t       magic;
+    uint16_t       version;
+    uint16_t       size;            // sizeof(meta_rec_t) à l'écriture
+    char           id[32];
+    char           date[20];
+    char           location[64];
+    char           diver[32];
+    uint32_t       flags;           // META_HAS_SUMMARY
+    dive_summary_t summary;
+    uint32_t       crc;             // CRC32 de magic..summary
+} meta_rec_t;
+
+_Static_assert(sizeof(dive_summary_t) == 44, "dive_summary_t fait partie du format meta.bin");
+_Static_assert(sizeof(meta_rec_t) == 208, "format meta.bin v1");
+
+static uint32_t meta_crc(const meta_rec_t *r)
 {
-    snprintf(out, out_sz, "/spiffs/dives/%s/%s", dive_id, fname);
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(meta_rec_t, crc));
 }
 
-esp_err_t dive_storage_create_dive(const dive_metadata_t *meta)
+static esp_err_t write_metadata(const dive_metadata_t *meta)
 {
-    char path[128];
-    snprintf(path, sizeof(path), "/spiffs/dives/%s", meta->id);
-
-    if (mkdir(path, 0777) != 0)
+    meta_rec_t r;
+    memset(&r, 0, sizeof(r));       // octets de fin de chaîne à zéro : CRC reproductible
+    r.magic = META_MAGIC;
+    r.version = META_VERSION;
+    r.size = sizeof(r);
+    strlcpy(r.id, meta->id, sizeof(r.id));
+    strlcpy(r.date, meta->date, sizeof(r.date));
+    strlcpy(r.location, meta->location, sizeof(r.location));
+    strlcpy(r.diver, meta->diver, sizeof(r.diver));
+    if (meta->has_summary)
     {
-        ESP_LOGE(TAG, "mkdir %s failed", path);
+        r.flags = META_HAS_SUMMARY;
+        r.summary = meta->summary;
+    }
+    r.crc = meta_crc(&r);
+
+    char file[160], tmp[168];
+    build_path(meta->id, DIVE_META, file, sizeof(file));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
         return ESP_FAIL;
+    size_t n = fwrite(&r, sizeof(r), 1, f);
+    if (fclose(f) != 0 || n != 1)
+        return ESP_FAIL;
+    unlink(file);   // SPIFFS : rename n'écrase pas la cible
+    return rename(tmp, file) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/* ESP_ERR_NOT_FOUND : pas de fichier ; ESP_ERR_INVALID_CRC / _VERSION : illisible */
+static esp_err_t read_meta_rec(const char *file, meta_rec_t *r)
+{
+    FILE *f = fopen(file, "rb");
+    if (!f)
+        return ESP_ERR_NOT_FOUND;
+    size_t n = fread(r, 1, sizeof(*r), f);
+    fclose(f);
+    if (n < sizeof(*r) || r->magic != META_MAGIC || r->crc != meta_crc(r))
+        return ESP_ERR_INVALID_CRC;
+    if (r->version != META_VERSION || r->size != sizeof(*r))
+        return ESP_ERR_INVALID_VERSION;
+    return ESP_OK;
+}
+
+/* Ancien format clé=valeur ; les noms avec espaces sont lus en entier */
+static esp_err_t read_text_metadata(const char *file, dive_metadata_t *meta)
+{
+    FILE *f = fopen(file, "r");
+    if (!f)
+        return ESP_ERR_NOT_FOUND;
+
+    char line[128];
+    dive_summary_t *sm = &meta->summary;
+    unsigned u0, u1, u2, u3;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "id=%31s", meta->id) == 1)
+            continue;
+        if (sscanf(line, "date=%19s", meta->date) == 1)
+            continue;
+        if (sscanf(line, "location=%63[^\n]", meta->location) == 1)
+            continue;
+        if (sscanf(line, "diver=%31[^\n]", meta->diver) == 1)
+            continue;
+        // résumé (présent seulement après fermeture)
+        if (sscanf(line, "samples=%u", &u0) == 1)
+        {
+            sm->samples = u0;
+            meta->has_summary = true;
+            continue;
+        }
+        if (sscanf(line, "duration_s=%u", &u0) == 1)
+        {
+            sm->duration_s = u0;
+            continue;
+        }
+        if (sscanf(line, "max_depth_m=%f", &sm->max_depth_m) == 1)
+            continue;
+        if (sscanf(line, "avg_depth_m=%f", &sm->avg_depth_m) == 1)
+            continue;
+        if (sscanf(line, "min_temp_c=%f", &sm->min_temp_c) == 1)
+            continue;
+        if (sscanf(line, "max_temp_c=%f", &sm->max_temp_c) == 1)
+            continue;
+        if (sscanf(line, "max_ascent_m_min=%f", &sm->max_ascent_m_min) == 1)
+            continue;
+        if (sscanf(line, "phases_s=%u,%u,%u,%u", &u0, &u1, &u2, &u3) == 4)
+        {
+            sm->descent_s = u0;
+            sm->bottom_s = u1;
+            sm->ascent_s = u2;
+            sm->safety_stop_s = u3;
+            continue;
+        }
     }
+    fclose(f);
+    return ESP_OK;
+}
 
+esp_err_t dive_storage_create_dive(const dive_metadata_t *meta)
+{
     char file[160];
-    build_path(meta->id, "metadata.txt", file, sizeof(file));
+    build_path(meta->id, DIVE_DATA, file, sizeof(file));
+    struct stat st;
+    if (stat(file, &st) == 0)
+    {
+        ESP_LOGE(TAG, "%s already exists", meta->id);
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    FILE *f = fopen(file, "w");
-    if (!f)
+    // métadonnées d'abord : un .csv présent a toujours son .met
+    if (write_metadata(meta) != ESP_OK)
         return ESP_FAIL;
-    fprintf(f, "id=%s\n", meta->id);
-    fprintf(f, "date=%s\n", meta->date);
-    fprintf(f, "location=%s\n", meta->location);
-    fprintf(f, "diver=%s\n", meta->diver);
-    fclose(f);
 
-    build_path(meta->id, "data.csv", file, sizeof(file));
-    f = fopen(file, "w");
+    FILE *f = fopen(file, "w");
     if (!f)
         return ESP_FAIL;
     fprintf(f, "timestamp_us,temperature_C,pressure_bar\n");
     fclose(f);
 
+    // index en dernier : sans lui la plongée n'est pas parcourue, vérification à relancer
+    if (index_add(meta->id) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "%s: index not updated", meta->id);
+        s_idx_ok = false;
+    }
     return ESP_OK;
 }
 
 esp_err_t dive_storage_append_sample(const char *dive_id, const dive_sample_t *sample)
 {
     char file[160];
-    build_path(dive_id, "data.csv", file, sizeof(file));
+    build_path(dive_id, DIVE_DATA, file, sizeof(file));
+    TRACE_BEGIN(TRACE_EV_STORE_APPEND, 0);
     FILE *f = fopen(file, "a");
-    if (!f)
+    if (!f) {
+        TRACE_END(TRACE_EV_STORE_APPEND, ESP_FAIL);
         return ESP_FAIL;
+    }
     fprintf(f, "%llu,%.2f,%.2f\n",
             (unsigned long long)sample->timestamp,
             sample->temperature,
             sample->pressure);
     fclose(f);
+    TRACE_END(TRACE_EV_STORE_APPEND, ESP_OK);
     return ESP_OK;
 }
 
+esp_err_t dive_storage_update_metadata(const dive_metadata_t *meta)
+{
+    if (!meta)
+        return ESP_ERR_INVALID_ARG;
+    TRACE_BEGIN(TRACE_EV_STORE_FLUSH, 0);
+    esp_err_t e = write_metadata(meta);
+    TRACE_END(TRACE_EV_STORE_FLUSH, e);
+    return e;
+}
+
 esp_err_t dive_storage_close_dive(const char *dive_id)
 {
     // Rien à faire : fichiers sont flushés à chaque append
@@ -89,24 +274,393 @@ esp_err_t dive_storage_close_dive(const char *dive_id)
     return ESP_OK;
 }
 
-esp_err_t dive_storage_list(char ids[][32], size_t max, size_t *count)
+/* --- Parcours des plongées --- */
+/* <id>.csv -> id ; false pour tout autre nom (.met, .cur, .tmp, last_id, ids.idx) */
+static bool dive_id_of(const struct dirent *ent, char id[32])
 {
-    DIR *dir = opendir("/spiffs/dives");
-    if (!dir)
+    const char *name = ent->d_name;
+    size_t n = strlen(name), ext = sizeof(DIVE_DATA) - 1;
+    if (n <= ext || n - ext >= 32 || strcmp(name + n - ext, DIVE_DATA) || strchr(name, '/'))
+        return false;
+    memcpy(id, name, n - ext);
+    id[n - ext] = '\0';
+    return true;
+}
+
+/* Index : un enregistrement de taille fixe par plongée, trié par id. Les ids
+ * neufs sont croissants : la création ajoute en fin ; la suppression marque
+ * l'enregistrement sur place. Un parcours lit donc l'index à la suite, sans
+ * relire le répertoire (SPIFFS : un readdir balaie toute la partition). */
+#define IDX_LIVE   0x1u
+#define IDX_SYNCED 0x2u     // curseur done : écarté par pending_only sans ouvrir le .cur
+
+typedef struct {
+    char    id[32];
+    uint8_t flags;          // IDX_LIVE | IDX_SYNCED ; 0 = supprimée
+    uint8_t pad[3];
+} idx_rec_t;
+
+_Static_assert(sizeof(idx_rec_t) == 36, "format ids.idx");
+
+static FILE *index_open(void)
+{
+    FILE *f = fopen(s_idx, "rb");
+    if (!f)
+    {
+        // coupure entre unlink et rename : le .tmp est complet
+        char tmp[88];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", s_idx);
+        f = fopen(tmp, "rb");
+    }
+    return f;
+}
+
+static bool index_get(FILE *f, uint32_t i, idx_rec_t *r)
+{
+    if (fseek(f, (long)(i * sizeof(*r)), SEEK_SET) != 0 || fread(r, sizeof(*r), 1, f) != 1)
+        return false;
+    r->id[sizeof(r->id) - 1] = '\0';
+    return true;
+}
+
+/* Premier enregistrement d'id > key (strict) ou >= key, par dichotomie */
+static uint32_t index_lower(FILE *f, const char *key, bool strict)
+{
+    uint32_t lo = 0, hi = 0;
+    if (fseek(f, 0, SEEK_END) == 0 && ftell(f) > 0)
+        hi = (uint32_t)(ftell(f) / sizeof(idx_rec_t));
+    idx_rec_t r;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int c = index_get(f, mid, &r) ? strcmp(r.id, key) : 1;
+        if (c < 0 || (strict && c == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Réécriture par .tmp sans les enregistrements supprimés ; add (optionnel)
+ * inséré à sa place, en remplacement d'un enregistrement de même id */
+static esp_err_t index_rewrite(const char *add)
+{
+    char tmp[88];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s_idx);
+    FILE *in = fopen(s_idx, "rb");
+    FILE *out = fopen(tmp, "wb");
+    if (!out)
+    {
+        if (in)
+            fclose(in);
+        return ESP_FAIL;
+    }
+    idx_rec_t r, a = { .flags = IDX_LIVE };
+    if (add)
+        strlcpy(a.id, add, sizeof(a.id));
+    char last[32] = "";
+    bool ok = true;
+    while (ok && in && fread(&r, sizeof(r), 1, in) == 1)
+    {
+        r.id[sizeof(r.id) - 1] = '\0';
+        int c = add ? strcmp(r.id, add) : -1;
+        if (c >= 0)
+        {
+            ok = fwrite(&a, sizeof(a), 1, out) == 1;
+            strlcpy(last, a.id, sizeof(last));
+            add = NULL;
+        }
+        if (c == 0 || !(r.flags & IDX_LIVE))
+            continue;
+        ok = ok && fwrite(&r, sizeof(r), 1, out) == 1;
+        strlcpy(last, r.id, sizeof(last));
+    }
+    if (ok && add)
+    {
+        ok = fwrite(&a, sizeof(a), 1, out) == 1;
+        strlcpy(last, a.id, sizeof(last));
+    }
+    if (in)
+        fclose(in);
+    if (fclose(out) != 0 || !ok)
+    {
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+    unlink(s_idx);   // SPIFFS : rename n'écrase pas la cible
+    if (rename(tmp, s_idx) != 0)
+        return ESP_FAIL;
+    strlcpy(s_idx_last, last, sizeof(s_idx_last));
+    return ESP_OK;
+}
+
+static esp_err_t index_add(const char *id)
+{
+    // id hors ordre (plongée importée, bancs d'essai) : réécriture triée
+    if (s_idx_last[0] && strcmp(id, s_idx_last) <= 0)
+        return index_rewrite(id);
+    idx_rec_t r = { .flags = IDX_LIVE };
+    strlcpy(r.id, id, sizeof(r.id));
+    FILE *f = fopen(s_idx, "ab");
+    if (!f)
+        return ESP_FAIL;
+    size_t n = fwrite(&r, sizeof(r), 1, f);
+    if (fclose(f) != 0 || n != 1)
+        return ESP_FAIL;
+    strlcpy(s_idx_last, id, sizeof(s_idx_last));
+    return ESP_OK;
+}
+
+/* Drapeaux de l'enregistrement id (set, puis clear) ; écrit seulement s'ils changent */
+static esp_err_t index_flags(const char *id, uint8_t set, uint8_t clear)
+{
+    FILE *f = fopen(s_idx, "r+b");
+    if (!f)
+        return ESP_FAIL;
+    idx_rec_t r;
+    uint32_t i = index_lower(f, id, false);
+    esp_err_t e = ESP_ERR_NOT_FOUND;
+    if (index_get(f, i, &r) && !strcmp(r.id, id))
+    {
+        uint8_t fl = (uint8_t)((r.flags | set) & ~clear);
+        e = ESP_OK;
+        if (fl != r.flags &&
+            (fseek(f, (long)(i * sizeof(r) + offsetof(idx_rec_t, flags)), SEEK_SET) != 0 ||
+             fwrite(&fl, 1, 1, f) != 1))
+            e = ESP_FAIL;
+    }
+    if (fclose(f) != 0 && e == ESP_OK)
+        e = ESP_FAIL;
+    return e;
+}
+
+/* Reconstruction depuis le répertoire : par pages de DIVE_ITER_PAGE ids
+ * (les plus petits après la position), triés par insertion au fil d'une
+ * lecture. Quadratique, mais seulement sans index ou après une coupure. */
+static esp_err_t index_build(void)
+{
+    char tmp[88];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s_idx);
+    FILE *out = fopen(tmp, "wb");
+    if (!out)
+        return ESP_FAIL;
+    char page[DIVE_ITER_PAGE][32], last[32] = "", name[32];
+    size_t seen, total = 0;
+    bool ok = true;
+    do
+    {
+        DIR *dir = opendir(s_dir);
+        if (!dir)
+        {
+            ok = false;
+            break;
+        }
+        struct dirent *ent;
+        size_t n = 0;
+        seen = 0;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            if (!dive_id_of(ent, name) || (last[0] && strcmp(name, last) <= 0))
+                continue;
+            seen++;
+            if (n == DIVE_ITER_PAGE && strcmp(name, page[DIVE_ITER_PAGE - 1]) >= 0)
+                continue;
+            size_t i = n < DIVE_ITER_PAGE ? n++ : DIVE_ITER_PAGE - 1;
+            for (; i > 0 && strcmp(name, page[i - 1]) < 0; --i)
+                memcpy(page[i], page[i - 1], sizeof(page[i]));
+            strlcpy(page[i], name, sizeof(page[i]));
+        }
+        closedir(dir);
+        for (size_t i = 0; ok && i < n; ++i)
+        {
+            dive_cursor_t c;
+            idx_rec_t r = { .flags = IDX_LIVE };
+            strlcpy(r.id, page[i], sizeof(r.id));
+            if (dive_storage_load_cursor(r.id, &c) == ESP_OK && c.done)
+                r.flags |= IDX_SYNCED;
+            ok = fwrite(&r, sizeof(r), 1, out) == 1;
+            strlcpy(last, r.id, sizeof(last));
+        }
+        total += n;
+    } while (ok && seen > DIVE_ITER_PAGE);
+    if (fclose(out) != 0 || !ok)
+    {
+        unlink(tmp);
         return ESP_FAIL;
+    }
+    unlink(s_idx);
+    if (rename(tmp, s_idx) != 0)
+        return ESP_FAIL;
+    strlcpy(s_idx_last, last, sizeof(s_idx_last));
+    ESP_LOGI(TAG, "index rebuilt: %u dives", (unsigned)total);
+    return ESP_OK;
+}
 
+/* Un readdir (compte des .csv) et une lecture de l'index : reconstruit s'il
+ * manque, n'est plus trié ou ne compte pas les mêmes plongées (coupure entre
+ * fichiers et index), compacte si les supprimées dominent */
+static esp_err_t index_check(void)
+{
+    size_t on_disk = 0, live = 0, dead = 0;
+    DIR *dir = opendir(s_dir);
+    if (!dir)
+        return ESP_FAIL;
     struct dirent *ent;
+    char id[32];
+    while ((ent = readdir(dir)) != NULL)
+        if (dive_id_of(ent, id))
+            on_disk++;
+    closedir(dir);
+
+    char tmp[88];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s_idx);
+    struct stat st;
+    if (stat(s_idx, &st) != 0 && stat(tmp, &st) == 0)
+        rename(tmp, s_idx);
+    FILE *f = fopen(s_idx, "rb");
+    bool sorted = f != NULL;
+    idx_rec_t r;
+    s_idx_last[0] = '\0';
+    while (sorted && fread(&r, sizeof(r), 1, f) == 1)
+    {
+        r.id[sizeof(r.id) - 1] = '\0';
+        sorted = !s_idx_last[0] || strcmp(r.id, s_idx_last) > 0;
+        strlcpy(s_idx_last, r.id, sizeof(s_idx_last));
+        if (r.flags & IDX_LIVE)
+            live++;
+        else
+            dead++;
+    }
+    if (f)
+        fclose(f);
+
+    esp_err_t e = ESP_OK;
+    if (!sorted || live != on_disk)
+    {
+        if (f)
+            ESP_LOGW(TAG, "index: %u dives, %u on disk", (unsigned)live, (unsigned)on_disk);
+        e = index_build();
+    }
+    else if (dead > live)
+        e = index_rewrite(NULL);
+    s_idx_ok = e == ESP_OK;
+    return e;
+}
+
+/* Filtre ; les métadonnées ne sont lues que si la date est filtrée ou demandée
+ * (pending_only : drapeau de l'index, voir iter_refill) */
+static bool filter_pass(const dive_filter_t *f, const char *id, dive_metadata_t *meta)
+{
+    if (!f->after_date[0] && !meta)
+        return true;
+    dive_metadata_t m = { 0 };
+    if (dive_storage_read_metadata(id, &m) != ESP_OK)
+        return false;   // dossier sans métadonnées : plongée à moitié créée
+    if (f->after_date[0] && strcmp(m.date, f->after_date) <= 0)
+        return false;
+    if (meta)
+        *meta = m;
+    return true;
+}
+
+static bool rec_pass(const dive_filter_t *f, const idx_rec_t *r)
+{
+    return (r->flags & IDX_LIVE) && !(f->pending_only && (r->flags & IDX_SYNCED));
+}
+
+/* Page suivante : les DIVE_ITER_PAGE ids suivants de l'index. La position est
+ * retrouvée par dichotomie sur it->last : une réécriture de l'index entre deux
+ * pages ne fait ni sauter ni répéter d'id. */
+static esp_err_t iter_refill(dive_iter_t *it)
+{
+    if (!s_idx_ok && index_check() != ESP_OK)
+        return ESP_FAIL;
+    FILE *f = index_open();
+    if (!f)
+        return ESP_FAIL;
+    it->n = 0;
+    it->pos = 0;
+    uint32_t i = it->last[0] ? index_lower(f, it->last, true) : 0;
+    idx_rec_t r;
+    bool more = fseek(f, (long)(i * sizeof(r)), SEEK_SET) == 0;
+    while (more && it->n < DIVE_ITER_PAGE && (more = fread(&r, sizeof(r), 1, f) == 1))
+    {
+        r.id[sizeof(r.id) - 1] = '\0';
+        if (rec_pass(&it->f, &r))
+            strlcpy(it->page[it->n++], r.id, sizeof(it->page[0]));
+    }
+    fclose(f);
+    it->eof = !more;
+    return ESP_OK;
+}
+
+void dive_iter_init(dive_iter_t *it, const dive_filter_t *f)
+{
+    memset(it, 0, sizeof(*it));
+    if (f)
+        it->f = *f;
+    strlcpy(it->last, it->f.start_after, sizeof(it->last));
+}
+
+esp_err_t dive_iter_next(dive_iter_t *it, char id[32], dive_metadata_t *meta)
+{
+    if (!it || !id)
+        return ESP_ERR_INVALID_ARG;
+    for (;;)
+    {
+        if (it->f.limit && it->returned >= it->f.limit)
+            return ESP_ERR_NOT_FOUND;
+        if (it->pos == it->n)
+        {
+            if (it->eof)
+                return ESP_ERR_NOT_FOUND;
+            esp_err_t e = iter_refill(it);
+            if (e != ESP_OK)
+                return e;
+            if (it->n == 0)
+                return ESP_ERR_NOT_FOUND;
+        }
+        const char *cand = it->page[it->pos++];
+        strlcpy(it->last, cand, sizeof(it->last));
+        if (!filter_pass(&it->f, cand, meta))
+            continue;
+        strlcpy(id, cand, 32);
+        it->returned++;
+        return ESP_OK;
+    }
+}
+
+const char *dive_iter_token(const dive_iter_t *it)
+{
+    return it->last;
+}
+
+esp_err_t dive_storage_count(const dive_filter_t *f, size_t *count)
+{
+    if (!count)
+        return ESP_ERR_INVALID_ARG;
+    static const dive_filter_t all = { 0 };
+    if (!f)
+        f = &all;
+    if (!s_idx_ok && index_check() != ESP_OK)
+        return ESP_FAIL;
+    FILE *fi = index_open();
+    if (!fi)
+        return ESP_FAIL;
+    uint32_t i = f->start_after[0] ? index_lower(fi, f->start_after, true) : 0;
     size_t n = 0;
-    while ((ent = readdir(dir)) != NULL && n < max)
+    idx_rec_t r;
+    if (fseek(fi, (long)(i * sizeof(r)), SEEK_SET) == 0)
     {
-        if (ent->d_type == DT_DIR && strcmp(ent->d_name, ".") && strcmp(ent->d_name, ".."))
+        while (fread(&r, sizeof(r), 1, fi) == 1)
         {
-            strncpy(ids[n], ent->d_name, 31);
-            ids[n][31] = 0;
-            n++;
+            r.id[sizeof(r.id) - 1] = '\0';
+            if (rec_pass(f, &r) && filter_pass(f, r.id, NULL))
+                n++;
         }
     }
-    closedir(dir);
+    fclose(fi);
     *count = n;
     return ESP_OK;
 }
@@ -114,40 +668,371 @@ esp_err_t dive_storage_list(char ids[][32], size_t max, size_t *count)
 esp_err_t dive_storage_read_metadata(const char *dive_id, dive_metadata_t *meta)
 {
     char file[160];
-    build_path(dive_id, "metadata.txt", file, sizeof(file));
+    build_path(dive_id, DIVE_META, file, sizeof(file));
+    meta_rec_t r;
+    esp_err_t e = read_meta_rec(file, &r);
+    if (e == ESP_ERR_NOT_FOUND)
+    {
+        // coupure entre unlink et rename : le .tmp est complet
+        strncat(file, ".tmp", sizeof(file) - strlen(file) - 1);
+        e = read_meta_rec(file, &r);
+    }
+    if (e == ESP_OK)
+    {
+        memset(meta, 0, sizeof(*meta));
+        memcpy(meta->id, r.id, sizeof(meta->id) - 1);
+        memcpy(meta->date, r.date, sizeof(meta->date) - 1);
+        memcpy(meta->location, r.location, sizeof(meta->location) - 1);
+        memcpy(meta->diver, r.diver, sizeof(meta->diver) - 1);
+        meta->has_summary = (r.flags & META_HAS_SUMMARY) != 0;
+        if (meta->has_summary)
+            meta->summary = r.summary;
+        return ESP_OK;
+    }
+    if (e != ESP_ERR_NOT_FOUND)
+        ESP_LOGW(TAG, "%s: bad metadata (%s)", dive_id, esp_err_to_name(e));
+    return e == ESP_ERR_NOT_FOUND ? ESP_FAIL : e;
+}
 
+esp_err_t dive_storage_delete(const char *dive_id)
+{
+    // index d'abord : la plongée n'apparaît plus dans les parcours
+    esp_err_t e = index_flags(dive_id, 0, IDX_LIVE);
+    if (e != ESP_OK && e != ESP_ERR_NOT_FOUND)
+        s_idx_ok = false;
+    static const char *const ext[] = { DIVE_DATA, DIVE_META, DIVE_META ".tmp",
+                                       DIVE_CURSOR, DIVE_CURSOR ".tmp" };
+    char file[160];
+    for (size_t i = 0; i < sizeof(ext) / sizeof(ext[0]); ++i)
+    {
+        build_path(dive_id, ext[i], file, sizeof(file));
+        unlink(file);
+    }
+    return ESP_OK;
+}
+
+/* --- Identifiants : dive_<10 chiffres>, strictement croissants ---
+ * Le numéro est l'heure epoch si elle avance, sinon dernier + 1 : sans horloge
+ * réglée (0 au démarrage à froid) les ids ne se répètent pas, et l'ordre
+ * strcmp des ids zéro-complétés reste l'ordre de création. */
+static long long id_number(const char *id)
+{
+    if (strncmp(id, "dive_", 5) != 0)
+        return -1;
+    char *end;
+    long long v = strtoll(id + 5, &end, 10);
+    return *end ? -1 : v;
+}
+
+esp_err_t dive_storage_new_id(int64_t epoch_s, char id[32])
+{
+    if (!id)
+        return ESP_ERR_INVALID_ARG;
+    char file[96];
+    snprintf(file, sizeof(file), "%s/" DIVE_LAST_ID, s_dir);
+    long long last = -1;
     FILE *f = fopen(file, "r");
-    if (!f)
-        return ESP_FAIL;
+    if (f)
+    {
+        if (fscanf(f, "%lld", &last) != 1)
+            last = -1;
+        fclose(f);
+    }
+    // last_id perdu ou en retard : le plus grand id présent fait foi
+    DIR *dir = opendir(s_dir);
+    if (dir)
+    {
+        struct dirent *ent;
+        char cur[32];
+        while ((ent = readdir(dir)) != NULL)
+        {
+            long long v = dive_id_of(ent, cur) ? id_number(cur) : -1;
+            if (v > last)
+                last = v;
+        }
+        closedir(dir);
+    }
+    long long next = epoch_s > last ? epoch_s : last + 1;
+    snprintf(id, 32, "dive_%010lld", next);
 
-    char line[128];
-    while (fgets(line, sizeof(line), f))
+    // non enregistré : le plus grand id présent reprend le relais (sauf après suppression)
+    f = fopen(file, "w");
+    bool saved = f && fprintf(f, "%lld\n", next) > 0;
+    if (f && fclose(f) != 0)
+        saved = false;
+    if (!saved)
+        ESP_LOGW(TAG, "%s not saved", DIVE_LAST_ID);
+    return ESP_OK;
+}
+
+/* Ancienne disposition dives/<id>/{metadata.txt|meta.bin,data.csv,sync.txt}
+ * (FS à répertoires : hôte) -> fichiers à plat. Sans effet sur SPIFFS. */
+static void migrate_dirs(void)
+{
+    DIR *dir = opendir(s_dir);
+    if (!dir)
+        return;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
     {
-        if (sscanf(line, "id=%31s", meta->id) == 1)
-            continue;
-        if (sscanf(line, "date=%19s", meta->date) == 1)
-            continue;
-        if (sscanf(line, "location=%63[^\n]", meta->location) == 1)
+        const char *id = ent->d_name;
+        if (ent->d_type != DT_DIR || !strcmp(id, ".") || !strcmp(id, "..") || strlen(id) >= 32)
             continue;
-        if (sscanf(line, "diver=%31s", meta->diver) == 1)
+        char from[160], to[160];
+        dive_metadata_t m = { 0 };
+        meta_rec_t r;
+        snprintf(from, sizeof(from), "%s/%s/meta.bin", s_dir, id);
+        if (read_meta_rec(from, &r) != ESP_OK)
+        {
+            snprintf(from, sizeof(from), "%s/%s/metadata.txt", s_dir, id);
+            if (read_text_metadata(from, &m) != ESP_OK)
+                continue;   // dossier inconnu : laissé tel quel
+            strlcpy(m.id, id, sizeof(m.id));
+            if (write_metadata(&m) != ESP_OK)
+                continue;
+        }
+        else
+        {
+            build_path(id, DIVE_META, to, sizeof(to));
+            if (rename(from, to) != 0)
+                continue;
+        }
+        snprintf(from, sizeof(from), "%s/%s/sync.txt", s_dir, id);
+        build_path(id, DIVE_CURSOR, to, sizeof(to));
+        rename(from, to);
+        snprintf(from, sizeof(from), "%s/%s/data.csv", s_dir, id);
+        build_path(id, DIVE_DATA, to, sizeof(to));
+        rename(from, to);
+        static const char *const left[] = { "metadata.txt", "meta.bin", "meta.bin.tmp", "sync.txt.tmp" };
+        for (size_t i = 0; i < sizeof(left) / sizeof(left[0]); ++i)
+        {
+            snprintf(from, sizeof(from), "%s/%s/%s", s_dir, id, left[i]);
+            unlink(from);
+        }
+        snprintf(from, sizeof(from), "%s/%s", s_dir, id);
+        rmdir(from);
+        ESP_LOGI(TAG, "%s: migrated to flat files", id);
+    }
+    closedir(dir);
+}
+
+/* --- Lecture par plages et curseur de synchro --- */
+static FILE *open_data_at(const char *dive_id, uint32_t offset)
+{
+    char file[160];
+    build_path(dive_id, DIVE_DATA, file, sizeof(file));
+    FILE *f = fopen(file, "r");
+    if (!f)
+        return NULL;
+    if (offset == 0)
+    {
+        // début des données : on saute l'en-tête
+        char line[192];
+        if (!fgets(line, sizeof(line), f))
+        {
+            fclose(f);
+            return NULL;
+        }
+    }
+    else if (fseek(f, (long)offset, SEEK_SET) != 0)
+    {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+esp_err_t dive_samples_open(const char *dive_id, const dive_cursor_t *from, uint64_t after_us,
+                            dive_sample_iter_t *it)
+{
+    if (!dive_id || !it)
+        return ESP_ERR_INVALID_ARG;
+    memset(it, 0, sizeof(*it));
+    if (from)
+        it->pos = *from;
+    it->after_us = after_us;
+    it->f = open_data_at(dive_id, it->pos.offset);
+    return it->f ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t dive_samples_next(dive_sample_iter_t *it, dive_sample_t *s)
+{
+    if (!it || !it->f || !s)
+        return ESP_ERR_INVALID_ARG;
+    FILE *f = it->f;
+    char line[192];
+    for (;;)
+    {
+        long at = ftell(f);
+        if (!fgets(line, sizeof(line), f))
+            return ESP_ERR_NOT_FOUND;
+        // une ligne sans '\n' est en cours d'écriture : on s'arrête avant, relue au prochain appel
+        if (!strchr(line, '\n'))
+        {
+            fseek(f, at, SEEK_SET);
+            return ESP_ERR_NOT_FOUND;
+        }
+        unsigned long long ts;
+        float tc, pb;
+        it->pos.offset = (uint32_t)ftell(f);
+        if (sscanf(line, "%llu,%f,%f", &ts, &tc, &pb) != 3)
             continue;
+        it->pos.acked++;
+        if (it->after_us && ts <= it->after_us)
+            continue;   // 0 = tous : un échantillon daté 0 compte aussi
+        *s = (dive_sample_t){ .timestamp = ts, .temperature = tc, .pressure = pb };
+        return ESP_OK;
     }
-    fclose(f);
+}
+
+void dive_samples_close(dive_sample_iter_t *it)
+{
+    if (it && it->f)
+    {
+        fclose(it->f);
+        it->f = NULL;
+    }
+}
+
+esp_err_t dive_storage_read_samples(const char *dive_id, dive_cursor_t *pos,
+                                    dive_sample_t *out, size_t max, size_t *n)
+{
+    if (!dive_id || !pos || !n || (max && !out))
+        return ESP_ERR_INVALID_ARG;
+    *n = 0;
+    dive_sample_iter_t it;
+    if (dive_samples_open(dive_id, pos, 0, &it) != ESP_OK)
+        return ESP_FAIL;
+    while (*n < max && dive_samples_next(&it, &out[*n]) == ESP_OK)
+        (*n)++;
+    dive_samples_close(&it);
+    pos->acked = it.pos.acked;
+    pos->offset = it.pos.offset;
     return ESP_OK;
 }
 
-esp_err_t dive_storage_delete(const char *dive_id)
+esp_err_t dive_storage_seek_samples(const char *dive_id, uint32_t index, dive_cursor_t *pos)
 {
-    char path[128];
-    snprintf(path, sizeof(path), "/spiffs/dives/%s", dive_id);
+    if (!dive_id || !pos)
+        return ESP_ERR_INVALID_ARG;
+    dive_cursor_t c = { 0 };
+    dive_sample_t buf[16];
+    while (c.acked < index)
+    {
+        size_t want = index - c.acked, n = 0;
+        if (want > 16)
+            want = 16;
+        esp_err_t e = dive_storage_read_samples(dive_id, &c, buf, want, &n);
+        if (e != ESP_OK)
+            return e;
+        if (n == 0)
+            break;   // moins d'échantillons que demandé : on s'arrête à la fin
+    }
+    pos->acked = c.acked;
+    pos->offset = c.offset;
+    pos->done = false;
+    return ESP_OK;
+}
 
+esp_err_t dive_storage_data_open(const char *dive_id, dive_data_t *d)
+{
+    if (!dive_id || !d)
+        return ESP_ERR_INVALID_ARG;
+    d->f = NULL;
+    d->size = 0;
+    char file[160];
+    build_path(dive_id, DIVE_DATA, file, sizeof(file));
+    FILE *f = fopen(file, "r");
+    if (!f)
+        return ESP_ERR_NOT_FOUND;
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0)
+    {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    d->f = f;
+    d->size = (uint32_t)st.st_size;
+    return ESP_OK;
+}
+
+esp_err_t dive_storage_data_read(dive_data_t *d, uint32_t offset, void *buf, size_t len, size_t *n)
+{
+    if (!d || !d->f || (len && !buf) || !n)
+        return ESP_ERR_INVALID_ARG;
+    *n = 0;
+    if (offset >= d->size)
+        return ESP_OK;
+    if (len > d->size - offset)
+        len = d->size - offset;
+    // lectures séquentielles : pas de fseek (vide le tampon stdio) si déjà en place
+    FILE *f = d->f;
+    if ((uint32_t)ftell(f) != offset && fseek(f, (long)offset, SEEK_SET) != 0)
+        return ESP_FAIL;
+    *n = fread(buf, 1, len, f);
+    return ferror(f) ? ESP_FAIL : ESP_OK;
+}
+
+void dive_storage_data_close(dive_data_t *d)
+{
+    if (d && d->f)
+    {
+        fclose(d->f);
+        d->f = NULL;
+    }
+}
+
+esp_err_t dive_storage_load_cursor(const char *dive_id, dive_cursor_t *c)
+{
+    if (!dive_id || !c)
+        return ESP_ERR_INVALID_ARG;
+    memset(c, 0, sizeof(*c));
     char file[160];
-    build_path(dive_id, "metadata.txt", file, sizeof(file));
-    unlink(file);
-    build_path(dive_id, "data.csv", file, sizeof(file));
-    unlink(file);
-    rmdir(path);
+    build_path(dive_id, DIVE_CURSOR, file, sizeof(file));
+    FILE *f = fopen(file, "r");
+    if (!f)
+    {
+        // coupure entre unlink et rename : le .tmp est complet
+        strncat(file, ".tmp", sizeof(file) - strlen(file) - 1);
+        f = fopen(file, "r");
+    }
+    if (!f)
+        return ESP_OK;   // jamais synchronisée
 
+    unsigned acked = 0, offset = 0, done = 0;
+    int got = fscanf(f, "acked=%u\noffset=%u\ndone=%u", &acked, &offset, &done);
+    fclose(f);
+    if (got != 3)
+    {
+        ESP_LOGW(TAG, "%s: bad cursor, full resync", dive_id);
+        return ESP_OK;
+    }
+    c->acked = acked;
+    c->offset = offset;
+    c->done = done != 0;
+    return ESP_OK;
+}
+
+esp_err_t dive_storage_save_cursor(const char *dive_id, const dive_cursor_t *c)
+{
+    if (!dive_id || !c)
+        return ESP_ERR_INVALID_ARG;
+    char file[160], tmp[168];
+    build_path(dive_id, DIVE_CURSOR, file, sizeof(file));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+
+    FILE *f = fopen(tmp, "w");
+    if (!f)
+        return ESP_FAIL;
+    fprintf(f, "acked=%u\noffset=%u\ndone=%u\n", (unsigned)c->acked, (unsigned)c->offset, c->done ? 1u : 0u);
+    if (fclose(f) != 0)
+        return ESP_FAIL;
+    unlink(file);   // SPIFFS : rename n'écrase pas la cible
+    if (rename(tmp, file) != 0)
+        return ESP_FAIL;
+    // drapeau de l'index pour pending_only ; perdu, la plongée est juste revue (curseur done)
+    if (index_flags(dive_id, c->done ? IDX_SYNCED : 0, c->done ? 0 : IDX_SYNCED) == ESP_FAIL)
+        ESP_LOGW(TAG, "%s: index flag not updated", dive_id);
     return ESP_OK;
 }
 
@@ -179,6 +1064,36 @@ static char *read_text_file(const char *path, size_t *out_len)
     return buf;
 }
 
+esp_err_t dive_storage_meta_to_json(const dive_metadata_t *meta, cJSON *obj)
+{
+    if (!meta || !obj)
+        return ESP_ERR_INVALID_ARG;
+    cJSON_AddStringToObject(obj, "id", meta->id);
+    cJSON_AddStringToObject(obj, "date", meta->date);
+    cJSON_AddStringToObject(obj, "location", meta->location);
+    cJSON_AddStringToObject(obj, "diver", meta->diver);
+    if (meta->has_summary)
+    {
+        cJSON *sum = cJSON_CreateObject();
+        if (!sum)
+            return ESP_ERR_NO_MEM;
+        const dive_summary_t *sm = &meta->summary;
+        cJSON_AddNumberToObject(sum, "samples", sm->samples);
+        cJSON_AddNumberToObject(sum, "duration_s", sm->duration_s);
+        cJSON_AddNumberToObject(sum, "max_depth_m", sm->max_depth_m);
+        cJSON_AddNumberToObject(sum, "avg_depth_m", sm->avg_depth_m);
+        cJSON_AddNumberToObject(sum, "min_temp_c", sm->min_temp_c);
+        cJSON_AddNumberToObject(sum, "max_temp_c", sm->max_temp_c);
+        cJSON_AddNumberToObject(sum, "max_ascent_m_min", sm->max_ascent_m_min);
+        cJSON_AddNumberToObject(sum, "descent_s", sm->descent_s);
+        cJSON_AddNumberToObject(sum, "bottom_s", sm->bottom_s);
+        cJSON_AddNumberToObject(sum, "ascent_s", sm->ascent_s);
+        cJSON_AddNumberToObject(sum, "safety_stop_s", sm->safety_stop_s);
+        cJSON_AddItemToObject(obj, "summary", sum);
+    }
+    return ESP_OK;
+}
+
 // --- construit un objet JSON pour UNE plongée ---
 static esp_err_t build_dive_cjson(const char *dive_id, cJSON **out_obj)
 {
@@ -190,57 +1105,41 @@ static esp_err_t build_dive_cjson(const char *dive_id, cJSON **out_obj)
     }
 
     // 2) data.csv -> samples array
-    char path[160];
-    build_path(dive_id, "data.csv", path, sizeof(path));
-    FILE *f = fopen(path, "r");
-    if (!f)
+    dive_sample_iter_t it;
+    if (dive_samples_open(dive_id, NULL, 0, &it) != ESP_OK)
         return ESP_FAIL;
 
-    // skip header
-    char line[192];
-    if (fgets(line, sizeof(line), f) == NULL)
-    {
-        fclose(f);
-        return ESP_FAIL;
-    }
-
     cJSON *root = cJSON_CreateObject();
     cJSON *arr = cJSON_CreateArray();
     if (!root || !arr)
     {
         if (root)
             cJSON_Delete(root);
-        fclose(f);
+        if (arr)
+            cJSON_Delete(arr);
+        dive_samples_close(&it);
         return ESP_ERR_NO_MEM;
     }
 
-    cJSON_AddStringToObject(root, "id", meta.id);
-    cJSON_AddStringToObject(root, "date", meta.date);
-    cJSON_AddStringToObject(root, "location", meta.location);
-    cJSON_AddStringToObject(root, "diver", meta.diver);
+    dive_storage_meta_to_json(&meta, root);
     cJSON_AddItemToObject(root, "samples", arr);
 
-    while (fgets(line, sizeof(line), f))
+    dive_sample_t smp;
+    while (dive_samples_next(&it, &smp) == ESP_OK)
     {
-        // Format: timestamp_us,temperature_C,pressure_bar
-        unsigned long long ts;
-        float tc, pb;
-        if (sscanf(line, "%llu,%f,%f", &ts, &tc, &pb) == 3)
+        cJSON *o = cJSON_CreateObject();
+        if (!o)
         {
-            cJSON *o = cJSON_CreateObject();
-            if (!o)
-            {
-                cJSON_Delete(root);
-                fclose(f);
-                return ESP_ERR_NO_MEM;
-            }
-            cJSON_AddNumberToObject(o, "ts_us", (double)ts);
-            cJSON_AddNumberToObject(o, "temp_c", tc);
-            cJSON_AddNumberToObject(o, "press_bar", pb);
-            cJSON_AddItemToArray(arr, o);
+            cJSON_Delete(root);
+            dive_samples_close(&it);
+            return ESP_ERR_NO_MEM;
         }
+        cJSON_AddNumberToObject(o, "ts_us", (double)smp.timestamp);
+        cJSON_AddNumberToObject(o, "temp_c", smp.temperature);
+        cJSON_AddNumberToObject(o, "press_bar", smp.pressure);
+        cJSON_AddItemToArray(arr, o);
     }
-    fclose(f);
+    dive_samples_close(&it);
 
     *out_obj = root;
     return ESP_OK;
@@ -272,26 +1171,29 @@ esp_err_t dive_storage_export_all_json(char **out_json, size_t *out_len)
     if (!out_json)
         return ESP_ERR_INVALID_ARG;
 
-    // lister les dossiers de plongées
-    char ids[64][32]; // jusqu’à 64 dives (ajuste si besoin)
-    size_t cnt = 0;
-    esp_err_t e = dive_storage_list(ids, 64, &cnt);
-    if (e != ESP_OK)
-        return e;
-
     cJSON *arr = cJSON_CreateArray();
     if (!arr)
         return ESP_ERR_NO_MEM;
 
-    for (size_t i = 0; i < cnt; ++i)
+    // toutes les plongées, dans l'ordre des ids
+    dive_iter_t it;
+    char id[32];
+    esp_err_t e;
+    dive_iter_init(&it, NULL);
+    while ((e = dive_iter_next(&it, id, NULL)) == ESP_OK)
     {
         cJSON *obj = NULL;
-        if (build_dive_cjson(ids[i], &obj) == ESP_OK && obj)
+        if (build_dive_cjson(id, &obj) == ESP_OK && obj)
         {
             cJSON_AddItemToArray(arr, obj);
         }
         // en cas d’erreur sur une dive, on peut choisir de continuer
     }
+    if (e != ESP_ERR_NOT_FOUND)
+    {
+        cJSON_Delete(arr);
+        return e;
+    }
 
     char *txt = cJSON_PrintUnformatted(arr);
     cJSON_Delete(arr);
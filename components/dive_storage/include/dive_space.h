@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* --- Place des plongées sur le FS ---
+ * Le GC de SPIFFS se déclenche à l'écriture quand il ne reste plus de pages
+ * effacées : un fprintf peut alors bloquer des dizaines de ms. SPIFFS ne
+ * préalloue pas de fichier. Entre deux plongées (fin de plongée, fin d'upload),
+ * la maintenance supprime les plongées synchronisées en trop puis fait effacer
+ * d'avance par le GC les pages d'une plongée de durée maximale. Au début d'une
+ * plongée, les échantillons arrivent déjà : on ne fait que vérifier la place
+ * (éviction seulement si elle manque, jamais de GC). Une plongée non
+ * synchronisée n'est jamais supprimée. */
+
+typedef struct {
+    size_t    total, used;      // occupation après l'opération
+    size_t    reserve;          // octets visés : une plongée de durée maximale
+    uint32_t  evicted;          // plongées supprimées
+    uint32_t  gc_ms;            // durée du GC
+    esp_err_t gc;               // ESP_ERR_NOT_FINISHED : pas assez de pages effacées
+} dive_space_report_t;
+
+/** Octets d'une plongée de CONFIG_APP_DIVE_MAX_MIN minutes */
+size_t    dive_space_reserve_bytes(void);
+
+/** Début de plongée (avant le premier échantillon) : place d'une plongée de
+ *  durée maximale, plongées synchronisées évincées seulement si elle manque ;
+ *  pas de GC (gc_ms = 0). ESP_ERR_NO_MEM : place insuffisante même sans
+ *  plongée synchronisée ; la plongée s'enregistre quand même */
+esp_err_t dive_space_check(dive_space_report_t *rep);
+
+/** Entre deux plongées : rétention (CONFIG_APP_RETAIN_DIVES, CONFIG_APP_SPACE_HIGH_PCT)
+ *  puis GC pour la prochaine plongée ; peut durer des secondes. rep optionnel */
+esp_err_t dive_space_maintain(dive_space_report_t *rep);
+
+#ifdef __cplusplus
+}
+#endif
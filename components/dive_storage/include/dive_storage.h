@@ -8,11 +8,28 @@
 extern "C" {
 #endif
 
+/* Résumé calculé en streaming pendant la plongée, écrit à la fermeture */
+typedef struct {
+    uint32_t samples;
+    uint32_t duration_s;
+    float    max_depth_m;
+    float    avg_depth_m;       // moyenne pondérée dans le temps
+    float    min_temp_c;
+    float    max_temp_c;
+    float    max_ascent_m_min;  // pire vitesse de remontée sur une fenêtre
+    uint32_t descent_s;         // durées par phase
+    uint32_t bottom_s;
+    uint32_t ascent_s;
+    uint32_t safety_stop_s;
+} dive_summary_t;
+
 typedef struct {
     char id[32];          // identifiant unique plongée
     char date[20];        // ISO8601 "YYYY-MM-DDTHH:MM:SS"
     char location[64];    // ex: "Brest, France"
     char diver[32];       // nom du plongeur
+    bool has_summary;     // summary valide (plongée fermée)
+    dive_summary_t summary;
 } dive_metadata_t;
 
 typedef struct {
@@ -21,20 +38,75 @@ typedef struct {
     float pressure;       // bar
 } dive_sample_t;
 
-/** Initialise le FS (SPIFFS) et le répertoire /dives */
+/* Position de synchronisation : échantillons acquittés par le serveur et
+ * offset correspondant dans <id>.csv (reprise sans relire le début) */
+typedef struct {
+    uint32_t acked;       // nb d'échantillons acquittés
+    uint32_t offset;      // octet suivant le dernier acquitté (0 = début des données)
+    bool     done;        // plongée fermée et entièrement acquittée
+} dive_cursor_t;
+
+/** Initialise le FS (SPIFFS) et le répertoire /dives (idempotent) */
 esp_err_t dive_storage_init(void);
 
-/** Crée un nouveau dossier pour une plongée + fichier metadata */
+/** Identifiant pour une nouvelle plongée : "dive_" + 10 chiffres, l'heure epoch
+ *  (s) si elle dépasse le dernier attribué, sinon dernier + 1 (horloge non réglée) */
+esp_err_t dive_storage_new_id(int64_t epoch_s, char id[32]);
+
+/** Crée les fichiers d'une plongée (métadonnées + <id>.csv vide).
+ *  ESP_ERR_INVALID_STATE : id déjà présent */
 esp_err_t dive_storage_create_dive(const dive_metadata_t *meta);
 
 /** Ajoute un échantillon à une plongée existante */
 esp_err_t dive_storage_append_sample(const char *dive_id, const dive_sample_t *sample);
 
+/** Réécrit les métadonnées (ex: ajout du résumé à la fermeture) */
+esp_err_t dive_storage_update_metadata(const dive_metadata_t *meta);
+
 /** Ferme la plongée (optionnel, ici juste flush) */
 esp_err_t dive_storage_close_dive(const char *dive_id);
 
-/** Liste les plongées enregistrées */
-esp_err_t dive_storage_list(char ids[][32], size_t max, size_t *count);
+/* --- Parcours des plongées, mémoire constante ---
+ * Ordre stable : identifiants croissants (strcmp ; dive_storage_new_id donne des
+ * numéros zéro-complétés monotones = ordre de création), quel que soit l'ordre
+ * du répertoire. Le parcours lit l'index trié dives/ids.idx (tenu à jour par
+ * create/delete/save_cursor) par pages de DIVE_ITER_PAGE identifiants : une
+ * dichotomie puis une lecture à la suite par page, sans relire le répertoire ;
+ * rien d'alloué, aucun plafond sur le nombre de plongées. pending_only se lit
+ * dans l'index (pas de curseur ouvert par plongée). La position atteinte
+ * (dive_iter_token) sert de jeton de pagination via start_after. */
+#ifndef DIVE_ITER_PAGE
+#define DIVE_ITER_PAGE 8
+#endif
+
+typedef struct {
+    char     start_after[32];   // ids > celui-ci ("" = depuis le début)
+    char     after_date[20];    // métadonnées datées après (ISO 8601, "" = toutes)
+    bool     pending_only;      // pas encore entièrement synchronisées
+    uint32_t limit;             // plongées rendues au plus (0 = toutes) : une page
+} dive_filter_t;
+
+typedef struct {
+    dive_filter_t f;
+    char     last[32];          // dernier id examiné : la page suivante part de là
+    char     page[DIVE_ITER_PAGE][32];
+    uint8_t  n, pos;
+    bool     eof;               // rien au-delà de la page en cours
+    uint32_t returned;
+} dive_iter_t;
+
+/** Début du parcours ; f NULL = toutes les plongées */
+void dive_iter_init(dive_iter_t *it, const dive_filter_t *f);
+
+/** Plongée suivante passant le filtre ; meta (optionnel) reçoit ses métadonnées.
+ *  @return ESP_OK, ESP_ERR_NOT_FOUND en fin de parcours (ou de page), autre = FS */
+esp_err_t dive_iter_next(dive_iter_t *it, char id[32], dive_metadata_t *meta);
+
+/** Jeton de reprise (à passer en start_after) : position atteinte, "" avant le début */
+const char *dive_iter_token(const dive_iter_t *it);
+
+/** Nombre de plongées passant le filtre (une lecture de l'index ; limit ignoré) */
+esp_err_t dive_storage_count(const dive_filter_t *f, size_t *count);
 
 /** Lit les métadonnées d’une plongée */
 esp_err_t dive_storage_read_metadata(const char *dive_id, dive_metadata_t *meta);
@@ -42,11 +114,60 @@ esp_err_t dive_storage_read_metadata(const char *dive_id, dive_metadata_t *meta)
 /** Supprime une plongée */
 esp_err_t dive_storage_delete(const char *dive_id);
 
+/* --- Parcours des échantillons d'une plongée (<id>.csv ouvert une fois) --- */
+typedef struct {
+    void         *f;            // FILE* interne
+    dive_cursor_t pos;          // après le dernier échantillon rendu : reprise possible
+    uint64_t      after_us;     // échantillons datés après (0 = tous)
+} dive_sample_iter_t;
+
+/** Ouvre <id>.csv à from (NULL = début) */
+esp_err_t dive_samples_open(const char *dive_id, const dive_cursor_t *from, uint64_t after_us,
+                            dive_sample_iter_t *it);
+
+/** Échantillon suivant. ESP_ERR_NOT_FOUND : fin des lignes complètes */
+esp_err_t dive_samples_next(dive_sample_iter_t *it, dive_sample_t *s);
+
+/** Ferme (sans effet si déjà fermé) */
+void dive_samples_close(dive_sample_iter_t *it);
+
+/** Lit jusqu'à max échantillons à partir de pos, et avance pos (acked = index, offset) */
+esp_err_t dive_storage_read_samples(const char *dive_id, dive_cursor_t *pos,
+                                    dive_sample_t *out, size_t max, size_t *n);
+
+/** Positionne pos sur l'échantillon index (relecture depuis le début) */
+esp_err_t dive_storage_seek_samples(const char *dive_id, uint32_t index, dive_cursor_t *pos);
+
+/* Accès brut à <id>.csv (téléchargement par plages d'octets) */
+typedef struct {
+    void    *f;           // FILE* interne
+    uint32_t size;        // taille à l'ouverture : les ajouts ultérieurs ne sont pas servis
+} dive_data_t;
+
+/** Ouvre <id>.csv en lecture et relève sa taille */
+esp_err_t dive_storage_data_open(const char *dive_id, dive_data_t *d);
+
+/** Lit jusqu'à len octets à offset (borné à d->size) ; *n = 0 au-delà */
+esp_err_t dive_storage_data_read(dive_data_t *d, uint32_t offset, void *buf, size_t len, size_t *n);
+
+/** Ferme (sans effet si déjà fermé) */
+void dive_storage_data_close(dive_data_t *d);
+
+/** Curseur de synchro persistant (absent = tout à envoyer) */
+esp_err_t dive_storage_load_cursor(const char *dive_id, dive_cursor_t *c);
+/** Écrit le curseur (fichier temporaire + rename : jamais de curseur à moitié écrit) */
+esp_err_t dive_storage_save_cursor(const char *dive_id, const dive_cursor_t *c);
+
+
+struct cJSON;
+/** Ajoute id/date/location/diver (+ summary si fermée) à l'objet JSON obj */
+esp_err_t dive_storage_meta_to_json(const dive_metadata_t *meta, struct cJSON *obj);
 
 /** Exporte une plongée en JSON (alloue une chaîne à free()).
  *  Format:
  *  {
  *    "id":"dive001","date":"...","location":"...","diver":"...",
+ *    "summary":{"max_depth_m":..,...},   // si la plongée a été fermée
  *    "samples":[{"ts_us":123,"temp_c":20.1,"press_bar":2.05}, ...]
  *  }
  */
@@ -0,0 +1,226 @@
+#include "dlog.h"
+#include "hal_fs.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "app_mem.h"
+#include <string.h>
+#include <inttypes.h>
+
+static const char *TAG = "dlog";
+
+#ifndef CONFIG_DLOG_SLOTS
+#define CONFIG_DLOG_SLOTS 128
+#endif
+#ifndef CONFIG_DLOG_DRAIN_MS
+#define CONFIG_DLOG_DRAIN_MS 200
+#endif
+#ifndef CONFIG_DLOG_TO_FILE
+#define CONFIG_DLOG_TO_FILE 0
+#endif
+
+_Static_assert((CONFIG_DLOG_SLOTS & (CONFIG_DLOG_SLOTS - 1)) == 0, "DLOG_SLOTS doit être une puissance de 2");
+
+#define DLOG_MASK (CONFIG_DLOG_SLOTS - 1)
+#define DLOG_PTR_WORDS (sizeof(void *) / 4)
+
+/* Enregistrement fixe ; le même format est écrit tel quel dans dlog.bin */
+typedef struct {
+    uint32_t    seq;        // index + 1 une fois publié (0 = en cours d'écriture)
+    uint32_t    ts_ms;
+    const char *fmt;
+    const char *tag;
+    uint16_t    meta;       // niveau (bits 0-2) | nb d'arguments (bits 3-5)
+    uint16_t    types;      // dlog_type_t sur 2 bits par argument
+    uint32_t    w[DLOG_MAX_WORDS];
+} dlog_rec_t;
+
+static dlog_rec_t        s_ring[CONFIG_DLOG_SLOTS];
+static uint32_t          s_head, s_tail, s_dropped;
+static SemaphoreHandle_t s_drain_mtx;      // sérialise les consommateurs (tâche / flush)
+static TaskHandle_t      s_task;
+
+/* ---------- Producteur : CAS sur la tête, aucune attente ---------- */
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt,
+                const dlog_arg_t *args, size_t nargs)
+{
+    uint32_t h = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+    do {
+        if (h - __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE) >= CONFIG_DLOG_SLOTS) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&s_head, &h, h + 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    dlog_rec_t *r = &s_ring[h & DLOG_MASK];
+    r->ts_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    r->fmt = fmt;
+    r->tag = tag;
+
+    size_t wi = 0, n = 0;
+    uint16_t types = 0;
+    for (; n < nargs && n < DLOG_MAX_ARGS; ++n) {
+        size_t need = (args[n].type == DLOG_T_I64) ? 2
+                    : (args[n].type == DLOG_T_PTR) ? DLOG_PTR_WORDS : 1;
+        if (wi + need > DLOG_MAX_WORDS) break;    // arguments suivants affichés "?"
+        r->w[wi++] = (uint32_t)args[n].v;
+        if (need == 2) r->w[wi++] = (uint32_t)(args[n].v >> 32);
+        types |= (uint16_t)(args[n].type << (2 * n));
+    }
+    r->types = types;
+    r->meta = (uint16_t)((level & 7) | (n << 3));
+    __atomic_store_n(&r->seq, h + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t dlog_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+/* ---------- Formatage différé (une conversion printf à la fois) ---------- */
+static size_t dlog_format(char *out, size_t sz, const dlog_rec_t *r)
+{
+    const char *p = r->fmt;
+    size_t pos = 0, wi = 0, ai = 0, nargs = (r->meta >> 3) & 7;
+
+    while (*p && pos + 1 < sz) {
+        if (*p != '%') { out[pos++] = *p++; continue; }
+        if (p[1] == '%') { out[pos++] = '%'; p += 2; continue; }
+
+        // %[flags][largeur][.précision][longueur]conversion
+        char spec[24];
+        size_t sl = 0;
+        spec[sl++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && sl < sizeof(spec) - 4) spec[sl++] = *p++;
+        while (*p && strchr("hlLqjzt", *p)) p++;          // remplacée selon le type stocké
+        char conv = *p;
+        if (!conv) break;
+        p++;
+
+        if (ai >= nargs) { out[pos++] = '?'; continue; }
+        dlog_type_t t = (dlog_type_t)((r->types >> (2 * ai++)) & 3);
+        uint64_t v = r->w[wi++];
+        size_t extra = (t == DLOG_T_I64) ? 1 : (t == DLOG_T_PTR) ? DLOG_PTR_WORDS - 1 : 0;
+        for (size_t k = 0; k < extra; ++k) v |= (uint64_t)r->w[wi++] << (32 * (k + 1));
+
+        int n;
+        if (strchr("di", conv)) {
+            int64_t sv = (t == DLOG_T_I32) ? (int64_t)(int32_t)v : (int64_t)v;
+            spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, (long long)sv);
+        } else if (strchr("uoxX", conv)) {
+            spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, (unsigned long long)v);
+        } else if (strchr("fFeEgGaA", conv)) {
+            float f;
+            uint32_t w32 = (uint32_t)v;
+            memcpy(&f, &w32, sizeof(f));
+            spec[sl++] = conv; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, (double)f);
+        } else if (conv == 's') {
+            const char *str = (const char *)(uintptr_t)v;
+            spec[sl++] = 's'; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, str ? str : "(null)");
+        } else if (conv == 'p') {
+            spec[sl++] = 'p'; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, (void *)(uintptr_t)v);
+        } else {
+            spec[sl++] = conv; spec[sl] = 0;
+            n = snprintf(out + pos, sz - pos, spec, (int)v);   // %c
+        }
+        if (n > 0) pos += (size_t)n;
+        if (pos >= sz) pos = sz - 1;
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+static char level_letter(int lvl)
+{
+    static const char l[] = "NEWIDV";
+    return (lvl >= 0 && lvl < 6) ? l[lvl] : '?';
+}
+
+/* ---------- Consommateur ---------- */
+#if CONFIG_DLOG_TO_FILE
+static FILE *open_sink(void)
+{
+    char path[80];
+    snprintf(path, sizeof(path), "%s/dlog.bin", hal_fs_base_path());
+    FILE *f = fopen(path, "ab");
+    if (f && ftell(f) == 0) {
+        // en-tête : magic, taille pointeur, mots d'arguments, taille d'enregistrement
+        const uint8_t hdr[8] = { 'D', 'L', 'G', '1', (uint8_t)sizeof(void *), DLOG_MAX_WORDS,
+                                 (uint8_t)sizeof(dlog_rec_t), 0 };
+        fwrite(hdr, 1, sizeof(hdr), f);
+    }
+    return f;
+}
+#endif
+
+static void drain(void)
+{
+    if (s_drain_mtx) xSemaphoreTake(s_drain_mtx, portMAX_DELAY);
+#if CONFIG_DLOG_TO_FILE
+    FILE *sink = NULL;
+#endif
+    static uint32_t reported;
+    for (;;) {
+        uint32_t t = __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+        const dlog_rec_t *slot = &s_ring[t & DLOG_MASK];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != t + 1) break;
+        dlog_rec_t r = *slot;
+        __atomic_store_n(&s_tail, t + 1, __ATOMIC_RELEASE);   // slot rendu avant la sortie lente
+
+#if CONFIG_DLOG_TO_FILE
+        if (!sink) sink = open_sink();
+        if (sink) { fwrite(&r, sizeof(r), 1, sink); continue; }
+#endif
+        char msg[160];
+        dlog_format(msg, sizeof(msg), &r);
+        int lvl = r.meta & 7;
+        esp_log_write((esp_log_level_t)lvl, r.tag, "%c (%" PRIu32 ") %s: %s\n",
+                      level_letter(lvl), r.ts_ms, r.tag, msg);
+    }
+#if CONFIG_DLOG_TO_FILE
+    if (sink) fclose(sink);
+#endif
+    uint32_t d = dlog_dropped();
+    if (d != reported) {
+        ESP_LOGW(TAG, "%" PRIu32 " records dropped (ring full)", d - reported);
+        reported = d;
+    }
+    if (s_drain_mtx) xSemaphoreGive(s_drain_mtx);
+}
+
+static void dlog_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DLOG_DRAIN_MS));
+        drain();
+    }
+}
+
+esp_err_t dlog_init(void)
+{
+    if (s_task) return ESP_OK;
+    APP_TASK_MEM(task_mem, 3072);
+#if CONFIG_APP_STATIC_ALLOC
+    static StaticSemaphore_t mtx_buf;
+    s_drain_mtx = xSemaphoreCreateMutexStatic(&mtx_buf);
+    app_mem_account("dlog", sizeof(mtx_buf));
+#else
+    s_drain_mtx = xSemaphoreCreateMutex();
+#endif
+    if (!s_drain_mtx) return ESP_ERR_NO_MEM;
+    app_mem_account("dlog", sizeof(s_ring));
+    return app_task_create(dlog_task, "dlog", &task_mem, NULL, APP_ROLE_BACKGROUND, &s_task);
+}
+
+void dlog_flush(void)
+{
+    drain();
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Log différé : l'appelant n'écrit qu'un enregistrement binaire (pointeur du format +
+ * arguments bruts) dans un anneau sans verrou ; le formatage et la sortie UART/fichier
+ * sont faits plus tard par une tâche basse priorité.
+ *
+ * Contraintes : fmt et tag doivent être des littéraux ; un argument %s doit pointer
+ * vers une chaîne statique (ex. esp_err_to_name(), nom de capteur), il est lu au drain.
+ * Au plus DLOG_MAX_WORDS mots de 32 bits d'arguments (un 64 bits en prend deux). */
+
+#ifndef CONFIG_DLOG_ENABLE
+#define CONFIG_DLOG_ENABLE 1
+#endif
+
+#define DLOG_MAX_ARGS   6
+#define DLOG_MAX_WORDS  8
+
+typedef enum {
+    DLOG_T_I32 = 0,     // entiers <= 32 bits (et char, bool, enum)
+    DLOG_T_I64,         // long / long long (64 bits sur hôte)
+    DLOG_T_F32,         // float/double, stocké en float
+    DLOG_T_PTR,         // %s / %p
+} dlog_type_t;
+
+typedef struct {
+    uint8_t  type;      // dlog_type_t
+    uint64_t v;
+} dlog_arg_t;
+
+static inline dlog_arg_t dlog_arg_i32(int32_t x)       { return (dlog_arg_t){ DLOG_T_I32, (uint32_t)x }; }
+static inline dlog_arg_t dlog_arg_u32(uint32_t x)      { return (dlog_arg_t){ DLOG_T_I32, x }; }
+static inline dlog_arg_t dlog_arg_i64(long long x)     { return (dlog_arg_t){ DLOG_T_I64, (uint64_t)x }; }
+/* long : 32 bits sur cible (uint32_t y est un unsigned long), 64 bits sur hôte */
+static inline dlog_arg_t dlog_arg_long(long x)
+{
+    return (dlog_arg_t){ sizeof(long) > 4 ? DLOG_T_I64 : DLOG_T_I32, (uint64_t)x };
+}
+static inline dlog_arg_t dlog_arg_ulong(unsigned long x)
+{
+    return (dlog_arg_t){ sizeof(long) > 4 ? DLOG_T_I64 : DLOG_T_I32, (uint64_t)x };
+}
+static inline dlog_arg_t dlog_arg_f32(double x)
+{
+    float f = (float)x;
+    uint32_t w;
+    __builtin_memcpy(&w, &f, sizeof(w));
+    return (dlog_arg_t){ DLOG_T_F32, w };
+}
+static inline dlog_arg_t dlog_arg_ptr(const void *p)   { return (dlog_arg_t){ DLOG_T_PTR, (uintptr_t)p }; }
+
+#define DLOG_ARG(x) _Generic((x),                                   \
+        float: dlog_arg_f32, double: dlog_arg_f32,                  \
+        long: dlog_arg_long, unsigned long: dlog_arg_ulong,            \
+        long long: dlog_arg_i64, unsigned long long: dlog_arg_i64,  \
+        unsigned int: dlog_arg_u32,                                 \
+        char *: dlog_arg_ptr, const char *: dlog_arg_ptr,           \
+        void *: dlog_arg_ptr, const void *: dlog_arg_ptr,           \
+        default: dlog_arg_i32)(x)
+
+/* Application de DLOG_ARG à chaque argument (0 à 6) */
+#define DLOG_NARG_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define DLOG_NARG(...) DLOG_NARG_(_, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_MAP0()
+#define DLOG_MAP1(a)                DLOG_ARG(a)
+#define DLOG_MAP2(a, b)             DLOG_ARG(a), DLOG_ARG(b)
+#define DLOG_MAP3(a, b, c)          DLOG_MAP2(a, b), DLOG_ARG(c)
+#define DLOG_MAP4(a, b, c, d)       DLOG_MAP3(a, b, c), DLOG_ARG(d)
+#define DLOG_MAP5(a, b, c, d, e)    DLOG_MAP4(a, b, c, d), DLOG_ARG(e)
+#define DLOG_MAP6(a, b, c, d, e, f) DLOG_MAP5(a, b, c, d, e), DLOG_ARG(f)
+
+/** Écrit un enregistrement (appelable depuis une tâche ou une ISR, jamais bloquant).
+ *  Anneau plein : l'enregistrement est compté comme perdu. */
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt,
+                const dlog_arg_t *args, size_t nargs);
+
+#if CONFIG_DLOG_ENABLE
+/* printf jamais exécuté : garde la vérification des formats par le compilateur */
+#define DLOG_LEVEL(level, tag, fmt, ...) do {                                          \
+        if ((level) <= LOG_LOCAL_LEVEL) {                                              \
+            if (0) printf(fmt, ##__VA_ARGS__);                                         \
+            const dlog_arg_t dlog_a_[] = { { 0, 0 }, DLOG_CAT(DLOG_MAP, DLOG_NARG(__VA_ARGS__))(__VA_ARGS__) }; \
+            dlog_write((level), (tag), (fmt), dlog_a_ + 1, DLOG_NARG(__VA_ARGS__));    \
+        }                                                                              \
+    } while (0)
+#else
+#define DLOG_LEVEL(level, tag, fmt, ...) ESP_LOG_LEVEL_LOCAL(level, tag, fmt, ##__VA_ARGS__)
+#endif
+
+#define DLOGE(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_ERROR,   tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_WARN,    tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_INFO,    tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_DEBUG,   tag, fmt, ##__VA_ARGS__)
+
+/** Démarre la tâche de drain (console texte, ou fichier binaire si CONFIG_DLOG_TO_FILE) */
+esp_err_t dlog_init(void);
+
+/** Vide l'anneau immédiatement (ex. avant le deep sleep) */
+void dlog_flush(void);
+
+/** Enregistrements perdus (anneau plein) depuis le boot */
+uint32_t dlog_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#include "hal_board.h"
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#include "esp_check.h"
+
+static const char *TAG = "hal_board";
+
+hal_wake_t hal_board_wake_cause(void)
+{
+    switch (esp_sleep_get_wakeup_cause()) {
+        case ESP_SLEEP_WAKEUP_UNDEFINED: return HAL_WAKE_COLD;
+        case ESP_SLEEP_WAKEUP_TOUCHPAD:  return HAL_WAKE_TOUCH;
+        case ESP_SLEEP_WAKEUP_EXT1:      return HAL_WAKE_VBUS;
+        default:                         return HAL_WAKE_OTHER;
+    }
+}
+
+int hal_board_vbus_level(int gpio)
+{
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_DISABLE};
+    gpio_config(&io);
+    return gpio_get_level(gpio);
+}
+
+esp_err_t hal_board_enable_wakeup(int vbus_gpio, bool touch)
+{
+    if (vbus_gpio >= 0) {
+        gpio_pulldown_en(vbus_gpio);
+        gpio_pullup_dis(vbus_gpio);
+        ESP_RETURN_ON_ERROR(esp_sleep_enable_ext1_wakeup(1ULL << vbus_gpio, ESP_EXT1_WAKEUP_ANY_HIGH),
+                            TAG, "ext1");
+    }
+    if (touch) ESP_RETURN_ON_ERROR(esp_sleep_enable_touchpad_wakeup(), TAG, "touch");
+    return ESP_OK;
+}
+
+void hal_board_deep_sleep(void)
+{
+    esp_deep_sleep_start();
+}
@@ -0,0 +1,29 @@
+#include "hal_fs.h"
+#include "esp_spiffs.h"
+
+#define HAL_FS_BASE "/spiffs"
+
+esp_err_t hal_fs_mount(size_t max_files, bool format_if_mount_failed)
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = HAL_FS_BASE,
+        .partition_label = NULL,
+        .max_files = max_files,
+        .format_if_mount_failed = format_if_mount_failed};
+    return esp_vfs_spiffs_register(&conf);
+}
+
+const char *hal_fs_base_path(void)
+{
+    return HAL_FS_BASE;
+}
+
+esp_err_t hal_fs_info(size_t *total, size_t *used)
+{
+    return esp_spiffs_info(NULL, total, used);
+}
+
+esp_err_t hal_fs_gc(size_t bytes)
+{
+    return esp_spiffs_gc(NULL, bytes);
+}
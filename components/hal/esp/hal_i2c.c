@@ -0,0 +1,68 @@
+#include "hal_i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c.h"
+#include "esp_check.h"
+
+esp_err_t hal_i2c_init(int port, int sda, int scl, uint32_t hz)
+{
+    i2c_config_t cfg = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = sda,
+        .scl_io_num = scl,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = hz,
+    };
+    ESP_RETURN_ON_ERROR(i2c_param_config(port, &cfg), "i2c", "param_config");
+    ESP_RETURN_ON_ERROR(i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0), "i2c", "install");
+    return ESP_OK;
+}
+
+void hal_i2c_deinit(int port)
+{
+    i2c_driver_delete(port);
+}
+
+#if CONFIG_APP_STATIC_ALLOC
+/* Liste de commandes par bus, sans tas : une écriture puis une lecture au plus.
+ * Les transferts d'un même port sont sérialisés par le mutex de i2c_bus. */
+static uint8_t s_link[I2C_NUM_MAX][I2C_LINK_RECOMMENDED_SIZE(2)];
+#endif
+
+esp_err_t hal_i2c_transfer(int port, uint8_t addr,
+                           const uint8_t *w, size_t wl,
+                           uint8_t *r, size_t rl,
+                           uint32_t timeout_ms)
+{
+#if CONFIG_APP_STATIC_ALLOC
+    if (port < 0 || port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(s_link[port], sizeof(s_link[port]));
+#else
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+#endif
+    if (!cmd) return ESP_ERR_NO_MEM;
+    // liste pleine (tampon statique) : ESP_ERR_NO_MEM plutôt qu'une transaction tronquée
+    esp_err_t ret = ESP_OK;
+    if (wl && w) {
+        ESP_GOTO_ON_ERROR(i2c_master_start(cmd), out, "i2c", "link");
+        ESP_GOTO_ON_ERROR(i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true), out, "i2c", "link");
+        ESP_GOTO_ON_ERROR(i2c_master_write(cmd, (uint8_t*)w, wl, true), out, "i2c", "link");
+    }
+    if (rl && r) {
+        ESP_GOTO_ON_ERROR(i2c_master_start(cmd), out, "i2c", "link");
+        ESP_GOTO_ON_ERROR(i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true), out, "i2c", "link");
+        if (rl > 1) {
+            ESP_GOTO_ON_ERROR(i2c_master_read(cmd, r, rl - 1, I2C_MASTER_ACK), out, "i2c", "link");
+        }
+        ESP_GOTO_ON_ERROR(i2c_master_read_byte(cmd, r + rl - 1, I2C_MASTER_NACK), out, "i2c", "link");
+    }
+    ESP_GOTO_ON_ERROR(i2c_master_stop(cmd), out, "i2c", "link");
+    ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(timeout_ms));
+out:
+#if CONFIG_APP_STATIC_ALLOC
+    i2c_cmd_link_delete_static(cmd);
+#else
+    i2c_cmd_link_delete(cmd);
+#endif
+    return ret;
+}
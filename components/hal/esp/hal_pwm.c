@@ -0,0 +1,87 @@
+#include "hal_pwm.h"
+#include "driver/ledc.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+
+static const char *TAG = "hal_pwm";
+
+#define HAL_LEDC_MODE   LEDC_LOW_SPEED_MODE
+#define HAL_LEDC_TIMER  LEDC_TIMER_0
+#define HAL_LEDC_CH_MAX 8
+
+typedef struct {
+    hal_pwm_fade_cb_t cb;
+    void             *arg;
+} fade_slot_t;
+
+static fade_slot_t s_fade[HAL_LEDC_CH_MAX];
+static bool        s_fade_installed;
+
+esp_err_t hal_pwm_timer_init(uint32_t freq_hz, uint8_t res_bits)
+{
+    ledc_timer_config_t tcfg = {
+        .speed_mode       = HAL_LEDC_MODE,
+        .duty_resolution  = res_bits,
+        .timer_num        = HAL_LEDC_TIMER,
+        .freq_hz          = freq_hz,
+        .clk_cfg          = LEDC_AUTO_CLK,
+    };
+    return ledc_timer_config(&tcfg);
+}
+
+esp_err_t hal_pwm_channel_init(int ch, int gpio, uint32_t duty)
+{
+    ledc_channel_config_t ccfg = {
+        .gpio_num   = gpio,
+        .speed_mode = HAL_LEDC_MODE,
+        .channel    = (ledc_channel_t)ch,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .timer_sel  = HAL_LEDC_TIMER,
+        .duty       = duty,
+        .hpoint     = 0
+    };
+    return ledc_channel_config(&ccfg);
+}
+
+esp_err_t hal_pwm_set_duty(int ch, uint32_t duty)
+{
+    // service de fondu installé : un seul appel thread-safe
+    if (s_fade_installed) return ledc_set_duty_and_update(HAL_LEDC_MODE, (ledc_channel_t)ch, duty, 0);
+    ESP_RETURN_ON_ERROR(ledc_set_duty(HAL_LEDC_MODE, (ledc_channel_t)ch, duty), TAG, "set_duty");
+    return ledc_update_duty(HAL_LEDC_MODE, (ledc_channel_t)ch);
+}
+
+esp_err_t hal_pwm_stop(int ch, uint32_t idle_level)
+{
+    return ledc_stop(HAL_LEDC_MODE, (ledc_channel_t)ch, idle_level);
+}
+
+esp_err_t hal_pwm_fade_install(void)
+{
+    if (s_fade_installed) return ESP_OK;
+    ESP_RETURN_ON_ERROR(ledc_fade_func_install(0), TAG, "fade install");
+    s_fade_installed = true;
+    return ESP_OK;
+}
+
+static bool IRAM_ATTR fade_isr(const ledc_cb_param_t *p, void *arg)
+{
+    fade_slot_t *f = arg;
+    if (p->event != LEDC_FADE_END_EVT || !f->cb) return false;
+    return f->cb((int)p->channel, f->arg);
+}
+
+esp_err_t hal_pwm_fade_cb_register(int ch, hal_pwm_fade_cb_t cb, void *arg)
+{
+    if (ch < 0 || ch >= HAL_LEDC_CH_MAX) return ESP_ERR_INVALID_ARG;
+    s_fade[ch].cb = cb;
+    s_fade[ch].arg = arg;
+    ledc_cbs_t cbs = { .fade_cb = fade_isr };
+    return ledc_cb_register(HAL_LEDC_MODE, (ledc_channel_t)ch, &cbs, &s_fade[ch]);
+}
+
+esp_err_t hal_pwm_fade_to(int ch, uint32_t duty, uint32_t ms)
+{
+    ESP_RETURN_ON_ERROR(ledc_set_fade_with_time(HAL_LEDC_MODE, (ledc_channel_t)ch, duty, (int)ms), TAG, "fade");
+    return ledc_fade_start(HAL_LEDC_MODE, (ledc_channel_t)ch, LEDC_FADE_NO_WAIT);
+}
@@ -0,0 +1,144 @@
+#include "hal_touch.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* ==== Détection auto de l'API tactile disponible ==== */
+#if __has_include("driver/touch_sens.h")
+  #define TW_USE_NEW_API 1
+  #include "driver/touch_sens.h"      // (IDF récents)
+#else
+  #define TW_USE_NEW_API 0
+  #include "driver/touch_sensor.h"    // (legacy, IDF 4.x/5.x)
+#endif
+
+static const char *TAG = "hal_touch";
+
+#if TW_USE_NEW_API
+/* =================== Nouvelle API =================== */
+esp_err_t hal_touch_init(int pad)
+{
+    touch_sensor_config_t cfg = {
+        .pad = (touch_pad_t)pad,
+        .voltage = TOUCH_HVOLT_2V7,
+        .threshold = 0,
+    };
+    return touch_sensor_config(&cfg);
+}
+
+void hal_touch_deinit(int pad)
+{
+    touch_sensor_deinit((touch_pad_t)pad);
+}
+
+esp_err_t hal_touch_read_raw(int pad, uint32_t *raw)
+{
+    return touch_sensor_read_raw((touch_pad_t)pad, raw);
+}
+
+esp_err_t hal_touch_set_thresh(int pad, uint32_t thr)
+{
+    return touch_sensor_set_threshold((touch_pad_t)pad, thr);
+}
+
+bool hal_touch_rises(void) { return true; }
+
+/* Pas d'interruption exposée : l'appelant passe en scrutation */
+esp_err_t hal_touch_intr_install(void (*cb)(void *arg), void *arg) { (void)cb; (void)arg; return ESP_ERR_NOT_SUPPORTED; }
+void      hal_touch_intr_uninstall(void) {}
+esp_err_t hal_touch_intr_arm(bool on) { (void)on; return ESP_ERR_NOT_SUPPORTED; }
+
+#else
+/* =================== API legacy =================== */
+static void (*s_cb)(void *arg) = NULL;
+static void *s_cb_arg = NULL;
+
+esp_err_t hal_touch_init(int pad)
+{
+    ESP_RETURN_ON_ERROR(touch_pad_init(), TAG, "touch_pad_init");
+    ESP_RETURN_ON_ERROR(touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER), TAG, "set_fsm");
+    ESP_RETURN_ON_ERROR(touch_pad_config((touch_pad_t)pad), TAG, "pad_config");
+
+    /* Filtre si activé dans la config */
+    #if CONFIG_TOUCH_PAD_FILTER_ENABLE
+      touch_pad_set_filter_period(10);
+      touch_pad_filter_enable();
+    #endif
+    return ESP_OK;
+}
+
+void hal_touch_deinit(int pad)
+{
+    (void)pad;
+    touch_pad_deinit();
+}
+
+esp_err_t hal_touch_read_raw(int pad, uint32_t *raw)
+{
+    return touch_pad_read_raw_data((touch_pad_t)pad, raw);
+}
+
+esp_err_t hal_touch_set_thresh(int pad, uint32_t thr)
+{
+#if CONFIG_IDF_TARGET_ESP32
+    return touch_pad_set_thresh((touch_pad_t)pad, thr);
+#else
+    /* S2/S3 : déclenchement quand (lissé - benchmark) > seuil, un écart donc */
+    uint32_t bm = 0;
+    ESP_RETURN_ON_ERROR(touch_pad_read_benchmark((touch_pad_t)pad, &bm), TAG, "benchmark");
+    return touch_pad_set_thresh((touch_pad_t)pad, thr > bm ? thr - bm : 1);
+#endif
+}
+
+bool hal_touch_rises(void)
+{
+#if CONFIG_IDF_TARGET_ESP32
+    return false;
+#else
+    return true;
+#endif
+}
+
+/* L'ISR se désarme elle-même puis délègue à l'appelant */
+static void IRAM_ATTR hal_touch_isr(void *arg)
+{
+#if CONFIG_IDF_TARGET_ESP32
+    touch_pad_intr_disable();
+    touch_pad_clear_status();
+#else
+    touch_pad_intr_disable(TOUCH_PAD_INTR_MASK_ACTIVE);
+    (void)touch_pad_read_intr_status_mask();
+#endif
+    if (s_cb) s_cb(s_cb_arg);
+}
+
+esp_err_t hal_touch_intr_install(void (*cb)(void *arg), void *arg)
+{
+    s_cb = cb;
+    s_cb_arg = arg;
+#if CONFIG_IDF_TARGET_ESP32
+    ESP_RETURN_ON_ERROR(touch_pad_set_trigger_mode(TOUCH_TRIGGER_BELOW), TAG, "trigger");
+    return touch_pad_isr_register(hal_touch_isr, NULL);
+#else
+    return touch_pad_isr_register(hal_touch_isr, NULL, TOUCH_PAD_INTR_MASK_ACTIVE);
+#endif
+}
+
+void hal_touch_intr_uninstall(void)
+{
+    touch_pad_isr_deregister(hal_touch_isr, NULL);
+    s_cb = NULL;
+}
+
+esp_err_t hal_touch_intr_arm(bool on)
+{
+#if CONFIG_IDF_TARGET_ESP32
+    if (on) touch_pad_clear_status();
+    return on ? touch_pad_intr_enable() : touch_pad_intr_disable();
+#else
+    return on ? touch_pad_intr_enable(TOUCH_PAD_INTR_MASK_ACTIVE)
+              : touch_pad_intr_disable(TOUCH_PAD_INTR_MASK_ACTIVE);
+#endif
+}
+#endif
@@ -0,0 +1,44 @@
+#include "hal_usb.h"
+#include "driver/usb_serial_jtag.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+
+static const char *TAG = "hal_usb";
+
+static bool s_open;
+
+esp_err_t hal_usb_open(size_t rx_buf, size_t tx_buf)
+{
+    if (s_open) return ESP_OK;
+    usb_serial_jtag_driver_config_t cfg = {
+        .rx_buffer_size = (uint32_t)rx_buf,
+        .tx_buffer_size = (uint32_t)tx_buf,
+    };
+    ESP_RETURN_ON_ERROR(usb_serial_jtag_driver_install(&cfg), TAG, "install");
+    s_open = true;
+    return ESP_OK;
+}
+
+bool hal_usb_host_present(void)
+{
+    return usb_serial_jtag_is_connected();
+}
+
+int hal_usb_read(void *buf, size_t len, uint32_t timeout_ms)
+{
+    if (!s_open) return -1;
+    return usb_serial_jtag_read_bytes(buf, (uint32_t)len, pdMS_TO_TICKS(timeout_ms));
+}
+
+int hal_usb_write(const void *buf, size_t len, uint32_t timeout_ms)
+{
+    if (!s_open) return -1;
+    return usb_serial_jtag_write_bytes(buf, len, pdMS_TO_TICKS(timeout_ms));
+}
+
+void hal_usb_close(void)
+{
+    if (!s_open) return;
+    usb_serial_jtag_driver_uninstall();
+    s_open = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    HAL_WAKE_COLD = 0,        // mise sous tension / reset
+    HAL_WAKE_TOUCH,
+    HAL_WAKE_VBUS,            // EXT1
+    HAL_WAKE_OTHER,
+} hal_wake_t;
+
+/** Cause du réveil (hôte : variable d'environnement REMORA_WAKE=touch|vbus) */
+hal_wake_t hal_board_wake_cause(void);
+
+/** Niveau de l'entrée VBUS_SENSE (configurée en entrée pull-down) */
+int  hal_board_vbus_level(int gpio);
+
+/** Arme les sources de réveil. vbus_gpio < 0 : pas de réveil EXT1 */
+esp_err_t hal_board_enable_wakeup(int vbus_gpio, bool touch);
+
+/** Deep sleep (hôte : fin du processus) */
+void hal_board_deep_sleep(void);
+
+#ifdef __cplusplus
+}
+#endif
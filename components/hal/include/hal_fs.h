@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Monte le système de fichiers des plongées (SPIFFS sur cible, répertoire sur hôte) */
+esp_err_t   hal_fs_mount(size_t max_files, bool format_if_mount_failed);
+
+/** Racine du FS monté ("/spiffs" sur cible, $REMORA_FS_ROOT sur hôte) */
+const char *hal_fs_base_path(void);
+
+/** Occupation en octets */
+esp_err_t   hal_fs_info(size_t *total, size_t *used);
+
+/** Ramasse-miettes jusqu'à disposer de bytes octets de pages effacées (SPIFFS ;
+ *  sans objet sur hôte). ESP_ERR_NOT_FINISHED : objectif non atteint */
+esp_err_t   hal_fs_gc(size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
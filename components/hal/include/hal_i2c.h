@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Installe le contrôleur I²C maître */
+esp_err_t hal_i2c_init(int port, int sda, int scl, uint32_t hz);
+void      hal_i2c_deinit(int port);
+
+/** Transaction [START addr+W w...] [START addr+R r...] STOP (une des deux phases peut être vide) */
+esp_err_t hal_i2c_transfer(int port, uint8_t addr,
+                           const uint8_t *w, size_t wl,
+                           uint8_t *r, size_t rl,
+                           uint32_t timeout_ms);
+
+#if CONFIG_IDF_TARGET_LINUX
+/* Hôte : périphériques simulés. Sans handler, les lectures renvoient des zéros. */
+typedef esp_err_t (*hal_i2c_sim_fn)(void *ctx, uint8_t addr,
+                                    const uint8_t *w, size_t wl,
+                                    uint8_t *r, size_t rl);
+void hal_i2c_sim_set_handler(hal_i2c_sim_fn fn, void *ctx);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
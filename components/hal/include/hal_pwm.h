@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* PWM basse vitesse (LEDC sur cible), un timer partagé par les canaux */
+esp_err_t hal_pwm_timer_init(uint32_t freq_hz, uint8_t res_bits);
+esp_err_t hal_pwm_channel_init(int ch, int gpio, uint32_t duty);
+esp_err_t hal_pwm_set_duty(int ch, uint32_t duty);
+esp_err_t hal_pwm_stop(int ch, uint32_t idle_level);
+
+/* Fondus matériels : le périphérique rampe seul, fin signalée par interruption.
+ * cb est appelé en contexte ISR ; retour true = tâche plus prioritaire réveillée. */
+typedef bool (*hal_pwm_fade_cb_t)(int ch, void *arg);
+
+esp_err_t hal_pwm_fade_install(void);
+esp_err_t hal_pwm_fade_cb_register(int ch, hal_pwm_fade_cb_t cb, void *arg);
+/** Lance un fondu vers duty en ms, sans attendre la fin */
+esp_err_t hal_pwm_fade_to(int ch, uint32_t duty, uint32_t ms);
+
+#if CONFIG_IDF_TARGET_LINUX
+/* Hôte : dernier rapport cyclique appliqué */
+uint32_t hal_pwm_sim_get_duty(int ch);
+/* Hôte : fondus demandés et durée du dernier (le fondu simulé aboutit immédiatement) */
+uint32_t hal_pwm_sim_fade_count(int ch);
+uint32_t hal_pwm_sim_fade_ms(int ch);
+/* Hôte : le prochain fondu du canal échoue (ESP_FAIL) */
+void     hal_pwm_sim_fail_next_fade(int ch);
+/* Hôte : rappels de fin retenus jusqu'à hal_pwm_sim_complete_fades() (comme l'ISR) */
+void     hal_pwm_sim_defer_fades(bool defer);
+/** @return nombre de fondus terminés */
+uint32_t hal_pwm_sim_complete_fades(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
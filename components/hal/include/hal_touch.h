@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Configure le pad (driver + FSM + filtre), sans calibrage */
+esp_err_t hal_touch_init(int pad);
+void      hal_touch_deinit(int pad);
+esp_err_t hal_touch_read_raw(int pad, uint32_t *raw);
+/** Seuil absolu en valeur brute (converti en écart au benchmark sur ESP32-S2/S3) */
+esp_err_t hal_touch_set_thresh(int pad, uint32_t thr);
+/** true si la capacité (eau) fait monter la valeur brute : ESP32-S2/S3.
+ *  Sur ESP32 elle baisse. */
+bool      hal_touch_rises(void);
+
+/** Interruption de seuil. L'ISR se désarme avant d'appeler cb (contexte ISR).
+ *  @return ESP_ERR_NOT_SUPPORTED si le driver n'en expose pas */
+esp_err_t hal_touch_intr_install(void (*cb)(void *arg), void *arg);
+void      hal_touch_intr_uninstall(void);
+esp_err_t hal_touch_intr_arm(bool on);
+
+#if CONFIG_IDF_TARGET_LINUX
+/* Hôte : valeur brute renvoyée par hal_touch_read_raw */
+void hal_touch_sim_set_raw(uint32_t raw);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
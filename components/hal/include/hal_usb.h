@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lien série USB vers le poste : USB-Serial-JTAG sur cible, pseudo-terminal sur
+ * hôte (esclave annoncé dans le log, ou REMORA_USB_TTY=chemin d'un tty existant). */
+
+/** Ouvre le lien (tampons du driver en octets) */
+esp_err_t hal_usb_open(size_t rx_buf, size_t tx_buf);
+
+/** Un hôte USB interroge le port (trames SOF) : VBUS sans hôte = chargeur */
+bool hal_usb_host_present(void);
+
+/** Lit jusqu'à len octets. @return nb lus (0 = délai écoulé), < 0 erreur */
+int  hal_usb_read(void *buf, size_t len, uint32_t timeout_ms);
+
+/** Écrit len octets (bloque tant que le tampon TX est plein, au plus timeout_ms).
+ *  @return nb écrits, < 0 erreur */
+int  hal_usb_write(const void *buf, size_t len, uint32_t timeout_ms);
+
+/** Ferme le lien (sans effet s'il n'est pas ouvert) */
+void hal_usb_close(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+#include "hal_board.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "hal_board";
+
+/* Hôte : REMORA_WAKE=touch|vbus simule la cause de réveil, REMORA_VBUS=1 la présence VBUS */
+hal_wake_t hal_board_wake_cause(void)
+{
+    const char *w = getenv("REMORA_WAKE");
+    if (!w) return HAL_WAKE_COLD;
+    if (!strcmp(w, "touch")) return HAL_WAKE_TOUCH;
+    if (!strcmp(w, "vbus"))  return HAL_WAKE_VBUS;
+    return HAL_WAKE_OTHER;
+}
+
+int hal_board_vbus_level(int gpio)
+{
+    (void)gpio;
+    const char *v = getenv("REMORA_VBUS");
+    return (v && atoi(v)) ? 1 : 0;
+}
+
+esp_err_t hal_board_enable_wakeup(int vbus_gpio, bool touch)
+{
+    ESP_LOGI(TAG, "wake sources: vbus_gpio=%d touch=%d", vbus_gpio, (int)touch);
+    return ESP_OK;
+}
+
+void hal_board_deep_sleep(void)
+{
+    ESP_LOGI(TAG, "deep sleep -> exit");
+    fflush(stdout);
+    exit(0);
+}
@@ -0,0 +1,47 @@
+#include "hal_fs.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+static const char *TAG = "hal_fs";
+
+/* Hôte : répertoire ordinaire ($REMORA_FS_ROOT, /tmp/remora_fs par défaut) */
+static char s_base[48] = "/tmp/remora_fs";
+
+esp_err_t hal_fs_mount(size_t max_files, bool format_if_mount_failed)
+{
+    (void)max_files; (void)format_if_mount_failed;
+    const char *env = getenv("REMORA_FS_ROOT");
+    if (env && *env) snprintf(s_base, sizeof(s_base), "%s", env);
+
+    if (mkdir(s_base, 0777) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "mkdir %s: %s", s_base, strerror(errno));
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "host fs at %s", s_base);
+    return ESP_OK;
+}
+
+const char *hal_fs_base_path(void)
+{
+    return s_base;
+}
+
+esp_err_t hal_fs_info(size_t *total, size_t *used)
+{
+    struct statvfs v;
+    if (statvfs(s_base, &v) != 0) return ESP_FAIL;
+    if (total) *total = (size_t)v.f_blocks * v.f_frsize;
+    if (used)  *used  = (size_t)(v.f_blocks - v.f_bfree) * v.f_frsize;
+    return ESP_OK;
+}
+
+esp_err_t hal_fs_gc(size_t bytes)
+{
+    (void)bytes;   // FS de l'hôte : pas de pages à effacer
+    return ESP_OK;
+}
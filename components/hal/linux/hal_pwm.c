@@ -0,0 +1,105 @@
+#include "hal_pwm.h"
+
+#define HAL_PWM_SIM_CH 8
+
+static uint32_t s_duty[HAL_PWM_SIM_CH];
+
+/* LEDC simulé : le fondu aboutit tout de suite et le rappel "ISR" est invoqué
+ * depuis l'appelant, ce qui rend l'enchaînement des keyframes déterministe.
+ * En mode différé, les rappels attendent hal_pwm_sim_complete_fades(). */
+static hal_pwm_fade_cb_t s_fade_cb[HAL_PWM_SIM_CH];
+static void             *s_fade_arg[HAL_PWM_SIM_CH];
+static uint32_t          s_fades[HAL_PWM_SIM_CH];
+static uint32_t          s_fade_ms[HAL_PWM_SIM_CH];
+static bool              s_fail[HAL_PWM_SIM_CH];
+static bool              s_pending[HAL_PWM_SIM_CH];
+static bool              s_defer;
+
+esp_err_t hal_pwm_timer_init(uint32_t freq_hz, uint8_t res_bits)
+{
+    (void)freq_hz; (void)res_bits;
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_channel_init(int ch, int gpio, uint32_t duty)
+{
+    (void)gpio;
+    return hal_pwm_set_duty(ch, duty);
+}
+
+esp_err_t hal_pwm_set_duty(int ch, uint32_t duty)
+{
+    if (ch < 0 || ch >= HAL_PWM_SIM_CH) return ESP_ERR_INVALID_ARG;
+    s_duty[ch] = duty;
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_stop(int ch, uint32_t idle_level)
+{
+    return hal_pwm_set_duty(ch, idle_level);
+}
+
+uint32_t hal_pwm_sim_get_duty(int ch)
+{
+    return (ch >= 0 && ch < HAL_PWM_SIM_CH) ? s_duty[ch] : 0;
+}
+
+esp_err_t hal_pwm_fade_install(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_fade_cb_register(int ch, hal_pwm_fade_cb_t cb, void *arg)
+{
+    if (ch < 0 || ch >= HAL_PWM_SIM_CH) return ESP_ERR_INVALID_ARG;
+    s_fade_cb[ch] = cb;
+    s_fade_arg[ch] = arg;
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_fade_to(int ch, uint32_t duty, uint32_t ms)
+{
+    if (ch < 0 || ch >= HAL_PWM_SIM_CH) return ESP_ERR_INVALID_ARG;
+    if (s_fail[ch]) {
+        s_fail[ch] = false;
+        return ESP_FAIL;
+    }
+    s_duty[ch] = duty;
+    s_fades[ch]++;
+    s_fade_ms[ch] = ms;
+    if (s_defer) s_pending[ch] = true;
+    else if (s_fade_cb[ch]) s_fade_cb[ch](ch, s_fade_arg[ch]);
+    return ESP_OK;
+}
+
+void hal_pwm_sim_fail_next_fade(int ch)
+{
+    if (ch >= 0 && ch < HAL_PWM_SIM_CH) s_fail[ch] = true;
+}
+
+void hal_pwm_sim_defer_fades(bool defer)
+{
+    s_defer = defer;
+}
+
+uint32_t hal_pwm_sim_complete_fades(void)
+{
+    uint32_t n = 0;
+    for (int ch = 0; ch < HAL_PWM_SIM_CH; ++ch) {
+        if (!s_pending[ch]) continue;
+        s_pending[ch] = false;
+        n++;
+        if (s_fade_cb[ch]) s_fade_cb[ch](ch, s_fade_arg[ch]);
+    }
+    return n;
+}
+
+uint32_t hal_pwm_sim_fade_count(int ch)
+{
+    return (ch >= 0 && ch < HAL_PWM_SIM_CH) ? s_fades[ch] : 0;
+}
+
+uint32_t hal_pwm_sim_fade_ms(int ch)
+{
+    return (ch >= 0 && ch < HAL_PWM_SIM_CH) ? s_fade_ms[ch] : 0;
+}
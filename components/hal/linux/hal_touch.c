@@ -0,0 +1,53 @@
+#include "hal_touch.h"
+
+/* Hôte : pas d'interruption, valeur brute pilotée par hal_touch_sim_set_raw() */
+static volatile uint32_t s_raw = 1000;
+
+void hal_touch_sim_set_raw(uint32_t raw)
+{
+    s_raw = raw;
+}
+
+esp_err_t hal_touch_init(int pad)
+{
+    (void)pad;
+    return ESP_OK;
+}
+
+void hal_touch_deinit(int pad)
+{
+    (void)pad;
+}
+
+esp_err_t hal_touch_read_raw(int pad, uint32_t *raw)
+{
+    (void)pad;
+    *raw = s_raw;
+    return ESP_OK;
+}
+
+esp_err_t hal_touch_set_thresh(int pad, uint32_t thr)
+{
+    (void)pad; (void)thr;
+    return ESP_OK;
+}
+
+/* Hôte : convention ESP32, l'eau fait baisser la valeur brute */
+bool hal_touch_rises(void)
+{
+    return false;
+}
+
+esp_err_t hal_touch_intr_install(void (*cb)(void *arg), void *arg)
+{
+    (void)cb; (void)arg;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void hal_touch_intr_uninstall(void) {}
+
+esp_err_t hal_touch_intr_arm(bool on)
+{
+    (void)on;
+    return ESP_ERR_NOT_SUPPORTED;
+}
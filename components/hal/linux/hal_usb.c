@@ -0,0 +1,103 @@
+#define _GNU_SOURCE
+#include "hal_usb.h"
+#include "esp_log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+static const char *TAG = "hal_usb";
+
+static int s_fd = -1;
+
+static void raw(int fd)
+{
+    struct termios t;
+    if (tcgetattr(fd, &t) == 0) {
+        cfmakeraw(&t);
+        tcsetattr(fd, TCSANOW, &t);
+    }
+}
+
+/* Hôte : maître d'un pseudo-terminal (le récepteur ouvre l'esclave), ou REMORA_USB_TTY */
+esp_err_t hal_usb_open(size_t rx_buf, size_t tx_buf)
+{
+    (void)rx_buf;
+    (void)tx_buf;
+    if (s_fd >= 0) return ESP_OK;
+    const char *tty = getenv("REMORA_USB_TTY");
+    if (tty) {
+        s_fd = open(tty, O_RDWR | O_NOCTTY);
+    } else {
+        s_fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (s_fd >= 0 && (grantpt(s_fd) || unlockpt(s_fd))) {
+            close(s_fd);
+            s_fd = -1;
+        }
+    }
+    if (s_fd < 0) {
+        ESP_LOGE(TAG, "open: errno %d", errno);
+        return ESP_FAIL;
+    }
+    raw(s_fd);
+    if (!tty) {
+        // esclave en mode brut aussi : le récepteur peut l'ouvrir tel quel
+        const char *slave = ptsname(s_fd);
+        int sfd = slave ? open(slave, O_RDWR | O_NOCTTY) : -1;
+        if (sfd >= 0) {
+            raw(sfd);
+            close(sfd);
+        }
+        ESP_LOGI(TAG, "pty %s", slave ? slave : "?");
+    }
+    return ESP_OK;
+}
+
+bool hal_usb_host_present(void)
+{
+    return true;
+}
+
+int hal_usb_read(void *buf, size_t len, uint32_t timeout_ms)
+{
+    if (s_fd < 0) return -1;
+    struct pollfd p = { .fd = s_fd, .events = POLLIN };
+    int r = poll(&p, 1, (int)timeout_ms);
+    if (r <= 0) return r < 0 && errno != EINTR ? -1 : 0;
+    ssize_t n = read(s_fd, buf, len);
+    // EIO : aucun esclave ouvert (récepteur pas encore lancé ou parti)
+    if (n < 0) {
+        if (errno == EIO || errno == EAGAIN || errno == EINTR) {
+            usleep(timeout_ms < 10 ? timeout_ms * 1000 : 10000);
+            return 0;
+        }
+        return -1;
+    }
+    return (int)n;
+}
+
+int hal_usb_write(const void *buf, size_t len, uint32_t timeout_ms)
+{
+    if (s_fd < 0) return -1;
+    size_t done = 0;
+    while (done < len) {
+        struct pollfd p = { .fd = s_fd, .events = POLLOUT };
+        if (poll(&p, 1, (int)timeout_ms) <= 0) break;
+        ssize_t n = write(s_fd, (const char *)buf + done, len - done);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            return done ? (int)done : -1;
+        }
+        done += (size_t)n;
+    }
+    return (int)done;
+}
+
+void hal_usb_close(void)
+{
+    if (s_fd < 0) return;
+    close(s_fd);
+    s_fd = -1;
+}
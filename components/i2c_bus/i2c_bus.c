@@ -1,34 +1,82 @@
 #include "i2c_bus.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
-#include "esp_check.h" 
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "hal_i2c.h"
+#include "trace.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include "app_mem.h"
+#include <stdlib.h>
+
+METRIC_COUNTER(s_m_retries, "i2c.retries");
+METRIC_HISTO(s_m_xfer_us, "i2c.xfer_us");
+
+#ifndef CONFIG_APP_STATIC_I2C_BUSES
+#define CONFIG_APP_STATIC_I2C_BUSES 1
+#endif
 
 struct i2c_bus {
-    i2c_port_t port;
+    int port;
     SemaphoreHandle_t mtx;
+#if CONFIG_APP_STATIC_ALLOC
+    StaticSemaphore_t mtx_buf;
+    bool used;
+#endif
 };
 
-esp_err_t i2c_bus_create(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t hz, i2c_bus_t **out)
+#if CONFIG_APP_STATIC_ALLOC
+static i2c_bus_t s_pool[CONFIG_APP_STATIC_I2C_BUSES];
+
+static i2c_bus_t *bus_alloc(void)
+{
+    static bool accounted;
+    if (!accounted) { app_mem_account("i2c_bus", sizeof(s_pool)); accounted = true; }
+    for (int i = 0; i < CONFIG_APP_STATIC_I2C_BUSES; ++i) {
+        i2c_bus_t *b = &s_pool[i];
+        if (b->used) continue;
+        b->mtx = xSemaphoreCreateMutexStatic(&b->mtx_buf);
+        b->used = true;
+        return b;
+    }
+    return NULL;
+}
+
+static void bus_free(i2c_bus_t *b)
+{
+    vSemaphoreDelete(b->mtx);
+    b->used = false;
+}
+#else
+static i2c_bus_t *bus_alloc(void)
+{
+    i2c_bus_t *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->mtx = xSemaphoreCreateMutex();
+    if (!b->mtx) { free(b); return NULL; }
+    return b;
+}
+
+static void bus_free(i2c_bus_t *b)
+{
+    vSemaphoreDelete(b->mtx);
+    free(b);
+}
+#endif
+
+esp_err_t i2c_bus_create(int port, int sda, int scl, uint32_t hz, i2c_bus_t **out)
 {
     if (!out) return ESP_ERR_INVALID_ARG;
     *out = NULL;
 
-    i2c_config_t cfg = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = sda,
-        .scl_io_num = scl,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = hz,
-    };
-    ESP_RETURN_ON_ERROR(i2c_param_config(port, &cfg), "i2c", "param_config");
-    ESP_RETURN_ON_ERROR(i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0), "i2c", "install");
+    ESP_RETURN_ON_ERROR(hal_i2c_init(port, sda, scl, hz), "i2c", "init");
+    metrics_register(&s_m_retries.m);
+    metrics_register(&s_m_xfer_us.m);
 
-    i2c_bus_t *b = calloc(1, sizeof(*b));
-    if (!b) return ESP_ERR_NO_MEM;
+    i2c_bus_t *b = bus_alloc();
+    if (!b) { hal_i2c_deinit(port); return ESP_ERR_NO_MEM; }
     b->port = port;
-    b->mtx = xSemaphoreCreateMutex();
-    if (!b->mtx) { i2c_driver_delete(port); free(b); return ESP_ERR_NO_MEM; }
 
     *out = b;
     return ESP_OK;
@@ -37,9 +85,8 @@ esp_err_t i2c_bus_create(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32
 void i2c_bus_destroy(i2c_bus_t *bus)
 {
     if (!bus) return;
-    vSemaphoreDelete(bus->mtx);
-    i2c_driver_delete(bus->port);
-    free(bus);
+    hal_i2c_deinit(bus->port);
+    bus_free(bus);
 }
 
 esp_err_t i2c_bus_write_read(i2c_bus_t *bus, uint8_t addr,
@@ -51,26 +98,13 @@ esp_err_t i2c_bus_write_read(i2c_bus_t *bus, uint8_t addr,
 
     esp_err_t err = ESP_FAIL;
     for (int attempt = 0; attempt < 3; ++attempt) {
+        if (attempt) metric_inc(&s_m_retries);
         xSemaphoreTake(bus->mtx, portMAX_DELAY);
-
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        if (wl && w) {
-            i2c_master_start(cmd);
-            i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
-            i2c_master_write(cmd, (uint8_t*)w, wl, true);
-        }
-        if (rl && r) {
-            i2c_master_start(cmd);
-            i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
-            if (rl > 1) {
-                i2c_master_read(cmd, r, rl - 1, I2C_MASTER_ACK);
-            }
-            i2c_master_read_byte(cmd, r + rl - 1, I2C_MASTER_NACK);
-        }
-        i2c_master_stop(cmd);
-        err = i2c_master_cmd_begin(bus->port, cmd, timeout_ticks);
-        i2c_cmd_link_delete(cmd);
-
+        TRACE_BEGIN(TRACE_EV_I2C, addr);
+        int64_t t0 = esp_timer_get_time();
+        err = hal_i2c_transfer(bus->port, addr, w, wl, r, rl, pdTICKS_TO_MS(timeout_ticks));
+        metric_observe(&s_m_xfer_us, (uint32_t)(esp_timer_get_time() - t0));
+        TRACE_END(TRACE_EV_I2C, err);
         xSemaphoreGive(bus->mtx);
 
         if (err == ESP_OK) break;
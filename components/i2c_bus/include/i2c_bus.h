@@ -1,5 +1,7 @@
 #pragma once
-#include "driver/i2c.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -9,7 +11,7 @@ extern "C" {
 typedef struct i2c_bus i2c_bus_t;
 
 /** Crée et initialise un bus I²C (avec mutex interne) */
-esp_err_t i2c_bus_create(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t hz, i2c_bus_t **out);
+esp_err_t i2c_bus_create(int port, int sda, int scl, uint32_t hz, i2c_bus_t **out);
 
 /** Détruit le bus */
 void i2c_bus_destroy(i2c_bus_t *bus);
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LED d'état : motifs joués par fondus LEDC. Entre deux keyframes, le CPU n'intervient
+ * pas (fondu matériel, tâche bloquée) ; la tâche ne se réveille qu'aux transitions. */
+typedef enum {
+    LED_STATUS_OFF = 0,
+    LED_STATUS_DIVE,            // respiration bleue lente
+    LED_STATUS_ASCENT_WARN,     // flash rouge rapide
+    LED_STATUS_UPLOAD,          // pulsation bleu -> vert selon la progression
+    LED_STATUS_LOW_BATTERY,     // double flash ambre
+    LED_STATUS_MAX
+} led_status_t;
+
+typedef struct {
+    uint8_t  r, g, b;           // couleur cible (0..255, corrigée gamma au rendu)
+    uint16_t fade_ms;           // durée du fondu vers la cible (0 = immédiat)
+    uint16_t hold_ms;           // maintien avant la keyframe suivante
+} led_keyframe_t;
+
+/** Keyframes du motif (progression 0..100 pour UPLOAD). Retourne le nombre écrit. */
+size_t led_status_keyframes(led_status_t st, uint8_t progress, led_keyframe_t *out, size_t max);
+
+/** Initialise rgb_led, les fondus et la tâche du moteur (idempotent) */
+esp_err_t led_status_init(void);
+
+/** Joue un motif en boucle ; bascule à la fin du fondu en cours */
+esp_err_t led_status_set(led_status_t st);
+
+/** Progression de l'upload (0..100), prise en compte au prochain cycle du motif */
+void led_status_progress(uint8_t pct);
+
+led_status_t led_status_get(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#include "led_status.h"
+#include "rgb_led.h"
+#include "app_mem.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "led_status";
+
+#define LED_MAX_KEYFRAMES 4
+#define EVT_PATTERN       (1u << 0)
+#define EVT_FADE          (1u << 1)
+
+static TaskHandle_t          s_task;
+static volatile led_status_t s_want = LED_STATUS_OFF;
+static volatile uint8_t      s_pct;
+
+size_t led_status_keyframes(led_status_t st, uint8_t progress, led_keyframe_t *out, size_t max)
+{
+    if (max < LED_MAX_KEYFRAMES) return 0;
+    switch (st) {
+    case LED_STATUS_DIVE:
+        out[0] = (led_keyframe_t){ 0, 40, 160, 1200, 300 };
+        out[1] = (led_keyframe_t){ 0,  4,  24, 1200, 600 };
+        return 2;
+    case LED_STATUS_ASCENT_WARN:
+        out[0] = (led_keyframe_t){ 255, 0, 0, 80, 150 };
+        out[1] = (led_keyframe_t){   0, 0, 0, 80, 150 };
+        return 2;
+    case LED_STATUS_UPLOAD: {
+        // teinte 240° (bleu) -> 120° (vert) avec la progression
+        uint8_t r, g, b;
+        if (progress > 100) progress = 100;
+        rgb_led_hsv_lut((uint16_t)(240 - progress * 120 / 100), 255, 255, &r, &g, &b);
+        out[0] = (led_keyframe_t){ r, g, b, 500, 100 };
+        out[1] = (led_keyframe_t){ r >> 3, g >> 3, b >> 3, 500, 100 };
+        return 2;
+    }
+    case LED_STATUS_LOW_BATTERY:
+        out[0] = (led_keyframe_t){ 255, 100, 0, 60, 120 };
+        out[1] = (led_keyframe_t){   0,   0, 0, 60, 120 };
+        out[2] = (led_keyframe_t){ 255, 100, 0, 60, 120 };
+        out[3] = (led_keyframe_t){   0,   0, 0, 60, 1500 };
+        return 4;
+    case LED_STATUS_OFF:
+    default:
+        out[0] = (led_keyframe_t){ 0, 0, 0, 300, 0 };
+        return 1;
+    }
+}
+
+/* Fin des trois fondus (ISR) : seul réveil de la tâche pendant un motif */
+static bool fade_done(void *arg)
+{
+    (void)arg;
+    BaseType_t hp = pdFALSE;
+    if (s_task) xTaskNotifyFromISR(s_task, EVT_FADE, eSetBits, &hp);
+    return hp == pdTRUE;
+}
+
+static void led_task(void *arg)
+{
+    (void)arg;
+    led_keyframe_t kf[LED_MAX_KEYFRAMES];
+    size_t n = 0, idx = 0;
+    enum { PH_IDLE, PH_FADING, PH_HOLDING } ph = PH_IDLE;
+    led_status_t cur = LED_STATUS_OFF;
+    uint32_t hold_ms = 0;
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (ph == PH_HOLDING) {
+            wait = pdMS_TO_TICKS(hold_ms);
+            if (!wait) wait = 1;
+        }
+        uint32_t bits = 0;
+        BaseType_t got = xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+        led_status_t want = s_want;
+
+        if (ph == PH_FADING) {
+            if (!(bits & EVT_FADE)) continue;        // nouveau motif : appliqué à la fin du fondu
+            ph = PH_HOLDING;
+            hold_ms = kf[idx].hold_ms;
+            if (want == cur && hold_ms) continue;    // maintien, tâche bloquée
+        } else if (want == cur && (ph == PH_IDLE || got == pdTRUE)) {
+            continue;
+        }
+
+        if (want != cur) {
+            cur = want;
+            idx = 0;
+            n = led_status_keyframes(cur, s_pct, kf, LED_MAX_KEYFRAMES);
+        } else if (++idx >= n) {
+            if (cur == LED_STATUS_OFF) { ph = PH_IDLE; continue; }
+            idx = 0;
+            n = led_status_keyframes(cur, s_pct, kf, LED_MAX_KEYFRAMES);   // progression à jour
+        }
+        if (!n) { ph = PH_IDLE; continue; }
+
+        bool started = false;
+        esp_err_t e = rgb_led_fade_rgb(kf[idx].r, kf[idx].g, kf[idx].b, kf[idx].fade_ms, &started);
+        if (e != ESP_OK) ESP_LOGW(TAG, "fade: %s", esp_err_to_name(e));
+        // pas de fondu lancé (couleur déjà là) : on tient la durée prévue
+        ph = started ? PH_FADING : PH_HOLDING;
+        hold_ms = started ? 0 : (uint32_t)kf[idx].fade_ms + kf[idx].hold_ms;
+    }
+}
+
+esp_err_t led_status_init(void)
+{
+    if (s_task) return ESP_OK;
+    ESP_RETURN_ON_ERROR(rgb_led_init(), TAG, "rgb");
+    ESP_RETURN_ON_ERROR(rgb_led_fade_init(fade_done, NULL), TAG, "fade");
+    APP_TASK_MEM(task_mem, 2560);
+    return app_task_create(led_task, "led_status", &task_mem, NULL, APP_ROLE_BACKGROUND, &s_task);
+}
+
+esp_err_t led_status_set(led_status_t st)
+{
+    if (st >= LED_STATUS_MAX) return ESP_ERR_INVALID_ARG;
+    if (!s_task) return ESP_ERR_INVALID_STATE;
+    if (s_want == st) return ESP_OK;
+    s_want = st;
+    xTaskNotify(s_task, EVT_PATTERN, eSetBits);
+    return ESP_OK;
+}
+
+void led_status_progress(uint8_t pct)
+{
+    s_pct = pct > 100 ? 100 : pct;
+}
+
+led_status_t led_status_get(void)
+{
+    return s_want;
+}
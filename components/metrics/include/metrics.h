@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Registre de métriques : objets statiques déclarés dans chaque composant,
+ * chaînés au registre par metrics_register() (idempotent, sans allocation).
+ * Les mises à jour sont des atomiques relâchés inline (quelques cycles).
+ * Objets et registre sont en RTC : les valeurs cumulent depuis la mise sous
+ * tension, d'un réveil à l'autre (l'upload voit les compteurs des plongées). */
+
+typedef enum {
+    METRIC_KIND_COUNTER = 0,
+    METRIC_KIND_GAUGE,
+    METRIC_KIND_HISTO,
+} metric_kind_t;
+
+typedef struct metric_s {
+    const char      *name;
+    metric_kind_t    kind;
+    bool             registered;
+    struct metric_s *next;
+} metric_t;
+
+typedef struct {
+    metric_t m;
+    uint32_t value;
+} metric_counter_t;
+
+/* Jauge : valeur posée par metric_set(), ou lue par sample() au moment du snapshot */
+typedef struct {
+    metric_t m;
+    int32_t  value;
+    int32_t  (*sample)(void *ctx);
+    void     *ctx;
+} metric_gauge_t;
+
+/* Histogramme log2 : bucket b compte les valeurs de [2^(b-1), 2^b), le dernier est ouvert */
+#define METRIC_HISTO_BUCKETS 20
+
+typedef struct {
+    metric_t m;
+    uint32_t count;
+    uint64_t sum;         // 64 bits : cumul en RTC sur des milliers de réveils
+    uint32_t max;
+    uint32_t bucket[METRIC_HISTO_BUCKETS];
+} metric_histo_t;
+
+#define METRIC_COUNTER(var, nm)  static RTC_DATA_ATTR metric_counter_t var = { .m = { .name = (nm), .kind = METRIC_KIND_COUNTER } }
+#define METRIC_GAUGE(var, nm)    static RTC_DATA_ATTR metric_gauge_t   var = { .m = { .name = (nm), .kind = METRIC_KIND_GAUGE } }
+#define METRIC_HISTO(var, nm)    static RTC_DATA_ATTR metric_histo_t   var = { .m = { .name = (nm), .kind = METRIC_KIND_HISTO } }
+
+/** Ajoute la métrique au registre (sans effet si déjà fait) */
+void metrics_register(metric_t *m);
+
+static inline void metric_inc(metric_counter_t *c)
+{
+    __atomic_fetch_add(&c->value, 1, __ATOMIC_RELAXED);
+}
+
+static inline void metric_add(metric_counter_t *c, uint32_t n)
+{
+    __atomic_fetch_add(&c->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_set(metric_gauge_t *g, int32_t v)
+{
+    __atomic_store_n(&g->value, v, __ATOMIC_RELAXED);
+}
+
+static inline void metric_observe(metric_histo_t *h, uint32_t v)
+{
+    unsigned b = v ? 32u - (unsigned)__builtin_clz(v) : 0u;
+    if (b >= METRIC_HISTO_BUCKETS) b = METRIC_HISTO_BUCKETS - 1;
+    __atomic_fetch_add(&h->bucket[b], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, (uint64_t)v, __ATOMIC_RELAXED);
+    uint32_t m = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (v > m && !__atomic_compare_exchange_n(&h->max, &m, v, true,
+                                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+}
+
+/** À appeler à chaque boot : désarme les sample() hérités du réveil précédent
+ *  (leur ctx n'existe plus) et enregistre les jauges système (tas min., ...) */
+esp_err_t metrics_init(void);
+
+struct cJSON;
+
+/** Snapshot JSON : {"nom": valeur, "histo": {"count":..,"sum":..,"max":..,"buckets":[..]}}.
+ *  Objet à libérer par cJSON_Delete (ou à attacher à un document parent) ; NULL si mémoire. */
+struct cJSON *metrics_to_json(void);
+
+/** Snapshot sur la console, une ligne par métrique. À la demande : tools/usb_offload.py --metrics */
+void metrics_log(void);
+
+#ifdef __cplusplus
+}
+#endif
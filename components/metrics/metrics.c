@@ -0,0 +1,111 @@
+#include "metrics.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <inttypes.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_system.h"
+#endif
+
+static const char *TAG = "metrics";
+
+static RTC_DATA_ATTR metric_t *s_head;
+
+void metrics_register(metric_t *m)
+{
+    bool expected = false;
+    if (!m || !__atomic_compare_exchange_n(&m->registered, &expected, true, false,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+    // empilement sans verrou : le registre n'est que parcouru, jamais réduit
+    metric_t *h = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+    do {
+        m->next = h;
+    } while (!__atomic_compare_exchange_n(&s_head, &h, m, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+static int32_t heap_min_sample(void *ctx)
+{
+    (void)ctx;
+    return (int32_t)esp_get_minimum_free_heap_size();
+}
+METRIC_GAUGE(s_heap_min, "heap.min_free");
+#endif
+
+esp_err_t metrics_init(void)
+{
+    // les jauges gardent leur dernière valeur jusqu'à ce que leur composant les réarme
+    for (metric_t *m = s_head; m; m = m->next) {
+        if (m->kind != METRIC_KIND_GAUGE) continue;
+        metric_gauge_t *g = (metric_gauge_t *)m;
+        g->sample = NULL;
+        g->ctx = NULL;
+    }
+#if !CONFIG_IDF_TARGET_LINUX
+    s_heap_min.sample = heap_min_sample;
+    metrics_register(&s_heap_min.m);
+#endif
+    return ESP_OK;
+}
+
+static int32_t gauge_value(metric_gauge_t *g)
+{
+    if (g->sample) metric_set(g, g->sample(g->ctx));   // dernière valeur lue, gardée en RTC
+    return __atomic_load_n(&g->value, __ATOMIC_RELAXED);
+}
+
+cJSON *metrics_to_json(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+
+    for (metric_t *m = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE); m; m = m->next) {
+        switch (m->kind) {
+        case METRIC_KIND_COUNTER:
+            cJSON_AddNumberToObject(root, m->name,
+                                    __atomic_load_n(&((metric_counter_t *)m)->value, __ATOMIC_RELAXED));
+            break;
+        case METRIC_KIND_GAUGE:
+            cJSON_AddNumberToObject(root, m->name, gauge_value((metric_gauge_t *)m));
+            break;
+        case METRIC_KIND_HISTO: {
+            metric_histo_t *h = (metric_histo_t *)m;
+            cJSON *o = cJSON_AddObjectToObject(root, m->name);
+            if (!o) break;
+            cJSON_AddNumberToObject(o, "count", __atomic_load_n(&h->count, __ATOMIC_RELAXED));
+            cJSON_AddNumberToObject(o, "sum", (double)__atomic_load_n(&h->sum, __ATOMIC_RELAXED));
+            cJSON_AddNumberToObject(o, "max", __atomic_load_n(&h->max, __ATOMIC_RELAXED));
+            // buckets jusqu'au dernier non vide (les suivants sont implicites à 0)
+            int last = METRIC_HISTO_BUCKETS - 1;
+            while (last >= 0 && !__atomic_load_n(&h->bucket[last], __ATOMIC_RELAXED)) last--;
+            cJSON *b = cJSON_AddArrayToObject(o, "buckets");
+            for (int i = 0; b && i <= last; ++i)
+                cJSON_AddItemToArray(b, cJSON_CreateNumber(__atomic_load_n(&h->bucket[i], __ATOMIC_RELAXED)));
+            break;
+        }
+        }
+    }
+    return root;
+}
+
+void metrics_log(void)
+{
+    for (metric_t *m = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE); m; m = m->next) {
+        switch (m->kind) {
+        case METRIC_KIND_COUNTER:
+            ESP_LOGI(TAG, "%s = %" PRIu32, m->name, ((metric_counter_t *)m)->value);
+            break;
+        case METRIC_KIND_GAUGE:
+            ESP_LOGI(TAG, "%s = %" PRId32, m->name, gauge_value((metric_gauge_t *)m));
+            break;
+        case METRIC_KIND_HISTO: {
+            metric_histo_t *h = (metric_histo_t *)m;
+            uint32_t n = h->count;
+            uint64_t sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+            ESP_LOGI(TAG, "%s: n=%" PRIu32 " avg=%" PRIu64 " max=%" PRIu32,
+                     m->name, n, n ? sum / n : 0, h->max);
+            break;
+        }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Serveur HTTP de la station d'accueil : un poste tire les plongées lui-même,
+ * sans URL de synchro configurée, ou pendant la synchro.
+ *   GET /dives        catalogue JSON (métadonnées, résumé, taille de <id>.csv)
+ *   GET /dives/<id>   <id>.csv en flux ; Range: bytes=... reprend un transfert coupé
+ *   GET /metrics      snapshot des métriques
+ * Les réponses partent en chunks lus directement en flash dans un tampon fixe. */
+
+/** Démarre le serveur (Wi-Fi déjà connecté, FS monté) ; idempotent */
+esp_err_t pull_server_start(void);
+
+/** Arrête le serveur (sans effet s'il ne tourne pas) */
+void pull_server_stop(void);
+
+/** Instant esp_timer (us) de la dernière requête ; 0 = aucune depuis le démarrage */
+int64_t pull_server_last_request_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,264 @@
+#include "pull_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "dive_storage.h"
+#include "metrics.h"
+#include "app_mem.h"
+
+static const char *TAG = "pull_server";
+
+#ifndef CONFIG_APP_PULL_PORT
+#define CONFIG_APP_PULL_PORT 80
+#endif
+/* Tampon de lecture flash -> socket (un chunk HTTP par lecture) */
+#ifndef CONFIG_APP_PULL_CHUNK
+#define CONFIG_APP_PULL_CHUNK 4096
+#endif
+
+static httpd_handle_t s_srv;
+// écrit par la tâche httpd, lu par la boucle de veille : 64 bits, pas d'accès
+// atomique simple sur un cœur 32 bits
+static int64_t        s_last_us;
+// une seule tâche serveur : requêtes traitées l'une après l'autre, tampons partagés
+static char s_buf[CONFIG_APP_PULL_CHUNK];
+
+METRIC_COUNTER(s_m_req, "pull.requests");
+METRIC_COUNTER(s_m_bytes, "pull.bytes");
+
+/* Range: bytes=a-b | a- | -n, une seule plage.
+ * @return 1 = plage [*from, *to], 0 = absente ou ignorée (réponse entière),
+ *         -1 = hors du fichier (416) */
+static int parse_range(const char *h, uint32_t size, uint32_t *from, uint32_t *to)
+{
+    if (strncmp(h, "bytes=", 6) != 0) return 0;
+    h += 6;
+    if (strchr(h, ',')) return 0;       // plages multiples : ignorées (RFC 9110 l'autorise)
+    char *end;
+    if (*h == '-') {
+        unsigned long n = strtoul(h + 1, &end, 10);
+        if (end == h + 1 || *end) return 0;
+        if (n == 0 || size == 0) return -1;
+        *from = n >= size ? 0 : size - (uint32_t)n;
+        *to = size - 1;
+        return 1;
+    }
+    if (!isdigit((unsigned char)*h)) return 0;
+    unsigned long a = strtoul(h, &end, 10);
+    if (*end != '-') return 0;
+    h = end + 1;
+    unsigned long b = ~0ul;
+    if (*h) {
+        b = strtoul(h, &end, 10);
+        if (*end || b < a) return 0;
+    }
+    if (a >= size) return -1;
+    *from = (uint32_t)a;
+    *to = b >= size ? size - 1 : (uint32_t)b;
+    return 1;
+}
+
+static bool valid_id(const char *p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (!isalnum((unsigned char)p[i]) && p[i] != '-' && p[i] != '_') return false;
+    return true;
+}
+
+static void served(void)
+{
+    __atomic_store_n(&s_last_us, esp_timer_get_time(), __ATOMIC_RELAXED);
+}
+
+/* GET /dives/<id> : <id>.csv tel qu'en flash, éventuellement une plage */
+static esp_err_t dive_get(httpd_req_t *req)
+{
+    served();
+    metric_inc(&s_m_req);
+    const char *p = req->uri + strlen("/dives/");
+    size_t len = strcspn(p, "?");
+    char id[32];
+    if (len == 0 || len >= sizeof(id) || !valid_id(p, len))
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such dive");
+    memcpy(id, p, len);
+    id[len] = '\0';
+
+    dive_data_t d;
+    if (dive_storage_data_open(id, &d) != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such dive");
+
+    // en-têtes référencés jusqu'à l'envoi : tampons vivants jusqu'à la fin du handler
+    char range[48], crange[48];
+    uint32_t from = 0, to = d.size ? d.size - 1 : 0;
+    int r = 0;
+    if (httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range)) == ESP_OK)
+        r = parse_range(range, d.size, &from, &to);
+    if (r < 0) {
+        snprintf(crange, sizeof(crange), "bytes */%u", (unsigned)d.size);
+        dive_storage_data_close(&d);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", crange);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, "text/csv");
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    if (r > 0) {
+        snprintf(crange, sizeof(crange), "bytes %u-%u/%u",
+                 (unsigned)from, (unsigned)to, (unsigned)d.size);
+        httpd_resp_set_status(req, "206 Partial Content");
+        httpd_resp_set_hdr(req, "Content-Range", crange);
+    }
+
+    uint32_t left = d.size ? to - from + 1 : 0;
+    esp_err_t e = ESP_OK;
+    while (left && e == ESP_OK) {
+        size_t got = 0;
+        e = dive_storage_data_read(&d, from, s_buf, left < sizeof(s_buf) ? left : sizeof(s_buf), &got);
+        if (e == ESP_OK && got == 0) e = ESP_FAIL;      // fichier tronqué depuis l'ouverture
+        if (e == ESP_OK) e = httpd_resp_send_chunk(req, s_buf, (ssize_t)got);
+        from += got;
+        left -= got;
+        metric_add(&s_m_bytes, got);
+        served();                       // un long transfert compte comme activité
+    }
+    dive_storage_data_close(&d);
+    if (e != ESP_OK) {
+        // flux interrompu : le client reprendra avec Range
+        ESP_LOGW(TAG, "%s: stopped at %u (%s)", id, (unsigned)from, esp_err_to_name(e));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* Filtre du catalogue : ?after=<id>&limit=N&since=<date ISO>&pending=1 */
+static void catalog_filter(httpd_req_t *req, dive_filter_t *f)
+{
+    char q[128], v[16];
+    if (httpd_req_get_url_query_str(req, q, sizeof(q)) != ESP_OK) return;
+    httpd_query_key_value(q, "after", f->start_after, sizeof(f->start_after));
+    httpd_query_key_value(q, "since", f->after_date, sizeof(f->after_date));
+    if (httpd_query_key_value(q, "limit", v, sizeof(v)) == ESP_OK) f->limit = (uint32_t)strtoul(v, NULL, 10);
+    if (httpd_query_key_value(q, "pending", v, sizeof(v)) == ESP_OK) f->pending_only = v[0] == '1';
+}
+
+/* GET /dives : un objet par plongée, chacun imprimé dans le tampon fixe.
+ * Pagination : page suivante avec after=<dernier id reçu>, vide à la fin. */
+static esp_err_t catalog_get(httpd_req_t *req)
+{
+    served();
+    metric_inc(&s_m_req);
+    dive_filter_t f = { 0 };
+    catalog_filter(req, &f);
+    dive_iter_t it;
+    dive_iter_init(&it, &f);
+
+    // premier élément lu avant les en-têtes : une erreur FS peut encore donner un 500
+    char id[32];
+    dive_metadata_t m;
+    esp_err_t ie = dive_iter_next(&it, id, &m);
+    if (ie != ESP_OK && ie != ESP_ERR_NOT_FOUND)
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "list failed");
+
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t e = httpd_resp_send_chunk(req, "[", 1);
+    bool first = true;
+    for (; ie == ESP_OK && e == ESP_OK; ie = dive_iter_next(&it, id, &m)) {
+        cJSON *o = cJSON_CreateObject();
+        if (!o) {
+            e = ESP_ERR_NO_MEM;
+            break;
+        }
+        dive_storage_meta_to_json(&m, o);
+        dive_data_t d;
+        if (dive_storage_data_open(id, &d) == ESP_OK) {
+            cJSON_AddNumberToObject(o, "bytes", d.size);
+            dive_storage_data_close(&d);
+        }
+        s_buf[0] = ',';                 // séparateur devant chaque objet sauf le premier
+        bool ok = cJSON_PrintPreallocated(o, s_buf + 1, sizeof(s_buf) - 1, false);
+        cJSON_Delete(o);
+        if (!ok) continue;
+        e = httpd_resp_send_chunk(req, first ? s_buf + 1 : s_buf, HTTPD_RESP_USE_STRLEN);
+        first = false;
+    }
+    if (e == ESP_OK) e = httpd_resp_send_chunk(req, "]", 1);
+    if (e != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t metrics_get(httpd_req_t *req)
+{
+    served();
+    metric_inc(&s_m_req);
+    cJSON *m = metrics_to_json();
+    if (!m) return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t e;
+    if (cJSON_PrintPreallocated(m, s_buf, sizeof(s_buf), false)) {
+        e = httpd_resp_send(req, s_buf, HTTPD_RESP_USE_STRLEN);
+    } else {
+        // snapshot plus grand que le tampon : copie allouée
+        char *txt = cJSON_PrintUnformatted(m);
+        e = txt ? httpd_resp_send(req, txt, HTTPD_RESP_USE_STRLEN)
+                : httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
+        free(txt);
+    }
+    cJSON_Delete(m);
+    return e;
+}
+
+static const httpd_uri_t s_uris[] = {
+    { .uri = "/dives",   .method = HTTP_GET, .handler = catalog_get },
+    { .uri = "/dives/*", .method = HTTP_GET, .handler = dive_get },
+    { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_get },
+};
+
+esp_err_t pull_server_start(void)
+{
+    if (s_srv) return ESP_OK;
+    static bool accounted;
+    if (!accounted) {
+        app_mem_account("pull_server", sizeof(s_buf));
+        metrics_register(&s_m_req.m);
+        metrics_register(&s_m_bytes.m);
+        accounted = true;
+    }
+
+    httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+    cfg.server_port = CONFIG_APP_PULL_PORT;
+    cfg.uri_match_fn = httpd_uri_match_wildcard;
+    cfg.lru_purge_enable = true;
+    cfg.stack_size = 6144;              // cJSON du catalogue
+    UBaseType_t prio;
+    BaseType_t core;
+    app_task_plan(APP_ROLE_NET, &prio, &core);
+    cfg.task_priority = prio;
+    cfg.core_id = core;
+
+    ESP_RETURN_ON_ERROR(httpd_start(&s_srv, &cfg), TAG, "httpd_start");
+    for (size_t i = 0; i < sizeof(s_uris) / sizeof(s_uris[0]); ++i)
+        httpd_register_uri_handler(s_srv, &s_uris[i]);
+    __atomic_store_n(&s_last_us, 0, __ATOMIC_RELAXED);
+    ESP_LOGI(TAG, "listening on :%d", CONFIG_APP_PULL_PORT);
+    return ESP_OK;
+}
+
+void pull_server_stop(void)
+{
+    if (!s_srv) return;
+    httpd_stop(s_srv);
+    s_srv = NULL;
+}
+
+int64_t pull_server_last_request_us(void)
+{
+    return __atomic_load_n(&s_last_us, __ATOMIC_RELAXED);
+}
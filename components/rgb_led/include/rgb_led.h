@@ -13,6 +13,18 @@ esp_err_t rgb_led_init(void);
 esp_err_t rgb_led_set_rgb(uint8_t r, uint8_t g, uint8_t b);
 /** h: 0..359 (°), s:0..255, v:0..255 */
 esp_err_t rgb_led_set_hsv(uint16_t h, uint8_t s, uint8_t v);
+/** HSV -> RGB 0..255 via la table précalculée (rgb_led_init requis) */
+void rgb_led_hsv_lut(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/* Fondus matériels (LEDC), couleurs corrigées gamma. Rappel en contexte ISR
+ * quand les trois canaux ont atteint la cible ; retour true = yield requis. */
+typedef bool (*rgb_led_fade_done_t)(void *arg);
+
+esp_err_t rgb_led_fade_init(rgb_led_fade_done_t cb, void *arg);
+/** Lance un fondu vers r,g,b en ms. *started = false si rien à faire (couleur
+ *  déjà atteinte ou ms = 0) : pas de rappel dans ce cas. En erreur, *started dit
+ *  si des canaux déjà lancés rappelleront encore. */
+esp_err_t rgb_led_fade_rgb(uint8_t r, uint8_t g, uint8_t b, uint32_t ms, bool *started);
 
 void rgb_led_deinit(void);
 
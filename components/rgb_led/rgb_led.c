@@ -1,7 +1,8 @@
 #include "rgb_led.h"
-#include "driver/ledc.h"
+#include "hal_pwm.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_attr.h"
 
 static const char *TAG = "rgb_led";
 
@@ -25,17 +26,52 @@ static const char *TAG = "rgb_led";
 #define CONFIG_RGB_LED_PWM_RES_BITS 8
 #endif
 
-/* Param LEDC */
-#define RGB_LEDC_MODE      LEDC_LOW_SPEED_MODE
-#define RGB_LEDC_TIMER     LEDC_TIMER_0
-#define CH_R               LEDC_CHANNEL_0
-#define CH_G               LEDC_CHANNEL_1
-#define CH_B               LEDC_CHANNEL_2
+/* Canaux PWM (LEDC 0..2 sur cible) */
+#define CH_R               0
+#define CH_G               1
+#define CH_B               2
 
 static uint32_t max_duty(void) {
     return (1u << CONFIG_RGB_LED_PWM_RES_BITS) - 1u;
 }
 
+/* Gamma 2.2 sur 16 bits, ramené à la résolution PWM à l'init */
+static const uint16_t s_gamma16[256] = {
+        0,     0,     2,     4,     7,    11,    17,    24,    32,    42,    53,    65,
+       79,    94,   111,   129,   148,   169,   192,   216,   242,   270,   299,   330,
+      362,   396,   432,   469,   508,   549,   591,   635,   681,   729,   779,   830,
+      883,   938,   995,  1053,  1113,  1175,  1239,  1305,  1373,  1443,  1514,  1587,
+     1663,  1740,  1819,  1900,  1983,  2068,  2155,  2243,  2334,  2427,  2521,  2618,
+     2717,  2817,  2920,  3024,  3131,  3240,  3350,  3463,  3578,  3694,  3813,  3934,
+     4057,  4182,  4309,  4438,  4570,  4703,  4838,  4976,  5115,  5257,  5401,  5547,
+     5695,  5845,  5998,  6152,  6309,  6468,  6629,  6792,  6957,  7124,  7294,  7466,
+     7640,  7816,  7994,  8175,  8358,  8543,  8730,  8919,  9111,  9305,  9501,  9699,
+     9900, 10102, 10307, 10515, 10724, 10936, 11150, 11366, 11585, 11806, 12029, 12254,
+    12482, 12712, 12944, 13179, 13416, 13655, 13896, 14140, 14386, 14635, 14885, 15138,
+    15394, 15652, 15912, 16174, 16439, 16706, 16975, 17247, 17521, 17798, 18077, 18358,
+    18642, 18928, 19216, 19507, 19800, 20095, 20393, 20694, 20996, 21301, 21609, 21919,
+    22231, 22546, 22863, 23182, 23504, 23829, 24156, 24485, 24817, 25151, 25487, 25826,
+    26168, 26512, 26858, 27207, 27558, 27912, 28268, 28627, 28988, 29351, 29717, 30086,
+    30457, 30830, 31206, 31585, 31966, 32349, 32735, 33124, 33514, 33908, 34304, 34702,
+    35103, 35507, 35913, 36321, 36732, 37146, 37562, 37981, 38402, 38825, 39252, 39680,
+    40112, 40546, 40982, 41421, 41862, 42306, 42753, 43202, 43654, 44108, 44565, 45025,
+    45487, 45951, 46418, 46888, 47360, 47835, 48313, 48793, 49275, 49761, 50249, 50739,
+    51232, 51728, 52226, 52727, 53230, 53736, 54245, 54756, 55270, 55787, 56306, 56828,
+    57352, 57879, 58409, 58941, 59476, 60014, 60554, 61097, 61642, 62190, 62741, 63295,
+    63851, 64410, 64971, 65535,
+};
+
+/* Tables précalculées à l'init : plus de division dans les chemins d'écriture */
+static uint16_t s_duty_lin[256];     // 0..255 -> duty linéaire
+static uint16_t s_duty_gam[256];     // 0..255 -> duty corrigé gamma
+static uint8_t  s_hue[360][3];       // roue des teintes à s = v = 255
+static uint16_t s_cur[3];            // duty courant (avant polarité) par canal
+
+/* Fondus : nb de canaux en cours, rappel quand le dernier a fini */
+static uint32_t            s_fading;
+static rgb_led_fade_done_t s_done_cb;
+static void               *s_done_arg;
+
 static inline uint32_t apply_polarity(uint32_t duty) {
 #if CONFIG_RGB_LED_COMMON_ANODE
     return max_duty() - duty;
@@ -44,9 +80,40 @@ static inline uint32_t apply_polarity(uint32_t duty) {
 #endif
 }
 
-static esp_err_t set_duty_channel(ledc_channel_t ch, uint32_t duty) {
-    ESP_RETURN_ON_ERROR(ledc_set_duty(RGB_LEDC_MODE, ch, apply_polarity(duty)), TAG, "set_duty");
-    return ledc_update_duty(RGB_LEDC_MODE, ch);
+static esp_err_t set_duty_channel(int ch, uint32_t duty) {
+    s_cur[ch] = (uint16_t)duty;
+    return hal_pwm_set_duty(ch, apply_polarity(duty));
+}
+
+/* Conversion HSV (0..359, 0..255, 0..255) -> RGB 0..255 */
+static void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    if (s == 0) { *r = *g = *b = v; return; }
+    uint16_t region = h / 60;
+    uint16_t remainder = (h % 60) * 255 / 60;
+    uint32_t p = (uint32_t)v * (255 - s) / 255;
+    uint32_t q = (uint32_t)v * (255 - (s * remainder) / 255) / 255;
+    uint32_t t = (uint32_t)v * (255 - (s * (255 - remainder)) / 255) / 255;
+
+    switch (region % 6) {
+        case 0: *r = v; *g = t; *b = p; break;
+        case 1: *r = q; *g = v; *b = p; break;
+        case 2: *r = p; *g = v; *b = t; break;
+        case 3: *r = p; *g = q; *b = v; break;
+        case 4: *r = t; *g = p; *b = v; break;
+        default:*r = v; *g = p; *b = q; break;
+    }
+}
+
+static void build_tables(void)
+{
+    const uint32_t m = max_duty();
+    for (int i = 0; i < 256; ++i) {
+        s_duty_lin[i] = (uint16_t)((uint32_t)i * m / 255u);
+        s_duty_gam[i] = (uint16_t)(((uint32_t)s_gamma16[i] * m + 32767u) / 65535u);
+    }
+    for (int h = 0; h < 360; ++h)
+        hsv_to_rgb((uint16_t)h, 255, 255, &s_hue[h][0], &s_hue[h][1], &s_hue[h][2]);
 }
 
 esp_err_t rgb_led_init(void)
@@ -55,78 +122,104 @@ esp_err_t rgb_led_init(void)
              CONFIG_RGB_LED_PIN_R, CONFIG_RGB_LED_PIN_G, CONFIG_RGB_LED_PIN_B,
              (int)CONFIG_RGB_LED_COMMON_ANODE, CONFIG_RGB_LED_PWM_FREQ_HZ, CONFIG_RGB_LED_PWM_RES_BITS);
 
-    ledc_timer_config_t tcfg = {
-        .speed_mode       = RGB_LEDC_MODE,
-        .duty_resolution  = CONFIG_RGB_LED_PWM_RES_BITS,
-        .timer_num        = RGB_LEDC_TIMER,
-        .freq_hz          = CONFIG_RGB_LED_PWM_FREQ_HZ,
-        .clk_cfg          = LEDC_AUTO_CLK,
-    };
-    ESP_RETURN_ON_ERROR(ledc_timer_config(&tcfg), TAG, "timer");
+    build_tables();
+    ESP_RETURN_ON_ERROR(hal_pwm_timer_init(CONFIG_RGB_LED_PWM_FREQ_HZ, CONFIG_RGB_LED_PWM_RES_BITS), TAG, "timer");
 
     const int pins[3] = { CONFIG_RGB_LED_PIN_R, CONFIG_RGB_LED_PIN_G, CONFIG_RGB_LED_PIN_B };
-    const ledc_channel_t ch[3] = { CH_R, CH_G, CH_B };
+    const int ch[3] = { CH_R, CH_G, CH_B };
 
     for (int i = 0; i < 3; ++i) {
-        ledc_channel_config_t ccfg = {
-            .gpio_num   = pins[i],
-            .speed_mode = RGB_LEDC_MODE,
-            .channel    = ch[i],
-            .intr_type  = LEDC_INTR_DISABLE,
-            .timer_sel  = RGB_LEDC_TIMER,
-            .duty       = apply_polarity(0),
-            .hpoint     = 0
-        };
-        ESP_RETURN_ON_ERROR(ledc_channel_config(&ccfg), TAG, "chan");
+        ESP_RETURN_ON_ERROR(hal_pwm_channel_init(ch[i], pins[i], apply_polarity(0)), TAG, "chan");
     }
     return ESP_OK;
 }
 
 esp_err_t rgb_led_set_rgb(uint8_t r, uint8_t g, uint8_t b)
 {
-    uint32_t mr = (uint32_t)r * max_duty() / 255u;
-    uint32_t mg = (uint32_t)g * max_duty() / 255u;
-    uint32_t mb = (uint32_t)b * max_duty() / 255u;
-
-    ESP_RETURN_ON_ERROR(set_duty_channel(CH_R, mr), TAG, "R");
-    ESP_RETURN_ON_ERROR(set_duty_channel(CH_G, mg), TAG, "G");
-    ESP_RETURN_ON_ERROR(set_duty_channel(CH_B, mb), TAG, "B");
+    ESP_RETURN_ON_ERROR(set_duty_channel(CH_R, s_duty_lin[r]), TAG, "R");
+    ESP_RETURN_ON_ERROR(set_duty_channel(CH_G, s_duty_lin[g]), TAG, "G");
+    ESP_RETURN_ON_ERROR(set_duty_channel(CH_B, s_duty_lin[b]), TAG, "B");
     return ESP_OK;
 }
 
-/* Conversion HSV (0..359, 0..255, 0..255) -> RGB 0..255 */
-static void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+esp_err_t rgb_led_set_hsv(uint16_t h, uint8_t s, uint8_t v)
 {
-    if (s == 0) { *r = *g = *b = v; return; }
-    uint16_t region = h / 60;
-    uint16_t remainder = (h % 60) * 255 / 60;
-    uint32_t p = (uint32_t)v * (255 - s) / 255;
-    uint32_t q = (uint32_t)v * (255 - (s * remainder) / 255) / 255;
-    uint32_t t = (uint32_t)v * (255 - (s * (255 - remainder)) / 255) / 255;
+    uint8_t r,g,b;
+    rgb_led_hsv_lut(h,s,v,&r,&g,&b);
+    return rgb_led_set_rgb(r,g,b);
+}
 
-    switch (region % 6) {
-        case 0: *r = v; *g = t; *b = p; break;
-        case 1: *r = q; *g = v; *b = p; break;
-        case 2: *r = p; *g = v; *b = t; break;
-        case 3: *r = p; *g = q; *b = v; break;
-        case 4: *r = t; *g = p; *b = v; break;
-        default:*r = v; *g = p; *b = q; break;
+/* Roue précalculée puis saturation/valeur par multiplication et décalage */
+void rgb_led_hsv_lut(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    if (h > 359) h %= 360;
+    uint8_t *out[3] = { r, g, b };
+    for (int i = 0; i < 3; ++i) {
+        uint32_t x = (uint32_t)s_hue[h][i] * s + 255u * (255u - s);   // 0..255²
+        uint32_t c = ((x + 1u) * 257u) >> 16;                          // x / 255
+        *out[i] = (uint8_t)((c * ((uint32_t)v + 1u)) >> 8);
     }
 }
 
-esp_err_t rgb_led_set_hsv(uint16_t h, uint8_t s, uint8_t v)
+static bool IRAM_ATTR fade_end(int ch, void *arg)
 {
-    if (h > 359) h %= 360;
-    uint8_t r,g,b;
-    hsv_to_rgb(h,s,v,&r,&g,&b);
-    return rgb_led_set_rgb(r,g,b);
+    (void)ch; (void)arg;
+    if (__atomic_sub_fetch(&s_fading, 1, __ATOMIC_ACQ_REL) != 0 || !s_done_cb) return false;
+    return s_done_cb(s_done_arg);
+}
+
+esp_err_t rgb_led_fade_init(rgb_led_fade_done_t cb, void *arg)
+{
+    ESP_RETURN_ON_ERROR(hal_pwm_fade_install(), TAG, "fade install");
+    s_done_cb = cb;
+    s_done_arg = arg;
+    const int ch[3] = { CH_R, CH_G, CH_B };
+    for (int i = 0; i < 3; ++i)
+        ESP_RETURN_ON_ERROR(hal_pwm_fade_cb_register(ch[i], fade_end, NULL), TAG, "fade cb");
+    return ESP_OK;
+}
+
+esp_err_t rgb_led_fade_rgb(uint8_t r, uint8_t g, uint8_t b, uint32_t ms, bool *started)
+{
+    const int ch[3] = { CH_R, CH_G, CH_B };
+    const uint16_t duty[3] = { s_duty_gam[r], s_duty_gam[g], s_duty_gam[b] };
+    *started = false;
+    if (__atomic_load_n(&s_fading, __ATOMIC_ACQUIRE)) return ESP_ERR_INVALID_STATE;
+
+    // seuls les canaux qui changent rampent (un fondu nul ne lève pas toujours d'interruption)
+    uint32_t n = 0;
+    for (int i = 0; i < 3; ++i) n += (duty[i] != s_cur[ch[i]]);
+    if (!n) return ESP_OK;
+    if (!ms) {
+        for (int i = 0; i < 3; ++i) ESP_RETURN_ON_ERROR(set_duty_channel(ch[i], duty[i]), TAG, "set");
+        return ESP_OK;
+    }
+
+    // compté d'avance : une fin de fondu peut tomber avant la fin de la boucle
+    __atomic_store_n(&s_fading, n, __ATOMIC_RELEASE);
+    uint32_t launched = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (duty[i] == s_cur[ch[i]]) continue;
+        esp_err_t e = hal_pwm_fade_to(ch[i], apply_polarity(duty[i]), ms);
+        if (e != ESP_OK) {
+            // on retire les fondus jamais lancés ; ceux déjà partis rappelleront
+            // au dernier, sauf s'ils ont tous déjà fini (reste 0 : pas de rappel)
+            uint32_t left = __atomic_sub_fetch(&s_fading, n - launched, __ATOMIC_ACQ_REL);
+            *started = left != 0;
+            return e;
+        }
+        s_cur[ch[i]] = duty[i];
+        launched++;
+    }
+    *started = true;
+    return ESP_OK;
 }
 
 void rgb_led_deinit(void)
 {
     /* Optionnel : repasser les pins à 0 et désinitialiser */
     rgb_led_set_rgb(0,0,0);
-    ledc_stop(RGB_LEDC_MODE, CH_R, 0);
-    ledc_stop(RGB_LEDC_MODE, CH_G, 0);
-    ledc_stop(RGB_LEDC_MODE, CH_B, 0);
+    hal_pwm_stop(CH_R, 0);
+    hal_pwm_stop(CH_G, 0);
+    hal_pwm_stop(CH_B, 0);
 }
@@ -22,6 +22,9 @@ typedef struct {
 /** Remplit un sensor_if_t prêt à l'emploi */
 void sensor_ms5837_make(i2c_bus_t *bus, uint8_t addr, sensor_if_t *out);
 
+/** Conversion seule (sans I²C) : D1/D2 bruts + PROM -> mesure compensée */
+void sensor_ms5837_convert(const uint16_t C[8], uint32_t D1, uint32_t D2, sensor_measure_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,7 @@
 #include "esp_check.h" 
 #include "esp_timer.h"
 #include "esp_random.h" 
+#include "calib_cache.h"
 #include <string.h>
 
 static const char *TAG = "MS5837";
@@ -55,6 +56,22 @@ static esp_err_t ms_read_prom(sensor_ms5837_t *s)
     return ESP_OK;
 }
 
+/* CRC4 de la PROM (datasheet MS5837, AN520) : comparé aux 4 bits hauts de C0 */
+static uint8_t ms_crc4(const uint16_t C[8])
+{
+    uint16_t p[8];
+    memcpy(p, C, sizeof(p));
+    p[0] &= 0x0FFF;
+    p[7] = 0;
+    uint16_t rem = 0;
+    for (int cnt = 0; cnt < 16; cnt++) {
+        rem ^= (cnt & 1) ? (p[cnt >> 1] & 0x00FF) : (p[cnt >> 1] >> 8);
+        for (int bit = 8; bit > 0; bit--)
+            rem = (rem & 0x8000) ? (uint16_t)((rem << 1) ^ 0x3000) : (uint16_t)(rem << 1);
+    }
+    return (rem >> 12) & 0x0F;
+}
+
 /* ---------- Computation (datasheet) ---------- */
 static esp_err_t ms_read_adc(sensor_ms5837_t *s)
 {
@@ -87,6 +104,32 @@ static void ms_compute(sensor_ms5837_t *s)
     }
 }
 
+/* Grandeurs compensées -> mesure (pression, température, profondeur) */
+static void ms_to_measure(const sensor_ms5837_t *s, sensor_measure_t *out)
+{
+    // pression en Pa: P = ((D1*SENS/2^21 - OFF)/2^13)
+    int64_t P = (((int64_t)s->D1_raw * (s->SENS >> 21) - s->OFF) >> 13);
+    double pressure_pa  = (double)P;              // Pa
+    double pressure_bar = pressure_pa / 1e5;      // bar
+    double temp_c       = ((double)s->TEMP) / 100.0;
+
+    out->temperature_c = temp_c;
+    out->pressure_bar  = pressure_bar;
+
+    const double p0_bar = 1.013;
+    const double rho = 1029.0, g = 9.80665;
+    double dp_pa = (pressure_bar - p0_bar) * 1e5;
+    out->depth_m = (dp_pa > 0) ? dp_pa / (rho * g) : 0.0;
+}
+
+void sensor_ms5837_convert(const uint16_t C[8], uint32_t D1, uint32_t D2, sensor_measure_t *out)
+{
+    sensor_ms5837_t s = { .D1_raw = D1, .D2_raw = D2 };
+    memcpy(s.C, C, sizeof(s.C));
+    ms_compute(&s);
+    ms_to_measure(&s, out);
+}
+
 /* ---------- sensor_if_t implementation ---------- */
 static esp_err_t fn_init(void *self)
 {
@@ -96,11 +139,22 @@ static esp_err_t fn_init(void *self)
     s->initialized = true;
     return ESP_OK;
 #else
+    // Réveil de deep sleep : PROM en cache RTC, pas de reset ni de relecture I2C
+    if (calib_cache_load(CALIB_SLOT_MS5837, s->addr, s->C, sizeof(s->C)) == ESP_OK &&
+        ms_crc4(s->C) == (s->C[0] >> 12)) {
+        s->initialized = true;
+        return ESP_OK;
+    }
     // Reset
     ESP_RETURN_ON_ERROR(ms_cmd(s, CMD_RESET), TAG, "reset");
     vTaskDelay(pdMS_TO_TICKS(10));
     // PROM
     ESP_RETURN_ON_ERROR(ms_read_prom(s), TAG, "prom");
+    if (ms_crc4(s->C) != (s->C[0] >> 12)) {
+        ESP_LOGW(TAG, "PROM CRC mismatch, not cached");
+    } else {
+        calib_cache_store(CALIB_SLOT_MS5837, s->addr, s->C, sizeof(s->C));
+    }
     s->initialized = true;
     return ESP_OK;
 #endif
@@ -140,23 +194,15 @@ static esp_err_t fn_read(void *self, sensor_measure_t *out)
         if (e != ESP_OK) return e;
     }
 
-    ESP_RETURN_ON_ERROR(ms_read_adc(s), TAG, "adc");
+    esp_err_t e = ms_read_adc(s);
+    if (e != ESP_OK) {
+        // capteur peut-être remplacé/réinitialisé : PROM relue au prochain essai
+        calib_cache_invalidate(CALIB_SLOT_MS5837);
+        s->initialized = false;
+        return e;
+    }
     ms_compute(s);
-
-    // pression en Pa: P = ((D1*SENS/2^21 - OFF)/2^13)
-    int64_t P = (((int64_t)s->D1_raw * (s->SENS >> 21) - s->OFF) >> 13);
-    double pressure_pa  = (double)P;              // Pa
-    double pressure_bar = pressure_pa / 1e5;      // bar
-    double temp_c       = ((double)s->TEMP) / 100.0;
-
-    out->temperature_c = temp_c;
-    out->pressure_bar  = pressure_bar;
-
-    const double p0_bar = 1.013;
-    const double rho = 1029.0, g = 9.80665;
-    double dp_pa = (pressure_bar - p0_bar) * 1e5;
-    out->depth_m = (dp_pa > 0) ? dp_pa / (rho * g) : 0.0;
-
+    ms_to_measure(s, out);
     return ESP_OK;
 #endif
 }
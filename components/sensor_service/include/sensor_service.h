@@ -30,7 +30,8 @@ esp_err_t sensor_service_add(sensor_service_t* svc,
                              uint32_t period_ms,
                              const char* short_name);   // ex "TSYS", "MS5837"
 
-/** Démarre la tâche FreeRTOS de polling */
+/** Démarre la tâche FreeRTOS de polling (rôle échantillonnage du plan app_mem).
+ *  prio 0 = priorité du plan ; stack_words 0 = pile par défaut */
 esp_err_t sensor_service_start(sensor_service_t* svc, UBaseType_t prio, uint32_t stack_words);
 
 /** Arrête la tâche et libère la ressource */
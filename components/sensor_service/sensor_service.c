@@ -1,16 +1,41 @@
 #include "sensor_service.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_timeline.h"
+#include "dlog.h"
+#include "trace.h"
+#include "metrics.h"
+#include "app_mem.h"
 #include <string.h>
 
 #define TAG "sensor_service"
 
+#ifndef CONFIG_APP_STATIC_SENSORS
+#define CONFIG_APP_STATIC_SENSORS 4
+#endif
+#ifndef CONFIG_APP_STATIC_QUEUE_LEN
+#define CONFIG_APP_STATIC_QUEUE_LEN 16
+#endif
+#define SENSOR_POLL_STACK 4096
+
+METRIC_COUNTER(s_m_read_err, "sensor.read_errors");
+METRIC_COUNTER(s_m_drops,    "queue.drops");
+METRIC_GAUGE(s_m_depth,      "queue.depth");
+METRIC_HISTO(s_m_jitter,     "sensor.poll_jitter_us");
+
+static int32_t queue_depth(void *ctx)
+{
+    return ctx ? (int32_t)uxQueueMessagesWaiting((QueueHandle_t)ctx) : 0;
+}
+
 typedef struct {
     sensor_if_t sensor;
     TickType_t  period;
     TickType_t  next_due;
     char        name[16];
     uint8_t     err_streak;
+    int64_t     last_us;       // début de la lecture précédente (gigue)
 } slot_t;
 
 struct sensor_service {
@@ -21,11 +46,13 @@ struct sensor_service {
     size_t         cap;
     size_t         n;
     bool           running;
+    bool           first_done;    // premier échantillon publié (mesure du boot)
 };
 
 static void poll_task(void* arg)
 {
     sensor_service_t* s = (sensor_service_t*)arg;
+    TRACE_TASK("sensor_poll");
 
     // init lazy des capteurs
     for (size_t i=0;i<s->n;i++) {
@@ -45,18 +72,38 @@ static void poll_task(void* arg)
         for (size_t i=0;i<s->n;i++) {
             if ((int32_t)(s->slots[i].next_due - now) <= 0) {
                 // Poll
+                // gigue = écart de l'intervalle entre deux lectures à la période nominale
+                int64_t t_us = esp_timer_get_time();
+                if (s->slots[i].last_us && !s->slots[i].err_streak) {
+                    int64_t d = t_us - s->slots[i].last_us - (int64_t)pdTICKS_TO_MS(s->slots[i].period) * 1000;
+                    metric_observe(&s_m_jitter, (uint32_t)(d < 0 ? -d : d));
+                }
+                s->slots[i].last_us = t_us;
+
                 sensor_measure_t m;
+                TRACE_BEGIN(TRACE_EV_SENSOR_READ, i);
                 esp_err_t e = s->slots[i].sensor.read(s->slots[i].sensor.self, &m);
+                TRACE_END(TRACE_EV_SENSOR_READ, e);
                 if (e == ESP_OK) {
                     s->slots[i].err_streak = 0;
                     sensor_sample_msg_t msg = {0};
                     strncpy(msg.name, s->slots[i].name, sizeof(msg.name)-1);
                     msg.measure = m;
-                    (void)xQueueSend(s->q, &msg, 0);
+                    BaseType_t sent = xQueueSend(s->q, &msg, 0);
+                    TRACE_INSTANT(TRACE_EV_QUEUE_SEND, sent == pdTRUE);
+                    if (sent != pdTRUE) metric_inc(&s_m_drops);
+                    if (!s->first_done) {
+                        s->first_done = true;
+                        boot_timeline_mark("first_sample");
+                        ESP_LOGI(TAG, "first sample [%s] at %lld ms since boot",
+                                 msg.name, (long long)(esp_timer_get_time() / 1000));
+                    }
                 } else {
                     if (s->slots[i].err_streak < 200) s->slots[i].err_streak++;
-                    ESP_LOGW(TAG, "[%s] read err(%u): %s",
-                             s->slots[i].name, s->slots[i].err_streak, esp_err_to_name(e));
+                    metric_inc(&s_m_read_err);
+                    // log différé : name vit aussi longtemps que le service
+                    DLOGW(TAG, "[%s] read err(%u): %s",
+                          s->slots[i].name, s->slots[i].err_streak, esp_err_to_name(e));
                     // petit backoff si erreurs répétées
                     TickType_t backoff = pdMS_TO_TICKS(50 * (s->slots[i].err_streak > 10 ? 10 : s->slots[i].err_streak));
                     s->slots[i].next_due = now + backoff;
@@ -68,32 +115,88 @@ static void poll_task(void* arg)
         }
 
         TickType_t delay = (next > now) ? (next - now) : 1;
+        TRACE_BEGIN(TRACE_EV_BLOCK, pdTICKS_TO_MS(delay));
         vTaskDelay(delay);
+        TRACE_END(TRACE_EV_BLOCK, 0);
     }
 
     // sleep() friendly (optionnel)
     for (size_t i=0;i<s->n;i++) {
         if (s->slots[i].sensor.sleep) (void)s->slots[i].sensor.sleep(s->slots[i].sensor.self);
     }
-    vTaskDelete(NULL);
+    app_task_exit();
 }
 
-sensor_service_t* sensor_service_create(i2c_bus_t* bus,
-                                        size_t max_sensors,
-                                        size_t queue_len)
+#if CONFIG_APP_STATIC_ALLOC
+/* Instance unique en .bss, dimensionnée par Kconfig */
+static sensor_service_t  s_svc;
+static bool              s_svc_used;
+static slot_t            s_slots[CONFIG_APP_STATIC_SENSORS];
+static StaticQueue_t     s_q_buf;
+static uint8_t           s_q_storage[CONFIG_APP_STATIC_QUEUE_LEN * sizeof(sensor_sample_msg_t)];
+
+static sensor_service_t *svc_alloc(size_t max_sensors, size_t queue_len)
 {
-    if (!bus || max_sensors == 0 || queue_len == 0) return NULL;
+    if (s_svc_used || max_sensors > CONFIG_APP_STATIC_SENSORS || queue_len > CONFIG_APP_STATIC_QUEUE_LEN) {
+        ESP_LOGE(TAG, "static pool: %u sensors / %u msgs max",
+                 CONFIG_APP_STATIC_SENSORS, CONFIG_APP_STATIC_QUEUE_LEN);
+        return NULL;
+    }
+    memset(&s_svc, 0, sizeof(s_svc));
+    memset(s_slots, 0, sizeof(s_slots));
+    s_svc.slots = s_slots;
+    s_svc.q = xQueueCreateStatic(queue_len, sizeof(sensor_sample_msg_t), s_q_storage, &s_q_buf);
+    if (!s_svc.q) return NULL;
+    s_svc_used = true;
+    app_mem_account("sensor_service", sizeof(s_svc) + sizeof(s_slots) + sizeof(s_q_buf) + sizeof(s_q_storage));
+    return &s_svc;
+}
 
+static void svc_free(sensor_service_t *s)
+{
+    vQueueDelete(s->q);
+    s_svc_used = false;
+}
+#else
+static sensor_service_t *svc_alloc(size_t max_sensors, size_t queue_len)
+{
     sensor_service_t* s = calloc(1, sizeof(*s));
     if (!s) return NULL;
 
-    s->bus = bus;
     s->slots = calloc(max_sensors, sizeof(slot_t));
     if (!s->slots) { free(s); return NULL; }
 
-    s->cap = max_sensors;
     s->q = xQueueCreate(queue_len, sizeof(sensor_sample_msg_t));
     if (!s->q) { free(s->slots); free(s); return NULL; }
+    return s;
+}
+
+static void svc_free(sensor_service_t *s)
+{
+    if (s->q) vQueueDelete(s->q);
+    if (s->slots) free(s->slots);
+    free(s);
+}
+#endif
+
+sensor_service_t* sensor_service_create(i2c_bus_t* bus,
+                                        size_t max_sensors,
+                                        size_t queue_len)
+{
+    if (!bus || max_sensors == 0 || queue_len == 0) return NULL;
+
+    sensor_service_t* s = svc_alloc(max_sensors, queue_len);
+    if (!s) return NULL;
+
+    s->bus = bus;
+    s->cap = max_sensors;
+
+    s_m_depth.sample = queue_depth;
+    s_m_depth.ctx = s->q;
+    metrics_register(&s_m_read_err.m);
+    metrics_register(&s_m_drops.m);
+    metrics_register(&s_m_depth.m);
+    metrics_register(&s_m_jitter.m);
 
     return s;
 }
@@ -116,12 +219,17 @@ esp_err_t sensor_service_add(sensor_service_t* svc,
 esp_err_t sensor_service_start(sensor_service_t* svc, UBaseType_t prio, uint32_t stack_words)
 {
     if (!svc || svc->running) return ESP_ERR_INVALID_STATE;
-    svc->running = true;
-    if (xTaskCreate(poll_task, "sensor_poll", stack_words ? stack_words : 4096, svc,
-                    prio ? prio : 5, &svc->task) != pdPASS) {
-        svc->running = false;
-        return ESP_ERR_NO_MEM;
+    APP_TASK_MEM(task_mem, SENSOR_POLL_STACK);
+    app_task_mem_t mem = task_mem;
+    if (stack_words) {
+        // la pile statique a une taille fixe : on refuse plutôt que déborder
+        if (mem.stack && stack_words > SENSOR_POLL_STACK) return ESP_ERR_INVALID_SIZE;
+        if (!mem.stack) mem.stack_size = stack_words;
     }
+    svc->running = true;
+    esp_err_t e = app_task_create(poll_task, "sensor_poll", &mem, svc, APP_ROLE_SAMPLING, &svc->task);
+    if (e != ESP_OK) { svc->running = false; return e; }
+    if (prio) vTaskPrioritySet(svc->task, prio);   // priorité imposée par l'appelant
     return ESP_OK;
 }
 
@@ -131,9 +239,7 @@ void sensor_service_destroy(sensor_service_t* svc)
     svc->running = false;
     // La tâche se termine toute seule; si tu veux forcer, attends un peu:
     vTaskDelay(pdMS_TO_TICKS(20));
-    if (svc->q) vQueueDelete(svc->q);
-    if (svc->slots) free(svc->slots);
-    free(svc);
+    svc_free(svc);
 }
 
 QueueHandle_t sensor_service_get_queue(sensor_service_t* svc)
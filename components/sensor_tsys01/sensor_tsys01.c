@@ -3,6 +3,7 @@
 #include "esp_check.h" 
 #include "esp_timer.h"
 #include "esp_random.h" 
+#include "calib_cache.h"
 #include <string.h>
 #include <math.h>
 
@@ -45,6 +46,12 @@ static esp_err_t ts_read_prom(sensor_tsys01_t *s) {
     }
     return ESP_OK;
 }
+/* Checksum PROM (datasheet TSYS01) : somme des 16 octets = 0 mod 256 */
+static bool ts_prom_valid(const uint16_t C[8]) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 8; ++i) sum += (uint8_t)(C[i] >> 8) + (uint8_t)(C[i] & 0xFF);
+    return sum == 0;
+}
 static esp_err_t ts_read_temp_raw(sensor_tsys01_t *s, uint32_t *out) {
     ESP_RETURN_ON_ERROR(ts_cmd(s, CMD_ADC_TEMP_CONV), TAG, "start conv");
     vTaskDelay(pdMS_TO_TICKS(10)); // temps de conversion
@@ -66,9 +73,17 @@ static esp_err_t fn_init(void *self)
     s->initialized = true;
     return ESP_OK;
 #else
+    // Réveil de deep sleep : PROM en cache RTC, pas de reset ni de relecture I2C
+    if (calib_cache_load(CALIB_SLOT_TSYS01, s->addr, s->C, sizeof(s->C)) == ESP_OK &&
+        ts_prom_valid(s->C)) {
+        s->initialized = true;
+        return ESP_OK;
+    }
     ESP_RETURN_ON_ERROR(ts_cmd(s, CMD_RESET), TAG, "reset");
     vTaskDelay(pdMS_TO_TICKS(10));
     ESP_RETURN_ON_ERROR(ts_read_prom(s), TAG, "prom");
+    if (ts_prom_valid(s->C)) calib_cache_store(CALIB_SLOT_TSYS01, s->addr, s->C, sizeof(s->C));
+    else ESP_LOGW(TAG, "PROM checksum mismatch, not cached");
     s->initialized = true;
     return ESP_OK;
 #endif
@@ -94,7 +109,12 @@ static esp_err_t fn_read(void *self, sensor_measure_t *out)
     }
 
     uint32_t D = 0;
-    ESP_RETURN_ON_ERROR(ts_read_temp_raw(s, &D), TAG, "adc");
+    esp_err_t e = ts_read_temp_raw(s, &D);
+    if (e != ESP_OK) {
+        calib_cache_invalidate(CALIB_SLOT_TSYS01);
+        s->initialized = false;
+        return e;
+    }
 
     /* Polynôme d'interpolation (repris de ton code Arduino):
        T(°C) = -2*C1*1e-21*D^4 + 4*C2*1e-16*D^3 -2*C3*1e-11*D^2
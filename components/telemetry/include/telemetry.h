@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Télémétrie en direct (MQTT) pour le bord de bassin ou une plongée câblée :
+ * les échantillons fusionnés sont groupés (CONFIG_APP_TELEMETRY_BATCH
+ * échantillons ou CONFIG_APP_TELEMETRY_BATCH_MS) en un message binaire publié
+ * sur CONFIG_APP_TELEMETRY_TOPIC. Boîte d'envoi bornée : pleine, l'échantillon
+ * le plus ancien est écarté et compté ; hors connexion, les lots sont perdus
+ * (flux en direct, la plongée reste en flash).
+ *
+ * Message (little-endian) :
+ *   u8 version (1), u8 n, u16 seq, u32 dropped (cumul), u64 t0_us (epoch)
+ *   n x { u32 dt_us (depuis t0), u16 depth_cm, i16 temp_cC, u16 press_mbar, u8 state } */
+
+#define TELEMETRY_VERSION     1
+#define TELEMETRY_HDR_SIZE    16
+#define TELEMETRY_SAMPLE_SIZE 11
+
+typedef struct {
+    uint64_t ts_us;          // epoch
+    float    depth_m;
+    float    temp_c;
+    float    press_bar;
+    uint8_t  state;          // dive_state_t
+} telemetry_sample_t;
+
+typedef struct {
+    uint32_t pushed;         // échantillons reçus
+    uint32_t dropped;        // écartés : boîte pleine ou lot non publiable
+    uint32_t messages;       // messages publiés
+    uint32_t pub_failed;     // lots perdus (hors connexion, refus du client)
+    uint32_t bytes;          // charge utile publiée
+} telemetry_stats_t;
+
+/** Connexion Wi-Fi non bloquante + client MQTT + tâche de publication.
+ *  uri NULL = CONFIG_APP_TELEMETRY_BROKER */
+esp_err_t telemetry_start(const char *uri);
+
+/** Dépose un échantillon (non bloquant, appelable depuis le chemin capteur).
+ *  @return ESP_OK, ESP_ERR_NO_MEM si la boîte était pleine (plus ancien écarté),
+ *          ESP_ERR_INVALID_STATE si la télémétrie n'est pas démarrée */
+esp_err_t telemetry_push(const telemetry_sample_t *s);
+
+/** Publie le lot en cours, arrête la tâche et le client */
+void telemetry_stop(void);
+
+void telemetry_get_stats(telemetry_stats_t *st);
+
+/** Encode n échantillons ; retourne la taille, 0 si cap insuffisant */
+size_t telemetry_encode(const telemetry_sample_t *s, size_t n, uint16_t seq, uint32_t dropped,
+                        uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,258 @@
+#include "telemetry.h"
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "wifi_net.h"
+#include "metrics.h"
+#include "app_mem.h"
+
+static const char *TAG = "telemetry";
+
+#ifndef CONFIG_APP_TELEMETRY_BROKER
+#define CONFIG_APP_TELEMETRY_BROKER "mqtt://192.168.4.2"
+#endif
+#ifndef CONFIG_APP_TELEMETRY_TOPIC
+#define CONFIG_APP_TELEMETRY_TOPIC "remora/telemetry"
+#endif
+#ifndef CONFIG_APP_TELEMETRY_BATCH
+#define CONFIG_APP_TELEMETRY_BATCH 8
+#endif
+#ifndef CONFIG_APP_TELEMETRY_BATCH_MS
+#define CONFIG_APP_TELEMETRY_BATCH_MS 1000
+#endif
+#ifndef CONFIG_APP_TELEMETRY_QOS
+#define CONFIG_APP_TELEMETRY_QOS 0
+#endif
+/* Boîte d'envoi (échantillons) entre le chemin capteur et la tâche de publication */
+#ifndef CONFIG_APP_TELEMETRY_OUTBOX
+#define CONFIG_APP_TELEMETRY_OUTBOX 64
+#endif
+
+/* QoS > 0 : lots gardés par le client jusqu'à l'ACK ; au-delà, on écarte */
+#define TELEMETRY_INFLIGHT_MAX 8
+
+typedef struct {
+    telemetry_sample_t s;
+    int64_t            t_push;        // esp_timer au dépôt (âge au moment de la publication)
+} outbox_item_t;
+
+static QueueHandle_t            s_q;
+static esp_mqtt_client_handle_t s_cli;
+static volatile bool            s_connected;
+static volatile bool            s_stop;
+static volatile bool            s_running;
+static SemaphoreHandle_t        s_exited;      // donné par la tâche après son dernier publish
+static uint16_t                 s_seq;
+static telemetry_stats_t        s_st;
+static uint8_t                  s_msg[TELEMETRY_HDR_SIZE + CONFIG_APP_TELEMETRY_BATCH * TELEMETRY_SAMPLE_SIZE];
+
+METRIC_COUNTER(s_m_msgs, "telemetry.messages");
+METRIC_COUNTER(s_m_drop, "telemetry.dropped");
+METRIC_HISTO(s_m_age, "telemetry.age_us");     // dépôt du plus ancien du lot -> publié
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t *p, uint32_t v) { put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+static void put64(uint8_t *p, uint64_t v) { put32(p, (uint32_t)v); put32(p + 4, (uint32_t)(v >> 32)); }
+
+/* Arrondi borné à l'entier de la taille du champ */
+static int32_t clampi(float v, int32_t lo, int32_t hi)
+{
+    float r = v < 0 ? v - 0.5f : v + 0.5f;
+    if (r <= (float)lo) return lo;
+    if (r >= (float)hi) return hi;
+    return (int32_t)r;
+}
+
+size_t telemetry_encode(const telemetry_sample_t *s, size_t n, uint16_t seq, uint32_t dropped,
+                        uint8_t *out, size_t cap)
+{
+    size_t len = TELEMETRY_HDR_SIZE + n * TELEMETRY_SAMPLE_SIZE;
+    if (!s || !out || n == 0 || n > 255 || len > cap) return 0;
+    const uint64_t t0 = s[0].ts_us;
+    out[0] = TELEMETRY_VERSION;
+    out[1] = (uint8_t)n;
+    put16(out + 2, seq);
+    put32(out + 4, dropped);
+    put64(out + 8, t0);
+    uint8_t *p = out + TELEMETRY_HDR_SIZE;
+    for (size_t i = 0; i < n; ++i, p += TELEMETRY_SAMPLE_SIZE) {
+        uint64_t dt = s[i].ts_us > t0 ? s[i].ts_us - t0 : 0;
+        put32(p, dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt);
+        put16(p + 4, (uint16_t)clampi(s[i].depth_m * 100.0f, 0, UINT16_MAX));
+        put16(p + 6, (uint16_t)(int16_t)clampi(s[i].temp_c * 100.0f, INT16_MIN, INT16_MAX));
+        put16(p + 8, (uint16_t)clampi(s[i].press_bar * 1000.0f, 0, UINT16_MAX));
+        p[10] = s[i].state;
+    }
+    return len;
+}
+
+static void count_drop(uint32_t n)
+{
+    __atomic_fetch_add(&s_st.dropped, n, __ATOMIC_RELAXED);
+    metric_add(&s_m_drop, n);
+}
+
+static void mqtt_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == MQTT_EVENT_CONNECTED) {
+        s_connected = true;
+        ESP_LOGI(TAG, "broker connected");
+    } else if (id == MQTT_EVENT_DISCONNECTED) {
+        s_connected = false;
+    }
+}
+
+static void publish(const outbox_item_t *items, telemetry_sample_t *batch, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) batch[i] = items[i].s;
+    uint32_t dropped = __atomic_load_n(&s_st.dropped, __ATOMIC_RELAXED);
+    size_t len = telemetry_encode(batch, n, s_seq, dropped, s_msg, sizeof(s_msg));
+    s_seq++;                            // trou de seq côté abonné = lot perdu
+
+    bool ok = s_connected && len;
+    if (ok && CONFIG_APP_TELEMETRY_QOS > 0 &&
+        esp_mqtt_client_get_outbox_size(s_cli) > TELEMETRY_INFLIGHT_MAX * (int)len)
+        ok = false;                     // ACK en retard : on n'empile pas plus
+    if (ok)
+        ok = esp_mqtt_client_publish(s_cli, CONFIG_APP_TELEMETRY_TOPIC, (const char *)s_msg,
+                                     (int)len, CONFIG_APP_TELEMETRY_QOS, 0) >= 0;
+    if (!ok) {
+        s_st.pub_failed++;
+        count_drop((uint32_t)n);
+        return;
+    }
+    s_st.messages++;
+    s_st.bytes += (uint32_t)len;
+    metric_inc(&s_m_msgs);
+    metric_observe(&s_m_age, (uint32_t)(esp_timer_get_time() - items[0].t_push));
+}
+
+static void telemetry_task(void *arg)
+{
+    static outbox_item_t      items[CONFIG_APP_TELEMETRY_BATCH];
+    static telemetry_sample_t batch[CONFIG_APP_TELEMETRY_BATCH];
+    size_t n = 0;
+    int64_t deadline = 0;
+
+    while (!s_stop || uxQueueMessagesWaiting(s_q)) {
+        // attente bornée à 100 ms : un arrêt n'attend pas l'échéance du lot
+        TickType_t wait = pdMS_TO_TICKS(100);
+        if (n) {
+            int64_t left_us = deadline - esp_timer_get_time();
+            if (left_us < 100000) wait = left_us > 0 ? pdMS_TO_TICKS(left_us / 1000) : 0;
+        }
+        if (xQueueReceive(s_q, &items[n], wait) == pdTRUE) {
+            if (n++ == 0) deadline = items[0].t_push + (int64_t)CONFIG_APP_TELEMETRY_BATCH_MS * 1000;
+        }
+        if (n && (n == CONFIG_APP_TELEMETRY_BATCH || esp_timer_get_time() >= deadline || s_stop)) {
+            publish(items, batch, n);
+            n = 0;
+        }
+    }
+    if (n) publish(items, batch, n);
+    s_running = false;
+    xSemaphoreGive(s_exited);
+    app_task_exit();
+}
+
+esp_err_t telemetry_start(const char *uri)
+{
+    if (s_running) return ESP_OK;
+    if (!s_q) {
+#if CONFIG_APP_STATIC_ALLOC
+        static StaticQueue_t q_buf;
+        static uint8_t       q_store[CONFIG_APP_TELEMETRY_OUTBOX * sizeof(outbox_item_t)];
+        s_q = xQueueCreateStatic(CONFIG_APP_TELEMETRY_OUTBOX, sizeof(outbox_item_t), q_store, &q_buf);
+        app_mem_account("telemetry", sizeof(q_buf) + sizeof(q_store) + sizeof(s_msg));
+#else
+        s_q = xQueueCreate(CONFIG_APP_TELEMETRY_OUTBOX, sizeof(outbox_item_t));
+        if (!s_q) return ESP_ERR_NO_MEM;
+#endif
+        metrics_register(&s_m_msgs.m);
+        metrics_register(&s_m_drop.m);
+        metrics_register(&s_m_age.m);
+    }
+    if (!s_exited) {
+        static StaticSemaphore_t exited_buf;
+        s_exited = xSemaphoreCreateBinaryStatic(&exited_buf);
+    }
+    xQueueReset(s_q);
+    xSemaphoreTake(s_exited, 0);
+
+    // radio en tâche de fond : le client MQTT se connecte dès que l'IP arrive
+    ESP_RETURN_ON_ERROR(wifi_net_connect(0), TAG, "wifi");
+
+    esp_mqtt_client_config_t cfg = {
+        .broker.address.uri = uri ? uri : CONFIG_APP_TELEMETRY_BROKER,
+        .session.keepalive = 30,
+        .network.reconnect_timeout_ms = 2000,
+    };
+    s_cli = esp_mqtt_client_init(&cfg);
+    if (!s_cli) return ESP_ERR_NO_MEM;
+    esp_mqtt_client_register_event(s_cli, ESP_EVENT_ANY_ID, mqtt_event, NULL);
+    esp_err_t e = esp_mqtt_client_start(s_cli);
+    if (e != ESP_OK) {
+        esp_mqtt_client_destroy(s_cli);
+        s_cli = NULL;
+        return e;
+    }
+
+    memset(&s_st, 0, sizeof(s_st));
+    s_stop = false;
+    s_running = true;
+    APP_TASK_MEM(task_mem, 4096);
+    e = app_task_create(telemetry_task, "telemetry", &task_mem, NULL, APP_ROLE_NET, NULL);
+    if (e != ESP_OK) {
+        s_running = false;
+        esp_mqtt_client_destroy(s_cli);
+        s_cli = NULL;
+        return e;
+    }
+    ESP_LOGI(TAG, "streaming to %s (%d samples / %d ms, QoS %d)", cfg.broker.address.uri,
+             CONFIG_APP_TELEMETRY_BATCH, CONFIG_APP_TELEMETRY_BATCH_MS, CONFIG_APP_TELEMETRY_QOS);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_push(const telemetry_sample_t *s)
+{
+    if (!s) return ESP_ERR_INVALID_ARG;
+    if (!s_running || s_stop) return ESP_ERR_INVALID_STATE;
+    outbox_item_t it = { .s = *s, .t_push = esp_timer_get_time() };
+    __atomic_fetch_add(&s_st.pushed, 1, __ATOMIC_RELAXED);
+    if (xQueueSend(s_q, &it, 0) == pdTRUE) return ESP_OK;
+
+    // pleine : en direct, le plus récent prime sur le plus ancien
+    outbox_item_t old;
+    xQueueReceive(s_q, &old, 0);
+    count_drop(1);
+    xQueueSend(s_q, &it, 0);
+    return ESP_ERR_NO_MEM;
+}
+
+void telemetry_stop(void)
+{
+    if (!s_cli) return;
+    s_stop = true;
+    // La tâche peut être dans publish() avec s_cli : on attend sa sortie avant
+    // de détruire le client. Sa boucle relit s_stop au plus tard après 100 ms
+    xSemaphoreTake(s_exited, portMAX_DELAY);
+    esp_mqtt_client_stop(s_cli);
+    esp_mqtt_client_destroy(s_cli);
+    s_cli = NULL;
+    s_connected = false;
+    ESP_LOGI(TAG, "stopped: pushed=%u msgs=%u dropped=%u failed=%u bytes=%u",
+             (unsigned)s_st.pushed, (unsigned)s_st.messages, (unsigned)s_st.dropped,
+             (unsigned)s_st.pub_failed, (unsigned)s_st.bytes);
+}
+
+void telemetry_get_stats(telemetry_stats_t *st)
+{
+    if (st) *st = s_st;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Détecteur eau/air indépendant du matériel : baseline IIR + hystérésis + debounce.
+ * Sens du capteur (hal_touch_rises()) : sur ESP32 l'eau fait BAISSER la valeur
+ * brute, sur ESP32-S2/S3 elle la fait MONTER. Les pourcentages s'appliquent
+ * en miroir : enter_pct = 70 donne 0,70 × baseline ou 1,30 × baseline. */
+
+typedef enum {
+    TOUCH_DETECT_NONE = 0,
+    TOUCH_DETECT_WET,         // transition sec -> mouillé confirmée
+    TOUCH_DETECT_DRY,         // transition mouillé -> sec confirmée
+} touch_detect_evt_t;
+
+typedef struct {
+    uint8_t  enter_pct;       // mouillé au-delà de baseline * enter_pct / 100 (en miroir si rises)
+    uint8_t  exit_pct;        // sec en deçà de baseline * exit_pct / 100 (exit_pct > enter_pct)
+    uint8_t  debounce;        // nb de lectures consécutives pour valider une transition
+    uint8_t  iir_shift;       // baseline += (raw - baseline) >> iir_shift (suivi lent)
+    bool     rises;           // l'eau fait monter la valeur brute (ESP32-S2/S3)
+} touch_detect_cfg_t;
+
+typedef struct {
+    touch_detect_cfg_t cfg;
+    uint32_t baseline_q8;     // baseline en virgule fixe Q24.8
+    bool     wet;             // état validé
+    uint8_t  streak;          // lectures consécutives allant vers l'autre état
+} touch_detect_t;
+
+void     touch_detect_init(touch_detect_t *d, const touch_detect_cfg_t *cfg, uint32_t baseline);
+
+/** Traite une lecture brute, renvoie la transition éventuelle */
+touch_detect_evt_t touch_detect_update(touch_detect_t *d, uint32_t raw);
+
+static inline uint32_t touch_detect_baseline(const touch_detect_t *d) { return d->baseline_q8 >> 8; }
+static inline uint32_t touch_detect_pct_(const touch_detect_t *d, uint8_t pct)
+{
+    uint32_t p = d->cfg.rises ? 200u - pct : pct;
+    return (uint32_t)(((uint64_t)touch_detect_baseline(d) * p) / 100u);
+}
+static inline uint32_t touch_detect_enter_thr(const touch_detect_t *d) { return touch_detect_pct_(d, d->cfg.enter_pct); }
+static inline uint32_t touch_detect_exit_thr(const touch_detect_t *d)  { return touch_detect_pct_(d, d->cfg.exit_pct); }
+
+/** raw est-il du côté « eau » de thr ? */
+static inline bool touch_detect_wetter(const touch_detect_t *d, uint32_t raw, uint32_t thr)
+{
+    return d->cfg.rises ? raw > thr : raw < thr;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,18 +3,38 @@
 #include <stdint.h>
 #include "sdkconfig.h"
 #include "esp_err.h"
+#include "esp_event.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Événements publiés sur la boucle par défaut par le moniteur */
+ESP_EVENT_DECLARE_BASE(TOUCH_WATER_EVENT);
+
+enum {
+    TOUCH_WATER_EVT_WET,     // entrée dans l'eau confirmée
+    TOUCH_WATER_EVT_DRY,     // sortie de l'eau confirmée
+};
+
+typedef struct {
+    uint32_t raw;            // lecture ayant validé la transition
+    uint32_t baseline;       // baseline suivie à cet instant
+} touch_water_evt_data_t;
+
 esp_err_t touch_water_init(void);
 void      touch_water_deinit(void);
+/** Présence d'eau : état filtré si le moniteur tourne, sinon lecture brute vs seuil */
 bool      touch_water_is_present(void);
 esp_err_t touch_water_prepare_wakeup(void);
 uint32_t  touch_water_get_baseline(void);
 uint32_t  touch_water_get_threshold(void);
 uint32_t  touch_water_read_raw(void);
 
+/** Démarre la détection sur interruption (baseline IIR, hystérésis, debounce).
+ *  Les transitions sont publiées en TOUCH_WATER_EVENT. */
+esp_err_t touch_water_start_monitor(void);
+void      touch_water_stop_monitor(void);
+
 #ifdef __cplusplus
 }
 #endif
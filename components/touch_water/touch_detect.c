@@ -0,0 +1,43 @@
+#include "touch_detect.h"
+#include <string.h>
+
+void touch_detect_init(touch_detect_t *d, const touch_detect_cfg_t *cfg, uint32_t baseline)
+{
+    memset(d, 0, sizeof(*d));
+    d->cfg = *cfg;
+    if (d->cfg.exit_pct <= d->cfg.enter_pct) d->cfg.exit_pct = d->cfg.enter_pct + 1;
+    if (d->cfg.debounce == 0) d->cfg.debounce = 1;
+    d->baseline_q8 = baseline << 8;
+}
+
+touch_detect_evt_t touch_detect_update(touch_detect_t *d, uint32_t raw)
+{
+    if (!d->wet) {
+        if (touch_detect_wetter(d, raw, touch_detect_enter_thr(d))) {
+            if (++d->streak >= d->cfg.debounce) {
+                d->wet = true;
+                d->streak = 0;
+                return TOUCH_DETECT_WET;
+            }
+            return TOUCH_DETECT_NONE;
+        }
+        d->streak = 0;
+        // Baseline suivie uniquement à sec, hors zone d'hystérésis (l'eau ne la tire pas)
+        if (!touch_detect_wetter(d, raw, touch_detect_exit_thr(d))) {
+            int32_t diff = (int32_t)((raw << 8) - d->baseline_q8);
+            d->baseline_q8 = (uint32_t)((int32_t)d->baseline_q8 + (diff >> d->cfg.iir_shift));
+        }
+        return TOUCH_DETECT_NONE;
+    }
+
+    if (!touch_detect_wetter(d, raw, touch_detect_exit_thr(d))) {
+        if (++d->streak >= d->cfg.debounce) {
+            d->wet = false;
+            d->streak = 0;
+            return TOUCH_DETECT_DRY;
+        }
+        return TOUCH_DETECT_NONE;
+    }
+    d->streak = 0;
+    return TOUCH_DETECT_NONE;
+}
@@ -1,141 +1,219 @@
 #include "touch_water.h"
+#include "touch_detect.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "esp_sleep.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "hal_touch.h"
+#include "calib_cache.h"
+#include "app_mem.h"
 #include <inttypes.h>
 
-/* ==== Détection auto de l'API tactile disponible ==== */
-#if __has_include("driver/touch_sens.h")
-  #define TW_USE_NEW_API 1
-  #include "driver/touch_sens.h"      // (IDF récents)
-#else
-  #define TW_USE_NEW_API 0
-  #include "driver/touch_sensor.h"    // (legacy, IDF 4.x/5.x)
-#endif
-
 static const char *TAG = "touch_water";
 
+ESP_EVENT_DEFINE_BASE(TOUCH_WATER_EVENT);
+
 static uint32_t s_baseline = 0;
 static uint32_t s_threshold = 0;
-static inline touch_pad_t tp(void) { return (touch_pad_t)CONFIG_APP_TOUCH_PAD_NUM; }
+#define TW_PAD CONFIG_APP_TOUCH_PAD_NUM
 
 #ifndef CONFIG_APP_TOUCH_THRESH_PCT
 #define CONFIG_APP_TOUCH_THRESH_PCT 70
 #endif
+#ifndef CONFIG_APP_TOUCH_EXIT_PCT
+#define CONFIG_APP_TOUCH_EXIT_PCT 80
+#endif
+#ifndef CONFIG_APP_TOUCH_DEBOUNCE
+#define CONFIG_APP_TOUCH_DEBOUNCE 3
+#endif
+#ifndef CONFIG_APP_TOUCH_POLL_MS
+#define CONFIG_APP_TOUCH_POLL_MS 200
+#endif
+#ifndef CONFIG_APP_TOUCH_IDLE_MS
+#define CONFIG_APP_TOUCH_IDLE_MS 5000
+#endif
 
-#if TW_USE_NEW_API
-/* =================== Nouvelle API =================== */
-static inline esp_err_t tw_read_raw(uint32_t *raw) {
-    return touch_sensor_read_raw(tp(), raw);
-}
+/* Moniteur (tâche + interruption) */
+static touch_detect_t s_det;
+static TaskHandle_t   s_task = NULL;
+static volatile bool  s_monitor = false;
+static SemaphoreHandle_t s_exited;     // donné par la tâche en sortant de sa boucle
 
-esp_err_t touch_water_init(void)
+/* Baseline en cache RTC : au réveil tactile le pad est mouillé, un recalibrage serait faux */
+static bool tw_cached_baseline(void)
 {
-    ESP_LOGI(TAG, "Init (NEW API) pad=%d, thresh=%d%%",
-             CONFIG_APP_TOUCH_PAD_NUM, CONFIG_APP_TOUCH_THRESH_PCT);
+    uint32_t b = 0;
+    if (calib_cache_load(CALIB_SLOT_TOUCH, CONFIG_APP_TOUCH_PAD_NUM, &b, sizeof(b)) != ESP_OK || !b)
+        return false;
+    s_baseline = b;
+    ESP_LOGI(TAG, "baseline from RTC cache: %" PRIu32, b);
+    return true;
+}
 
-    touch_sensor_config_t cfg = {
-        .pad = tp(),
-        .voltage = TOUCH_HVOLT_2V7,
-        .threshold = 0,
+static void tw_calibrated(bool fresh)
+{
+    const touch_detect_cfg_t cfg = {
+        .enter_pct = CONFIG_APP_TOUCH_THRESH_PCT,
+        .exit_pct  = CONFIG_APP_TOUCH_EXIT_PCT,
+        .debounce  = CONFIG_APP_TOUCH_DEBOUNCE,
+        .iir_shift = 4,
+        .rises     = hal_touch_rises(),
     };
-    ESP_RETURN_ON_ERROR(touch_sensor_config(&cfg), TAG, "config");
+    touch_detect_init(&s_det, &cfg, s_baseline);
+    s_threshold = touch_detect_enter_thr(&s_det);
+    if (fresh)
+        calib_cache_store(CALIB_SLOT_TOUCH, CONFIG_APP_TOUCH_PAD_NUM, &s_baseline, sizeof(s_baseline));
+}
 
-    // Calibrage simple
-    uint64_t sum = 0;
-    const int samples = 20;
-    for (int i = 0; i < samples; ++i) {
-        uint32_t raw = 0;
-        ESP_RETURN_ON_ERROR(touch_sensor_read_raw(tp(), &raw), TAG, "read_raw");
-        sum += raw;
-        vTaskDelay(pdMS_TO_TICKS(10));
+static inline esp_err_t tw_read_raw(uint32_t *raw) { return hal_touch_read_raw(TW_PAD, raw); }
+static inline esp_err_t tw_set_thresh(uint32_t thr) { return hal_touch_set_thresh(TW_PAD, thr); }
+
+/* Appelé depuis l'ISR (déjà désarmée) : la lecture est déléguée à la tâche moniteur */
+static void IRAM_ATTR tw_isr_cb(void *arg)
+{
+    (void)arg;
+    BaseType_t hp = pdFALSE;
+    if (s_task) vTaskNotifyGiveFromISR(s_task, &hp);
+    portYIELD_FROM_ISR(hp);
+}
+
+esp_err_t touch_water_init(void)
+{
+    ESP_LOGI(TAG, "Init pad=%d, thresh=%d%%", TW_PAD, CONFIG_APP_TOUCH_THRESH_PCT);
+
+    ESP_RETURN_ON_ERROR(hal_touch_init(TW_PAD), TAG, "touch init");
+
+    bool cached = tw_cached_baseline();
+    if (!cached) {
+        vTaskDelay(pdMS_TO_TICKS(50));
+
+        // Calibrage simple
+        uint64_t sum = 0;
+        const int samples = 20;
+        for (int i = 0; i < samples; ++i) {
+            uint32_t raw = 0;
+            ESP_RETURN_ON_ERROR(tw_read_raw(&raw), TAG, "read_raw");
+            sum += raw;
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        s_baseline = (uint32_t)(sum / samples);
     }
-    s_baseline  = (uint32_t)(sum / samples);
-    s_threshold = (s_baseline * CONFIG_APP_TOUCH_THRESH_PCT) / 100;
+    tw_calibrated(!cached);
 
-    ESP_RETURN_ON_ERROR(touch_sensor_set_threshold(tp(), s_threshold), TAG, "set_thresh");
+    ESP_RETURN_ON_ERROR(tw_set_thresh(s_threshold), TAG, "set_thresh");
 
     ESP_LOGI(TAG, "baseline=%" PRIu32 ", threshold=%" PRIu32, s_baseline, s_threshold);
     return ESP_OK;
 }
 
 void touch_water_deinit(void) {
-    touch_sensor_deinit(tp());
-}
-
-bool touch_water_is_present(void)
-{
-    uint32_t raw = 0;
-    if (touch_sensor_read_raw(tp(), &raw) != ESP_OK) return false;
-    return (raw < s_threshold);
+    touch_water_stop_monitor();
+    hal_touch_deinit(TW_PAD);
 }
 
 esp_err_t touch_water_prepare_wakeup(void)
 {
     if (!s_threshold) ESP_RETURN_ON_ERROR(touch_water_init(), TAG, "reinit");
-    return touch_sensor_set_threshold(tp(), s_threshold);
+    return tw_set_thresh(s_threshold);
 }
 
-#else
-/* =================== API legacy =================== */
-static inline esp_err_t tw_read_raw(uint32_t *raw) {
-    return touch_pad_read_raw_data(tp(), raw);
+/* =================== Moniteur commun =================== */
+static void tw_post(touch_detect_evt_t ev, uint32_t raw)
+{
+    int32_t id = (ev == TOUCH_DETECT_WET) ? TOUCH_WATER_EVT_WET : TOUCH_WATER_EVT_DRY;
+    touch_water_evt_data_t data = { .raw = raw, .baseline = touch_detect_baseline(&s_det) };
+    ESP_LOGI(TAG, "%s (raw=%" PRIu32 ", baseline=%" PRIu32 ")",
+             id == TOUCH_WATER_EVT_WET ? "WET" : "DRY", raw, data.baseline);
+    esp_err_t e = esp_event_post(TOUCH_WATER_EVENT, id, &data, sizeof(data), 0);
+    if (e != ESP_OK) ESP_LOGW(TAG, "event post: %s", esp_err_to_name(e));
 }
 
-esp_err_t touch_water_init(void)
+static void tw_task(void *arg)
 {
-    ESP_LOGI(TAG, "Init (LEGACY API) pad=%d, thresh=%d%%",
-             CONFIG_APP_TOUCH_PAD_NUM, CONFIG_APP_TOUCH_THRESH_PCT);
+    const bool has_intr = (bool)(uintptr_t)arg;
+
+    while (s_monitor) {
+        // À sec et stable : on dort sur l'interruption (réveil lent pour suivre la baseline).
+        // Transition en cours ou mouillé : scrutation au rythme du debounce.
+        bool settling = s_det.wet || s_det.streak > 0;
+        TickType_t wait = pdMS_TO_TICKS((settling || !has_intr) ? CONFIG_APP_TOUCH_POLL_MS
+                                                                : CONFIG_APP_TOUCH_IDLE_MS);
+        if (has_intr && !settling) hal_touch_intr_arm(true);
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!s_monitor) break;
+        if (has_intr) hal_touch_intr_arm(false);
 
-    ESP_RETURN_ON_ERROR(touch_pad_init(), TAG, "touch_pad_init");
-    ESP_RETURN_ON_ERROR(touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER), TAG, "set_fsm");
-    ESP_RETURN_ON_ERROR(touch_pad_config(tp()), TAG, "pad_config");
+        uint32_t raw = 0;
+        if (tw_read_raw(&raw) != ESP_OK) continue;
+
+        touch_detect_evt_t ev = touch_detect_update(&s_det, raw);
+        if (!s_det.wet) {
+            // Seuil matériel aligné sur la baseline suivie
+            uint32_t thr = touch_detect_enter_thr(&s_det);
+            if (thr != s_threshold) {
+                s_threshold = thr;
+                s_baseline = touch_detect_baseline(&s_det);
+                tw_set_thresh(thr);
+                // rafraîchissement paresseux du cache pour le prochain réveil
+                calib_cache_store(CALIB_SLOT_TOUCH, CONFIG_APP_TOUCH_PAD_NUM, &s_baseline, sizeof(s_baseline));
+            }
+        }
+        if (ev != TOUCH_DETECT_NONE) tw_post(ev, raw);
+    }
+    s_task = NULL;
+    xSemaphoreGive(s_exited);
+    app_task_exit();
+}
 
-    /* Filtre si activé dans la config */
-    #if CONFIG_TOUCH_PAD_FILTER_ENABLE
-      touch_pad_set_filter_period(10);
-      touch_pad_filter_enable();
-    #endif
+esp_err_t touch_water_start_monitor(void)
+{
+    if (s_monitor) return ESP_OK;
+    if (!s_threshold) ESP_RETURN_ON_ERROR(touch_water_init(), TAG, "init");
 
-    vTaskDelay(pdMS_TO_TICKS(50));
+    // Boucle d'événements par défaut (déjà créée si wifi_net est initialisé)
+    esp_err_t e = esp_event_loop_create_default();
+    if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) return e;
 
-    uint64_t sum = 0;
-    const int samples = 20;
-    for (int i = 0; i < samples; ++i) {
-        uint32_t raw = 0;
-        ESP_RETURN_ON_ERROR(touch_pad_read_raw_data(tp(), &raw), TAG, "read_raw");
-        sum += raw;
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
-    s_baseline  = (uint32_t)(sum / samples);
-    s_threshold = (s_baseline * CONFIG_APP_TOUCH_THRESH_PCT) / 100;
+    bool has_intr = (hal_touch_intr_install(tw_isr_cb, NULL) == ESP_OK);
+    if (!has_intr) ESP_LOGW(TAG, "no touch interrupt, polling every %d ms", CONFIG_APP_TOUCH_POLL_MS);
 
-    ESP_RETURN_ON_ERROR(touch_pad_set_thresh(tp(), s_threshold), TAG, "set_thresh");
+    if (!s_exited) {
+        static StaticSemaphore_t exited_buf;
+        s_exited = xSemaphoreCreateBinaryStatic(&exited_buf);
+    }
 
-    ESP_LOGI(TAG, "baseline=%" PRIu32 ", threshold=%" PRIu32, s_baseline, s_threshold);
-    return ESP_OK;
+    APP_TASK_MEM(task_mem, 3072);
+    s_monitor = true;
+    esp_err_t te = app_task_create(tw_task, "touch_water", &task_mem, (void*)(uintptr_t)has_intr, APP_ROLE_MONITOR, &s_task);
+    if (te != ESP_OK) {
+        s_monitor = false;
+        if (has_intr) hal_touch_intr_uninstall();
+    }
+    return te;
 }
 
-void touch_water_deinit(void) {
-    touch_pad_deinit();
+void touch_water_stop_monitor(void)
+{
+    if (!s_monitor) return;
+    s_monitor = false;
+    if (s_task) xTaskNotifyGive(s_task);
+    // La tâche peut être au milieu d'une lecture : on attend sa sortie de boucle
+    // avant de retirer l'interruption qui la réveille
+    xSemaphoreTake(s_exited, portMAX_DELAY);
+    hal_touch_intr_arm(false);
+    hal_touch_intr_uninstall();
 }
 
 bool touch_water_is_present(void)
 {
+    if (s_monitor) return s_det.wet;   // état filtré (hystérésis + debounce)
     uint32_t raw = 0;
     if (tw_read_raw(&raw) != ESP_OK) return false;
-    return (raw < s_threshold);
+    return hal_touch_rises() ? raw > s_threshold : raw < s_threshold;
 }
 
-esp_err_t touch_water_prepare_wakeup(void)
-{
-    if (!s_threshold) ESP_RETURN_ON_ERROR(touch_water_init(), TAG, "reinit");
-    return touch_pad_set_thresh(tp(), s_threshold);
-}
-#endif
-
 uint32_t touch_water_get_baseline(void)  { return s_baseline;  }
 uint32_t touch_water_get_threshold(void) { return s_threshold; }
 uint32_t touch_water_read_raw(void)
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Enregistreur de traces : événements fixes de 12 octets dans un anneau RAM
+ * (les plus anciens sont écrasés), vidé en binaire par trace_dump().
+ * Conversion hôte : tools/trace_to_chrome.py -> Chrome trace JSON (chrome://tracing, Perfetto). */
+
+#ifndef CONFIG_TRACE_ENABLE
+#define CONFIG_TRACE_ENABLE 1
+#endif
+
+typedef enum {
+    TRACE_EV_I2C = 1,       // transaction I²C (arg = adresse 7 bits)
+    TRACE_EV_SENSOR_READ,   // lecture capteur (arg = index du slot)
+    TRACE_EV_QUEUE_SEND,    // publication d'une mesure (arg = 1 ok, 0 queue pleine)
+    TRACE_EV_QUEUE_RECV,    // consommation d'une mesure
+    TRACE_EV_STORE_APPEND,  // écriture d'un échantillon
+    TRACE_EV_STORE_FLUSH,   // métadonnées / fermeture de plongée
+    TRACE_EV_BLOCK,         // tâche bloquée (délai, attente queue) : arg = délai demandé (ms)
+} trace_ev_t;
+
+typedef enum {
+    TRACE_PH_BEGIN = 0,
+    TRACE_PH_END,
+    TRACE_PH_INSTANT,
+} trace_phase_t;
+
+/** Enregistre un événement (tâche ou ISR, sans verrou) */
+void trace_record(trace_ev_t ev, trace_phase_t ph, uint32_t arg);
+
+/** Nomme la tâche courante dans la trace (au plus 8 tâches) */
+void trace_task_register(const char *name);
+
+/** Suspend / reprend l'enregistrement (ex. pendant trace_dump) */
+void trace_enable(bool on);
+
+/** Écrit l'anneau (du plus ancien au plus récent) dans path (NULL = <FS>/trace.bin) */
+esp_err_t trace_dump(const char *path);
+
+#if CONFIG_TRACE_ENABLE
+#define TRACE_BEGIN(ev, arg)   trace_record((ev), TRACE_PH_BEGIN, (uint32_t)(arg))
+#define TRACE_END(ev, arg)     trace_record((ev), TRACE_PH_END, (uint32_t)(arg))
+#define TRACE_INSTANT(ev, arg) trace_record((ev), TRACE_PH_INSTANT, (uint32_t)(arg))
+#define TRACE_TASK(name)       trace_task_register(name)
+#else
+#define TRACE_BEGIN(ev, arg)   do { } while (0)
+#define TRACE_END(ev, arg)     do { } while (0)
+#define TRACE_INSTANT(ev, arg) do { } while (0)
+#define TRACE_TASK(name)       do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+#include "trace.h"
+#include "hal_fs.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "app_mem.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "trace";
+
+#ifndef CONFIG_TRACE_EVENTS
+#define CONFIG_TRACE_EVENTS 512
+#endif
+
+_Static_assert((CONFIG_TRACE_EVENTS & (CONFIG_TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS doit être une puissance de 2");
+
+#define TRACE_MAX_TASKS  8
+#define TRACE_TASK_NONE  0xFF
+
+typedef struct {
+    uint32_t ts_us;         // esp_timer, 32 bits bas (~71 min)
+    uint8_t  ev;            // trace_ev_t
+    uint8_t  ph_core;       // phase (bits 0-1) | cœur (bit 7)
+    uint8_t  task;          // index dans s_tasks, 0xFF = tâche non nommée
+    uint8_t  rsvd;
+    uint32_t arg;
+} trace_evt_t;
+
+_Static_assert(sizeof(trace_evt_t) == 12, "format du dump");
+
+typedef struct {
+    TaskHandle_t handle;
+    char         name[16];
+} trace_task_t;
+
+static trace_evt_t  s_ring[CONFIG_TRACE_EVENTS];
+static uint32_t     s_idx;
+static bool         s_on = true;
+static trace_task_t s_tasks[TRACE_MAX_TASKS];
+static uint32_t     s_ntasks;
+
+static inline uint8_t task_id(void)
+{
+    TaskHandle_t h = xTaskGetCurrentTaskHandle();
+    uint32_t n = __atomic_load_n(&s_ntasks, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n && i < TRACE_MAX_TASKS; ++i)
+        if (s_tasks[i].handle == h) return (uint8_t)i;
+    return TRACE_TASK_NONE;
+}
+
+static inline uint8_t core_id(void)
+{
+#if CONFIG_IDF_TARGET_LINUX || CONFIG_FREERTOS_UNICORE
+    return 0;
+#else
+    return (uint8_t)xPortGetCoreID();
+#endif
+}
+
+void trace_record(trace_ev_t ev, trace_phase_t ph, uint32_t arg)
+{
+    if (!__atomic_load_n(&s_on, __ATOMIC_RELAXED)) return;
+    uint32_t i = __atomic_fetch_add(&s_idx, 1, __ATOMIC_RELAXED);
+    trace_evt_t *e = &s_ring[i & (CONFIG_TRACE_EVENTS - 1)];
+    e->ts_us   = (uint32_t)esp_timer_get_time();
+    e->ev      = (uint8_t)ev;
+    e->ph_core = (uint8_t)((ph & 3) | (core_id() << 7));
+    e->task    = task_id();
+    e->arg     = arg;
+}
+
+void trace_task_register(const char *name)
+{
+    TaskHandle_t h = xTaskGetCurrentTaskHandle();
+    uint32_t n = __atomic_load_n(&s_ntasks, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n && i < TRACE_MAX_TASKS; ++i) {
+        if (s_tasks[i].handle == h) {
+            strncpy(s_tasks[i].name, name, sizeof(s_tasks[i].name) - 1);
+            return;
+        }
+    }
+    uint32_t i = __atomic_fetch_add(&s_ntasks, 1, __ATOMIC_ACQ_REL);
+    if (i >= TRACE_MAX_TASKS) return;
+    if (i == 0) app_mem_account("trace", sizeof(s_ring) + sizeof(s_tasks));
+    // nom écrit avant le handle : task_id() ne voit jamais une entrée incomplète
+    strncpy(s_tasks[i].name, name, sizeof(s_tasks[i].name) - 1);
+    __atomic_store_n(&s_tasks[i].handle, h, __ATOMIC_RELEASE);
+}
+
+void trace_enable(bool on)
+{
+    __atomic_store_n(&s_on, on, __ATOMIC_RELAXED);
+}
+
+esp_err_t trace_dump(const char *path)
+{
+    char def[80];
+    if (!path) {
+        snprintf(def, sizeof(def), "%s/trace.bin", hal_fs_base_path());
+        path = def;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) return ESP_FAIL;
+
+    bool was_on = __atomic_exchange_n(&s_on, false, __ATOMIC_RELAXED);
+    uint32_t end = __atomic_load_n(&s_idx, __ATOMIC_RELAXED);
+    uint32_t n = end < CONFIG_TRACE_EVENTS ? end : CONFIG_TRACE_EVENTS;
+    uint32_t nt = __atomic_load_n(&s_ntasks, __ATOMIC_ACQUIRE);
+    if (nt > TRACE_MAX_TASKS) nt = TRACE_MAX_TASKS;
+
+    // en-tête : magic, taille d'événement, nb de tâches, nb d'événements
+    const uint8_t hdr[8] = { 'T', 'R', 'C', '1', sizeof(trace_evt_t), (uint8_t)nt, 0, 0 };
+    fwrite(hdr, 1, sizeof(hdr), f);
+    for (uint32_t i = 0; i < nt; ++i) fwrite(s_tasks[i].name, 1, sizeof(s_tasks[i].name), f);
+    fwrite(&n, sizeof(n), 1, f);
+    for (uint32_t i = end - n; i != end; ++i)
+        fwrite(&s_ring[i & (CONFIG_TRACE_EVENTS - 1)], sizeof(trace_evt_t), 1, f);
+
+    bool ok = (ferror(f) == 0);
+    fclose(f);
+    __atomic_store_n(&s_on, was_on, __ATOMIC_RELAXED);
+    ESP_LOGI(TAG, "%u events -> %s", (unsigned)n, path);
+    return ok ? ESP_OK : ESP_FAIL;
+}
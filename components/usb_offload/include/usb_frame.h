@@ -0,0 +1,107 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trame du lien USB (petit-boutiste) :
+ *   A5 5A | u8 type | u8 seq | u16 len | payload[len] | u32 crc32(type..payload)
+ * Les octets hors trame (log égaré, trame corrompue) sont sautés jusqu'au
+ * prochain A5 5A ; une trame dont le CRC est faux est ignorée.
+ *
+ * Hôte -> appareil                    Appareil -> hôte
+ *   HELLO                               HELLO   u8 ver, u8 window, u16 max payload
+ *   LIST  u32 offset, u16 n, après-id   DATA    u32 offset, octets (catalogue ou <id>.csv)
+ *   GET   u32 offset, id                END     u32 size, u32 crc32 des octets [offset, size)
+ *   ACK   u32 offset (reçus en continu)  ERR     u8 code, texte
+ *   NAK   u32 offset (trou détecté)
+ *   METRICS u32 offset
+ *   MARK  u32 size, id                  END     u32 size, u32 échantillons (MARK)
+ *   BYE
+ * Fenêtre : au plus `window` trames DATA au-delà du dernier ACK. Un NAK, ou un
+ * ACK qui n'avance plus, fait repartir l'envoi de l'offset acquitté (go-back-N,
+ * relu depuis la flash : rien n'est gardé en RAM). LIST = GET d'une page du
+ * catalogue : JSON, au plus n plongées (bornées à USB_LIST_PAGE) d'id > après-id,
+ * une par objet avec "bytes" et "synced" ; page suivante après le dernier id
+ * reçu, tableau vide à la fin. GET à offset = size : END seul. METRICS = GET de
+ * l'instantané JSON des métriques (metrics_to_json), refait à chaque requête.
+ * MARK, après le END d'un GET complet d'une plongée fermée ("summary" au
+ * catalogue) : si size est la taille de ses données, la plongée passe
+ * synchronisée comme après un upload Wi-Fi (curseur done) ; ERR sinon. */
+
+#define USB_FRAME_SYNC0     0xA5
+#define USB_FRAME_SYNC1     0x5A
+#define USB_FRAME_HDR       6
+#define USB_FRAME_OVERHEAD  (USB_FRAME_HDR + 4)
+#define USB_PROTO_VERSION   4
+#define USB_LIST_PAGE       32      // plongées par page de catalogue (JSON en RAM)
+
+typedef enum {
+    USB_F_HELLO = 0x01,
+    USB_F_LIST  = 0x02,
+    USB_F_GET   = 0x03,
+    USB_F_ACK   = 0x04,
+    USB_F_NAK   = 0x05,
+    USB_F_BYE   = 0x06,
+    USB_F_METRICS = 0x07,
+    USB_F_MARK  = 0x08,
+    USB_F_DATA  = 0x81,
+    USB_F_END   = 0x82,
+    USB_F_ERR   = 0x83,
+} usb_frame_type_t;
+
+typedef enum {
+    USB_ERR_NOT_FOUND = 1,
+    USB_ERR_IO        = 2,
+    USB_ERR_BAD_REQ   = 3,
+} usb_err_code_t;
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  seq;
+    uint16_t len;
+    uint8_t *payload;     // dans le tampon du parseur, valide jusqu'à la trame suivante
+} usb_frame_t;
+
+/** Écrit une trame complète dans out (cap >= len + USB_FRAME_OVERHEAD).
+ *  @return taille écrite, 0 si elle ne tient pas */
+size_t usb_frame_encode(uint8_t type, uint8_t seq, const void *payload, uint16_t len,
+                        uint8_t *out, size_t cap);
+
+/** En-tête d'une trame dont le payload est déjà en place à out + USB_FRAME_HDR
+ *  (DATA lu directement de la flash dans le tampon d'émission) ; ajoute le CRC.
+ *  @return taille totale */
+size_t usb_frame_seal(uint8_t type, uint8_t seq, uint16_t len, uint8_t *out);
+
+/* Parseur en flux : octets bruts en entrée, trames validées en sortie */
+typedef struct {
+    uint8_t *buf;
+    size_t   cap;         // payload max + USB_FRAME_OVERHEAD
+    size_t   n;           // octets accumulés
+    uint32_t bad_crc;     // trames rejetées (CRC)
+    uint32_t skipped;     // octets sautés pour se resynchroniser
+    bool     ready;       // trame rendue : tampon repris à l'appel suivant
+} usb_parser_t;
+
+void usb_parser_init(usb_parser_t *p, uint8_t *buf, size_t cap);
+
+/** Consomme au plus len octets de in. *used = octets consommés.
+ *  @return true si une trame est complète dans *f (rappeler avec le reste de in) */
+bool usb_parser_feed(usb_parser_t *p, const uint8_t *in, size_t len, size_t *used, usb_frame_t *f);
+
+static inline uint32_t usb_get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void usb_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
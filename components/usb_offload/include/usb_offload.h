@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Déchargement des plongées par le câble USB (USB-Serial-JTAG) quand un poste
+ * est branché : trames avec CRC et fenêtre d'acquittements (usb_frame.h),
+ * catalogue et <id>.csv lus directement du stockage. Récepteur : tools/usb_offload.py.
+ * Une plongée fermée reçue en entière est marquée synchronisée (MARK) : le
+ * Wi-Fi ne la renvoie pas et la rétention peut l'évincer. */
+
+typedef struct {
+    uint32_t files;        // transferts terminés (catalogue compris)
+    uint32_t bytes;        // octets utiles envoyés (première émission)
+    uint32_t resent;       // octets réémis (NAK, délai d'ACK)
+    uint32_t bad_frames;   // trames reçues rejetées (CRC, synchro)
+    uint32_t busy_ms;      // temps passé en transfert
+} usb_offload_stats_t;
+
+/** Un hôte USB est là et le récepteur a salué (HELLO) dans wait_ms : le lien
+ *  reste ouvert pour usb_offload_start(). false = chargeur seul ou pas de
+ *  récepteur, le lien est refermé (repli Wi-Fi). */
+bool usb_offload_probe(uint32_t wait_ms);
+
+/** Monte le stockage et démarre la tâche de service (job APP_JOB_UPLOAD) :
+ *  répond aux requêtes jusqu'au BYE ou à l'inactivité, ferme le lien puis
+ *  entretient la place (dive_space_maintain). Échec du montage : lien fermé */
+esp_err_t usb_offload_start(void);
+
+/** Bilan de la dernière session */
+void usb_offload_get_stats(usb_offload_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+#include "usb_frame.h"
+#include <string.h>
+#include "esp_rom_crc.h"
+
+static uint32_t frame_crc(const uint8_t *f, uint16_t len)
+{
+    // type, seq, len, payload : tout sauf la synchro
+    return esp_rom_crc32_le(0, f + 2, (uint32_t)(USB_FRAME_HDR - 2 + len));
+}
+
+size_t usb_frame_seal(uint8_t type, uint8_t seq, uint16_t len, uint8_t *out)
+{
+    out[0] = USB_FRAME_SYNC0;
+    out[1] = USB_FRAME_SYNC1;
+    out[2] = type;
+    out[3] = seq;
+    out[4] = (uint8_t)len;
+    out[5] = (uint8_t)(len >> 8);
+    usb_put32(out + USB_FRAME_HDR + len, frame_crc(out, len));
+    return (size_t)len + USB_FRAME_OVERHEAD;
+}
+
+size_t usb_frame_encode(uint8_t type, uint8_t seq, const void *payload, uint16_t len,
+                        uint8_t *out, size_t cap)
+{
+    if ((size_t)len + USB_FRAME_OVERHEAD > cap) return 0;
+    if (len) memmove(out + USB_FRAME_HDR, payload, len);
+    return usb_frame_seal(type, seq, len, out);
+}
+
+void usb_parser_init(usb_parser_t *p, uint8_t *buf, size_t cap)
+{
+    memset(p, 0, sizeof(*p));
+    p->buf = buf;
+    p->cap = cap;
+}
+
+bool usb_parser_feed(usb_parser_t *p, const uint8_t *in, size_t len, size_t *used, usb_frame_t *f)
+{
+    size_t i = 0;
+    if (p->ready) {                     // trame rendue à l'appel précédent
+        p->ready = false;
+        p->n = 0;
+    }
+    while (i < len) {
+        if (p->n < 2) {
+            uint8_t c = in[i++];
+            if (c == (p->n ? USB_FRAME_SYNC1 : USB_FRAME_SYNC0)) {
+                p->buf[p->n++] = c;
+            } else {
+                p->skipped += p->n + 1;
+                p->n = (c == USB_FRAME_SYNC0);   // A5 A5 5A : la seconde peut ouvrir la trame
+                if (p->n) { p->buf[0] = c; p->skipped--; }
+            }
+            continue;
+        }
+        size_t want = USB_FRAME_HDR;
+        if (p->n >= USB_FRAME_HDR) {
+            want = (size_t)(p->buf[4] | p->buf[5] << 8) + USB_FRAME_OVERHEAD;
+            if (want > p->cap) {        // longueur impossible : fausse synchro
+                p->skipped += p->n;
+                p->n = 0;
+                continue;
+            }
+        }
+        size_t k = want - p->n;
+        if (k > len - i) k = len - i;
+        memcpy(p->buf + p->n, in + i, k);
+        p->n += k;
+        i += k;
+        if (p->n < want || want == USB_FRAME_HDR) continue;
+
+        uint16_t flen = (uint16_t)(want - USB_FRAME_OVERHEAD);
+        if (usb_get32(p->buf + USB_FRAME_HDR + flen) != frame_crc(p->buf, flen)) {
+            p->bad_crc++;
+            p->n = 0;
+            continue;
+        }
+        f->type = p->buf[2];
+        f->seq = p->buf[3];
+        f->len = flen;
+        f->payload = p->buf + USB_FRAME_HDR;
+        p->ready = true;
+        *used = i;
+        return true;
+    }
+    *used = i;
+    return false;
+}
@@ -0,0 +1,470 @@
+#include "usb_offload.h"
+#include "usb_frame.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include "hal_usb.h"
+#include "app_jobs.h"
+#include "app_mem.h"
+#include "dive_storage.h"
+#include "dive_space.h"
+#include "led_status.h"
+#include "metrics.h"
+
+static const char *TAG = "usb_offload";
+
+/* Octets de données par trame DATA (plus 4 d'offset) */
+#ifndef CONFIG_APP_USB_FRAME
+#define CONFIG_APP_USB_FRAME 2048
+#endif
+/* Trames DATA en vol sans acquittement */
+#ifndef CONFIG_APP_USB_WINDOW
+#define CONFIG_APP_USB_WINDOW 8
+#endif
+#ifndef CONFIG_APP_USB_ACK_MS
+#define CONFIG_APP_USB_ACK_MS 250
+#endif
+#ifndef CONFIG_APP_USB_IDLE_S
+#define CONFIG_APP_USB_IDLE_S 10
+#endif
+
+// console secondaire sur le même port : le log s'intercalerait entre les trames
+#if !CONFIG_IDF_TARGET_LINUX && \
+    (CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG)
+#define USB_QUIET_LOG 1
+#endif
+
+#define USB_CMD_MAX     64              // plus grande trame hôte : GET/MARK (offset + id)
+#define USB_GIVE_UP     8               // délais d'ACK consécutifs avant abandon du transfert
+#define USB_ENUM_MS     500             // énumération après le réveil ; au-delà : chargeur seul
+
+static usb_offload_stats_t s_st;
+static uint8_t      s_tx[USB_FRAME_OVERHEAD + 4 + CONFIG_APP_USB_FRAME];
+static uint8_t      s_rx_buf[USB_FRAME_OVERHEAD + USB_CMD_MAX];
+static uint8_t      s_in[256];
+static size_t       s_in_len, s_in_pos;
+static usb_parser_t s_rx;
+static uint8_t      s_seq;
+static usb_frame_t  s_pending;          // commande reçue pendant un transfert, traitée ensuite
+static bool         s_has_pending;
+
+METRIC_COUNTER(s_m_bytes, "usb.bytes");
+METRIC_COUNTER(s_m_resent, "usb.resent");
+METRIC_GAUGE(s_m_kbps, "usb.kib_s");    // débit du dernier transfert de plongée
+
+/* Source d'un transfert : <id>.csv d'une plongée, ou catalogue JSON en RAM */
+typedef struct {
+    dive_data_t d;
+    const char *mem;
+    uint32_t    size;
+} src_t;
+
+static esp_err_t src_read(src_t *s, uint32_t off, void *buf, size_t len, size_t *n)
+{
+    if (!s->mem) return dive_storage_data_read(&s->d, off, buf, len, n);
+    *n = off < s->size ? (s->size - off < len ? s->size - off : len) : 0;
+    memcpy(buf, s->mem + off, *n);
+    return ESP_OK;
+}
+
+static esp_err_t send_frame(uint8_t type, const void *payload, uint16_t len)
+{
+    size_t n = usb_frame_encode(type, s_seq++, payload, len, s_tx, sizeof(s_tx));
+    return hal_usb_write(s_tx, n, CONFIG_APP_USB_ACK_MS) == (int)n ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void send_err(usb_err_code_t code, const char *msg)
+{
+    uint8_t p[40];
+    size_t len = strnlen(msg, sizeof(p) - 1);
+    p[0] = (uint8_t)code;
+    memcpy(p + 1, msg, len);
+    send_frame(USB_F_ERR, p, (uint16_t)(len + 1));
+}
+
+/** Prochaine trame de l'hôte (le tampon du parseur la garde jusqu'à l'appel suivant).
+ *  @return true = trame dans *f, false = délai écoulé */
+static bool next_frame(usb_frame_t *f, uint32_t timeout_ms)
+{
+    for (;;) {
+        if (s_in_pos < s_in_len) {
+            size_t used = 0;
+            uint32_t bad = s_rx.bad_crc;
+            bool got = usb_parser_feed(&s_rx, s_in + s_in_pos, s_in_len - s_in_pos, &used, f);
+            s_in_pos += used;
+            s_st.bad_frames += s_rx.bad_crc - bad;
+            if (got) return true;
+        }
+        int r = hal_usb_read(s_in, sizeof(s_in), timeout_ms);
+        if (r <= 0) return false;
+        s_in_len = (size_t)r;
+        s_in_pos = 0;
+        timeout_ms = 0;                 // déjà reçu quelque chose : on ne fait que vider
+    }
+}
+
+/* Garde une commande pour la boucle principale (copie hors du tampon du parseur) */
+static void keep_pending(const usb_frame_t *f)
+{
+    static uint8_t payload[USB_CMD_MAX];
+    s_pending = *f;
+    s_pending.len = f->len < sizeof(payload) ? f->len : sizeof(payload);
+    memcpy(payload, f->payload, s_pending.len);
+    s_pending.payload = payload;
+    s_has_pending = true;
+}
+
+/** Envoie [start, size) par fenêtre ; les ACK/NAK de l'hôte règlent la reprise.
+ *  Une autre commande de l'hôte interrompt le transfert (gardée en attente). */
+static esp_err_t transfer(src_t *s, uint32_t start)
+{
+    const uint32_t chunk = CONFIG_APP_USB_FRAME;
+    const uint32_t window = CONFIG_APP_USB_WINDOW * chunk;
+    // crc_off : fin de la première émission (les octets avant sont déjà comptés au CRC)
+    uint32_t sent = start, acked = start, crc_off = start, crc = 0, nak_off = UINT32_MAX;
+    int64_t t0 = esp_timer_get_time(), t_ack = t0;
+    int stalls = 0;
+
+    while (acked < s->size) {
+        // fenêtre ouverte : trames DATA lues de la source directement dans le tampon d'émission
+        if (sent < s->size && sent - acked < window) {
+            uint8_t *p = s_tx + USB_FRAME_HDR;
+            size_t n = 0;
+            uint32_t want = s->size - sent < chunk ? s->size - sent : chunk;
+            esp_err_t e = src_read(s, sent, p + 4, want, &n);
+            if (e != ESP_OK || n == 0) {
+                send_err(USB_ERR_IO, "read");
+                return e != ESP_OK ? e : ESP_FAIL;
+            }
+            usb_put32(p, sent);
+            size_t len = usb_frame_seal(USB_F_DATA, s_seq++, (uint16_t)(n + 4), s_tx);
+            if (hal_usb_write(s_tx, len, CONFIG_APP_USB_ACK_MS) != (int)len) return ESP_ERR_TIMEOUT;
+            if (sent == crc_off) {
+                crc = esp_rom_crc32_le(crc, p + 4, (uint32_t)n);
+                crc_off += (uint32_t)n;
+                s_st.bytes += (uint32_t)n;
+                metric_add(&s_m_bytes, (uint32_t)n);
+            } else {
+                s_st.resent += (uint32_t)n;
+                metric_add(&s_m_resent, (uint32_t)n);
+            }
+            sent += (uint32_t)n;
+        }
+
+        // fenêtre pleine (ou tout envoyé) : on attend l'hôte ; sinon on ne fait que vider l'entrée
+        bool full = sent >= s->size || sent - acked >= window;
+        usb_frame_t f;
+        while (next_frame(&f, full ? CONFIG_APP_USB_ACK_MS : 0)) {
+            uint32_t off = f.len >= 4 ? usb_get32(f.payload) : 0;
+            if (f.type == USB_F_ACK || f.type == USB_F_NAK) {
+                if (f.len < 4 || off < acked || off > crc_off) continue;   // périmé
+                if (off > acked) {
+                    acked = off;
+                    t_ack = esp_timer_get_time();
+                    stalls = 0;
+                }
+                if (sent < acked) sent = acked;          // ACK tardif après un retour arrière
+                // trou : go-back-N, une fois par trou (les trames déjà en vol en redemandent)
+                if (f.type == USB_F_NAK && off != nak_off) {
+                    sent = acked;
+                    nak_off = off;
+                }
+            } else {
+                keep_pending(&f);
+                return ESP_ERR_INVALID_STATE;
+            }
+            full = sent >= s->size || sent - acked >= window;
+            if (!full || acked >= s->size) break;
+        }
+        if (full && acked < s->size && esp_timer_get_time() - t_ack > (int64_t)CONFIG_APP_USB_ACK_MS * 1000) {
+            // plus d'ACK : trames (ou ACK) perdues, on repart du dernier acquittement
+            if (++stalls > USB_GIVE_UP) return ESP_ERR_TIMEOUT;
+            sent = acked;
+            t_ack = esp_timer_get_time();
+        }
+        app_jobs_progress(APP_JOB_UPLOAD);
+    }
+
+    uint8_t end[8];
+    usb_put32(end, s->size);
+    usb_put32(end + 4, crc);
+    s_st.files++;
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    s_st.busy_ms += ms;
+    if (!s->mem && ms) metric_set(&s_m_kbps, (int32_t)((s->size - start) / ms * 1000 / 1024));
+    return send_frame(USB_F_END, end, sizeof(end));
+}
+
+/* Une page du catalogue : un objet par plongée (métadonnées + "bytes"), comme GET /dives en HTTP */
+static char *build_catalog(const dive_filter_t *f)
+{
+    cJSON *arr = cJSON_CreateArray();
+    if (!arr) return NULL;
+    dive_iter_t it;
+    dive_iter_init(&it, f);
+    char id[32];
+    dive_metadata_t m;
+    while (dive_iter_next(&it, id, &m) == ESP_OK) {
+        cJSON *o = cJSON_CreateObject();
+        if (!o) break;
+        dive_storage_meta_to_json(&m, o);
+        dive_data_t d;
+        if (dive_storage_data_open(id, &d) == ESP_OK) {
+            cJSON_AddNumberToObject(o, "bytes", d.size);
+            dive_storage_data_close(&d);
+        }
+        dive_cursor_t c;
+        cJSON_AddBoolToObject(o, "synced", dive_storage_load_cursor(id, &c) == ESP_OK && c.done);
+        cJSON_AddItemToArray(arr, o);
+    }
+    char *txt = cJSON_PrintUnformatted(arr);
+    cJSON_Delete(arr);
+    return txt;
+}
+
+static void serve_list(const usb_frame_t *f)
+{
+    uint32_t off = f->len >= 4 ? usb_get32(f->payload) : 0;
+    dive_filter_t flt = { .limit = USB_LIST_PAGE };
+    if (f->len >= 6) {
+        uint16_t n = (uint16_t)(f->payload[4] | f->payload[5] << 8);
+        if (n && n < flt.limit) flt.limit = n;
+        size_t len = f->len - 6;
+        if (len >= sizeof(flt.start_after)) {
+            send_err(USB_ERR_BAD_REQ, "id");
+            return;
+        }
+        memcpy(flt.start_after, f->payload + 6, len);
+    }
+    char *cat = build_catalog(&flt);
+    if (!cat) {
+        send_err(USB_ERR_IO, "catalog");
+        return;
+    }
+    src_t s = { .mem = cat, .size = (uint32_t)strlen(cat) };
+    if (off <= s.size) transfer(&s, off);
+    else send_err(USB_ERR_BAD_REQ, "offset");
+    free(cat);
+}
+
+/* id d'une requête GET/MARK (après l'offset) : alphanumérique, '-' ou '_',
+ * comme pour le serveur HTTP (pas de '/' ni de '..' vers un autre fichier) */
+static bool frame_id(const usb_frame_t *f, char id[32])
+{
+    size_t len = f->len > 4 ? f->len - 4 : 0;
+    if (len == 0 || len >= 32) return false;
+    for (size_t i = 0; i < len; ++i) {
+        char c = (char)f->payload[4 + i];
+        if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+    }
+    memcpy(id, f->payload + 4, len);
+    id[len] = '\0';
+    return true;
+}
+
+static void serve_get(const usb_frame_t *f)
+{
+    char id[32];
+    if (!frame_id(f, id)) {
+        send_err(USB_ERR_BAD_REQ, "id");
+        return;
+    }
+    uint32_t off = usb_get32(f->payload);
+
+    src_t s = { 0 };
+    if (dive_storage_data_open(id, &s.d) != ESP_OK) {
+        send_err(USB_ERR_NOT_FOUND, id);
+        return;
+    }
+    s.size = s.d.size;
+    if (off > s.size) {
+        send_err(USB_ERR_BAD_REQ, "offset");
+    } else {
+        esp_err_t e = transfer(&s, off);
+        if (e != ESP_OK && e != ESP_ERR_INVALID_STATE)
+            ESP_LOGW(TAG, "%s: %s", id, esp_err_to_name(e));
+    }
+    dive_storage_data_close(&s.d);
+}
+
+/* L'hôte a reçu toute la plongée (END, CRC vérifié) : curseur de synchro à la
+ * fin, comme après le dernier bloc acquitté en Wi-Fi. Sans cela la plongée
+ * resterait en attente : renvoyée au serveur et jamais évincée */
+static void serve_mark(const usb_frame_t *f)
+{
+    char id[32];
+    if (!frame_id(f, id)) {
+        send_err(USB_ERR_BAD_REQ, "id");
+        return;
+    }
+    uint32_t size = usb_get32(f->payload);
+
+    dive_metadata_t m;
+    dive_data_t d;
+    if (dive_storage_read_metadata(id, &m) != ESP_OK || dive_storage_data_open(id, &d) != ESP_OK) {
+        send_err(USB_ERR_NOT_FOUND, id);
+        return;
+    }
+    uint32_t have = d.size;
+    dive_storage_data_close(&d);
+    if (!m.has_summary) {
+        send_err(USB_ERR_BAD_REQ, "open");     // plongée en cours : la suite viendra
+        return;
+    }
+    if (size != have) {
+        send_err(USB_ERR_BAD_REQ, "size");     // l'hôte n'a pas tout
+        return;
+    }
+
+    dive_cursor_t c;
+    esp_err_t e = dive_storage_seek_samples(id, UINT32_MAX, &c);
+    if (e == ESP_OK) {
+        c.done = true;
+        e = dive_storage_save_cursor(id, &c);
+    }
+    if (e != ESP_OK) {
+        send_err(USB_ERR_IO, "cursor");
+        return;
+    }
+    ESP_LOGI(TAG, "%s marked synced (%u samples)", id, (unsigned)c.acked);
+    uint8_t end[8];
+    usb_put32(end, have);
+    usb_put32(end + 4, c.acked);
+    send_frame(USB_F_END, end, sizeof(end));
+}
+
+/* Métriques à la demande, sans attendre le prochain upload */
+static void serve_metrics(const usb_frame_t *f)
+{
+    uint32_t off = f->len >= 4 ? usb_get32(f->payload) : 0;
+    cJSON *m = metrics_to_json();
+    char *txt = m ? cJSON_PrintUnformatted(m) : NULL;
+    cJSON_Delete(m);
+    if (!txt) {
+        send_err(USB_ERR_IO, "metrics");
+        return;
+    }
+    src_t s = { .mem = txt, .size = (uint32_t)strlen(txt) };
+    if (off <= s.size) transfer(&s, off);
+    else send_err(USB_ERR_BAD_REQ, "offset");
+    free(txt);
+}
+
+static void send_hello(void)
+{
+    uint8_t p[4] = { USB_PROTO_VERSION, CONFIG_APP_USB_WINDOW,
+                     (uint8_t)CONFIG_APP_USB_FRAME, (uint8_t)(CONFIG_APP_USB_FRAME >> 8) };
+    send_frame(USB_F_HELLO, p, sizeof(p));
+}
+
+/* Fin de session : le port redevient console */
+static void close_link(void)
+{
+    hal_usb_close();
+#if USB_QUIET_LOG
+    esp_log_level_set("*", CONFIG_LOG_DEFAULT_LEVEL);
+#endif
+}
+
+static void offload_task(void *arg)
+{
+    led_status_set(LED_STATUS_UPLOAD);
+    int64_t seen = esp_timer_get_time();
+    bool bye = false;
+    while (!bye && esp_timer_get_time() - seen < (int64_t)CONFIG_APP_USB_IDLE_S * 1000000) {
+        usb_frame_t f;
+        if (s_has_pending) {
+            f = s_pending;
+            s_has_pending = false;
+        } else if (!next_frame(&f, 500)) {
+            continue;
+        }
+        seen = esp_timer_get_time();
+        app_jobs_progress(APP_JOB_UPLOAD);
+        switch (f.type) {
+            case USB_F_HELLO: send_hello(); break;
+            case USB_F_LIST:  serve_list(&f); break;
+            case USB_F_GET:   serve_get(&f); break;
+            case USB_F_METRICS: serve_metrics(&f); break;
+            case USB_F_MARK:  serve_mark(&f); break;
+            case USB_F_BYE:   bye = true; break;
+            default:          break;    // ACK/NAK d'un transfert terminé
+        }
+        seen = esp_timer_get_time();
+    }
+    close_link();
+    ESP_LOGI(TAG, "%s: files=%u bytes=%u resent=%u bad=%u busy=%ums", bye ? "bye" : "idle",
+             (unsigned)s_st.files, (unsigned)s_st.bytes, (unsigned)s_st.resent,
+             (unsigned)s_st.bad_frames, (unsigned)s_st.busy_ms);
+    // comme après un upload Wi-Fi : les plongées marquées (MARK) peuvent être évincées
+    app_jobs_progress(APP_JOB_UPLOAD);
+    dive_space_maintain(NULL);
+    led_status_set(LED_STATUS_OFF);
+    app_jobs_done(APP_JOB_UPLOAD);
+    app_task_exit();
+}
+
+bool usb_offload_probe(uint32_t wait_ms)
+{
+    const int64_t t0 = esp_timer_get_time();
+    // le port est ré-énuméré après le deep sleep : quelques centaines de ms
+    while (!hal_usb_host_present()) {
+        if (esp_timer_get_time() - t0 >= (int64_t)USB_ENUM_MS * 1000) return false;
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    const int64_t deadline = t0 + (int64_t)wait_ms * 1000;
+    if (hal_usb_open(1024, 4 * sizeof(s_tx)) != ESP_OK) return false;
+    usb_parser_init(&s_rx, s_rx_buf, sizeof(s_rx_buf));
+    s_in_len = s_in_pos = 0;
+    s_has_pending = false;
+    memset(&s_st, 0, sizeof(s_st));
+
+    // le récepteur répète HELLO jusqu'à la réponse
+    while (esp_timer_get_time() < deadline) {
+        usb_frame_t f;
+        if (!next_frame(&f, 100) || f.type != USB_F_HELLO) continue;
+#if USB_QUIET_LOG
+        esp_log_level_set("*", ESP_LOG_NONE);
+#endif
+        send_hello();
+        return true;
+    }
+    hal_usb_close();
+    return false;
+}
+
+esp_err_t usb_offload_start(void)
+{
+    static bool registered;
+    if (!registered) {
+        app_mem_account("usb_offload", sizeof(s_tx) + sizeof(s_rx_buf) + sizeof(s_in));
+        metrics_register(&s_m_bytes.m);
+        metrics_register(&s_m_resent.m);
+        metrics_register(&s_m_kbps.m);
+        registered = true;
+    }
+    // réveil VBUS : ni app_dive ni dive_sync n'ont monté le FS sur ce chemin
+    esp_err_t e = dive_storage_init();
+    if (e == ESP_OK) {
+        APP_TASK_MEM(task_mem, 4096);
+        e = app_task_create(offload_task, "usb_offload", &task_mem, NULL, APP_ROLE_NET, NULL);
+    }
+    if (e != ESP_OK) {
+        close_link();
+        ESP_LOGE(TAG, "start: %s", esp_err_to_name(e));
+    }
+    return e;
+}
+
+void usb_offload_get_stats(usb_offload_stats_t *st)
+{
+    if (st) *st = s_st;
+}
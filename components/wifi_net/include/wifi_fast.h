@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Reconnexion rapide : le dernier point d'accès (BSSID, canal) et le bail DHCP
+ * sont gardés en RTC ; la connexion suivante vise directement ce BSSID sur ce
+ * canal, avec l'adresse du bail, puis retombe sur un scan complet + DHCP.
+ * Logique pure (pas d'appel esp_wifi) : wifi_net.c traduit les événements du
+ * driver en wifi_ev_t et applique les actions rendues, un banc hôte peut
+ * rejouer une séquence d'événements simulée. */
+
+typedef struct {
+    uint32_t ip, netmask, gw, dns;   // ordre réseau, comme esp_ip4_addr_t
+} wifi_lease_t;
+
+typedef struct {
+    uint32_t     magic;
+    uint32_t     cred;               // CRC de SSID + mot de passe : change de réseau = cache invalide
+    uint8_t      bssid[6];
+    uint8_t      channel;
+    uint8_t      has_lease;
+    wifi_lease_t lease;
+    int64_t      lease_t;            // obtention du bail (s, horloge système, tient le deep sleep)
+    uint32_t     crc;
+} wifi_cache_t;
+
+typedef enum {
+    WIFI_PHASE_IDLE = 0,
+    WIFI_PHASE_FAST,                 // BSSID + canal imposés, bail réutilisé si frais
+    WIFI_PHASE_SCAN,                 // scan complet + DHCP
+    WIFI_PHASE_DHCP,                 // associé, bail attendu (l'échéance rapide ne compte plus)
+    WIFI_PHASE_UP,
+    WIFI_PHASE_FAILED,
+} wifi_phase_t;
+
+typedef enum {
+    WIFI_EV_START = 0,               // driver démarré
+    WIFI_EV_CONNECTED,               // associé : bssid, channel
+    WIFI_EV_GOT_IP,                  // lease
+    WIFI_EV_DISCONNECTED,            // reason
+    WIFI_EV_TIMEOUT,                 // échéance de la phase en cours
+} wifi_ev_kind_t;
+
+typedef struct {
+    wifi_ev_kind_t kind;
+    uint8_t        bssid[6];
+    uint8_t        channel;
+    uint8_t        reason;
+    wifi_lease_t   lease;
+} wifi_ev_t;
+
+typedef enum {
+    WIFI_ACT_NONE = 0,
+    WIFI_ACT_CONNECT,                // esp_wifi_connect() avec la config courante
+    WIFI_ACT_RESCAN,                 // config sans BSSID, DHCP relancé, puis connect
+    WIFI_ACT_FALLBACK,               // idem, la phase rapide a échoué (wifi.fast_miss)
+    WIFI_ACT_UP,                     // connecté, IP utilisable
+    WIFI_ACT_GIVE_UP,
+} wifi_act_t;
+
+typedef struct {
+    wifi_phase_t  phase;
+    wifi_cache_t *cache;
+    uint32_t      cred;
+    bool          fixed_ip;          // IP statique du menuconfig : jamais de DHCP
+    bool          lease_used;        // phase rapide avec le bail du cache (pas de DHCP)
+    bool          fast;              // association obtenue en phase rapide
+    uint8_t       bssid[6];          // association en cours
+    uint8_t       channel;
+} wifi_fsm_t;
+
+/** CRC identifiant les identifiants Wi-Fi (clé du cache) */
+uint32_t wifi_fast_cred(const char *ssid, const char *pass);
+
+/** Cache utilisable pour ces identifiants (magic, CRC, clé) */
+bool wifi_fast_cache_valid(const wifi_cache_t *c, uint32_t cred);
+
+/** Bail réutilisable : présent et obtenu il y a moins de max_age_s */
+bool wifi_fast_lease_fresh(const wifi_cache_t *c, int64_t now_s, uint32_t max_age_s);
+
+/** Oublie le point d'accès et le bail */
+void wifi_fast_cache_clear(wifi_cache_t *c);
+
+/** Début de connexion : phase FAST si le cache est valide, sinon SCAN.
+ *  lease_ok : le bail du cache peut servir d'adresse statique. */
+wifi_phase_t wifi_fast_begin(wifi_fsm_t *f, wifi_cache_t *cache, uint32_t cred,
+                             bool fixed_ip, bool lease_ok);
+
+/** Un événement ; now_s sert à dater le bail enregistré */
+wifi_act_t wifi_fast_event(wifi_fsm_t *f, const wifi_ev_t *ev, int64_t now_s);
+
+/** Échéance d'attente : fin de la tentative directe (final false, sans effet une
+ *  fois associé) ou abandon (final true : scan ou DHCP en cours) */
+wifi_act_t wifi_fast_timeout(wifi_fsm_t *f, bool final, int64_t now_s);
+
+#ifdef __cplusplus
+}
+#endif
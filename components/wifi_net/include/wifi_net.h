@@ -10,7 +10,9 @@ extern "C" {
 /** Initialise netif, event loop, driver Wi-Fi (mode STA). */
 esp_err_t wifi_net_init(void);
 
-/** Démarre le Wi-Fi STA et tente la connexion.
+/** Démarre le Wi-Fi STA et tente la connexion : directe vers le dernier point
+ * d'accès (cache RTC, cf. wifi_fast.h) puis scan complet. Durée dans la
+ * métrique wifi.connect_ms, succès/échecs du raccourci dans wifi.fast_ok/miss.
  * @param timeout_ms  Delai max (ex: 10000). 0 = non bloquant.
  * @return ESP_OK si connecté, ESP_ERR_TIMEOUT si délai, autre code sinon.
  */
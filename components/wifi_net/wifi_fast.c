@@ -0,0 +1,158 @@
+#include "wifi_fast.h"
+#include <stddef.h>
+#include <string.h>
+#include "esp_rom_crc.h"
+
+#define WIFI_CACHE_MAGIC 0x57464331u   // "WFC1"
+
+static uint32_t cache_crc(const wifi_cache_t *c)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)c, offsetof(wifi_cache_t, crc));
+}
+
+uint32_t wifi_fast_cred(const char *ssid, const char *pass)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)ssid, strlen(ssid) + 1);
+    return esp_rom_crc32_le(crc, (const uint8_t *)pass, strlen(pass));
+}
+
+bool wifi_fast_cache_valid(const wifi_cache_t *c, uint32_t cred)
+{
+    return c->magic == WIFI_CACHE_MAGIC && c->cred == cred && c->channel
+        && c->crc == cache_crc(c);
+}
+
+bool wifi_fast_lease_fresh(const wifi_cache_t *c, int64_t now_s, uint32_t max_age_s)
+{
+    // horloge remise à zéro (cold boot sans RTC) : âge négatif, bail écarté
+    return c->has_lease && c->lease.ip && now_s >= c->lease_t
+        && now_s - c->lease_t < (int64_t)max_age_s;
+}
+
+void wifi_fast_cache_clear(wifi_cache_t *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+/* Association réussie : point d'accès (et bail DHCP neuf) mémorisés */
+static void cache_store(wifi_fsm_t *f, const wifi_lease_t *fresh, int64_t now_s)
+{
+    wifi_cache_t *c = f->cache;
+    wifi_cache_t keep = *c;
+    bool keep_lease = f->lease_used && keep.has_lease;
+
+    memset(c, 0, sizeof(*c));
+    c->magic = WIFI_CACHE_MAGIC;
+    c->cred = f->cred;
+    memcpy(c->bssid, f->bssid, sizeof(c->bssid));
+    c->channel = f->channel;
+    if (fresh) {
+        c->has_lease = 1;
+        c->lease = *fresh;
+        c->lease_t = now_s;
+    } else if (keep_lease) {
+        // bail réutilisé tel quel : son âge court toujours depuis le DHCP
+        c->has_lease = 1;
+        c->lease = keep.lease;
+        c->lease_t = keep.lease_t;
+    }
+    c->crc = cache_crc(c);
+}
+
+wifi_phase_t wifi_fast_begin(wifi_fsm_t *f, wifi_cache_t *cache, uint32_t cred,
+                             bool fixed_ip, bool lease_ok)
+{
+    memset(f, 0, sizeof(*f));
+    f->cache = cache;
+    f->cred = cred;
+    f->fixed_ip = fixed_ip;
+    if (wifi_fast_cache_valid(cache, cred)) {
+        f->phase = WIFI_PHASE_FAST;
+        f->lease_used = !fixed_ip && lease_ok;
+    } else {
+        wifi_fast_cache_clear(cache);
+        f->phase = WIFI_PHASE_SCAN;
+    }
+    return f->phase;
+}
+
+/* Phase rapide ratée : le cache ne resservira pas, scan complet + DHCP */
+static wifi_act_t fall_back(wifi_fsm_t *f)
+{
+    wifi_fast_cache_clear(f->cache);
+    f->phase = WIFI_PHASE_SCAN;
+    f->lease_used = false;
+    f->fast = false;
+    return WIFI_ACT_FALLBACK;
+}
+
+wifi_act_t wifi_fast_event(wifi_fsm_t *f, const wifi_ev_t *ev, int64_t now_s)
+{
+    bool trying = f->phase == WIFI_PHASE_FAST || f->phase == WIFI_PHASE_SCAN;
+
+    switch (ev->kind) {
+    case WIFI_EV_START:
+        return trying ? WIFI_ACT_CONNECT : WIFI_ACT_NONE;
+
+    case WIFI_EV_CONNECTED:
+        if (!trying) return WIFI_ACT_NONE;
+        memcpy(f->bssid, ev->bssid, sizeof(f->bssid));
+        f->channel = ev->channel;
+        f->fast = f->phase == WIFI_PHASE_FAST;
+        if (!f->lease_used && !f->fixed_ip) {
+            // associé : la tentative directe a abouti, le DHCP a le reste du délai
+            f->phase = WIFI_PHASE_DHCP;
+            return WIFI_ACT_NONE;
+        }
+        // adresse déjà posée : utilisable dès l'association
+        cache_store(f, NULL, now_s);
+        f->phase = WIFI_PHASE_UP;
+        return WIFI_ACT_UP;
+
+    case WIFI_EV_GOT_IP:
+        // hors attente du bail : ex. annonce de l'adresse statique après UP
+        if (f->phase != WIFI_PHASE_DHCP) return WIFI_ACT_NONE;
+        cache_store(f, &ev->lease, now_s);
+        f->phase = WIFI_PHASE_UP;
+        return WIFI_ACT_UP;
+
+    case WIFI_EV_DISCONNECTED:
+        if (f->phase == WIFI_PHASE_FAST) return fall_back(f);
+        if (f->phase == WIFI_PHASE_SCAN) return WIFI_ACT_CONNECT;
+        if (f->phase == WIFI_PHASE_DHCP) {
+            // perdu avant le bail : une association directe sans suite compte comme ratée
+            if (f->fast) return fall_back(f);
+            f->phase = WIFI_PHASE_SCAN;
+            return WIFI_ACT_CONNECT;
+        }
+        if (f->phase == WIFI_PHASE_UP) {
+            // perte en cours de passage : on retente, sans s'accrocher au BSSID imposé
+            bool was_fast = f->fast;
+            f->phase = WIFI_PHASE_SCAN;
+            f->fast = false;
+            if (!was_fast) return WIFI_ACT_CONNECT;
+            f->lease_used = false;
+            return WIFI_ACT_RESCAN;
+        }
+        return WIFI_ACT_NONE;
+
+    case WIFI_EV_TIMEOUT:
+        if (f->phase == WIFI_PHASE_FAST) return fall_back(f);
+        if (f->phase == WIFI_PHASE_SCAN || f->phase == WIFI_PHASE_DHCP) {
+            f->phase = WIFI_PHASE_FAILED;
+            return WIFI_ACT_GIVE_UP;
+        }
+        return WIFI_ACT_NONE;
+    }
+    return WIFI_ACT_NONE;
+}
+
+wifi_act_t wifi_fast_timeout(wifi_fsm_t *f, bool final, int64_t now_s)
+{
+    // échéance arrivée après un changement de phase : sans objet
+    bool due = final ? f->phase == WIFI_PHASE_SCAN || f->phase == WIFI_PHASE_DHCP
+                     : f->phase == WIFI_PHASE_FAST;
+    if (!due) return WIFI_ACT_NONE;
+    const wifi_ev_t ev = { .kind = WIFI_EV_TIMEOUT };
+    return wifi_fast_event(f, &ev, now_s);
+}
@@ -1,31 +1,193 @@
 #include "wifi_net.h"
+#include "wifi_fast.h"
 #include <string.h>
+#include <time.h>
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "app_mem.h"
+#include "metrics.h"
 
 static const char *TAG = "wifi_net";
 
+/* Délai de la tentative directe (BSSID + canal du cache) avant le scan complet */
+#ifndef CONFIG_APP_WIFI_FAST_TIMEOUT_MS
+#define CONFIG_APP_WIFI_FAST_TIMEOUT_MS 1500
+#endif
+/* Âge max. d'un bail DHCP réutilisé sans redemander (0 = toujours DHCP) */
+#ifndef CONFIG_APP_WIFI_LEASE_REUSE_S
+#define CONFIG_APP_WIFI_LEASE_REUSE_S 1800
+#endif
+#ifndef CONFIG_APP_WIFI_STATIC_IP
+#define CONFIG_APP_WIFI_STATIC_IP ""
+#define CONFIG_APP_WIFI_STATIC_GW ""
+#define CONFIG_APP_WIFI_STATIC_NETMASK "255.255.255.0"
+#define CONFIG_APP_WIFI_STATIC_DNS ""
+#endif
+
 static EventGroupHandle_t s_evt;
 #define WIFI_CONNECTED_BIT BIT0
+#define WIFI_FAIL_BIT      BIT1
 
 static bool s_inited = false;
 static bool s_started = false;
+static esp_netif_t *s_netif;
+
+/* Dernier point d'accès et bail : survivent au deep sleep, perdus au cold boot */
+static RTC_DATA_ATTR wifi_cache_t s_cache;
+static wifi_fsm_t   s_fsm;                 // partagé tâche appelante / boucle d'événements
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t      s_t0;                  // début de wifi_net_connect (us)
+static uint32_t     s_last_ms;
+
+METRIC_HISTO(s_m_connect, "wifi.connect_ms");
+METRIC_COUNTER(s_m_fast_ok, "wifi.fast_ok");
+METRIC_COUNTER(s_m_fast_miss, "wifi.fast_miss");
+
+static bool fixed_ip(void)
+{
+    return CONFIG_APP_WIFI_STATIC_IP[0] != '\0';
+}
+
+static wifi_lease_t fixed_lease(void)
+{
+    wifi_lease_t l = {
+        .ip      = esp_ip4addr_aton(CONFIG_APP_WIFI_STATIC_IP),
+        .netmask = esp_ip4addr_aton(CONFIG_APP_WIFI_STATIC_NETMASK),
+        .gw      = esp_ip4addr_aton(CONFIG_APP_WIFI_STATIC_GW),
+        .dns     = esp_ip4addr_aton(CONFIG_APP_WIFI_STATIC_DNS),
+    };
+    if (!l.dns) l.dns = l.gw;
+    return l;
+}
+
+/* Adresse posée à la main (IP fixe ou bail du cache) : DHCP arrêté */
+static void ip_static(const wifi_lease_t *l)
+{
+    esp_netif_dhcpc_stop(s_netif);          // ALREADY_STOPPED sans importance
+    esp_netif_ip_info_t info = { 0 };
+    info.ip.addr = l->ip;
+    info.netmask.addr = l->netmask;
+    info.gw.addr = l->gw;
+    esp_netif_set_ip_info(s_netif, &info);
+    if (l->dns) {
+        esp_netif_dns_info_t dns = { 0 };
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4.addr = l->dns;
+        esp_netif_set_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+}
+
+static void ip_dhcp(void)
+{
+    if (fixed_ip()) {
+        wifi_lease_t l = fixed_lease();
+        ip_static(&l);
+    } else {
+        esp_netif_dhcpc_start(s_netif);     // ALREADY_STARTED sans importance
+    }
+}
+
+/* Config STA : directe (BSSID + canal du cache) ou scan complet */
+static esp_err_t sta_config(bool direct)
+{
+    wifi_config_t sta = {0};
+    strlcpy((char*)sta.sta.ssid,     CONFIG_APP_WIFI_SSID, sizeof(sta.sta.ssid));
+    strlcpy((char*)sta.sta.password, CONFIG_APP_WIFI_PASS, sizeof(sta.sta.password));
+    sta.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    if (direct) {
+        sta.sta.bssid_set = true;
+        memcpy(sta.sta.bssid, s_cache.bssid, sizeof(sta.sta.bssid));
+        sta.sta.channel = s_cache.channel;
+    }
+    return esp_wifi_set_config(WIFI_IF_STA, &sta);
+}
+
+static void up(void)
+{
+    s_last_ms = (uint32_t)((esp_timer_get_time() - s_t0) / 1000);
+    metric_observe(&s_m_connect, s_last_ms);
+    if (s_fsm.fast) metric_inc(&s_m_fast_ok);
+    xEventGroupSetBits(s_evt, WIFI_CONNECTED_BIT);
+}
+
+/* Action rendue par wifi_fast, appliquée hors section critique */
+static void apply(wifi_act_t act, bool from_timeout)
+{
+    switch (act) {
+    case WIFI_ACT_CONNECT:
+        esp_wifi_connect();
+        break;
+    case WIFI_ACT_FALLBACK:
+        ESP_LOGW(TAG, "fast connect missed, full scan");
+        metric_inc(&s_m_fast_miss);
+        // fall through
+    case WIFI_ACT_RESCAN:
+        if (from_timeout) esp_wifi_disconnect();
+        sta_config(false);
+        ip_dhcp();
+        esp_wifi_connect();
+        break;
+    case WIFI_ACT_UP:
+        up();
+        break;
+    case WIFI_ACT_GIVE_UP:
+        xEventGroupSetBits(s_evt, WIFI_FAIL_BIT);
+        break;
+    case WIFI_ACT_NONE:
+        break;
+    }
+}
+
+/* Échéance d'attente : fin de la tentative directe (final false) ou abandon
+ * (scan, DHCP) ; ignorée si la machine a déjà quitté ces phases entre-temps */
+static void timeout(bool final)
+{
+    taskENTER_CRITICAL(&s_lock);
+    wifi_act_t act = wifi_fast_timeout(&s_fsm, final, (int64_t)time(NULL));
+    taskEXIT_CRITICAL(&s_lock);
+    apply(act, true);
+}
 
 static void handler(void* arg, esp_event_base_t base, int32_t id, void* data)
 {
+    wifi_ev_t ev = { 0 };
     if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
+        ev.kind = WIFI_EV_START;
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        const wifi_event_sta_connected_t *c = data;
+        ev.kind = WIFI_EV_CONNECTED;
+        memcpy(ev.bssid, c->bssid, sizeof(ev.bssid));
+        ev.channel = c->channel;
     } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
-        // On retente, tant que starté
-        if (s_started) esp_wifi_connect();
+        const wifi_event_sta_disconnected_t *d = data;
+        xEventGroupClearBits(s_evt, WIFI_CONNECTED_BIT);
+        // On retente (ou on bascule sur le scan), tant que starté
+        if (!s_started) return;
+        ev.kind = WIFI_EV_DISCONNECTED;
+        ev.reason = d->reason;
     } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
-        xEventGroupSetBits(s_evt, WIFI_CONNECTED_BIT);
+        const ip_event_got_ip_t *g = data;
+        esp_netif_dns_info_t dns = { 0 };
+        esp_netif_get_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns);
+        ev.kind = WIFI_EV_GOT_IP;
+        ev.lease.ip = g->ip_info.ip.addr;
+        ev.lease.netmask = g->ip_info.netmask.addr;
+        ev.lease.gw = g->ip_info.gw.addr;
+        ev.lease.dns = dns.ip.u_addr.ip4.addr;
+    } else {
+        return;
     }
+    taskENTER_CRITICAL(&s_lock);
+    wifi_act_t act = wifi_fast_event(&s_fsm, &ev, (int64_t)time(NULL));
+    taskEXIT_CRITICAL(&s_lock);
+    apply(act, false);
 }
 
 esp_err_t wifi_net_init(void)
@@ -35,7 +197,7 @@ esp_err_t wifi_net_init(void)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default()); // idempotent si déjà créé
 
-    esp_netif_create_default_wifi_sta();
+    s_netif = esp_netif_create_default_wifi_sta();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_RETURN_ON_ERROR(esp_wifi_init(&cfg), TAG, "wifi_init");
@@ -45,35 +207,86 @@ esp_err_t wifi_net_init(void)
     ESP_RETURN_ON_ERROR(esp_event_handler_instance_register(
         IP_EVENT, IP_EVENT_STA_GOT_IP, &handler, NULL, NULL), TAG, "reg_ip");
 
+#if CONFIG_APP_STATIC_ALLOC
+    static StaticEventGroup_t evt_buf;
+    s_evt = xEventGroupCreateStatic(&evt_buf);
+    app_mem_account("wifi_net", sizeof(evt_buf));
+#else
     s_evt = xEventGroupCreate();
+    if (!s_evt) return ESP_ERR_NO_MEM;
+#endif
+    metrics_register(&s_m_connect.m);
+    metrics_register(&s_m_fast_ok.m);
+    metrics_register(&s_m_fast_miss.m);
     s_inited = true;
     return ESP_OK;
 }
 
+/* (Re)lance la machine : tentative directe si le cache le permet, sinon scan */
+static esp_err_t attempt(void)
+{
+#if !CONFIG_APP_WIFI_FAST_CONNECT
+    wifi_fast_cache_clear(&s_cache);
+#endif
+    uint32_t cred = wifi_fast_cred(CONFIG_APP_WIFI_SSID, CONFIG_APP_WIFI_PASS);
+    bool lease_ok = wifi_fast_lease_fresh(&s_cache, (int64_t)time(NULL), CONFIG_APP_WIFI_LEASE_REUSE_S);
+
+    taskENTER_CRITICAL(&s_lock);
+    wifi_phase_t ph = wifi_fast_begin(&s_fsm, &s_cache, cred, fixed_ip(), lease_ok);
+    bool lease_used = s_fsm.lease_used;
+    taskEXIT_CRITICAL(&s_lock);
+
+    xEventGroupClearBits(s_evt, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    s_t0 = esp_timer_get_time();
+    ESP_RETURN_ON_ERROR(sta_config(ph == WIFI_PHASE_FAST), TAG, "set_cfg");
+    if (lease_used) ip_static(&s_cache.lease);
+    else ip_dhcp();
+    if (ph == WIFI_PHASE_FAST)
+        ESP_LOGI(TAG, "fast connect: ch %u%s", s_cache.channel, lease_used ? ", cached lease" : "");
+    return ESP_OK;
+}
+
 esp_err_t wifi_net_connect(int timeout_ms)
 {
     ESP_RETURN_ON_ERROR(wifi_net_init(), TAG, "init_first");
+    if (wifi_net_is_connected()) return ESP_OK;
 
-    wifi_config_t sta = {0};
-    strlcpy((char*)sta.sta.ssid,     CONFIG_APP_WIFI_SSID, sizeof(sta.sta.ssid));
-    strlcpy((char*)sta.sta.password, CONFIG_APP_WIFI_PASS, sizeof(sta.sta.password));
-    sta.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
-
-    ESP_RETURN_ON_ERROR(esp_wifi_set_mode(WIFI_MODE_STA), TAG, "set_mode");
-    ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_STA, &sta), TAG, "set_cfg");
-    ESP_RETURN_ON_ERROR(esp_wifi_start(), TAG, "start");
-    s_started = true;
+    if (!s_started) {
+        ESP_RETURN_ON_ERROR(esp_wifi_set_mode(WIFI_MODE_STA), TAG, "set_mode");
+        ESP_RETURN_ON_ERROR(attempt(), TAG, "attempt");
+        ESP_RETURN_ON_ERROR(esp_wifi_start(), TAG, "start");   // STA_START -> connect
+        s_started = true;
+    } else if (s_fsm.phase == WIFI_PHASE_FAILED) {
+        // précédente tentative abandonnée : le driver est au repos
+        ESP_RETURN_ON_ERROR(attempt(), TAG, "attempt");
+        esp_wifi_connect();
+    }
 
     if (timeout_ms <= 0) return ESP_OK;
 
-    EventBits_t bits = xEventGroupWaitBits(
-        s_evt, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+    const EventBits_t done = WIFI_CONNECTED_BIT | WIFI_FAIL_BIT;
+    int fast_ms = CONFIG_APP_WIFI_FAST_TIMEOUT_MS < timeout_ms ? CONFIG_APP_WIFI_FAST_TIMEOUT_MS : timeout_ms;
+    int waited = 0;
+    EventBits_t bits = 0;
+    if (s_fsm.phase == WIFI_PHASE_FAST) {
+        bits = xEventGroupWaitBits(s_evt, done, pdFALSE, pdFALSE, pdMS_TO_TICKS(fast_ms));
+        waited = fast_ms;
+        // ni association ni refus : AP déplacé/éteint, on passe au scan (associé : DHCP en cours, on attend)
+        if (!(bits & done)) timeout(false);
+    }
+    if (!(bits & done))
+        bits = xEventGroupWaitBits(s_evt, done, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms - waited));
+    if (!(bits & done)) {
+        timeout(true);                       // abandon : plus de reconnexion
+        bits = xEventGroupGetBits(s_evt);
+    }
 
     if (!(bits & WIFI_CONNECTED_BIT)) {
         ESP_LOGE(TAG, "connect timeout (%d ms)", timeout_ms);
         return ESP_ERR_TIMEOUT;
     }
-    ESP_LOGI(TAG, "connected to SSID='%s'", CONFIG_APP_WIFI_SSID);
+    ESP_LOGI(TAG, "connected to SSID='%s' (%s) in %u ms", CONFIG_APP_WIFI_SSID,
+             s_fsm.fast ? "fast" : "scan", (unsigned)s_last_ms);
     return ESP_OK;
 }
 
@@ -88,7 +301,10 @@ esp_err_t wifi_net_stop(void)
 {
     if (!s_inited || !s_started) return ESP_OK;
     s_started = false;
-    xEventGroupClearBits(s_evt, WIFI_CONNECTED_BIT);
+    xEventGroupClearBits(s_evt, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    taskENTER_CRITICAL(&s_lock);
+    s_fsm.phase = WIFI_PHASE_IDLE;
+    taskEXIT_CRITICAL(&s_lock);
     return esp_wifi_stop();
 }
 
@@ -0,0 +1,36 @@
+#include "wifi_net.h"
+#include "esp_log.h"
+
+/* Hôte (IDF_TARGET=linux) : le réseau de la machine est déjà disponible,
+ * la couche Wi-Fi se réduit à des no-op pour que l'upload tourne tel quel. */
+static const char *TAG = "wifi_net";
+static bool s_up = false;
+
+esp_err_t wifi_net_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t wifi_net_connect(int timeout_ms)
+{
+    (void)timeout_ms;
+    if (!s_up) ESP_LOGI(TAG, "host network");
+    s_up = true;
+    return ESP_OK;
+}
+
+bool wifi_net_is_connected(void)
+{
+    return s_up;
+}
+
+esp_err_t wifi_net_stop(void)
+{
+    s_up = false;
+    return ESP_OK;
+}
+
+esp_err_t wifi_net_deinit(void)
+{
+    return wifi_net_stop();
+}
@@ -3,24 +3,40 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_check.h"
 #include "nvs_flash.h"
 #include "esp_timer.h"
-#include "esp_sleep.h"
-#include "driver/gpio.h"
+#include "hal_board.h"
 
 #include "touch_water.h"
 #include "wifi_net.h"
 #include "app_upload.h"
 #include "app_dive.h"
+#include "app_jobs.h"
 #include "i2c_bus.h"
 #include "sensor.h"
 #include "sensor_tsys01.h"
 #include "sensor_ms5837.h"
 #include "sensor_service.h"
+#include "boot_timeline.h"
+#include "dlog.h"
+#include "metrics.h"
+#include "app_mem.h"
+#include "led_status.h"
+#if CONFIG_APP_USB_OFFLOAD
+#include "usb_offload.h"
+#endif
+#if CONFIG_APP_BENCH
+#include "bench.h"
+#include "dive_storage.h"
+#endif
 
 // Filets de sécurité
-#ifndef CONFIG_APP_MAX_RUN_SECONDS
-#define CONFIG_APP_MAX_RUN_SECONDS 120
+#ifndef CONFIG_APP_DIVE_DEADLINE_S
+#define CONFIG_APP_DIVE_DEADLINE_S 120
+#endif
+#ifndef CONFIG_APP_UPLOAD_DEADLINE_S
+#define CONFIG_APP_UPLOAD_DEADLINE_S 60
 #endif
 #ifndef CONFIG_APP_VBUS_SENSE_GPIO
 #define CONFIG_APP_VBUS_SENSE_GPIO 4
@@ -28,6 +44,12 @@
 #ifndef CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
 #define CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE 0
 #endif
+#ifndef CONFIG_APP_LED_STATUS
+#define CONFIG_APP_LED_STATUS 1
+#endif
+#ifndef CONFIG_APP_USB_HELLO_MS
+#define CONFIG_APP_USB_HELLO_MS 1500
+#endif
 
 static const char *TAG = "main";
 
@@ -35,131 +57,165 @@ static const char *TAG = "main";
 
 
 /* Adapte SDA/SCL selon ta carte */
+#ifndef I2C_PORT
+#define I2C_PORT 0
+#endif
 #ifndef I2C_SDA_GPIO
-#define I2C_SDA_GPIO GPIO_NUM_8
+#define I2C_SDA_GPIO 8
 #endif
 #ifndef I2C_SCL_GPIO
-#define I2C_SCL_GPIO GPIO_NUM_9
+#define I2C_SCL_GPIO 9
 #endif
 
-static void consumer_task(void* arg)
+/* Pile capteurs (I²C + capteurs + polling), démarrée seulement pour une plongée */
+static esp_err_t start_sensors(QueueHandle_t *out_q)
 {
-    QueueHandle_t q = (QueueHandle_t)arg;
-    sensor_sample_msg_t msg;
-    while (1) {
-        if (xQueueReceive(q, &msg, portMAX_DELAY)) {
-            const sensor_measure_t* m = &msg.measure;
-            ESP_LOGI("samples", "[%s] T=%.2f C, P=%.3f bar, depth=%.2f m (ts=%llu us)",
-                     msg.name, m->temperature_c, m->pressure_bar, m->depth_m,
-                     (unsigned long long)m->ts_us);
-        }
+    // 1) Bus I²C commun
+    i2c_bus_t *bus = NULL;
+    ESP_RETURN_ON_ERROR(i2c_bus_create(I2C_PORT, I2C_SDA_GPIO, I2C_SCL_GPIO, 400000, &bus), TAG, "i2c");
+    boot_timeline_mark("i2c");
+
+    // 2) Instancier les capteurs
+    sensor_if_t tsys;
+    sensor_tsys01_make(bus, 0x77, &tsys);    // TSYS01 (temp)
+    sensor_if_t ms;
+    sensor_ms5837_make(bus, 0x76, &ms);      // MS5837 (temp+pression+depth)
+
+    // 3) Créer le service de polling
+    sensor_service_t* svc = sensor_service_create(bus, /*max_sensors*/ 4, /*queue_len*/ 16);
+    if (!svc) return ESP_ERR_NO_MEM;
+
+    // 4) Enregistrer les capteurs avec leur période
+    ESP_RETURN_ON_ERROR(sensor_service_add(svc, tsys, /*period_ms*/ 1000, "TSYS"), TAG, "add tsys");
+    ESP_RETURN_ON_ERROR(sensor_service_add(svc, ms,   /*period_ms*/  500, "MS5837"), TAG, "add ms");
+
+    // 5) Démarrer la tâche de polling
+    ESP_RETURN_ON_ERROR(sensor_service_start(svc, /*prio: plan*/0, /*stack_words*/4096), TAG, "svc start");
+    boot_timeline_mark("sensors");
+
+    // 6) La queue est consommée par la session de plongée (app_dive -> dive_storage)
+    *out_q = sensor_service_get_queue(svc);
+    return ESP_OK;
+}
+
+/* LED d'état : seulement quand un job tourne (rien au réveil "idle") */
+static void start_led(void)
+{
+#if CONFIG_APP_LED_STATUS
+    esp_err_t e = led_status_init();
+    if (e != ESP_OK) ESP_LOGW(TAG, "led: %s", esp_err_to_name(e));
+#endif
+}
+
+static bool start_dive(void)
+{
+    start_led();
+    QueueHandle_t q = NULL;
+    esp_err_t e = start_sensors(&q);
+    if (e != ESP_OK) {
+        ESP_LOGE(TAG, "sensors: %s", esp_err_to_name(e));
+        return false;
     }
+    app_jobs_begin(APP_JOB_DIVE, CONFIG_APP_DIVE_DEADLINE_S);
+    bool ok = (app_dive_start(q) == ESP_OK);
+    if (!ok) app_jobs_done(APP_JOB_DIVE);
+    boot_timeline_mark("dive");
+    return ok;
+}
+
+#if !CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
+static int read_vbus(void)
+{
+    return hal_board_vbus_level(CONFIG_APP_VBUS_SENSE_GPIO);
 }
+#endif
 
+static bool start_upload(void)
+{
+    start_led();
+    app_jobs_begin(APP_JOB_UPLOAD, CONFIG_APP_UPLOAD_DEADLINE_S);
+#if CONFIG_APP_USB_OFFLOAD
+    // câble de données branché : plus rapide et moins coûteux que la radio
+    if (usb_offload_probe(CONFIG_APP_USB_HELLO_MS))
+    {
+        bool usb = (usb_offload_start() == ESP_OK);
+        if (!usb) app_jobs_done(APP_JOB_UPLOAD);
+        boot_timeline_mark("usb");
+        return usb;
+    }
+#endif
+    bool ok = (app_upload_start() == ESP_OK);
+    if (!ok) app_jobs_done(APP_JOB_UPLOAD);
+    boot_timeline_mark("upload");
+    return ok;
+}
 
 static void configure_wake_sources(void)
 {
 #if !CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
-    gpio_pulldown_en(CONFIG_APP_VBUS_SENSE_GPIO);
-    gpio_pullup_dis(CONFIG_APP_VBUS_SENSE_GPIO);
-    esp_sleep_enable_ext1_wakeup(1ULL << CONFIG_APP_VBUS_SENSE_GPIO, ESP_EXT1_WAKEUP_ANY_HIGH);
+    const int vbus_gpio = CONFIG_APP_VBUS_SENSE_GPIO;
 #else
+    const int vbus_gpio = -1;
     ESP_LOGW(TAG, "DEBUG: EXT1 (VBUS) wake DISABLED");
 #endif
 
     touch_water_prepare_wakeup();
-    esp_sleep_enable_touchpad_wakeup();
+    hal_board_enable_wakeup(vbus_gpio, true);
 }
 
-static void go_to_deep_sleep(void)
+static void go_to_deep_sleep(const char *path)
 {
+    // dernière étape marquée avant l'affichage, sinon elle n'y figure jamais
+    boot_timeline_mark("sleep");
+    boot_timeline_dump(path);
+    dlog_flush();
+    app_mem_report();
     ESP_LOGI(TAG, "Entering deep sleep...");
     vTaskDelay(pdMS_TO_TICKS(100));
-    esp_deep_sleep_start();
+    hal_board_deep_sleep();
 }
 
 void app_main(void)
 {
+    boot_timeline_mark("app_main");
+    dlog_init();
+    metrics_init();
 #if CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
     ESP_LOGW(TAG, "Config: EXT1 (VBUS) DISABLED by CONFIG");
 #else
     ESP_LOGI(TAG, "Config: EXT1 (VBUS) ENABLED");
 #endif
 
-/*
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
-    {
-        nvs_flash_erase();
-        nvs_flash_init();
-    }
-
-    // Init capteur tactile
-    ESP_ERROR_CHECK(touch_water_init());
-
-    // Pile Wi-Fi prête (ne se connecte que si app_upload_start() est appelé)
-    wifi_net_init();
-*/
-
-//I2C
-    // 1) Bus I²C commun
-    i2c_bus_t *bus = NULL;
-    ESP_ERROR_CHECK(i2c_bus_create(I2C_NUM_0, I2C_SDA_GPIO, I2C_SCL_GPIO, 400000, &bus));
-
-    // 2) Instancier les capteurs
-    sensor_if_t tsys;
-    sensor_tsys01_make(bus, 0x77, &tsys);    // TSYS01 (temp)
-    sensor_if_t ms;
-    sensor_ms5837_make(bus, 0x76, &ms);      // MS5837 (temp+pression+depth)
-
-    // 3) Créer le service de polling
-    sensor_service_t* svc = sensor_service_create(bus, /*max_sensors*/ 4, /*queue_len*/ 16);
-    assert(svc);
-
-    // 4) Enregistrer les capteurs avec leur période
-    ESP_ERROR_CHECK(sensor_service_add(svc, tsys, /*period_ms*/ 1000, "TSYS"));
-    ESP_ERROR_CHECK(sensor_service_add(svc, ms,   /*period_ms*/  500, "MS5837"));
-
-    // 5) Démarrer la tâche de polling
-    ESP_ERROR_CHECK(sensor_service_start(svc, /*prio*/5, /*stack_words*/4096));
-
-    // 6) Tâche consommatrice (lecture de la queue)
-    QueueHandle_t q = sensor_service_get_queue(svc);
-    xTaskCreate(consumer_task, "samples_consumer", 4096, (void*)q, 5, NULL);
-
-    // … à partir d’ici, tu peux router ces échantillons :
-    //    - vers `dive_storage` (CSV/JSON),
-    //    - vers un `http_post_json` (upload),
-    //    - vers un contrôle (seuils, LED, …).
-
+#if CONFIG_APP_BENCH
+    // Mode banc : mesures puis sommeil, sans le cycle plongée/upload
+    ESP_ERROR_CHECK(dive_storage_init());   // monte le FS où bench.json est écrit
+    bench_run_all(NULL);
+    configure_wake_sources();
+    go_to_deep_sleep("bench");
+#endif
 
-    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
-    ESP_LOGI(TAG, "Wake cause=%d (0=cold, 3=touch, 6=ext1)", cause);
+    // Chaque sous-système n'est initialisé que dans la branche qui en a besoin
+    hal_wake_t cause = hal_board_wake_cause();
+    ESP_LOGI(TAG, "Wake cause=%d (0=cold, 1=touch, 2=vbus)", cause);
 
     bool launched = false;
+    const char *path = "idle";
+    ESP_ERROR_CHECK(app_jobs_init());
 
-    if (cause == ESP_SLEEP_WAKEUP_TOUCHPAD)
+    if (cause == HAL_WAKE_TOUCH)
     {
-        app_dive_start();
-        launched = true;
+        path = "touch";
+        launched = start_dive();
     }
 #if !CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
-    else if (cause == ESP_SLEEP_WAKEUP_EXT1)
+    else if (cause == HAL_WAKE_VBUS)
     {
-        gpio_config_t io = {
-            .pin_bit_mask = 1ULL << CONFIG_APP_VBUS_SENSE_GPIO,
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .pull_down_en = GPIO_PULLDOWN_ENABLE,
-            .intr_type = GPIO_INTR_DISABLE};
-        gpio_config(&io);
-        int vbus = gpio_get_level(CONFIG_APP_VBUS_SENSE_GPIO);
+        int vbus = read_vbus();
         ESP_LOGI(TAG, "EXT1 wake, VBUS=%d", vbus);
         if (vbus == 1)
         {
-            app_upload_start();
-            launched = true;
+            path = "vbus";
+            launched = start_upload();
         }
     }
 #endif
@@ -167,54 +223,41 @@ void app_main(void)
     {
         // Cold boot : on teste les triggers
         ESP_LOGI(TAG, "Cold boot -> probing triggers before sleep");
+        path = "cold";
 
 #if !CONFIG_APP_DEBUG_DISABLE_VBUS_WAKE
-        gpio_config_t io = {
-            .pin_bit_mask = 1ULL << CONFIG_APP_VBUS_SENSE_GPIO,
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .pull_down_en = GPIO_PULLDOWN_ENABLE,
-            .intr_type = GPIO_INTR_DISABLE};
-        gpio_config(&io);
-        int vbus = gpio_get_level(CONFIG_APP_VBUS_SENSE_GPIO);
-        if (vbus == 1)
+        if (read_vbus() == 1)
         {
             ESP_LOGI(TAG, "VBUS present at cold boot -> upload");
-            app_upload_start();
-            launched = true;
+            launched = start_upload();
         }
         else
 #endif
         {
+            // le seuil tactile doit exister avant la lecture (baseline en cache RTC si dispo)
+            esp_err_t te = touch_water_init();
+            if (te != ESP_OK) ESP_LOGW(TAG, "touch init: %s", esp_err_to_name(te));
+            boot_timeline_mark("touch");
             bool wet = touch_water_is_present();
             ESP_LOGI(TAG, "Water at boot: %s", wet ? "YES" : "no");
             if (wet)
             {
-                app_dive_start();
-                launched = true;
+                launched = start_dive();
             }
         }
     }
 
-    // Petite boucle garde-fou puis sommeil
-    const int64_t t0 = esp_timer_get_time();
-    while (1)
+    // Sommeil dès que le dernier job se termine (ou que son échéance expire)
+    if (!launched)
+        ESP_LOGI(TAG, "No task -> sleep");
+    else if (!app_jobs_wait_all())
     {
-        vTaskDelay(pdMS_TO_TICKS(200));
-        int64_t elapsed_s = (esp_timer_get_time() - t0) / 1000000;
-        if (!launched)
-        {
-            ESP_LOGI(TAG, "No task -> sleep");
-            break;
-        }
-        if (elapsed_s >= CONFIG_APP_MAX_RUN_SECONDS)
-        {
-            ESP_LOGW(TAG, "Timeout (%ds) -> sleep", CONFIG_APP_MAX_RUN_SECONDS);
-            break;
-        }
+        ESP_LOGW(TAG, "Job deadline expired -> sleep");
+        app_dive_stop(5000);   // une plongée ouverte est close avant le sommeil
     }
 
     configure_wake_sources();
     wifi_net_stop(); // coupe la radio si elle a été utilisée
-    go_to_deep_sleep();
+    boot_timeline_mark("wake_cfg");
+    go_to_deep_sleep(path);
 }
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Décode un dlog.bin (log différé, components/dlog) en texte.
+
+Les enregistrements ne contiennent que les adresses des chaînes de format/tag :
+elles sont relues dans l'ELF du firmware qui a produit le fichier.
+
+    python tools/dlog_decode.py build/firmware.elf dlog.bin
+
+Dépendance : pyelftools (installé avec l'environnement Python d'ESP-IDF).
+"""
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+LEVELS = "NEWIDV"
+SPEC = re.compile(r"%(?P<flags>[-+ #0-9.]*)(?P<len>[hlLqjzt]*)(?P<conv>[diouxXcsfFeEgGaAp%])")
+T_I32, T_I64, T_F32, T_PTR = range(4)
+
+
+class Strings:
+    def __init__(self, elf):
+        self.secs = [(s["sh_addr"], s.data()) for s in elf.iter_sections()
+                     if s["sh_addr"] and s["sh_type"] == "SHT_PROGBITS"]
+
+    def get(self, addr):
+        for base, data in self.secs:
+            if base <= addr < base + len(data):
+                off = addr - base
+                return data[off:data.index(b"\0", off)].decode("utf-8", "replace")
+        return "<0x%08x>" % addr
+
+
+def format_rec(fmt, args, strings):
+    it = iter(args)
+
+    def repl(m):
+        conv = m.group("conv")
+        if conv == "%":
+            return "%"
+        try:
+            t, v = next(it)
+        except StopIteration:
+            return "?"
+        flags = m.group("flags")
+        if conv in "di":
+            if t == T_I32:
+                v = v - (1 << 32) if v & 0x80000000 else v
+            elif v & (1 << 63):
+                v -= 1 << 64
+            return ("%" + flags + "d") % v
+        if conv in "uoxX":
+            return ("%" + flags + conv) % v
+        if conv in "fFeEgGaA":
+            return ("%" + flags + conv.replace("a", "e").replace("A", "E")) % \
+                struct.unpack("<f", struct.pack("<I", v & 0xFFFFFFFF))[0]
+        if conv == "s":
+            return ("%" + flags + "s") % (strings.get(v) if v else "(null)")
+        if conv == "c":
+            return chr(v & 0xFF)
+        return "0x%x" % v
+
+    return SPEC.sub(repl, fmt)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        strings = Strings(ELFFile(f))
+        raw = open(sys.argv[2], "rb").read()
+
+    if raw[:4] != b"DLG1":
+        sys.exit("not a dlog file")
+    psz, nwords, rsz = raw[4], raw[5], raw[6]
+    pf = "I" if psz == 4 else "Q"
+    head = struct.Struct("<II" + pf + pf + "HH")
+    ptr_words = psz // 4
+
+    for off in range(8, len(raw) - rsz + 1, rsz):
+        rec = raw[off:off + rsz]
+        _, ts, fmt, tag, meta, types = head.unpack_from(rec)
+        words = struct.unpack_from("<%dI" % nwords, rec, head.size)
+        args, wi = [], 0
+        for i in range((meta >> 3) & 7):
+            t = (types >> (2 * i)) & 3
+            n = 2 if t == T_I64 else ptr_words if t == T_PTR else 1
+            v = 0
+            for k in range(n):
+                v |= words[wi + k] << (32 * k)
+            wi += n
+            args.append((t, v))
+        lvl = meta & 7
+        tag_s = strings.get(tag)
+        print("%s (%d) %s: %s" % (LEVELS[lvl] if lvl < 6 else "?", ts, tag_s,
+                                  format_rec(strings.get(fmt), args, strings)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Broker MQTT de remplacement (banc local) pour la télémétrie (components/telemetry).
+
+MQTT 3.1.1 minimal : CONNECT, PUBLISH QoS 0/1 (PUBACK), SUBSCRIBE (retransmis
+en QoS 0 aux abonnés, ex. mosquitto_sub), PINGREQ, DISCONNECT. Décode les
+messages du topic de télémétrie et mesure :
+  - latence de bout en bout : réception - horodatage de l'échantillon, pour le
+    dernier échantillon du lot (transport) et le premier (attente du lot comprise) ;
+  - débit soutenu : messages/s et échantillons/s ;
+  - pertes : trous de séquence et compteur "dropped" rapporté par l'appareil.
+La latence suppose des horloges alignées (build hôte, ou appareil à l'heure SNTP) ;
+sinon se fier à la métrique telemetry.age_us de l'appareil.
+
+    tools/mqtt_sink.py --port 1883 --duration 30
+    -> CONFIG_APP_TELEMETRY_BROKER / CONFIG_APP_BENCH_MQTT_URI = "mqtt://<hôte>:1883"
+"""
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+HDR = struct.Struct("<BBHIQ")
+SAMPLE = struct.Struct("<IHhHB")
+
+lock = threading.Lock()
+subs = []           # (socket, filtre)
+st = {"msgs": 0, "samples": 0, "bytes": 0, "gaps": 0, "dev_dropped": 0,
+      "first": None, "last": None, "lat_last": [], "lat_first": [], "bad": 0}
+last_seq = {}
+
+
+def recv_exact(s, n):
+    b = b""
+    while len(b) < n:
+        c = s.recv(n - len(b))
+        if not c:
+            raise ConnectionError
+        b += c
+    return b
+
+
+def read_packet(s):
+    h = recv_exact(s, 1)[0]
+    mult, rl = 1, 0
+    while True:
+        c = recv_exact(s, 1)[0]
+        rl += (c & 0x7F) * mult
+        if not c & 0x80:
+            break
+        mult *= 128
+    return h, recv_exact(s, rl) if rl else b""
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        d, n = n % 128, n // 128
+        out.append(d | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def topic_match(flt, topic):
+    f, t = flt.split("/"), topic.split("/")
+    for i, p in enumerate(f):
+        if p == "#":
+            return True
+        if i >= len(t) or (p != "+" and p != t[i]):
+            return False
+    return len(f) == len(t)
+
+
+def decode(peer, payload, now_us):
+    if len(payload) < HDR.size:
+        st["bad"] += 1
+        return
+    ver, n, seq, dropped, t0 = HDR.unpack_from(payload)
+    if ver != 1 or len(payload) != HDR.size + n * SAMPLE.size:
+        st["bad"] += 1
+        return
+    dts = [SAMPLE.unpack_from(payload, HDR.size + i * SAMPLE.size)[0] for i in range(n)]
+    prev = last_seq.get(peer)
+    if prev is not None and seq != (prev + 1) & 0xFFFF:
+        st["gaps"] += (seq - prev - 1) & 0xFFFF
+    last_seq[peer] = seq
+    st["msgs"] += 1
+    st["samples"] += n
+    st["bytes"] += len(payload)
+    st["dev_dropped"] = dropped
+    st["first"] = st["first"] or time.monotonic()
+    st["last"] = time.monotonic()
+    st["lat_last"].append(now_us - (t0 + dts[-1]))
+    st["lat_first"].append(now_us - t0)
+
+
+def client(conn, peer, topic):
+    try:
+        while True:
+            h, body = read_packet(conn)
+            kind = h >> 4
+            if kind == 1:                               # CONNECT
+                conn.sendall(b"\x20\x02\x00\x00")
+            elif kind == 3:                             # PUBLISH
+                qos = (h >> 1) & 3
+                tl = struct.unpack_from(">H", body)[0]
+                t = body[2:2 + tl].decode()
+                i = 2 + tl
+                if qos:
+                    pid = body[i:i + 2]
+                    i += 2
+                    conn.sendall(b"\x40\x02" + pid)
+                payload = body[i:]
+                now_us = time.time_ns() // 1000
+                with lock:
+                    if t == topic:
+                        decode(peer, payload, now_us)
+                    fwd = [s for s, f in subs if topic_match(f, t)]
+                pkt = bytes([0x30]) + encode_len(2 + tl + len(payload)) + body[:2 + tl] + payload
+                for s in fwd:
+                    try:
+                        s.sendall(pkt)
+                    except OSError:
+                        pass
+            elif kind == 8:                             # SUBSCRIBE
+                pid = body[:2]
+                tl = struct.unpack_from(">H", body, 2)[0]
+                with lock:
+                    subs.append((conn, body[4:4 + tl].decode()))
+                conn.sendall(b"\x90\x03" + pid + b"\x00")
+            elif kind == 12:                            # PINGREQ
+                conn.sendall(b"\xd0\x00")
+            elif kind == 14:                            # DISCONNECT
+                break
+    except (ConnectionError, OSError, struct.error):
+        pass
+    finally:
+        with lock:
+            subs[:] = [(s, f) for s, f in subs if s is not conn]
+        conn.close()
+
+
+def pct(v, p):
+    if not v:
+        return 0
+    v = sorted(v)
+    return v[min(len(v) - 1, int(len(v) * p / 100))]
+
+
+def report():
+    with lock:
+        span = (st["last"] - st["first"]) if st["first"] and st["last"] else 0
+        print(f"msgs {st['msgs']} samples {st['samples']} bytes {st['bytes']}"
+              f" | {st['msgs'] / span if span else 0:.1f} msg/s"
+              f" {st['samples'] / span if span else 0:.1f} samples/s"
+              f" | seq gaps {st['gaps']} dev dropped {st['dev_dropped']} bad {st['bad']}")
+        for name in ("lat_last", "lat_first"):
+            v = st[name]
+            print(f"  {name:9s} us p50 {pct(v, 50)} p90 {pct(v, 90)} p99 {pct(v, 99)}"
+                  f" max {max(v) if v else 0}")
+        sys.stdout.flush()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--topic", default="remora/telemetry")
+    ap.add_argument("--duration", type=float, default=0, help="s, 0 = jusqu'à Ctrl-C")
+    ap.add_argument("--every", type=float, default=5, help="période du bilan (s)")
+    args = ap.parse_args()
+
+    srv = socket.socket()
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(("", args.port))
+    srv.listen(8)
+    srv.settimeout(0.5)
+    print(f"listening on :{args.port}, topic {args.topic}")
+    t_end = time.monotonic() + args.duration if args.duration else None
+    t_rep = time.monotonic() + args.every
+    try:
+        while not t_end or time.monotonic() < t_end:
+            try:
+                conn, addr = srv.accept()
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                threading.Thread(target=client, args=(conn, addr, args.topic), daemon=True).start()
+            except socket.timeout:
+                pass
+            if time.monotonic() >= t_rep:
+                report()
+                t_rep += args.every
+    except KeyboardInterrupt:
+        pass
+    report()
+
+
+if __name__ == "__main__":
+    main()
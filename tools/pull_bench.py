@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Client du serveur de téléchargement (components/pull_server) : débit et reprise.
+
+Lit le catalogue, télécharge chaque plongée en entier puis la retélécharge en
+coupant la connexion au milieu et en reprenant avec Range: bytes=N-, vérifie
+que les deux copies sont identiques et que la taille annoncée est respectée.
+Contrôle aussi une plage suffixe (bytes=-N), le 416 hors fichier, et que le
+catalogue relu par pages (?after=<id>&limit=N) redonne la liste complète.
+
+    tools/pull_bench.py http://<station>:80 --out /tmp/pull
+    # hôte : build IDF_TARGET=linux avec CONFIG_APP_PULL_SERVER, puis
+    tools/pull_bench.py http://127.0.0.1:8080
+"""
+import argparse
+import http.client
+import json
+import os
+import sys
+import time
+from urllib.parse import urlsplit
+
+
+class Client:
+    def __init__(self, base):
+        u = urlsplit(base)
+        self.host, self.port = u.hostname, u.port or 80
+        self.conn = None
+
+    def _conn(self):
+        if self.conn is None:
+            self.conn = http.client.HTTPConnection(self.host, self.port, timeout=30)
+        return self.conn
+
+    def get(self, path, headers=None, stop_after=None):
+        """GET ; stop_after = octets lus avant de couper la connexion (transfert interrompu)"""
+        c = self._conn()
+        c.request("GET", path, headers=headers or {})
+        r = c.getresponse()
+        if stop_after is None:
+            return r, r.read()
+        body = r.read(stop_after)
+        c.close()
+        self.conn = None
+        return r, body
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("base", help="ex. http://192.168.1.42")
+    ap.add_argument("--out", help="répertoire où écrire les <id>.csv téléchargés")
+    ap.add_argument("--page", type=int, default=3, help="plongées par page du catalogue paginé")
+    args = ap.parse_args()
+
+    cl = Client(args.base)
+    r, body = cl.get("/dives")
+    if r.status != 200:
+        sys.exit(f"/dives: HTTP {r.status}")
+    catalog = json.loads(body)
+    print(f"{len(catalog)} dives, {sum(d.get('bytes', 0) for d in catalog)} bytes announced")
+
+    total = 0
+    t_full = 0.0
+    errors = 0
+
+    paged = []
+    while True:
+        after = f"&after={paged[-1]['id']}" if paged else ""
+        r, body = cl.get(f"/dives?limit={args.page}{after}")
+        page = json.loads(body) if r.status == 200 else None
+        if not page:
+            break
+        paged += page
+    if [d["id"] for d in paged] != [d["id"] for d in catalog]:
+        print(f"paged catalog mismatch: {len(paged)} vs {len(catalog)} dives")
+        errors += 1
+    for d in catalog:
+        dive, size = d["id"], d.get("bytes", 0)
+        t0 = time.perf_counter()
+        r, full = cl.get(f"/dives/{dive}")
+        t_full += time.perf_counter() - t0
+        total += len(full)
+        if r.status != 200 or len(full) != size:
+            print(f"{dive}: HTTP {r.status}, {len(full)}/{size} bytes")
+            errors += 1
+            continue
+
+        # coupure à mi-chemin puis reprise
+        half = max(1, size // 2)
+        _, part = cl.get(f"/dives/{dive}", stop_after=half)
+        r, rest = cl.get(f"/dives/{dive}", {"Range": f"bytes={len(part)}-"})
+        cr = r.getheader("Content-Range", "")
+        if r.status != 206 or part + rest != full or cr != f"bytes {len(part)}-{size - 1}/{size}":
+            print(f"{dive}: resume mismatch (HTTP {r.status}, {cr!r})")
+            errors += 1
+
+        r, tail = cl.get(f"/dives/{dive}", {"Range": "bytes=-100"})
+        if r.status != 206 or tail != full[-100:]:
+            print(f"{dive}: suffix range mismatch (HTTP {r.status})")
+            errors += 1
+        r, _ = cl.get(f"/dives/{dive}", {"Range": f"bytes={size}-"})
+        if r.status != 416:
+            print(f"{dive}: expected 416, got {r.status}")
+            errors += 1
+
+        if args.out:
+            os.makedirs(args.out, exist_ok=True)
+            with open(os.path.join(args.out, f"{dive}.csv"), "wb") as f:
+                f.write(full)
+
+    r, m = cl.get("/metrics")
+    print(f"metrics: HTTP {r.status}, {len(m)} bytes")
+    if t_full > 0:
+        print(f"full downloads: {total} bytes in {t_full * 1000:.0f} ms "
+              f"({total / t_full / 1024:.0f} KiB/s)")
+    print("OK" if not errors else f"{errors} error(s)")
+    sys.exit(1 if errors else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Serveur de synchro de remplacement (banc local) pour dive_sync.
+
+Tient pour chaque plongée le nombre d'échantillons reçus et répond {"acked":N}.
+Accepte les corps chunked et Content-Encoding deflate/gzip (upload_http), en
+JSON ou en protobuf (components/app_upload/proto/dive_sync.proto, annoncé par
+Accept-Post sauf --json-only).
+Peut couper la connexion au milieu du corps (--drop) ou après l'avoir traité
+sans répondre (--lose-ack) pour éprouver la reprise au curseur.
+
+    tools/sync_server.py --port 8080 --drop 0.3 --lose-ack 0.1 --store /tmp/sync
+    -> CONFIG_APP_SYNC_URL="http://<hôte>:8080/sync"
+
+--self-check décode un bloc de référence produit par sync_codec.c (le cas
+chunk_pb du banc vérifie que l'encodeur produit toujours ces octets).
+"""
+import argparse
+import json
+import os
+import random
+import struct
+import socket
+import threading
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+state = {}          # dive -> {"acked": int, "final": bool, "meta": dict}
+lock = threading.Lock()
+stats = {"requests": 0, "dropped": 0, "lost_ack": 0, "dup": 0, "conflict": 0,
+         "raw_bytes": 0, "wire_bytes": 0, "protobuf": 0}
+
+
+def _varint(b, i):
+    v = shift = 0
+    while True:
+        c = b[i]
+        i += 1
+        v |= (c & 0x7F) << shift
+        shift += 7
+        if not c & 0x80:
+            return v, i
+
+
+def _fields(b):
+    """(numéro, valeur) d'un message protobuf ; LEN -> bytes, FIXED32 -> bytes"""
+    i = 0
+    while i < len(b):
+        key, i = _varint(b, i)
+        wt = key & 7
+        if wt == 0:
+            v, i = _varint(b, i)
+        elif wt == 2:
+            n, i = _varint(b, i)
+            v, i = b[i:i + n], i + n
+        elif wt == 5:
+            v, i = b[i:i + 4], i + 4
+        else:
+            raise ValueError("wire type %d" % wt)
+        yield key >> 3, v
+
+
+SUMMARY = {1: "samples", 2: "duration_s", 3: "max_depth_m", 4: "avg_depth_m", 5: "min_temp_c",
+           6: "max_temp_c", 7: "max_ascent_m_min", 8: "descent_s", 9: "bottom_s", 10: "ascent_s",
+           11: "safety_stop_s"}
+
+
+def decode_chunk(b):
+    """SyncChunk -> même dict que le JSON"""
+    req = {"from": 0, "final": False, "samples": []}
+    for f, v in _fields(b):
+        if f in (1, 2):
+            req["device" if f == 1 else "dive"] = v.decode()
+        elif f == 3:
+            req["from"] = v
+        elif f == 4:
+            req["final"] = bool(v)
+        elif f == 5:
+            meta = {}
+            for mf, mv in _fields(v):
+                if mf <= 4:
+                    meta[("id", "date", "location", "diver")[mf - 1]] = mv.decode()
+                elif mf == 5:
+                    meta["summary"] = {SUMMARY[sf]: struct.unpack("<f", sv)[0] if isinstance(sv, bytes) else sv
+                                       for sf, sv in _fields(mv)}
+            req["meta"] = meta
+        elif f == 6:
+            ts, dts, temp, press = 0, [], [], []
+            for sf, sv in _fields(v):
+                if sf == 1:
+                    ts = sv
+                elif sf == 2:
+                    i = 0
+                    while i < len(sv):
+                        z, i = _varint(sv, i)
+                        dts.append((z >> 1) ^ -(z & 1))
+                elif sf == 3:
+                    temp = list(struct.unpack("<%df" % (len(sv) // 4), sv))
+                elif sf == 4:
+                    press = list(struct.unpack("<%df" % (len(sv) // 4), sv))
+            for d, t, p in zip(dts, temp, press):
+                ts += d
+                req["samples"].append({"ts_us": ts, "temp_c": t, "press_bar": p})
+    return req
+
+
+# Bloc de référence (GOLDEN_PB de components/bench/bench_cases.c) : métadonnées
+# et résumé, 3 échantillons dont un delta négatif, bloc final
+GOLDEN_PB = bytes.fromhex(
+    "0a0865737033322d7333120f646976655f3030303030303030343220012a550a0f646976655f"
+    "303030303030303034321213323032362d31302d31385431303a30303a30301a09506f7274"
+    "2d43726f732201412a1f080310011d0000484125000004412d00008e4135000092413d0000"
+    "10414001322e088080f9c0c1c48203120700c0843dbf9a0c1a0c000092410000904100008e"
+    "41220cfca9813f0000204000001040")
+
+
+def _f32(x):
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+GOLDEN = {
+    "device": "esp32-s3", "dive": "dive_0000000042", "from": 0, "final": True,
+    "meta": {"id": "dive_0000000042", "date": "2026-10-18T10:00:00", "location": "Port-Cros", "diver": "A",
+             "summary": {"samples": 3, "duration_s": 1, "max_depth_m": 12.5, "avg_depth_m": 8.25,
+                         "min_temp_c": 17.75, "max_temp_c": 18.25, "max_ascent_m_min": 9.0, "descent_s": 1}},
+    "samples": [{"ts_us": 1700000000000000, "temp_c": 18.25, "press_bar": _f32(1.013)},
+                {"ts_us": 1700000000500000, "temp_c": 18.0, "press_bar": 2.5},
+                {"ts_us": 1700000000400000, "temp_c": 17.75, "press_bar": 2.25}],
+}
+
+
+def self_check():
+    got = decode_chunk(GOLDEN_PB)
+    if got != GOLDEN:
+        print("self-check FAILED\n got:      %s\n expected: %s" % (got, GOLDEN))
+        return 1
+    print("self-check ok (%d bytes, %d samples)" % (len(GOLDEN_PB), len(got["samples"])))
+    return 0
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    disable_nagle_algorithm = True
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            super().log_message(fmt, *args)
+
+    def _reply(self, code, obj):
+        body = json.dumps(obj).encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("Accept-Post", "application/json" if self.server.json_only
+                         else "application/x-protobuf, application/json")
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _cut(self):
+        # fermeture brutale (RST) : le client voit une erreur de transport
+        self.close_connection = True
+        try:
+            self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, b"\x01\x00\x00\x00\x00\x00\x00\x00")
+        except OSError:
+            pass
+        self.connection.close()
+
+    def _body(self):
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            parts = []
+            while True:
+                n = int(self.rfile.readline().split(b";")[0], 16)
+                parts.append(self.rfile.read(n))
+                self.rfile.readline()
+                if n == 0:
+                    break
+            raw = b"".join(parts)
+        else:
+            raw = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        wire = len(raw)
+        enc = self.headers.get("Content-Encoding", "identity").lower()
+        if enc == "gzip":
+            raw = zlib.decompress(raw, 16 + zlib.MAX_WBITS)
+        elif enc == "deflate":
+            raw = zlib.decompress(raw)
+        with lock:
+            stats["wire_bytes"] += wire
+            stats["raw_bytes"] += len(raw)
+        return raw
+
+    def _quickack(self):
+        # en-têtes et corps arrivent en deux segments (esp_http_client) : avec Nagle
+        # côté lwIP, le corps attend l'ACK des en-têtes, que Linux retarde ~40 ms
+        # sur une connexion gardée. Relancé à chaque requête (Linux le retire).
+        if self.server.quickack and hasattr(socket, "TCP_QUICKACK"):
+            try:
+                self.connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_QUICKACK, 1)
+            except OSError:
+                pass
+
+    def do_POST(self):
+        with lock:
+            stats["requests"] += 1
+        self._quickack()
+        if random.random() < self.server.drop:
+            self.rfile.read(max(1, int(self.headers.get("Content-Length", 64)) // 2))
+            with lock:
+                stats["dropped"] += 1
+            self._cut()
+            return
+        ctype = self.headers.get("Content-Type", "application/json").split(";")[0].strip()
+        try:
+            body = self._body()
+            if ctype == "application/x-protobuf" and not self.server.json_only:
+                req = decode_chunk(body)
+                with lock:
+                    stats["protobuf"] += 1
+            elif ctype == "application/json":
+                req = json.loads(body)
+            else:
+                self._reply(415, {"error": "unsupported " + ctype})
+                return
+        except (ValueError, IndexError, KeyError, struct.error, zlib.error):
+            self._reply(400, {"error": "bad json"})
+            return
+
+        dive, start, samples = req.get("dive"), int(req.get("from", 0)), req.get("samples", [])
+        with lock:
+            d = state.setdefault(dive, {"acked": 0, "final": False, "meta": {}})
+            if start > d["acked"]:
+                stats["conflict"] += 1
+                code, resp = 409, {"acked": d["acked"]}
+            else:
+                if start < d["acked"]:
+                    stats["dup"] += 1           # renvoi d'un bloc déjà reçu (ack perdu)
+                new = samples[d["acked"] - start:]
+                if self.server.store and new:
+                    with open(os.path.join(self.server.store, dive + ".jsonl"), "a") as f:
+                        for s in new:
+                            f.write(json.dumps(s) + "\n")
+                d["acked"] = max(d["acked"], start + len(samples))
+                d["meta"].update(req.get("meta") or {})
+                d["final"] |= bool(req.get("final"))
+                code, resp = 200, {"acked": d["acked"]}
+            lost = code == 200 and random.random() < self.server.lose_ack
+            if lost:
+                stats["lost_ack"] += 1
+        if lost:
+            self._cut()
+            return
+        self._reply(code, resp)
+
+    def do_GET(self):
+        with lock:
+            self._reply(200, {"dives": state, "stats": stats})
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--drop", type=float, default=0.0, help="probabilité de coupure au milieu du corps")
+    ap.add_argument("--lose-ack", type=float, default=0.0, help="probabilité de traiter sans répondre")
+    ap.add_argument("--json-only", action="store_true", help="refuser le protobuf (415), ne pas l'annoncer")
+    ap.add_argument("--store", help="répertoire où écrire les échantillons reçus (<dive>.jsonl)")
+    ap.add_argument("--seed", type=int)
+    ap.add_argument("--delayed-ack", action="store_true",
+                    help="garder les ACK retardés (sans TCP_QUICKACK) : serveur tel quel")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    ap.add_argument("--self-check", action="store_true", help="décoder le bloc de référence et quitter")
+    a = ap.parse_args()
+    if a.self_check:
+        raise SystemExit(self_check())
+    if a.seed is not None:
+        random.seed(a.seed)
+    if a.store:
+        os.makedirs(a.store, exist_ok=True)
+    srv = ThreadingHTTPServer(("", a.port), Handler)
+    srv.drop, srv.lose_ack, srv.store, srv.verbose = a.drop, a.lose_ack, a.store, a.verbose
+    srv.json_only, srv.quickack = a.json_only, not a.delayed_ack
+    print(f"sync server on :{a.port} (drop={a.drop}, lose-ack={a.lose_ack}); GET / for state")
+    srv.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
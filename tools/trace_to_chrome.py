@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Convertit un trace.bin (components/trace) en Chrome trace JSON.
+
+    python tools/trace_to_chrome.py trace.bin > trace.json
+
+Ouvrir le résultat dans chrome://tracing ou https://ui.perfetto.dev.
+Une piste par tâche nommée (trace_task_register), cœur dans args.core.
+"""
+import json
+import struct
+import sys
+
+EVENTS = {
+    1: "i2c",
+    2: "sensor_read",
+    3: "queue_send",
+    4: "queue_recv",
+    5: "store_append",
+    6: "store_flush",
+    7: "blocked",
+}
+PHASES = {0: "B", 1: "E", 2: "i"}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    raw = open(sys.argv[1], "rb").read()
+    if raw[:4] != b"TRC1":
+        sys.exit("not a trace file")
+    esz, ntasks = raw[4], raw[5]
+    off = 8
+    tasks = []
+    for _ in range(ntasks):
+        tasks.append(raw[off:off + 16].split(b"\0")[0].decode("utf-8", "replace"))
+        off += 16
+    (n,) = struct.unpack_from("<I", raw, off)
+    off += 4
+
+    out = [{"ph": "M", "pid": 0, "name": "process_name", "args": {"name": "remora"}}]
+    for i, name in enumerate(tasks):
+        out.append({"ph": "M", "pid": 0, "tid": i, "name": "thread_name", "args": {"name": name}})
+    out.append({"ph": "M", "pid": 0, "tid": 255, "name": "thread_name", "args": {"name": "other"}})
+
+    base, prev = 0, None
+    for k in range(n):
+        ts, ev, ph_core, task, _, arg = struct.unpack_from("<IBBBBI", raw, off + k * esz)
+        if prev is not None and ts < prev and prev - ts > 0x80000000:
+            base += 1 << 32          # compteur 32 bits rebouclé
+        prev = ts
+        e = {
+            "name": EVENTS.get(ev, "ev%d" % ev),
+            "ph": PHASES.get(ph_core & 3, "i"),
+            "ts": base + ts,
+            "pid": 0,
+            "tid": task,
+            "args": {"arg": arg, "core": ph_core >> 7},
+        }
+        if e["ph"] == "i":
+            e["s"] = "t"
+        out.append(e)
+
+    json.dump({"traceEvents": out, "displayTimeUnit": "ms"}, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Récepteur du déchargement USB (components/usb_offload) : catalogue puis plongées.
+
+Protocole dans components/usb_offload/include/usb_frame.h. Salue l'appareil
+(HELLO répété jusqu'à la réponse), lit le catalogue, télécharge chaque plongée
+dans --out (reprise d'un .part existant par GET à l'offset), vérifie le CRC de
+fin, mesure le débit. Une plongée fermée reçue en entier est marquée
+synchronisée sur l'appareil (MARK), sauf --no-mark. --loss / --corrupt perdent ou abîment des trames reçues
+pour éprouver NAK et go-back-N. --min-kbps : code de sortie 1 sous ce débit.
+--metrics : affiche l'instantané des métriques de l'appareil, sans décharger.
+
+    tools/usb_offload.py /dev/ttyACM0 --out /tmp/dives
+    # hôte : build IDF_TARGET=linux, REMORA_VBUS=1 ; le log donne "pty /dev/pts/N"
+    tools/usb_offload.py /dev/pts/N --out /tmp/dives --loss 0.02 --min-kbps 2000
+    tools/usb_offload.py /dev/ttyACM0 --metrics
+"""
+import argparse
+import json
+import os
+import random
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+import zlib
+
+SYNC = b"\xa5\x5a"
+HELLO, LIST, GET, ACK, NAK, BYE, METRICS, MARK = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08
+DATA, END, ERR = 0x81, 0x82, 0x83
+PROTOCOL = 4
+PAGE = 32                               # plongées par page de catalogue (borne de l'appareil)
+
+
+class Link:
+    def __init__(self, path, loss=0.0, corrupt=0.0):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.buf = bytearray()
+        self.seq = 0
+        self.loss, self.corrupt = loss, corrupt
+        self.max_payload = 8192 + 4     # précisé par le HELLO de l'appareil
+        self.st = {"bad_crc": 0, "skipped": 0, "lost": 0, "naks": 0, "dups": 0}
+
+    def send(self, kind, payload=b""):
+        body = struct.pack("<BBH", kind, self.seq & 0xFF, len(payload)) + payload
+        self.seq += 1
+        os.write(self.fd, SYNC + body + struct.pack("<I", zlib.crc32(body)))
+
+    def recv(self, timeout):
+        """Trame suivante (type, payload), ou None après timeout s"""
+        t_end = time.monotonic() + timeout
+        while True:
+            f = self._parse()
+            if f:
+                if self.loss and random.random() < self.loss:
+                    self.st["lost"] += 1
+                    continue
+                return f
+            left = t_end - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                return None
+            chunk = bytearray(os.read(self.fd, 65536))
+            if self.corrupt and chunk and random.random() < self.corrupt:
+                chunk[random.randrange(len(chunk))] ^= 0x40
+            self.buf += chunk
+
+    def _parse(self):
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                keep = 1 if self.buf[-1:] == SYNC[:1] else 0
+                self.st["skipped"] += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                return None
+            if i:
+                self.st["skipped"] += i
+                del self.buf[:i]
+            if len(self.buf) < 6:
+                return None
+            kind, _, n = struct.unpack_from("<BBH", self.buf, 2)
+            if n > self.max_payload:
+                # longueur impossible : fausse synchro, sinon on attendrait des octets qui ne viendront pas
+                self.st["bad_crc"] += 1
+                del self.buf[:2]
+                continue
+            if len(self.buf) < 10 + n:
+                return None
+            (crc,) = struct.unpack_from("<I", self.buf, 6 + n)
+            if crc != zlib.crc32(self.buf[2:6 + n]):
+                # fausse synchro ou trame abîmée : on repart après ce A5 5A
+                self.st["bad_crc"] += 1
+                del self.buf[:2]
+                continue
+            payload = bytes(self.buf[6:6 + n])
+            del self.buf[:10 + n]
+            return kind, payload
+
+
+class Offload:
+    def __init__(self, link, ack_s=0.25):
+        self.link = link
+        self.window, self.frame = 8, 2048
+        self.ack_s = ack_s
+
+    def hello(self, wait):
+        t_end = time.monotonic() + wait
+        while time.monotonic() < t_end:
+            self.link.send(HELLO)
+            f = self.link.recv(0.2)
+            while f and f[0] != HELLO:
+                f = self.link.recv(0.05)
+            if f:
+                ver, self.window, self.frame = struct.unpack_from("<BBH", f[1])
+                self.link.max_payload = self.frame + 4
+                return ver, self.window, self.frame
+        raise TimeoutError("no HELLO from device")
+
+    def fetch(self, kind, dive, offset, out):
+        """Reçoit [offset, size) dans out (fichier ou bytearray). @return (size, octets reçus)"""
+        def request():
+            # le CRC de END couvre [offset de la requête, size) : on repart de zéro
+            nonlocal crc
+            crc = 0
+            p = struct.pack("<I", received)
+            if kind == LIST:
+                p += struct.pack("<H", PAGE)   # dive = id après lequel commence la page
+            self.link.send(kind, p + dive.encode())
+
+        received = offset
+        crc = 0
+        since_ack = 0
+        last = False
+        nak_at, nak_t, dup_t = None, 0.0, 0.0
+        t_progress = time.monotonic()
+        request()
+        while True:
+            f = self.link.recv(self.ack_s)
+            now = time.monotonic()
+            if f is None:
+                if now - t_progress > 20 * self.ack_s:
+                    raise TimeoutError(f"{dive or 'catalog'}: stalled at {received}")
+                if now - t_progress > 8 * self.ack_s or (last and now - t_progress > self.ack_s):
+                    # appareil reparti en attente de commande (END perdu après la
+                    # dernière trame, ou requête perdue) : on relance à l'offset reçu
+                    request()
+                    t_progress = now
+                else:
+                    self.link.send(ACK, struct.pack("<I", received))   # état courant
+                continue
+            kind_in, p = f
+            if kind_in == DATA:
+                (off,) = struct.unpack_from("<I", p)
+                data = p[4:]
+                if off == received:
+                    out.write(data) if hasattr(out, "write") else out.extend(data)
+                    crc = zlib.crc32(data, crc)
+                    received += len(data)
+                    t_progress = now
+                    since_ack += 1
+                    # une demi-fenêtre, ou une trame courte : la dernière, l'appareil attend
+                    last = len(data) < self.frame
+                    if since_ack >= max(1, self.window // 2) or last:
+                        self.link.send(ACK, struct.pack("<I", received))
+                        since_ack = 0
+                elif off > received:
+                    # trou : un NAK par trou, répété seulement si rien ne bouge
+                    if nak_at != received or now - nak_t > 2 * self.ack_s:
+                        self.link.send(NAK, struct.pack("<I", received))
+                        self.link.st["naks"] += 1
+                        nak_at, nak_t = received, now
+                else:
+                    # réémission : notre ACK s'est perdu ou est en retard, on le redonne
+                    self.link.st["dups"] += 1
+                    if now - dup_t > self.ack_s:
+                        self.link.send(ACK, struct.pack("<I", received))
+                        dup_t = now
+            elif kind_in == END:
+                size, dev_crc = struct.unpack_from("<II", p)
+                if size != received:
+                    raise IOError(f"{dive or 'catalog'}: END at {size}, have {received}")
+                if dev_crc != crc:
+                    raise IOError(f"{dive or 'catalog'}: CRC {crc:08x} != device {dev_crc:08x}")
+                return size, received - offset
+            elif kind_in == ERR:
+                raise IOError(f"{dive or 'catalog'}: device error {p[0]} {p[1:].decode(errors='replace')}")
+
+    def mark(self, dive, size):
+        """Plongée reçue en entier : curseur de synchro à la fin. @return échantillons"""
+        for _ in range(8):
+            self.link.send(MARK, struct.pack("<I", size) + dive.encode())
+            f = self.link.recv(4 * self.ack_s)
+            while f and f[0] not in (END, ERR):
+                f = self.link.recv(self.ack_s)     # ACK/DATA en retard du GET précédent
+            if f and f[0] == END:
+                return struct.unpack_from("<II", f[1])[1]
+            if f:
+                raise IOError(f"{dive}: mark refused {f[1][0]} {f[1][1:].decode(errors='replace')}")
+        raise TimeoutError(f"{dive}: no answer to MARK")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("tty", help="ex. /dev/ttyACM0, ou l'esclave pty du build hôte")
+    ap.add_argument("--out", default="dives", help="répertoire des <id>.csv reçus")
+    ap.add_argument("--wait", type=float, default=10, help="attente du HELLO (s)")
+    ap.add_argument("--loss", type=float, default=0, help="proba. de perdre une trame reçue")
+    ap.add_argument("--corrupt", type=float, default=0, help="proba. d'abîmer un bloc lu")
+    ap.add_argument("--min-kbps", type=float, default=0, help="débit minimal attendu (KiB/s)")
+    ap.add_argument("--stay", action="store_true", help="pas de BYE (l'appareil attend l'inactivité)")
+    ap.add_argument("--metrics", action="store_true", help="affiche les métriques et s'arrête")
+    ap.add_argument("--no-mark", action="store_true",
+                    help="copie seule : les plongées restent à synchroniser par le Wi-Fi")
+    args = ap.parse_args()
+
+    link = Link(args.tty, args.loss, args.corrupt)
+    off = Offload(link)
+    ver, window, frame = off.hello(args.wait)
+    print(f"device: protocol {ver}, window {window} x {frame} bytes")
+    if ver != PROTOCOL:
+        sys.exit(f"protocol {ver} not supported (want {PROTOCOL})")
+
+    if args.metrics:
+        snap = bytearray()
+        off.fetch(METRICS, "", 0, snap)
+        for name, v in sorted(json.loads(snap).items()):
+            if isinstance(v, dict):
+                n = v.get("count", 0)
+                print(f"{name}: n={n} avg={v.get('sum', 0) // n if n else 0} max={v.get('max', 0)}")
+            else:
+                print(f"{name} = {v}")
+        if not args.stay:
+            link.send(BYE)
+        return
+
+    # catalogue par pages : la suivante part du dernier id reçu, vide à la fin
+    catalog = []
+    while True:
+        cat = bytearray()
+        off.fetch(LIST, catalog[-1]["id"] if catalog else "", 0, cat)
+        page = json.loads(cat)
+        if not page:
+            break
+        catalog += page
+    print(f"{len(catalog)} dives, {sum(d.get('bytes', 0) for d in catalog)} bytes announced")
+
+    os.makedirs(args.out, exist_ok=True)
+    total, t_total, errors, marked = 0, 0.0, 0, 0
+    for d in catalog:
+        dive = d["id"]
+        dst = os.path.join(args.out, f"{dive}.csv")
+        part = dst + ".part"
+        if os.path.exists(dst) and os.path.getsize(dst) == d.get("bytes"):
+            print(f"{dive}: up to date")
+        else:
+            start = os.path.getsize(part) if os.path.exists(part) else 0
+            t0 = time.perf_counter()
+            try:
+                with open(part, "ab") as f:
+                    size, got = off.fetch(GET, dive, start, f)
+            except (IOError, TimeoutError) as e:
+                print(e)
+                errors += 1
+                continue
+            dt = time.perf_counter() - t0
+            os.replace(part, dst)
+            total += got
+            t_total += dt
+            print(f"{dive}: {got} bytes from {start} in {dt * 1000:.0f} ms"
+                  f" ({got / dt / 1024 if dt else 0:.0f} KiB/s)")
+
+        # plongée en cours : la suite viendra, elle reste à synchroniser
+        if args.no_mark or d.get("synced") or "summary" not in d:
+            continue
+        try:
+            n = off.mark(dive, os.path.getsize(dst))
+            marked += 1
+            print(f"{dive}: marked synced ({n} samples)")
+        except (IOError, TimeoutError) as e:
+            print(e)
+            errors += 1
+
+    if not args.stay:
+        link.send(BYE)
+    kbps = total / t_total / 1024 if t_total else 0
+    print(f"total {total} bytes in {t_total * 1000:.0f} ms ({kbps:.0f} KiB/s)"
+          f" | bad crc {link.st['bad_crc']} skipped {link.st['skipped']} lost {link.st['lost']}"
+          f" naks {link.st['naks']} dups {link.st['dups']} | marked {marked}")
+    if args.min_kbps and total and kbps < args.min_kbps:
+        print(f"below target: {kbps:.0f} < {args.min_kbps:.0f} KiB/s")
+        errors += 1
+    sys.exit(1 if errors else 0)
+
+
+if __name__ == "__main__":
+    main()